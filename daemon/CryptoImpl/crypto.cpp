@@ -11,8 +11,10 @@
 #include "logging_p.h"
 
 #include "Crypto/serialization_p.h"
+#include "Crypto/payloadtransfer_p.h"
 #include "Crypto/cryptodaemonconnection_p.h"
 
+#include "Crypto/batchrequest.h"
 #include "Crypto/key.h"
 #include "Crypto/result.h"
 #include "Crypto/cryptomanager.h"
@@ -54,6 +56,37 @@ namespace {
             const QString &pluginName) {
         return controller->mappedPluginName(pluginName);
     }
+
+    Sailfish::Crypto::Result readInputPayload(
+            const QDBusUnixFileDescriptor &fd,
+            QByteArray *data) {
+        if (!Sailfish::Crypto::PayloadTransfer::readFileDescriptor(fd, data)) {
+            return Sailfish::Crypto::Result(Sailfish::Crypto::Result::EmptyDataError,
+                                            QLatin1String("Unable to read the data from the given file descriptor, or it exceeds the maximum payload size"));
+        }
+        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::Succeeded);
+    }
+
+    // If the client gave a file descriptor for the output (see encryptFd()
+    // and decryptFd()) it will be the last remaining in-parameter of the
+    // request, and the output is written to it rather than being returned
+    // inline in the reply.
+    QByteArray transferOutputPayload(
+            Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request,
+            const QByteArray &output,
+            Sailfish::Crypto::Result *result) {
+        if (request->inParams.isEmpty()
+                || request->inParams.last().userType() != qMetaTypeId<QDBusUnixFileDescriptor>()) {
+            return output;
+        }
+        const QDBusUnixFileDescriptor fd = request->inParams.takeLast().value<QDBusUnixFileDescriptor>();
+        if (result->code() == Sailfish::Crypto::Result::Succeeded
+                && !Sailfish::Crypto::PayloadTransfer::writeFileDescriptor(fd, output)) {
+            *result = Sailfish::Crypto::Result(Sailfish::Crypto::Result::DaemonError,
+                                               QLatin1String("Unable to write the output to the given file descriptor"));
+        }
+        return QByteArray();
+    }
 }
 
 using namespace Sailfish::Crypto;
@@ -378,6 +411,40 @@ void Daemon::ApiImpl::CryptoDBusObject::verify(
                                   result);
 }
 
+void Daemon::ApiImpl::CryptoDBusObject::batch(
+        const QVector<int> &operations,
+        const QVector<QByteArray> &data,
+        const QVector<QByteArray> &signatures,
+        const Key &key,
+        CryptoManager::SignaturePadding padding,
+        CryptoManager::DigestFunction digest,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        const QDBusMessage &message,
+        Result &result,
+        QVector<Result> &results,
+        QVector<QByteArray> &outputs,
+        QVector<int> &verificationStatuses)
+{
+    Q_UNUSED(results);               // outparam, set in handlePendingRequest / handleFinishedRequest
+    Q_UNUSED(outputs);               // outparam, set in handlePendingRequest / handleFinishedRequest
+    Q_UNUSED(verificationStatuses);  // outparam, set in handlePendingRequest / handleFinishedRequest
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QVector<int> >(operations);
+    inParams << QVariant::fromValue<QVector<QByteArray> >(data);
+    inParams << QVariant::fromValue<QVector<QByteArray> >(signatures);
+    inParams << QVariant::fromValue<Key>(MAP_PLUGIN_NAMES(key));
+    inParams << QVariant::fromValue<CryptoManager::SignaturePadding>(padding);
+    inParams << QVariant::fromValue<CryptoManager::DigestFunction>(digest);
+    inParams << QVariant::fromValue<QVariantMap>(customParameters);
+    inParams << QVariant::fromValue<QString>(MAP_PLUGIN_NAMES(cryptosystemProviderName));
+    m_requestQueue->handleRequest(Daemon::ApiImpl::BatchOperationsRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
 void Daemon::ApiImpl::CryptoDBusObject::encrypt(
         const QByteArray &data,
         const QByteArray &iv,
@@ -448,6 +515,149 @@ void Daemon::ApiImpl::CryptoDBusObject::decrypt(
                                   result);
 }
 
+void Daemon::ApiImpl::CryptoDBusObject::calculateDigestFd(
+        const QDBusUnixFileDescriptor &data,
+        CryptoManager::SignaturePadding padding,
+        CryptoManager::DigestFunction digestFunction,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        const QDBusMessage &message,
+        Result &result,
+        QByteArray &digest)
+{
+    QByteArray payload;
+    result = readInputPayload(data, &payload);
+    if (result.code() == Result::Succeeded) {
+        calculateDigest(payload, padding, digestFunction, customParameters,
+                        cryptosystemProviderName, message, result, digest);
+    }
+}
+
+void Daemon::ApiImpl::CryptoDBusObject::signFd(
+        const QDBusUnixFileDescriptor &data,
+        const Key &key,
+        CryptoManager::SignaturePadding padding,
+        CryptoManager::DigestFunction digest,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        const QDBusMessage &message,
+        Result &result,
+        QByteArray &signature)
+{
+    QByteArray payload;
+    result = readInputPayload(data, &payload);
+    if (result.code() == Result::Succeeded) {
+        sign(payload, key, padding, digest, customParameters,
+             cryptosystemProviderName, message, result, signature);
+    }
+}
+
+void Daemon::ApiImpl::CryptoDBusObject::verifyFd(
+        const QByteArray &signature,
+        const QDBusUnixFileDescriptor &data,
+        const Key &key,
+        CryptoManager::SignaturePadding padding,
+        CryptoManager::DigestFunction digest,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        const QDBusMessage &message,
+        Result &result,
+        CryptoManager::VerificationStatus &verificationStatus)
+{
+    QByteArray payload;
+    result = readInputPayload(data, &payload);
+    if (result.code() == Result::Succeeded) {
+        verify(signature, payload, key, padding, digest, customParameters,
+               cryptosystemProviderName, message, result, verificationStatus);
+    }
+}
+
+void Daemon::ApiImpl::CryptoDBusObject::encryptFd(
+        const QDBusUnixFileDescriptor &data,
+        const QDBusUnixFileDescriptor &output,
+        const QByteArray &iv,
+        const Key &key,
+        CryptoManager::BlockMode blockMode,
+        CryptoManager::EncryptionPadding padding,
+        const QByteArray &authenticationData,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        const QDBusMessage &message,
+        Result &result,
+        QByteArray &encrypted,
+        QByteArray &authenticationTag)
+{
+    // outparams, set in handlePendingRequest / handleFinishedRequest
+    Q_UNUSED(encrypted);
+    Q_UNUSED(authenticationTag);
+
+    QByteArray payload;
+    result = readInputPayload(data, &payload);
+    if (result.code() != Result::Succeeded) {
+        return;
+    }
+
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QByteArray>(payload);
+    inParams << QVariant::fromValue<QByteArray>(iv);
+    inParams << QVariant::fromValue<Key>(MAP_PLUGIN_NAMES(key));
+    inParams << QVariant::fromValue<CryptoManager::BlockMode>(blockMode);
+    inParams << QVariant::fromValue<CryptoManager::EncryptionPadding>(padding);
+    inParams << QVariant::fromValue<QByteArray>(authenticationData);
+    inParams << QVariant::fromValue<QVariantMap>(customParameters);
+    inParams << QVariant::fromValue<QString>(MAP_PLUGIN_NAMES(cryptosystemProviderName));
+    inParams << QVariant::fromValue<QDBusUnixFileDescriptor>(output);
+    m_requestQueue->handleRequest(Daemon::ApiImpl::EncryptRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
+void Daemon::ApiImpl::CryptoDBusObject::decryptFd(
+        const QDBusUnixFileDescriptor &data,
+        const QDBusUnixFileDescriptor &output,
+        const QByteArray &iv,
+        const Key &key,
+        CryptoManager::BlockMode blockMode,
+        CryptoManager::EncryptionPadding padding,
+        const QByteArray &authenticationData,
+        const QByteArray &authenticationTag,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        const QDBusMessage &message,
+        Result &result,
+        QByteArray &decrypted,
+        CryptoManager::VerificationStatus &verificationStatus)
+{
+    // outparam, set in handlePendingRequest / handleFinishedRequest
+    Q_UNUSED(decrypted);
+    Q_UNUSED(verificationStatus);
+
+    QByteArray payload;
+    result = readInputPayload(data, &payload);
+    if (result.code() != Result::Succeeded) {
+        return;
+    }
+
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QByteArray>(payload);
+    inParams << QVariant::fromValue<QByteArray>(iv);
+    inParams << QVariant::fromValue<Key>(MAP_PLUGIN_NAMES(key));
+    inParams << QVariant::fromValue<CryptoManager::BlockMode>(blockMode);
+    inParams << QVariant::fromValue<CryptoManager::EncryptionPadding>(padding);
+    inParams << QVariant::fromValue<QByteArray>(authenticationData);
+    inParams << QVariant::fromValue<QByteArray>(authenticationTag);
+    inParams << QVariant::fromValue<QVariantMap>(customParameters);
+    inParams << QVariant::fromValue<QString>(MAP_PLUGIN_NAMES(cryptosystemProviderName));
+    inParams << QVariant::fromValue<QDBusUnixFileDescriptor>(output);
+    m_requestQueue->handleRequest(Daemon::ApiImpl::DecryptRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
 void Daemon::ApiImpl::CryptoDBusObject::initializeCipherSession(
         const QByteArray &initializationVector,
         const Sailfish::Crypto::Key &key,
@@ -546,6 +756,34 @@ void Daemon::ApiImpl::CryptoDBusObject::finalizeCipherSession(
                                   result);
 }
 
+void Daemon::ApiImpl::CryptoDBusObject::streamCipherSession(
+        const QDBusUnixFileDescriptor &input,
+        const QDBusUnixFileDescriptor &output,
+        const QByteArray &data,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        quint32 cipherSessionToken,
+        const QDBusMessage &message,
+        Sailfish::Crypto::Result &result,
+        QByteArray &generatedData,
+        CryptoManager::VerificationStatus &verificationStatus)
+{
+    Q_UNUSED(generatedData);  // outparam, set in handlePendingRequest / handleFinishedRequest
+    Q_UNUSED(verificationStatus);       // outparam, set in handlePendingRequest / handleFinishedRequest
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QDBusUnixFileDescriptor>(input);
+    inParams << QVariant::fromValue<QDBusUnixFileDescriptor>(output);
+    inParams << QVariant::fromValue<QByteArray>(data);
+    inParams << QVariant::fromValue<QVariantMap>(customParameters);
+    inParams << QVariant::fromValue<QString>(MAP_PLUGIN_NAMES(cryptosystemProviderName));
+    inParams << QVariant::fromValue<quint32>(cipherSessionToken);
+    m_requestQueue->handleRequest(Daemon::ApiImpl::StreamCipherSessionRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
 void Daemon::ApiImpl::CryptoDBusObject::queryLockStatus(
         LockCodeRequest::LockCodeTargetType lockCodeTargetType,
         const QString &lockCodeTarget,
@@ -634,9 +872,6 @@ Daemon::ApiImpl::CryptoRequestQueue::CryptoRequestQueue(
 {
     CryptoDaemonConnection::registerDBusTypes();
 
-    m_cryptoThreadPool = QSharedPointer<QThreadPool>::create();
-    m_cryptoThreadPool->setMaxThreadCount(1);
-    m_cryptoThreadPool->setExpiryTimeout(-1);
     m_requestProcessor = new Daemon::ApiImpl::RequestProcessor(secrets, autotestMode, this);
 
     setDBusObject(new Daemon::ApiImpl::CryptoDBusObject(this));
@@ -653,11 +888,6 @@ Daemon::ApiImpl::CryptoRequestQueue::controller()
     return m_controller;
 }
 
-QWeakPointer<QThreadPool> Daemon::ApiImpl::CryptoRequestQueue::cryptoThreadPool()
-{
-    return m_cryptoThreadPool.toWeakRef();
-}
-
 QMap<QString, Sailfish::Crypto::CryptoPlugin*>
 Daemon::ApiImpl::CryptoRequestQueue::plugins() const
 {
@@ -719,16 +949,38 @@ QString Daemon::ApiImpl::CryptoRequestQueue::requestTypeToString(int type) const
         case ModifyLockCodeRequest:            return QLatin1String("ModifyLockCodeRequest");
         case ProvideLockCodeRequest:           return QLatin1String("ProvideLockCodeRequest");
         case ForgetLockCodeRequest:            return QLatin1String("ForgetLockCodeRequest");
+        case BatchOperationsRequest:           return QLatin1String("BatchOperationsRequest");
+        case StreamCipherSessionRequest:       return QLatin1String("StreamCipherSessionRequest");
         default: break;
     }
     return QLatin1String("Unknown Crypto Request!");
 }
 
+bool Daemon::ApiImpl::CryptoRequestQueue::isBulkRequest(int type) const
+{
+    // Key generation and import (which may involve key derivation)
+    // can be expensive, as can batches of many operations or whole
+    // cipher streams, so these should not delay interactive requests.
+    switch (type) {
+        case GenerateKeyRequest:                // fall through
+        case GenerateStoredKeyRequest:          // fall through
+        case ImportKeyRequest:                  // fall through
+        case ImportStoredKeyRequest:            // fall through
+        case BatchOperationsRequest:            // fall through
+        case StreamCipherSessionRequest:        return true;
+        default: break;
+    }
+    return false;
+}
+
 void Daemon::ApiImpl::CryptoRequestQueue::handleCancelation(
         Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request)
 {
-    Q_UNUSED(request);
-    // Only UserInput from Secrets is currently cancellable.
+    // Only UserInput from Secrets, and cipher session streams
+    // (which wait for the client), are currently cancellable.
+    if (request->type == StreamCipherSessionRequest) {
+        m_requestProcessor->abortCipherSessionStream(request->requestId);
+    }
 }
 
 void Daemon::ApiImpl::CryptoRequestQueue::handlePendingRequest(
@@ -1189,6 +1441,7 @@ void Daemon::ApiImpl::CryptoRequestQueue::handlePendingRequest(
                 // waiting for asynchronous flow to complete
                 *completed = false;
             } else {
+                encrypted = transferOutputPayload(request, encrypted, &result);
                 request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
                                                                         << QVariant::fromValue<QByteArray>(encrypted)
                                                                         << QVariant::fromValue<QByteArray>(authenticationTag));
@@ -1228,6 +1481,7 @@ void Daemon::ApiImpl::CryptoRequestQueue::handlePendingRequest(
                 // waiting for asynchronous flow to complete
                 *completed = false;
             } else {
+                decrypted = transferOutputPayload(request, decrypted, &result);
                 request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
                                                                         << QVariant::fromValue<QByteArray>(decrypted)
                                                                         << QVariant::fromValue<int>(verificationStatus));
@@ -1349,6 +1603,39 @@ void Daemon::ApiImpl::CryptoRequestQueue::handlePendingRequest(
             }
             break;
         }
+        case StreamCipherSessionRequest: {
+            qCDebug(lcSailfishCryptoDaemon) << "Handling StreamCipherSessionRequest from client:" << request->remotePid << ", request number:" << request->requestId;
+            QByteArray generatedData;
+            CryptoManager::VerificationStatus verificationStatus = CryptoManager::VerificationStatusUnknown;
+            QDBusUnixFileDescriptor input = request->inParams.size() ? request->inParams.takeFirst().value<QDBusUnixFileDescriptor>() : QDBusUnixFileDescriptor();
+            QDBusUnixFileDescriptor output = request->inParams.size() ? request->inParams.takeFirst().value<QDBusUnixFileDescriptor>() : QDBusUnixFileDescriptor();
+            QByteArray data = request->inParams.size() ? request->inParams.takeFirst().value<QByteArray>() : QByteArray();
+            QVariantMap customParameters = request->inParams.size() ? request->inParams.takeFirst().value<QVariantMap>() : QVariantMap();
+            QString cryptosystemProviderName = request->inParams.size() ? request->inParams.takeFirst().value<QString>() : QString();
+            quint32 cipherSessionToken = request->inParams.size() ? request->inParams.takeFirst().value<quint32>() : 0;
+            Result result = m_requestProcessor->streamCipherSession(
+                        request->remotePid,
+                        request->requestId,
+                        input,
+                        output,
+                        data,
+                        customParameters,
+                        cryptosystemProviderName,
+                        cipherSessionToken,
+                        &generatedData,
+                        &verificationStatus);
+            // send the reply to the calling peer.
+            if (result.code() == Result::Pending) {
+                // waiting for asynchronous flow to complete
+                *completed = false;
+            } else {
+                request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
+                                                                        << QVariant::fromValue<QByteArray>(generatedData)
+                                                                        << QVariant::fromValue<int>(verificationStatus));
+                *completed = true;
+            }
+            break;
+        }
         case QueryLockStatusRequest: {
             qCDebug(lcSailfishCryptoDaemon) << "Handling QueryLockStatusRequest from client:" << request->remotePid << ", request number:" << request->requestId;
             LockCodeRequest::LockCodeTargetType lockCodeTargetType = request->inParams.size()
@@ -1456,6 +1743,11 @@ void Daemon::ApiImpl::CryptoRequestQueue::handlePendingRequest(
             }
             break;
         }
+        case BatchOperationsRequest: {
+            qCDebug(lcSailfishCryptoDaemon) << "Handling BatchOperationsRequest from client:" << request->remotePid << ", request number:" << request->requestId;
+            handleBatchRequest(request, false, completed);
+            break;
+        }
         default: {
             qCWarning(lcSailfishCryptoDaemon) << "Cannot handle request:" << request->requestId
                                               << "with invalid type:" << requestTypeToString(request->type);
@@ -1745,6 +2037,7 @@ void Daemon::ApiImpl::CryptoRequestQueue::handleFinishedRequest(
                 QByteArray authenticationTag = request->outParams.size()
                         ? request->outParams.takeFirst().toByteArray()
                         : QByteArray();
+                encrypted = transferOutputPayload(request, encrypted, &result);
                 request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
                                                                         << QVariant::fromValue<QByteArray>(encrypted)
                                                                         << QVariant::fromValue<QByteArray>(authenticationTag));
@@ -1768,6 +2061,7 @@ void Daemon::ApiImpl::CryptoRequestQueue::handleFinishedRequest(
                 CryptoManager::VerificationStatus verificationStatus = request->outParams.size()
                         ? request->outParams.takeFirst().value<CryptoManager::VerificationStatus>()
                         : CryptoManager::VerificationStatusUnknown;
+                decrypted = transferOutputPayload(request, decrypted, &result);
                 request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
                                                                         << QVariant::fromValue<QByteArray>(decrypted)
                                                                         << QVariant::fromValue<CryptoManager::VerificationStatus>(verificationStatus));
@@ -1855,6 +2149,29 @@ void Daemon::ApiImpl::CryptoRequestQueue::handleFinishedRequest(
             }
             break;
         }
+        case StreamCipherSessionRequest: {
+            Result result = request->outParams.size()
+                    ? request->outParams.takeFirst().value<Result>()
+                    : Result(Result::UnknownError,
+                             QLatin1String("Unable to determine result of StreamCipherSessionRequest request"));
+            if (result.code() == Result::Pending) {
+                // shouldn't happen!
+                qCWarning(lcSailfishCryptoDaemon) << "StreamCipherSessionRequest:" << request->requestId << "finished as pending!";
+                *completed = true;
+            } else {
+                QByteArray generatedData = request->outParams.size()
+                        ? request->outParams.takeFirst().toByteArray()
+                        : QByteArray();
+                CryptoManager::VerificationStatus verificationStatus = request->outParams.size()
+                        ? request->outParams.takeFirst().value<CryptoManager::VerificationStatus>()
+                        : CryptoManager::VerificationStatusUnknown;
+                request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
+                                                                        << QVariant::fromValue<QByteArray>(generatedData)
+                                                                        << QVariant::fromValue<CryptoManager::VerificationStatus>(verificationStatus));
+                *completed = true;
+            }
+            break;
+        }
         case QueryLockStatusRequest: {
             Result result = request->outParams.size()
                     ? request->outParams.takeFirst().value<Result>()
@@ -1918,6 +2235,10 @@ void Daemon::ApiImpl::CryptoRequestQueue::handleFinishedRequest(
             }
             break;
         }
+        case BatchOperationsRequest: {
+            handleBatchRequest(request, true, completed);
+            break;
+        }
         default: {
             qCWarning(lcSailfishCryptoDaemon) << "Cannot handle synchronous request:" << request->requestId << "with type:" << requestTypeToString(request->type) << "in an asynchronous fashion";
             *completed = false;
@@ -1925,3 +2246,168 @@ void Daemon::ApiImpl::CryptoRequestQueue::handleFinishedRequest(
         }
     }
 }
+
+void Daemon::ApiImpl::CryptoRequestQueue::handleBatchRequest(
+        Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request,
+        bool operationFinished,
+        bool *completed)
+{
+    // The operations of the batch are performed one after another,
+    // all as part of the single queued request.  The progress of the
+    // batch is kept in the inParams of the request, so that it can be
+    // resumed each time an asynchronous operation finishes:
+    // operations, data, signatures, key, padding, digest, customParameters,
+    // cryptosystemProviderName, and then the results, outputs and
+    // verification statuses of completed operations.
+    const QVector<int> operations = request->inParams.value(0).value<QVector<int> >();
+    const QVector<QByteArray> data = request->inParams.value(1).value<QVector<QByteArray> >();
+    const QVector<QByteArray> signatures = request->inParams.value(2).value<QVector<QByteArray> >();
+    const Key key = request->inParams.value(3).value<Key>();
+    const CryptoManager::SignaturePadding padding = request->inParams.size() > 4
+            ? request->inParams.at(4).value<CryptoManager::SignaturePadding>()
+            : CryptoManager::SignaturePaddingUnknown;
+    const CryptoManager::DigestFunction digest = request->inParams.size() > 5
+            ? request->inParams.at(5).value<CryptoManager::DigestFunction>()
+            : CryptoManager::DigestUnknown;
+    const QVariantMap customParameters = request->inParams.value(6).value<QVariantMap>();
+    const QString cryptosystemProviderName = request->inParams.value(7).value<QString>();
+    QVector<Result> results = request->inParams.value(8).value<QVector<Result> >();
+    QVector<QByteArray> outputs = request->inParams.value(9).value<QVector<QByteArray> >();
+    QVector<int> verificationStatuses = request->inParams.value(10).value<QVector<int> >();
+
+    if (operations.size() != data.size() || operations.size() != signatures.size()) {
+        Result result(Result::EmptyDataError,
+                      QLatin1String("Each operation in the batch must have data and a signature"));
+        request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
+                                                                << QVariant::fromValue<QVector<Result> >(QVector<Result>())
+                                                                << QVariant::fromValue<QVector<QByteArray> >(QVector<QByteArray>())
+                                                                << QVariant::fromValue<QVector<int> >(QVector<int>()));
+        *completed = true;
+        return;
+    }
+
+    if (operationFinished) {
+        // the previous operation of the batch has finished asynchronously.
+        Result result = request->outParams.size()
+                ? request->outParams.takeFirst().value<Result>()
+                : Result(Result::UnknownError,
+                         QLatin1String("Unable to determine result of BatchOperationsRequest operation"));
+        QByteArray output;
+        int verificationStatus = CryptoManager::VerificationStatusUnknown;
+        if (request->outParams.size()) {
+            if (operations.at(results.size()) == Sailfish::Crypto::BatchRequest::VerifyOperation) {
+                verificationStatus = request->outParams.takeFirst().value<CryptoManager::VerificationStatus>();
+            } else {
+                output = request->outParams.takeFirst().toByteArray();
+            }
+        }
+        results.append(result);
+        outputs.append(output);
+        verificationStatuses.append(verificationStatus);
+    }
+
+    while (results.size() < operations.size()) {
+        const int index = results.size();
+        QByteArray output;
+        int verificationStatus = CryptoManager::VerificationStatusUnknown;
+        Result result = performBatchOperation(request,
+                                              operations.at(index),
+                                              data.at(index),
+                                              signatures.at(index),
+                                              key,
+                                              padding,
+                                              digest,
+                                              customParameters,
+                                              cryptosystemProviderName,
+                                              &output,
+                                              &verificationStatus);
+        if (result.code() == Result::Pending) {
+            // waiting for asynchronous flow to complete
+            request->inParams = QList<QVariant>()
+                    << QVariant::fromValue<QVector<int> >(operations)
+                    << QVariant::fromValue<QVector<QByteArray> >(data)
+                    << QVariant::fromValue<QVector<QByteArray> >(signatures)
+                    << QVariant::fromValue<Key>(key)
+                    << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
+                    << QVariant::fromValue<CryptoManager::DigestFunction>(digest)
+                    << QVariant::fromValue<QVariantMap>(customParameters)
+                    << QVariant::fromValue<QString>(cryptosystemProviderName)
+                    << QVariant::fromValue<QVector<Result> >(results)
+                    << QVariant::fromValue<QVector<QByteArray> >(outputs)
+                    << QVariant::fromValue<QVector<int> >(verificationStatuses);
+            setRequestInProgress(request, true);
+            *completed = false;
+            return;
+        }
+        results.append(result);
+        outputs.append(output);
+        verificationStatuses.append(verificationStatus);
+    }
+
+    // send the reply to the calling peer.
+    request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(Result(Result::Succeeded))
+                                                            << QVariant::fromValue<QVector<Result> >(results)
+                                                            << QVariant::fromValue<QVector<QByteArray> >(outputs)
+                                                            << QVariant::fromValue<QVector<int> >(verificationStatuses));
+    *completed = true;
+}
+
+Result Daemon::ApiImpl::CryptoRequestQueue::performBatchOperation(
+        Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request,
+        int operation,
+        const QByteArray &data,
+        const QByteArray &signature,
+        const Key &key,
+        CryptoManager::SignaturePadding padding,
+        CryptoManager::DigestFunction digestFunction,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        QByteArray *output,
+        int *verificationStatus)
+{
+    switch (operation) {
+        case Sailfish::Crypto::BatchRequest::SignOperation: {
+            return m_requestProcessor->sign(
+                        request->remotePid,
+                        request->requestId,
+                        data,
+                        key,
+                        padding,
+                        digestFunction,
+                        customParameters,
+                        cryptosystemProviderName,
+                        output);
+        }
+        case Sailfish::Crypto::BatchRequest::VerifyOperation: {
+            CryptoManager::VerificationStatus status = CryptoManager::VerificationStatusUnknown;
+            Result result = m_requestProcessor->verify(
+                        request->remotePid,
+                        request->requestId,
+                        signature,
+                        data,
+                        key,
+                        padding,
+                        digestFunction,
+                        customParameters,
+                        cryptosystemProviderName,
+                        &status);
+            *verificationStatus = status;
+            return result;
+        }
+        case Sailfish::Crypto::BatchRequest::CalculateDigestOperation: {
+            return m_requestProcessor->calculateDigest(
+                        request->remotePid,
+                        request->requestId,
+                        data,
+                        padding,
+                        digestFunction,
+                        customParameters,
+                        cryptosystemProviderName,
+                        output);
+        }
+        default: break;
+    }
+
+    return Result(Result::OperationNotSupportedError,
+                  QLatin1String("Unknown batch operation type"));
+}
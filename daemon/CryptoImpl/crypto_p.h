@@ -28,6 +28,7 @@
 #include <QtCore/QThreadPool>
 #include <QtCore/QSharedPointer>
 #include <QtDBus/QDBusContext>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 namespace Sailfish {
 
@@ -208,6 +209,30 @@ class CryptoDBusObject : public Secrets::Daemon::ApiImpl::DBusObject
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Crypto::CryptoManager::VerificationStatus\" />\n"
     "      </method>\n"
+    "      <method name=\"batch\">\n"
+    "          <arg name=\"operations\" type=\"ai\" direction=\"in\" />\n"
+    "          <arg name=\"data\" type=\"aay\" direction=\"in\" />\n"
+    "          <arg name=\"signatures\" type=\"aay\" direction=\"in\" />\n"
+    "          <arg name=\"key\" type=\"((sss)iiiiiayayayaay(a{sv}))\" direction=\"in\" />\n"
+    "          <arg name=\"padding\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"digest\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"results\" type=\"a(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"outputs\" type=\"aay\" direction=\"out\" />\n"
+    "          <arg name=\"verificationStatuses\" type=\"ai\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In0\" value=\"QVector<int>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In1\" value=\"QVector<QByteArray>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In2\" value=\"QVector<QByteArray>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In3\" value=\"Sailfish::Crypto::Key\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In4\" value=\"Sailfish::Crypto::CryptoManager::SignaturePadding\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In5\" value=\"Sailfish::Crypto::CryptoManager::Digest\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"QVector<Sailfish::Crypto::Result>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out2\" value=\"QVector<QByteArray>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out3\" value=\"QVector<int>\" />\n"
+    "      </method>\n"
     "      <method name=\"encrypt\">\n"
     "          <arg name=\"data\" type=\"ay\" direction=\"in\" />\n"
     "          <arg name=\"iv\" type=\"ay\" direction=\"in\" />\n"
@@ -244,6 +269,86 @@ class CryptoDBusObject : public Secrets::Daemon::ApiImpl::DBusObject
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Crypto::CryptoManager::VerificationStatus\" />\n"
     "      </method>\n"
+    "      <method name=\"calculateDigestFd\">\n"
+    "          <arg name=\"data\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"padding\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"digestFunction\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"digest\" type=\"ay\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In1\" value=\"Sailfish::Crypto::CryptoManager::SignaturePadding\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In2\" value=\"Sailfish::Crypto::CryptoManager::Digest\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "      </method>\n"
+    "      <method name=\"signFd\">\n"
+    "          <arg name=\"data\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"key\" type=\"((sss)iiiiiayayayaay(a{sv}))\" direction=\"in\" />\n"
+    "          <arg name=\"padding\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"digest\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"signature\" type=\"ay\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In1\" value=\"Sailfish::Crypto::Key\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In2\" value=\"Sailfish::Crypto::CryptoManager::SignaturePadding\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In3\" value=\"Sailfish::Crypto::CryptoManager::Digest\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "      </method>\n"
+    "      <method name=\"verifyFd\">\n"
+    "          <arg name=\"signature\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"data\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"key\" type=\"((sss)iiiiiayayayaay(a{sv}))\" direction=\"in\" />\n"
+    "          <arg name=\"padding\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"digest\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"verificationStatus\" type=\"(i)\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In2\" value=\"Sailfish::Crypto::Key\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In3\" value=\"Sailfish::Crypto::CryptoManager::SignaturePadding\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In4\" value=\"Sailfish::Crypto::CryptoManager::Digest\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Crypto::CryptoManager::VerificationStatus\" />\n"
+    "      </method>\n"
+    "      <method name=\"encryptFd\">\n"
+    "          <arg name=\"data\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"output\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"iv\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"key\" type=\"((sss)iiiiiayayayaay(a{sv}))\" direction=\"in\" />\n"
+    "          <arg name=\"blockMode\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"padding\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"authenticationData\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"encrypted\" type=\"ay\" direction=\"out\" />\n"
+    "          <arg name=\"authenticationTag\" type=\"ay\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In3\" value=\"Sailfish::Crypto::Key\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In4\" value=\"Sailfish::Crypto::CryptoManager::BlockMode\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In5\" value=\"Sailfish::Crypto::CryptoManager::EncryptionPadding\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "      </method>\n"
+    "      <method name=\"decryptFd\">\n"
+    "          <arg name=\"data\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"output\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"iv\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"key\" type=\"((sss)iiiiiayayayaay(a{sv}))\" direction=\"in\" />\n"
+    "          <arg name=\"blockMode\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"padding\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"authenticationData\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"authenticationTag\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"decrypted\" type=\"ay\" direction=\"out\" />\n"
+    "          <arg name=\"verificationStatus\" type=\"(i)\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In3\" value=\"Sailfish::Crypto::Key\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In4\" value=\"Sailfish::Crypto::CryptoManager::BlockMode\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In5\" value=\"Sailfish::Crypto::CryptoManager::EncryptionPadding\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Crypto::CryptoManager::VerificationStatus\" />\n"
+    "      </method>\n"
     "      <method name=\"initializeCipherSession\">\n"
     "          <arg name=\"initializationVector\" type=\"ay\" direction=\"in\" />\n"
     "          <arg name=\"key\" type=\"((sss)iiiiiayayayaay(a{sv}))\" direction=\"in\" />\n"
@@ -292,6 +397,19 @@ class CryptoDBusObject : public Secrets::Daemon::ApiImpl::DBusObject
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Crypto::CryptoManager::VerificationStatus\" />\n"
     "      </method>\n"
+    "      <method name=\"streamCipherSession\">\n"
+    "          <arg name=\"input\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"output\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"data\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"customParameters\" type=\"a{sv}\" direction=\"in\" />\n"
+    "          <arg name=\"cryptosystemProviderName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"cipherSessionToken\" type=\"u\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iiis)\" direction=\"out\" />\n"
+    "          <arg name=\"generatedData\" type=\"ay\" direction=\"out\" />\n"
+    "          <arg name=\"verificationStatus\" type=\"(i)\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Crypto::Result\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Crypto::CryptoManager::VerificationStatus\" />\n"
+    "      </method>\n"
     "      <method name=\"queryLockStatus\">\n"
     "          <arg name=\"lockCodeTargetType\" type=\"(i)\" direction=\"in\" />\n"
     "          <arg name=\"lockCodeTarget\" type=\"s\" direction=\"in\" />\n"
@@ -463,6 +581,21 @@ public Q_SLOTS:
             Sailfish::Crypto::Result &result,
             Sailfish::Crypto::CryptoManager::VerificationStatus &verificationStatus);
 
+    void batch(
+            const QVector<int> &operations,
+            const QVector<QByteArray> &data,
+            const QVector<QByteArray> &signatures,
+            const Sailfish::Crypto::Key &key,
+            Sailfish::Crypto::CryptoManager::SignaturePadding padding,
+            Sailfish::Crypto::CryptoManager::DigestFunction digestFunction,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            QVector<Sailfish::Crypto::Result> &results,
+            QVector<QByteArray> &outputs,
+            QVector<int> &verificationStatuses);
+
     void encrypt(
             const QByteArray &data,
             const QByteArray &iv,
@@ -492,6 +625,73 @@ public Q_SLOTS:
             QByteArray &decrypted,
             Sailfish::Crypto::CryptoManager::VerificationStatus &verificationStatus);
 
+    // Variants of the above methods, which take the (potentially large)
+    // data, and return the encrypted or decrypted output, via file
+    // descriptors rather than inline in the D-Bus messages.
+    void calculateDigestFd(
+            const QDBusUnixFileDescriptor &data,
+            Sailfish::Crypto::CryptoManager::SignaturePadding padding,
+            Sailfish::Crypto::CryptoManager::DigestFunction digestFunction,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            QByteArray &digest);
+
+    void signFd(
+            const QDBusUnixFileDescriptor &data,
+            const Sailfish::Crypto::Key &key,
+            Sailfish::Crypto::CryptoManager::SignaturePadding padding,
+            Sailfish::Crypto::CryptoManager::DigestFunction digestFunction,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            QByteArray &signature);
+
+    void verifyFd(
+            const QByteArray &signature,
+            const QDBusUnixFileDescriptor &data,
+            const Sailfish::Crypto::Key &key,
+            Sailfish::Crypto::CryptoManager::SignaturePadding padding,
+            Sailfish::Crypto::CryptoManager::DigestFunction digestFunction,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            Sailfish::Crypto::CryptoManager::VerificationStatus &verificationStatus);
+
+    void encryptFd(
+            const QDBusUnixFileDescriptor &data,
+            const QDBusUnixFileDescriptor &output,
+            const QByteArray &iv,
+            const Sailfish::Crypto::Key &key,
+            Sailfish::Crypto::CryptoManager::BlockMode blockMode,
+            Sailfish::Crypto::CryptoManager::EncryptionPadding padding,
+            const QByteArray &authenticationData,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            QByteArray &encrypted,
+            QByteArray &authenticationTag);
+
+    void decryptFd(
+            const QDBusUnixFileDescriptor &data,
+            const QDBusUnixFileDescriptor &output,
+            const QByteArray &iv,
+            const Sailfish::Crypto::Key &key,
+            Sailfish::Crypto::CryptoManager::BlockMode blockMode,
+            Sailfish::Crypto::CryptoManager::EncryptionPadding padding,
+            const QByteArray &authenticationData,
+            const QByteArray &authenticationTag,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            QByteArray &decrypted,
+            Sailfish::Crypto::CryptoManager::VerificationStatus &verificationStatus);
+
     void initializeCipherSession(
             const QByteArray &initializationVector,
             const Sailfish::Crypto::Key &key,
@@ -533,6 +733,20 @@ public Q_SLOTS:
             QByteArray &generatedData,
             Sailfish::Crypto::CryptoManager::VerificationStatus &verificationStatus);
 
+    // The input is read until the client closes it, with the generated data
+    // written to the output as it is produced, and then the session is finalized.
+    void streamCipherSession(
+            const QDBusUnixFileDescriptor &input,
+            const QDBusUnixFileDescriptor &output,
+            const QByteArray &data,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            quint32 cipherSessionToken,
+            const QDBusMessage &message,
+            Sailfish::Crypto::Result &result,
+            QByteArray &generatedData,
+            Sailfish::Crypto::CryptoManager::VerificationStatus &verificationStatus);
+
     void queryLockStatus(
             Sailfish::Crypto::LockCodeRequest::LockCodeTargetType lockCodeTargetType,
             const QString &lockCodeTarget,
@@ -574,7 +788,6 @@ public:
     ~CryptoRequestQueue();
 
     Sailfish::Secrets::Daemon::Controller *controller();
-    QWeakPointer<QThreadPool> cryptoThreadPool();
     QMap<QString, Sailfish::Crypto::CryptoPlugin*> plugins() const;
 
     Sailfish::Crypto::LockCodeRequest::LockStatus queryLockStatusPlugin(const QString &pluginName);
@@ -586,9 +799,25 @@ public:
     void handlePendingRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool *completed) Q_DECL_OVERRIDE;
     void handleFinishedRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool *completed) Q_DECL_OVERRIDE;
     QString requestTypeToString(int type) const Q_DECL_OVERRIDE;
+    bool isBulkRequest(int type) const Q_DECL_OVERRIDE;
 
 private:
-    QSharedPointer<QThreadPool> m_cryptoThreadPool;
+    void handleBatchRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request,
+                            bool operationFinished,
+                            bool *completed);
+    Sailfish::Crypto::Result performBatchOperation(
+            Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request,
+            int operation,
+            const QByteArray &data,
+            const QByteArray &signature,
+            const Sailfish::Crypto::Key &key,
+            Sailfish::Crypto::CryptoManager::SignaturePadding padding,
+            Sailfish::Crypto::CryptoManager::DigestFunction digestFunction,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            QByteArray *output,
+            int *verificationStatus);
+
     Sailfish::Crypto::Daemon::ApiImpl::RequestProcessor *m_requestProcessor;
     Sailfish::Secrets::Daemon::Controller *m_controller;
 };
@@ -618,7 +847,11 @@ enum RequestType {
     QueryLockStatusRequest,
     ModifyLockCodeRequest,
     ProvideLockCodeRequest,
-    ForgetLockCodeRequest
+    ForgetLockCodeRequest,
+    // Batched request types:
+    BatchOperationsRequest,
+    // Streamed request types:
+    StreamCipherSessionRequest
 };
 
 } // ApiImpl
@@ -6,13 +6,23 @@
  */
 
 #include "CryptoImpl/cryptopluginfunctionwrappers_p.h"
+#include "Crypto/payloadtransfer_p.h"
 #include "SecretsImpl/metadatadb_p.h"
 #include "logging_p.h"
+#include "statistics_p.h"
 #include "util_p.h"
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSemaphore>
+#include <QtConcurrent>
+
+#include <fcntl.h>
+#include <errno.h>
+
 using namespace Sailfish::Crypto;
 using namespace Sailfish::Crypto::Daemon::ApiImpl;
 using namespace Sailfish::Secrets::Daemon::Util;
+using Sailfish::Secrets::Daemon::ApiImpl::PluginCallTimer;
 
 namespace {
     Sailfish::Secrets::Result unlockCollection(CryptoStoragePluginWrapper *w,
@@ -47,6 +57,57 @@ namespace {
         }
         return lockedResult;
     }
+
+    // Runs the call in the given plugin thread pool and waits for it, so that
+    // the calls to plugins which don't support concurrent operations remain
+    // serialized.  The future is not waited on, as that may run the call in
+    // this thread instead if the pool has not started it yet.
+    template <typename T, typename Function>
+    bool runInPluginThreadPool(const QWeakPointer<QThreadPool> &threadPool, Function call, T *result) {
+        QSharedPointer<QThreadPool> pool = threadPool.toStrongRef();
+        if (!pool) {
+            return false;
+        }
+        QSemaphore finished;
+        QtConcurrent::run(pool.data(), [&] {
+            *result = call();
+            finished.release();
+        });
+        finished.acquire();
+        return true;
+    }
+
+    void setNonBlocking(const QDBusUnixFileDescriptor &fd) {
+        const int flags = fcntl(fd.fileDescriptor(), F_GETFL);
+        if (flags >= 0 && !(flags & O_NONBLOCK)) {
+            fcntl(fd.fileDescriptor(), F_SETFL, flags | O_NONBLOCK);
+        }
+    }
+
+    Result streamAborted() {
+        return Result(Result::CryptoPluginCipherSessionError,
+                      QLatin1String("The cipher session stream was aborted"));
+    }
+
+    Result streamError(const char *message) {
+        const int error = errno;
+        if (error == ECANCELED) {
+            return streamAborted();
+        } else if (error == ETIMEDOUT) {
+            return Result(Result::CryptoPluginCipherSessionError,
+                          QStringLiteral("%1: timed out").arg(QLatin1String(message)));
+        }
+        return Result(Result::CryptoPluginCipherSessionError, QLatin1String(message));
+    }
+
+    QString pluginName(const PluginWrapperAndCustomParams &pluginAndCustomParams) {
+        if (pluginAndCustomParams.wrapper) {
+            return pluginAndCustomParams.wrapper->name();
+        } else if (pluginAndCustomParams.plugin) {
+            return pluginAndCustomParams.plugin->name();
+        }
+        return QString();
+    }
 }
 
 /* These methods are to be called via QtConcurrent */
@@ -54,12 +115,14 @@ namespace {
 bool CryptoPluginFunctionWrapper::isLocked(
         CryptoPlugin *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->isLocked();
 }
 
 bool CryptoPluginFunctionWrapper::lock(
         CryptoPlugin *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->lock();
 }
 
@@ -67,6 +130,7 @@ bool CryptoPluginFunctionWrapper::unlock(
         CryptoPlugin *plugin,
         const QByteArray &lockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->unlock(lockCode);
 }
 
@@ -75,6 +139,7 @@ bool CryptoPluginFunctionWrapper::setLockCode(
         const QByteArray &oldLockCode,
         const QByteArray &newLockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setLockCode(oldLockCode, newLockCode);
 }
 
@@ -84,6 +149,7 @@ DataResult CryptoPluginFunctionWrapper::generateRandomData(
         const QString &csprngEngineName,
         quint64 numberBytes)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     QByteArray randomData;
     Result result = pluginAndCustomParams.plugin->generateRandomData(
                 callerIdent,
@@ -101,6 +167,7 @@ Result CryptoPluginFunctionWrapper::seedRandomDataGenerator(
         const QByteArray &seedData,
         double entropyEstimate)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     return pluginAndCustomParams.plugin->seedRandomDataGenerator(
                 callerIdent,
                 csprngEngineName,
@@ -115,6 +182,7 @@ DataResult CryptoPluginFunctionWrapper::generateInitializationVector(
         CryptoManager::BlockMode blockMode,
         int keySize)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     QByteArray iv;
     Result result = pluginAndCustomParams.plugin->generateInitializationVector(
                 algorithm, blockMode, keySize,
@@ -128,6 +196,7 @@ KeyResult CryptoPluginFunctionWrapper::importKey(
         const QByteArray &keyData,
         const QByteArray &passphrase)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     Key key;
     Result result = pluginAndCustomParams.plugin->importKey(
                 keyData, passphrase,
@@ -143,6 +212,7 @@ KeyResult CryptoPluginFunctionWrapper::importAndStoreKey(
         const QByteArray &passphrase,
         const QByteArray &collectionDecryptionKey)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     Sailfish::Secrets::Daemon::ApiImpl::CollectionMetadata collectionMetadata;
     Sailfish::Secrets::Result sresult = pluginAndCustomParams.wrapper->collectionMetadata(
                 keyTemplate.identifier().collectionName(),
@@ -181,6 +251,7 @@ KeyResult CryptoPluginFunctionWrapper::generateKey(
         const KeyPairGenerationParameters &kpgParams,
         const KeyDerivationParameters &skdfParams)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     Key key(keyTemplate);
     Result result = pluginAndCustomParams.plugin->generateKey(
                 keyTemplate, kpgParams, skdfParams,
@@ -190,14 +261,15 @@ KeyResult CryptoPluginFunctionWrapper::generateKey(
 }
 
 KeyResult CryptoPluginFunctionWrapper::storedKey(
-        CryptoPlugin *plugin,
+        CryptoStoragePluginWrapper *wrapper,
         const Key::Identifier &identifier,
         Key::Components keyComponents,
         const QVariantMap &customParameters)
 {
+    PluginCallTimer timer(wrapper->name());
     Key key;
     key.setIdentifier(identifier);
-    Result result = plugin->storedKey(
+    Result result = wrapper->storedKey(
                 identifier, keyComponents, customParameters, &key);
     return KeyResult(result, key);
 }
@@ -207,6 +279,7 @@ IdentifiersResult CryptoPluginFunctionWrapper::storedKeyIdentifiers(
         const QString &collectionName,
         const QVariantMap &customParameters)
 {
+    PluginCallTimer timer(plugin->name());
     QVector<Key::Identifier> identifiers;
     Result result = plugin->storedKeyIdentifiers(collectionName, customParameters, &identifiers);
     return IdentifiersResult(result, identifiers);
@@ -217,6 +290,7 @@ DataResult CryptoPluginFunctionWrapper::calculateDigest(
         const QByteArray &data,
         const SignatureOptions &options)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     QByteArray digest;
     Result result = pluginAndCustomParams.plugin->calculateDigest(
                 data,
@@ -233,6 +307,7 @@ DataResult CryptoPluginFunctionWrapper::sign(
         const KeyAndCollectionKey &keyAndCollectionKey,
         const SignatureOptions &options)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     QByteArray signature;
     Result result(Result::Succeeded);
 
@@ -262,10 +337,10 @@ DataResult CryptoPluginFunctionWrapper::sign(
         }
 
         if (wasLocked) {
-            // relock.
-            Sailfish::Secrets::Result r = w->setEncryptionKey(
+            // relock.  the collection may be kept open briefly for subsequent accesses.
+            Sailfish::Secrets::Result r = w->relockCollection(
                         collectionName,
-                        QByteArray());
+                        collectionKey);
             Q_UNUSED(r);
         }
     } else if (pluginAndCustomParams.plugin) {
@@ -290,6 +365,7 @@ ValidatedResult CryptoPluginFunctionWrapper::verify(
         const KeyAndCollectionKey &keyAndCollectionKey,
         const SignatureOptions &options)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     Sailfish::Crypto::CryptoManager::VerificationStatus verificationStatus = Sailfish::Crypto::CryptoManager::VerificationStatusUnknown;
     Result result(Result::Succeeded);
 
@@ -321,10 +397,10 @@ ValidatedResult CryptoPluginFunctionWrapper::verify(
         }
 
         if (wasLocked) {
-            // relock.
-            Sailfish::Secrets::Result r = w->setEncryptionKey(
+            // relock.  the collection may be kept open briefly for subsequent accesses.
+            Sailfish::Secrets::Result r = w->relockCollection(
                         collectionName,
-                        QByteArray());
+                        collectionKey);
             Q_UNUSED(r);
         }
     } else if (pluginAndCustomParams.plugin) {
@@ -349,6 +425,7 @@ TagDataResult CryptoPluginFunctionWrapper::encrypt(
         const EncryptionOptions &options,
         const QByteArray &authenticationData)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     QByteArray ciphertext;
     QByteArray authenticationTag;
     Result result(Result::Succeeded);
@@ -384,10 +461,10 @@ TagDataResult CryptoPluginFunctionWrapper::encrypt(
         }
 
         if (wasLocked) {
-            // relock.
-            Sailfish::Secrets::Result r = w->setEncryptionKey(
+            // relock.  the collection may be kept open briefly for subsequent accesses.
+            Sailfish::Secrets::Result r = w->relockCollection(
                         collectionName,
-                        QByteArray());
+                        collectionKey);
             Q_UNUSED(r);
         }
     } else if (pluginAndCustomParams.plugin) {
@@ -415,6 +492,7 @@ VerifiedDataResult CryptoPluginFunctionWrapper::decrypt(
         const EncryptionOptions &options,
         const AuthDataAndTag &authDataAndTag)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     QByteArray plaintext;
     Sailfish::Crypto::CryptoManager::VerificationStatus verificationStatus = Sailfish::Crypto::CryptoManager::VerificationStatusUnknown;
     Result result(Result::Succeeded);
@@ -449,10 +527,10 @@ VerifiedDataResult CryptoPluginFunctionWrapper::decrypt(
         }
 
         if (wasLocked) {
-            // relock.
-            Sailfish::Secrets::Result r = w->setEncryptionKey(
+            // relock.  the collection may be kept open briefly for subsequent accesses.
+            Sailfish::Secrets::Result r = w->relockCollection(
                         collectionName,
-                        QByteArray());
+                        collectionKey);
             Q_UNUSED(r);
         }
     } else if (pluginAndCustomParams.plugin) {
@@ -481,6 +559,7 @@ CipherSessionTokenResult CryptoPluginFunctionWrapper::initializeCipherSession(
         const KeyAndCollectionKey &keyAndCollectionKey,
         const CipherSessionOptions &options)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     quint32 cipherSessionToken = 0;
     Result result(Result::Succeeded);
 
@@ -492,7 +571,8 @@ CipherSessionTokenResult CryptoPluginFunctionWrapper::initializeCipherSession(
         // check to see if we need to unlock the collection in order to access the key.
         // we don't need to do this if the given key has the appropriate components already.
         if (((options.operation == CryptoManager::OperationSign
-             || options.operation == CryptoManager::OperationDecrypt)
+             || options.operation == CryptoManager::OperationDecrypt
+             || options.operation == CryptoManager::OperationCalculateMac)
                     && keyAndCollectionKey.key.privateKey().isEmpty()
                     && keyAndCollectionKey.key.secretKey().isEmpty())
          || ((options.operation == CryptoManager::OperationVerify
@@ -522,10 +602,10 @@ CipherSessionTokenResult CryptoPluginFunctionWrapper::initializeCipherSession(
         }
 
         if (wasLocked) {
-            // relock.
-            Sailfish::Secrets::Result r = w->setEncryptionKey(
+            // relock.  the collection may be kept open briefly for subsequent accesses.
+            Sailfish::Secrets::Result r = w->relockCollection(
                         collectionName,
-                        QByteArray());
+                        collectionKey);
             Q_UNUSED(r);
         }
     } else if (pluginAndCustomParams.plugin) {
@@ -554,6 +634,7 @@ Result CryptoPluginFunctionWrapper::updateCipherSessionAuthentication(
         const QByteArray &authenticationData,
         quint32 cipherSessionToken)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     return pluginAndCustomParams.plugin->updateCipherSessionAuthentication(
                 clientId, authenticationData,
                 pluginAndCustomParams.customParameters,
@@ -566,6 +647,7 @@ DataResult CryptoPluginFunctionWrapper::updateCipherSession(
         const QByteArray &data,
         quint32 cipherSessionToken)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     QByteArray generatedData;
     Result result = pluginAndCustomParams.plugin->updateCipherSession(
                 clientId, data,
@@ -581,6 +663,7 @@ VerifiedDataResult CryptoPluginFunctionWrapper::finalizeCipherSession(
         const QByteArray &data,
         quint32 cipherSessionToken)
 {
+    PluginCallTimer timer(pluginAndCustomParams.plugin->name());
     Sailfish::Crypto::CryptoManager::VerificationStatus verificationStatus = Sailfish::Crypto::CryptoManager::VerificationStatusUnknown;
     QByteArray generatedData;
     Result result = pluginAndCustomParams.plugin->finalizeCipherSession(
@@ -591,6 +674,82 @@ VerifiedDataResult CryptoPluginFunctionWrapper::finalizeCipherSession(
     return VerifiedDataResult(result, generatedData, verificationStatus);
 }
 
+VerifiedDataResult CryptoPluginFunctionWrapper::streamCipherSession(
+        const PluginAndCustomParams &pluginAndCustomParams,
+        quint64 clientId,
+        const CipherSessionStream &stream,
+        const QByteArray &finalData,
+        quint32 cipherSessionToken)
+{
+    // The transfers are performed on this thread, and only the plugin calls
+    // in the plugin's thread pool, so that a slow client never occupies it.
+    // Only those calls are timed, as the duration of the stream as a whole
+    // depends on the client.
+    // Writes must not block past the timeout if the client stops reading.
+    setNonBlocking(stream.output);
+
+    // Update the session with each chunk of input as soon as it is
+    // available, until the client closes its end of the input stream.
+    QElapsedTimer streamTimer;
+    streamTimer.start();
+    Result streamResult(Result::Succeeded);
+    QByteArray chunk(PayloadTransfer::StreamChunkSize, Qt::Uninitialized);
+    while (true) {
+        const int timeout = static_cast<int>(qMin<qint64>(
+                PayloadTransfer::StreamInactivityTimeout,
+                PayloadTransfer::MaximumStreamDuration - streamTimer.elapsed()));
+        if (timeout <= 0) {
+            errno = ETIMEDOUT;
+            streamResult = streamError("Unable to read from the cipher session input stream");
+            break;
+        }
+
+        const qint64 bytesRead = PayloadTransfer::readStream(
+                stream.input, chunk.data(), chunk.size(), timeout, stream.cancelFd);
+        if (bytesRead == 0) {
+            break;
+        } else if (bytesRead < 0) {
+            streamResult = streamError("Unable to read from the cipher session input stream");
+            break;
+        }
+
+        const QByteArray data = QByteArray::fromRawData(chunk.constData(), bytesRead);
+        DataResult updated;
+        if (!runInPluginThreadPool(stream.pluginThreadPool, [&] {
+                    return CryptoPluginFunctionWrapper::updateCipherSession(
+                                pluginAndCustomParams, clientId,
+                                data, cipherSessionToken);
+                }, &updated)) {
+            streamResult = streamAborted();
+            break;
+        } else if (updated.result.code() != Result::Succeeded) {
+            streamResult = updated.result;
+            break;
+        }
+
+        if (!updated.data.isEmpty() && !PayloadTransfer::writeStream(
+                    stream.output, updated.data, timeout, stream.cancelFd)) {
+            streamResult = streamError("Unable to write to the cipher session output stream");
+            break;
+        }
+    }
+
+    // The finalization output (e.g. the last block, or an authentication tag)
+    // is returned in the reply, as with finalizeCipherSession().
+    // The session is also finalized if the stream failed, to release it.
+    const bool succeeded = streamResult.code() == Result::Succeeded;
+    VerifiedDataResult finalized;
+    if (!runInPluginThreadPool(stream.pluginThreadPool, [&] {
+                return CryptoPluginFunctionWrapper::finalizeCipherSession(
+                            pluginAndCustomParams, clientId,
+                            succeeded ? finalData : QByteArray(),
+                            cipherSessionToken);
+            }, &finalized)) {
+        return VerifiedDataResult(succeeded ? streamAborted() : streamResult);
+    }
+    return succeeded ? finalized : VerifiedDataResult(streamResult);
+}
+
 KeyResult CryptoPluginFunctionWrapper::generateAndStoreKey(
         const PluginWrapperAndCustomParams &pluginAndCustomParams,
         const Sailfish::Crypto::Key &keyTemplate,
@@ -598,6 +757,7 @@ KeyResult CryptoPluginFunctionWrapper::generateAndStoreKey(
         const Sailfish::Crypto::KeyDerivationParameters &skdfParams,
         const QByteArray &collectionUnlockCode)
 {
+    PluginCallTimer timer(pluginName(pluginAndCustomParams));
     Sailfish::Secrets::Daemon::ApiImpl::CollectionMetadata collectionMetadata;
     Sailfish::Secrets::Result sresult = pluginAndCustomParams.wrapper->collectionMetadata(
                 keyTemplate.identifier().collectionName(),
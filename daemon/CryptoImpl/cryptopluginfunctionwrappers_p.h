@@ -19,6 +19,10 @@
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
 #include <QtCore/QVector>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWeakPointer>
+
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 namespace Sailfish {
 
@@ -98,6 +102,21 @@ struct CipherSessionTokenResult {
     quint32 cipherSessionToken;
 };
 
+struct CipherSessionStream {
+    CipherSessionStream(const QDBusUnixFileDescriptor &in = QDBusUnixFileDescriptor(),
+                        const QDBusUnixFileDescriptor &out = QDBusUnixFileDescriptor(),
+                        int cancel = -1,
+                        const QWeakPointer<QThreadPool> &pool = QWeakPointer<QThreadPool>())
+        : input(in), output(out), cancelFd(cancel), pluginThreadPool(pool) {}
+    CipherSessionStream(const CipherSessionStream &other)
+        : input(other.input), output(other.output)
+        , cancelFd(other.cancelFd), pluginThreadPool(other.pluginThreadPool) {}
+    QDBusUnixFileDescriptor input;
+    QDBusUnixFileDescriptor output;
+    int cancelFd; // becomes readable when the stream should be aborted
+    QWeakPointer<QThreadPool> pluginThreadPool; // where the plugin is called
+};
+
 struct SignatureOptions {
     SignatureOptions(Sailfish::Crypto::CryptoManager::SignaturePadding p = Sailfish::Crypto::CryptoManager::SignaturePaddingNone,
                      Sailfish::Crypto::CryptoManager::DigestFunction df = Sailfish::Crypto::CryptoManager::DigestUnknown)
@@ -250,7 +269,7 @@ KeyResult generateKey(
         const Sailfish::Crypto::KeyDerivationParameters &skdfParams);
 
 KeyResult storedKey(
-        Sailfish::Crypto::CryptoPlugin *plugin,
+        Sailfish::Crypto::Daemon::ApiImpl::CryptoStoragePluginWrapper *wrapper,
         const Sailfish::Crypto::Key::Identifier &identifier,
         Sailfish::Crypto::Key::Components keyComponents,
         const QVariantMap &customParameters);
@@ -317,6 +336,13 @@ VerifiedDataResult finalizeCipherSession(
         const QByteArray &data,
         quint32 cipherSessionToken);
 
+VerifiedDataResult streamCipherSession(
+        const PluginAndCustomParams &pluginAndCustomParams,
+        quint64 clientId,
+        const CipherSessionStream &stream,
+        const QByteArray &finalData,
+        quint32 cipherSessionToken);
+
 KeyResult generateAndStoreKey(
         const PluginWrapperAndCustomParams &pluginAndCustomParams,
         const Sailfish::Crypto::Key &keyTemplate,
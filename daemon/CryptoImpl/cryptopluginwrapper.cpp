@@ -37,6 +37,12 @@ CryptoStoragePluginWrapper::keyNames(
         const QVariantMap &customParameters,
         QStringList *keyNames)
 {
+    if (isWarmCollection(collectionName)) {
+        return Sailfish::Secrets::Result(Sailfish::Secrets::Result::CollectionIsLockedError,
+                                         QStringLiteral("Collection %1 in plugin %2 is locked")
+                                         .arg(collectionName, m_encryptedStoragePlugin->name()));
+    }
+
     QStringList knownKeys;
     Sailfish::Secrets::Result sresult = m_metadataDb.keyNames(collectionName, &knownKeys);
     if (sresult.code() != Sailfish::Secrets::Result::Succeeded) {
@@ -68,12 +74,36 @@ CryptoStoragePluginWrapper::keyNames(
     return Sailfish::Secrets::Result(Sailfish::Secrets::Result::Succeeded);
 }
 
-Sailfish::Crypto::Result
+Sailfish::Crypto::// The stored key is read without unlocking the collection, so a collection
+// which has been relocked must be refused even while it is kept open.
+Result
+CryptoStoragePluginWrapper::storedKey(
+        const Key::Identifier &identifier,
+        Key::Components keyComponents,
+        const QVariantMap &customParameters,
+        Key *key)
+{
+    if (isWarmCollection(identifier.collectionName())) {
+        return Result(Result::StorageError,
+                      Sailfish::Secrets::Result::CollectionIsLockedError,
+                      QStringLiteral("Collection %1 in plugin %2 is locked")
+                      .arg(identifier.collectionName(), m_encryptedStoragePlugin->name()));
+    }
+    return m_cryptoPlugin->storedKey(identifier, keyComponents, customParameters, key);
+}
+
+Result
 CryptoStoragePluginWrapper::storedKeyIdentifiers(
         const QString &collectionName,
         const QVariantMap &customParameters,
         QVector<Sailfish::Crypto::Key::Identifier> *identifiers)
 {
+    if (isWarmCollection(collectionName)) {
+        return Result(Result::StorageError,
+                      Sailfish::Secrets::Result::CollectionIsLockedError,
+                      QStringLiteral("Collection %1 in plugin %2 is locked")
+                      .arg(collectionName, m_encryptedStoragePlugin->name()));
+    }
     return m_cryptoPlugin->storedKeyIdentifiers(collectionName, customParameters, identifiers);
 }
 
@@ -101,15 +131,17 @@ CryptoStoragePluginWrapper::prepareToStoreKey(
                       .arg(m_encryptedStoragePlugin->name()));
     }
 
+    // a relocked collection which is still kept open is reported as locked,
+    // and is only reused if the given key matches.
     bool locked = false;
-    Sailfish::Secrets::Result sresult = m_encryptedStoragePlugin->isCollectionLocked(metadata.collectionName, &locked);
+    Sailfish::Secrets::Result sresult = isCollectionLocked(metadata.collectionName, &locked);
     if (sresult.code() != Sailfish::Secrets::Result::Succeeded) {
         return transformSecretsResult(sresult);
     }
 
     *wasLocked = locked;
     if (locked) {
-        sresult = m_encryptedStoragePlugin->setEncryptionKey(metadata.collectionName, collectionUnlockKey);
+        sresult = setEncryptionKey(metadata.collectionName, collectionUnlockKey);
         if (sresult.code() != Sailfish::Secrets::Result::Succeeded) {
             return transformSecretsResult(sresult);
         }
@@ -183,8 +215,8 @@ CryptoStoragePluginWrapper::generateAndStoreKey(
     }
 
     if (wasLocked) {
-        Sailfish::Secrets::Result relockResult = m_encryptedStoragePlugin->setEncryptionKey(
-                    metadata.collectionName, QByteArray());
+        Sailfish::Secrets::Result relockResult = relockCollection(
+                    metadata.collectionName, collectionUnlockKey);
         if (relockResult.code() != Sailfish::Secrets::Result::Succeeded) {
             qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << metadata.collectionName
                                                << relockResult.errorMessage();
@@ -221,8 +253,8 @@ CryptoStoragePluginWrapper::importAndStoreKey(
     }
 
     if (wasLocked) {
-        Sailfish::Secrets::Result relockResult = m_encryptedStoragePlugin->setEncryptionKey(
-                    metadata.collectionName, QByteArray());
+        Sailfish::Secrets::Result relockResult = relockCollection(
+                    metadata.collectionName, collectionUnlockKey);
         if (relockResult.code() != Sailfish::Secrets::Result::Succeeded) {
             qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << metadata.collectionName
                                                << relockResult.errorMessage();
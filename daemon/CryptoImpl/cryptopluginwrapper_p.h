@@ -42,6 +42,12 @@ public:
                                        const QVariantMap &customParameters,
                                        QStringList *keyNames) Q_DECL_OVERRIDE;
 
+    Sailfish::Crypto::Result storedKey(
+            const Sailfish::Crypto::Key::Identifier &identifier,
+            Sailfish::Crypto::Key::Components keyComponents,
+            const QVariantMap &customParameters,
+            Sailfish::Crypto::Key *key);
+
     Sailfish::Crypto::Result storedKeyIdentifiers(
             const QString &collectionName,
             const QVariantMap &customParameters,
@@ -31,6 +31,10 @@
 
 #include <QtConcurrent>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
 namespace {
     void nullifyKeyFields(Sailfish::Crypto::Key *key, Sailfish::Crypto::Key::Components keep) {
         // This method is called for keys stored in generic secrets storage plugins.
@@ -103,6 +107,26 @@ Daemon::ApiImpl::RequestProcessor::RequestProcessor(
             this, &Daemon::ApiImpl::RequestProcessor::secretsCryptoPluginLockStatusRequestCompleted);
     connect(m_secrets, &Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue::cryptoPluginLockCodeRequestCompleted,
             this, &Daemon::ApiImpl::RequestProcessor::secretsCryptoPluginLockCodeRequestCompleted);
+
+    // Cipher session streams are paced by the client, so they are processed
+    // in their own bounded thread pool rather than in the plugin thread pools
+    // (which may be the secrets thread pool), to which only the individual
+    // plugin calls are dispatched.  Further streams wait until one finishes.
+    bool ok = false;
+    int streamThreadCount = QString::fromUtf8(qgetenv(ENV_STREAM_THREADPOOL_SIZE)).toInt(&ok);
+    if (!ok || streamThreadCount <= 0) {
+        streamThreadCount = 4;
+    }
+    m_streamThreadPool.setMaxThreadCount(streamThreadCount);
+}
+
+Daemon::ApiImpl::RequestProcessor::~RequestProcessor()
+{
+    for (QHash<quint64, int>::const_iterator it = m_cipherSessionStreamCancelFds.constBegin();
+            it != m_cipherSessionStreamCancelFds.constEnd(); ++it) {
+        abortCipherSessionStream(it.key());
+    }
+    m_streamThreadPool.waitForDone();
 }
 
 QMap<QString, CryptoPlugin*>
@@ -1107,11 +1131,17 @@ Daemon::ApiImpl::RequestProcessor::storedKey(
     }
 
     if (m_cryptoPlugins.contains(identifier.storagePluginName())) {
+        Sailfish::Crypto::Daemon::ApiImpl::CryptoStoragePluginWrapper *wrapper(m_secrets->cryptoStoragePluginWrapper(identifier.storagePluginName()));
+        if (!wrapper) {
+            return Result(Result::InvalidStorageProvider,
+                          QLatin1String("Unknown crypto storage plugin name specified in identifier"));
+        }
+
         QFutureWatcher<KeyResult> *watcher = new QFutureWatcher<KeyResult>(this);
         QFuture<KeyResult> future = QtConcurrent::run(
                     m_requestQueue->controller()->threadPoolForPlugin(identifier.storagePluginName()).data(),
                     CryptoPluginFunctionWrapper::storedKey,
-                    m_cryptoPlugins[identifier.storagePluginName()],
+                    wrapper,
                     identifier,
                     keyComponents,
                     customParameters);
@@ -2178,7 +2208,8 @@ Daemon::ApiImpl::RequestProcessor::initializeCipherSession(
     }
 
     Key fullKey;
-    if (key.privateKey().isEmpty() && key.secretKey().isEmpty()) {
+    if (operation != CryptoManager::OperationCalculateDigest // digest sessions require no key.
+            && key.privateKey().isEmpty() && key.secretKey().isEmpty()) {
         // the key is a key reference, we may need to read the full key from storage.
         if (key.identifier().name().isEmpty()) {
             return Result(Result::InvalidKeyIdentifier,
@@ -2510,6 +2541,81 @@ Daemon::ApiImpl::RequestProcessor::finalizeCipherSession(
     return Result(Result::Pending);
 }
 
+Result
+Daemon::ApiImpl::RequestProcessor::streamCipherSession(
+        pid_t callerPid,
+        quint64 requestId,
+        const QDBusUnixFileDescriptor &input,
+        const QDBusUnixFileDescriptor &output,
+        const QByteArray &data,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        quint32 cipherSessionToken,
+        QByteArray *generatedData,
+        Sailfish::Crypto::CryptoManager::VerificationStatus *verificationStatus)
+{
+    Q_UNUSED(generatedData); // asynchronous out-param.
+    Q_UNUSED(verificationStatus);      // asynchronous out-param.
+
+    CryptoPlugin* cryptoPlugin = m_cryptoPlugins.value(cryptosystemProviderName);
+    if (cryptoPlugin == Q_NULLPTR) {
+        return Result(Result::InvalidCryptographicServiceProvider,
+                      QLatin1String("No such cryptographic service provider plugin exists"));
+    } else if (!input.isValid() || !output.isValid()) {
+        return Result(Result::CryptoPluginCipherSessionError,
+                      QLatin1String("Invalid cipher session stream file descriptors"));
+    }
+
+    // Writing to the pipe wakes up the stream task if it is waiting for
+    // the client, so that the stream can be aborted on cancelation.
+    int cancelPipe[2];
+    if (pipe2(cancelPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        return Result(Result::CryptoPluginCipherSessionError,
+                      QLatin1String("Unable to create the cipher session stream"));
+    }
+    const int cancelReadFd = cancelPipe[0];
+    m_cipherSessionStreamCancelFds.insert(requestId, cancelPipe[1]);
+
+    // The whole stream is processed by a single task in the stream thread
+    // pool, which finalizes the session once the input is exhausted.
+    QFutureWatcher<VerifiedDataResult> *watcher = new QFutureWatcher<VerifiedDataResult>(this);
+    QFuture<VerifiedDataResult> future = QtConcurrent::run(
+                &m_streamThreadPool,
+                CryptoPluginFunctionWrapper::streamCipherSession,
+                PluginAndCustomParams(cryptoPlugin, customParameters),
+                callerPid,
+                CipherSessionStream(input, output, cancelReadFd,
+                                    m_requestQueue->controller()->threadPoolForPlugin(cryptosystemProviderName)),
+                data,
+                cipherSessionToken);
+
+    connect(watcher, &QFutureWatcher<VerifiedDataResult>::finished, [=] {
+        watcher->deleteLater();
+        close(cancelReadFd);
+        close(m_cipherSessionStreamCancelFds.take(requestId));
+        VerifiedDataResult vdr = watcher->future().result();
+        QVariantList outParams;
+        outParams << QVariant::fromValue<Result>(vdr.result);
+        outParams << QVariant::fromValue<QByteArray>(vdr.data);
+        outParams << QVariant::fromValue<CryptoManager::VerificationStatus>(vdr.verificationStatus);
+        m_requestQueue->requestFinished(requestId, outParams);
+    });
+    watcher->setFuture(future);
+
+    return Result(Result::Pending);
+}
+
+void
+Daemon::ApiImpl::RequestProcessor::abortCipherSessionStream(
+        quint64 requestId)
+{
+    const int cancelWriteFd = m_cipherSessionStreamCancelFds.value(requestId, -1);
+    if (cancelWriteFd >= 0) {
+        const char wakeUp = 0;
+        while (write(cancelWriteFd, &wakeUp, 1) < 0 && errno == EINTR) {
+        }
+    }
+}
 
 Result
 Daemon::ApiImpl::RequestProcessor::queryLockStatus(
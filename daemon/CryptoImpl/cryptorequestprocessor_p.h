@@ -35,6 +35,8 @@
 #include <QtCore/QString>
 #include <QtCore/QDateTime>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QThreadPool>
 #include <QtCore/QVector>
 
 #include <sys/types.h>
@@ -68,6 +70,7 @@ public:
     RequestProcessor(Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue *secrets,
                      bool autotestMode,
                      Sailfish::Crypto::Daemon::ApiImpl::CryptoRequestQueue *parent = Q_NULLPTR);
+    ~RequestProcessor();
 
     QMap<QString, Sailfish::Crypto::CryptoPlugin*> plugins() const;
     Sailfish::Crypto::LockCodeRequest::LockStatus queryLockStatusPlugin(const QString &pluginName);
@@ -274,6 +277,19 @@ public:
             QByteArray *generatedData,
             Sailfish::Crypto::CryptoManager::VerificationStatus *verificationStatus);
 
+    Sailfish::Crypto::Result streamCipherSession(
+            pid_t callerPid,
+            quint64 requestId,
+            const QDBusUnixFileDescriptor &input,
+            const QDBusUnixFileDescriptor &output,
+            const QByteArray &data,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            quint32 cipherSessionToken,
+            QByteArray *generatedData,
+            Sailfish::Crypto::CryptoManager::VerificationStatus *verificationStatus);
+    void abortCipherSessionStream(quint64 requestId);
+
     Sailfish::Crypto::Result queryLockStatus(
             pid_t callerPid,
             quint64 requestId,
@@ -605,6 +621,8 @@ private:
     Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue *m_secrets;
     QMap<QString, Sailfish::Crypto::CryptoPlugin*> m_cryptoPlugins;
     QMap<quint64, Sailfish::Crypto::Daemon::ApiImpl::RequestProcessor::PendingRequest> m_pendingRequests;
+    QHash<quint64, int> m_cipherSessionStreamCancelFds;
+    QThreadPool m_streamThreadPool;
     bool m_autotestMode;
 };
 
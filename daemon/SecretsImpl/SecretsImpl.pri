@@ -4,20 +4,29 @@ DEPENDPATH = $$INCLUDEPATH
 include($$PWD/../../database/database.pri)
 
 HEADERS += \
+    $$PWD/collectionarchive_p.h \
+    $$PWD/derivedkeycache_p.h \
     $$PWD/metadatadb_p.h \
+    $$PWD/metadatadbschema_p.h \
     $$PWD/pluginfunctionwrappers_p.h \
     $$PWD/pluginwrapper_p.h \
     $$PWD/secrets_p.h \
     $$PWD/secretsrequestprocessor_p.h \
+    $$PWD/secretwritequeue_p.h \
+    $$PWD/storedkeycache_p.h \
     $$PWD/applicationpermissions_p.h \
     $$PWD/dataprotector_p.h
 
 SOURCES += \
+    $$PWD/collectionarchive.cpp \
+    $$PWD/derivedkeycache.cpp \
     $$PWD/metadatadb.cpp \
     $$PWD/pluginfunctionwrappers.cpp \
     $$PWD/pluginwrapper.cpp \
     $$PWD/secrets.cpp \
     $$PWD/secretsrequestprocessor.cpp \
+    $$PWD/secretwritequeue.cpp \
+    $$PWD/storedkeycache.cpp \
     $$PWD/applicationpermissions.cpp \
     $$PWD/dataprotector.cpp
 
@@ -106,6 +106,63 @@ namespace {
         qCDebug(lcSailfishSecretsDaemon) << "caller with pid" << pid << "has cmdline applicationId:" << retn;
         return retn;
     }
+
+    quint64 readStartTime(pid_t pid)
+    {
+        QFile file(QStringLiteral("/proc/%1/stat").arg(pid));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCDebug(lcSailfishSecretsDaemon) << "unable to open stat file for process:" << pid;
+            return 0;
+        }
+
+        // The start time is the 22nd field.  The second field is the
+        // command name, which may itself contain spaces or parentheses,
+        // so the remaining fields are counted from the last parenthesis.
+        const QByteArray contents(file.readAll());
+        const int commEnd = contents.lastIndexOf(')');
+        if (commEnd < 0) {
+            return 0;
+        }
+        const QList<QByteArray> fields(contents.mid(commEnd + 2).split(' '));
+        return fields.size() > 19 ? fields.at(19).toULongLong() : 0;
+    }
+}
+
+void Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::addConnection(const QString &connectionName, pid_t pid)
+{
+    if (pid == 0 || m_connectionCallers.contains(connectionName)) {
+        // already known, e.g. registered by another API implementation.
+        return;
+    }
+
+    const CallerKey key(callerKey(pid));
+    m_connectionCallers.insert(connectionName, key);
+    CallerIdentity &identity(m_callerIdentities[key]);
+    if (identity.connectionCount == 0) {
+        identity.applicationId = resolveApplicationId(pid);
+        identity.isPlatformApplication = resolveApplicationIsPlatformApplication(pid);
+    }
+    identity.connectionCount++;
+}
+
+void Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::removeConnection(const QString &connectionName)
+{
+    QHash<QString, CallerKey>::iterator it = m_connectionCallers.find(connectionName);
+    if (it == m_connectionCallers.end()) {
+        return;
+    }
+
+    QHash<CallerKey, CallerIdentity>::iterator identity = m_callerIdentities.find(*it);
+    if (identity != m_callerIdentities.end() && --identity->connectionCount <= 0) {
+        m_callerIdentities.erase(identity);
+    }
+    m_connectionCallers.erase(it);
+}
+
+Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::CallerKey
+Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::callerKey(pid_t pid) const
+{
+    return CallerKey(pid, readStartTime(pid));
 }
 
 QString Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::applicationId(pid_t pid) const
@@ -115,6 +172,16 @@ QString Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::applicationI
         return platformApplicationId();
     }
 
+    QHash<CallerKey, CallerIdentity>::const_iterator identity = m_callerIdentities.constFind(callerKey(pid));
+    if (identity != m_callerIdentities.constEnd()) {
+        return identity->applicationId;
+    }
+
+    return resolveApplicationId(pid);
+}
+
+QString Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::resolveApplicationId(pid_t pid) const
+{
     const QString cgroupName = readBoosterCgroup(pid);
     if (!cgroupName.isEmpty()) {
         return cgroupName;
@@ -136,13 +203,23 @@ QString Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::applicationI
 
 bool Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::applicationIsPlatformApplication(pid_t pid) const
 {
-    // TODO: implement a real ACL?  This implementation just checks that the pid is privileged egid.
-
     if (pid == 0) {
         qCDebug(lcSailfishSecretsDaemon) << "zero pid, assuming privileged!";
         return true;
     }
 
+    QHash<CallerKey, CallerIdentity>::const_iterator identity = m_callerIdentities.constFind(callerKey(pid));
+    if (identity != m_callerIdentities.constEnd()) {
+        return identity->isPlatformApplication;
+    }
+
+    return resolveApplicationIsPlatformApplication(pid);
+}
+
+bool Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions::resolveApplicationIsPlatformApplication(pid_t pid) const
+{
+    // TODO: implement a real ACL?  This implementation just checks that the pid is privileged egid.
+
     QFileInfo info(QString("/proc/%1").arg(pid));
     if (info.group() != "privileged" && info.group() != "disk" && info.owner() != "root") {
         return false;
@@ -12,7 +12,9 @@
 #include <QtCore/QVariant>
 #include <QtCore/QString>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QList>
+#include <QtCore/QPair>
 #include <QtCore/QSet>
 
 #include <aboutsettings.h>
@@ -41,8 +43,33 @@ public:
     QString platformApplicationId() const { return m_osName; }
     bool applicationIsPlatformApplication(pid_t pid) const;
 
+    // The identity of a caller is resolved once, when its connection is
+    // accepted, and cached until the last connection from it is closed.
+    // The cache is keyed by the pid and the start time of the process,
+    // so that a process which reuses the pid of a caller whose connection
+    // has not yet been closed is not given that caller's identity.
+    void addConnection(const QString &connectionName, pid_t pid);
+    void removeConnection(const QString &connectionName);
+
 private:
+    typedef QPair<pid_t, quint64> CallerKey; // pid and process start time
+
+    struct CallerIdentity {
+        CallerIdentity()
+            : isPlatformApplication(false)
+            , connectionCount(0) {}
+        QString applicationId;
+        bool isPlatformApplication;
+        int connectionCount;
+    };
+
+    CallerKey callerKey(pid_t pid) const;
+    QString resolveApplicationId(pid_t pid) const;
+    bool resolveApplicationIsPlatformApplication(pid_t pid) const;
+
     QString m_osName;
+    QHash<QString, CallerKey> m_connectionCallers;
+    QHash<CallerKey, CallerIdentity> m_callerIdentities;
 };
 
 } // namespace ApiImpl
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "collectionarchive_p.h"
+#include "logging_p.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QMessageAuthenticationCode>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace Sailfish::Secrets;
+using namespace Sailfish::Secrets::Daemon::ApiImpl;
+
+namespace {
+    const QByteArray ArchiveMagic = QByteArrayLiteral("SAILSECA");
+    const quint32 ArchiveVersion = 1;
+    const int SaltSize = 32;
+    const int MacSize = 32;
+    const int MaximumHeaderSize = 4096;
+    const quint32 FinalFrameFlag = 0x1;
+
+    bool writeAll(int fd, const QByteArray &data, qint64 *offset)
+    {
+        qint64 written = 0;
+        while (written < data.size()) {
+            const ssize_t w = pwrite(fd,
+                                     data.constData() + written,
+                                     data.size() - written,
+                                     *offset + written);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            } else if (w <= 0) {
+                return false;
+            }
+            written += w;
+        }
+        *offset += written;
+        return true;
+    }
+
+    bool readAll(int fd, QByteArray *data, qint64 size, qint64 *offset)
+    {
+        data->resize(size);
+        qint64 read = 0;
+        while (read < size) {
+            const ssize_t r = pread(fd,
+                                    data->data() + read,
+                                    size - read,
+                                    *offset + read);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            } else if (r <= 0) {
+                return false;
+            }
+            read += r;
+        }
+        *offset += read;
+        return true;
+    }
+
+    bool constantTimeEquals(const QByteArray &a, const QByteArray &b)
+    {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        char diff = 0;
+        for (int i = 0; i < a.size(); ++i) {
+            diff |= a.at(i) ^ b.at(i);
+        }
+        return diff == 0;
+    }
+
+    void wipe(QByteArray *data)
+    {
+        data->fill('\0');
+        data->clear();
+    }
+}
+
+CollectionArchive::CollectionArchive(EncryptionPlugin *plugin, int fd)
+    : m_plugin(plugin)
+    , m_fd(fd)
+    , m_offset(0)
+    , m_frameIndex(0)
+{
+}
+
+CollectionArchive::~CollectionArchive()
+{
+    wipe(&m_encryptionKey);
+    wipe(&m_authenticationKey);
+}
+
+Result CollectionArchive::checkFileDescriptor() const
+{
+    // Only regular files are supported, so that reading or writing the
+    // archive can never block the secrets thread on the client.
+    struct stat sb;
+    if (m_fd < 0 || fstat(m_fd, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+        return Result(Result::OperationNotSupportedError,
+                      QLatin1String("Collection archives must be regular files"));
+    }
+    return Result(Result::Succeeded);
+}
+
+Result CollectionArchive::deriveKeys(const QByteArray &passphrase, const QByteArray &salt)
+{
+    QByteArray masterKey;
+    Result result = m_plugin->deriveKeyFromCode(passphrase, salt, &masterKey);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    m_encryptionKey = QMessageAuthenticationCode::hash(
+                QByteArrayLiteral("encryption"), masterKey, QCryptographicHash::Sha256);
+    m_authenticationKey = QMessageAuthenticationCode::hash(
+                QByteArrayLiteral("authentication"), masterKey, QCryptographicHash::Sha256);
+    wipe(&masterKey);
+    return result;
+}
+
+QByteArray CollectionArchive::frameKey() const
+{
+    // Each frame is encrypted with a distinct key, as encryption plugins
+    // may derive their initialization vector from the key.
+    QByteArray index;
+    QDataStream out(&index, QIODevice::WriteOnly);
+    out << m_frameIndex;
+    return QMessageAuthenticationCode::hash(index, m_encryptionKey, QCryptographicHash::Sha256);
+}
+
+QByteArray CollectionArchive::frameAuthenticationCode(quint32 flags, const QByteArray &ciphertext) const
+{
+    QByteArray frameHeader;
+    QDataStream out(&frameHeader, QIODevice::WriteOnly);
+    out << m_frameIndex << flags << quint32(ciphertext.size());
+
+    QMessageAuthenticationCode mac(QCryptographicHash::Sha256, m_authenticationKey);
+    mac.addData(m_header);
+    mac.addData(frameHeader);
+    mac.addData(ciphertext);
+    return mac.result();
+}
+
+CollectionArchiveWriter::CollectionArchiveWriter(EncryptionPlugin *plugin, int fd)
+    : CollectionArchive(plugin, fd)
+    , m_recordCount(0)
+{
+}
+
+CollectionArchiveWriter::~CollectionArchiveWriter()
+{
+    wipe(&m_buffer);
+}
+
+Result CollectionArchiveWriter::begin(const QByteArray &passphrase)
+{
+    Result result = checkFileDescriptor();
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    if (ftruncate(m_fd, 0) != 0) {
+        return Result(Result::UnknownError,
+                      QLatin1String("Unable to truncate the collection archive"));
+    }
+
+    QFile urandom(QLatin1String("/dev/urandom"));
+    if (!urandom.open(QIODevice::ReadOnly)) {
+        qCWarning(lcSailfishSecretsDaemon) << "Unable to read archive salt from /dev/urandom";
+        return Result(Result::UnknownError,
+                      QLatin1String("Unable to generate collection archive salt"));
+    }
+    const QByteArray salt = urandom.read(SaltSize);
+    urandom.close();
+    if (salt.size() != SaltSize) {
+        return Result(Result::UnknownError,
+                      QLatin1String("Unable to generate collection archive salt"));
+    }
+
+    result = deriveKeys(passphrase, salt);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    QByteArray headerData;
+    QDataStream out(&headerData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << ArchiveVersion << m_plugin->name() << salt;
+
+    m_header = ArchiveMagic;
+    QDataStream lengthOut(&m_header, QIODevice::Append);
+    lengthOut << quint32(headerData.size());
+    m_header.append(headerData);
+
+    m_offset = 0;
+    m_frameIndex = 0;
+    const QByteArray check = QMessageAuthenticationCode::hash(
+                m_header, m_authenticationKey, QCryptographicHash::Sha256);
+    if (!writeAll(m_fd, m_header + check, &m_offset)) {
+        return Result(Result::UnknownError,
+                      QLatin1String("Unable to write the collection archive header"));
+    }
+
+    return Result(Result::Succeeded);
+}
+
+Result CollectionArchiveWriter::append(const ArchiveRecord &record)
+{
+    {
+        QDataStream out(&m_buffer, QIODevice::Append);
+        out.setVersion(QDataStream::Qt_5_6);
+        out << record.secretName
+            << record.secretType
+            << record.cryptoPluginName
+            << record.data
+            << static_cast<const QMap<QString, QString> &>(record.filterData);
+    }
+    ++m_recordCount;
+
+    return m_buffer.size() >= FrameSize ? writeFrame(false) : Result(Result::Succeeded);
+}
+
+Result CollectionArchiveWriter::finish()
+{
+    return writeFrame(true);
+}
+
+Result CollectionArchiveWriter::writeFrame(bool finalFrame)
+{
+    QByteArray plaintext;
+    {
+        QDataStream out(&plaintext, QIODevice::WriteOnly);
+        out << m_recordCount;
+    }
+    plaintext.append(m_buffer);
+    wipe(&m_buffer);
+    m_recordCount = 0;
+
+    QByteArray ciphertext;
+    Result result = m_plugin->encryptSecret(plaintext, frameKey(), &ciphertext);
+    wipe(&plaintext);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+    if (ciphertext.size() > MaximumFrameSize) {
+        return Result(Result::SerializationError,
+                      QLatin1String("Secret is too large to be archived"));
+    }
+
+    const quint32 flags = finalFrame ? FinalFrameFlag : 0;
+    QByteArray frame;
+    {
+        QDataStream out(&frame, QIODevice::WriteOnly);
+        out << flags << quint32(ciphertext.size());
+    }
+    frame.append(ciphertext);
+    frame.append(frameAuthenticationCode(flags, ciphertext));
+
+    if (!writeAll(m_fd, frame, &m_offset)) {
+        return Result(Result::UnknownError,
+                      QLatin1String("Unable to write to the collection archive"));
+    }
+
+    ++m_frameIndex;
+    return Result(Result::Succeeded);
+}
+
+CollectionArchiveReader::CollectionArchiveReader(EncryptionPlugin *plugin, int fd)
+    : CollectionArchive(plugin, fd)
+    , m_firstFrameOffset(0)
+{
+}
+
+Result CollectionArchiveReader::begin(const QByteArray &passphrase)
+{
+    Result result = checkFileDescriptor();
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    const Result invalidArchive(Result::SerializationError,
+                                QLatin1String("Invalid collection archive"));
+
+    m_offset = 0;
+    m_frameIndex = 0;
+    QByteArray preamble;
+    if (!readAll(m_fd, &preamble, ArchiveMagic.size() + sizeof(quint32), &m_offset)
+            || !preamble.startsWith(ArchiveMagic)) {
+        return invalidArchive;
+    }
+
+    quint32 headerSize = 0;
+    {
+        QDataStream in(preamble.mid(ArchiveMagic.size()));
+        in >> headerSize;
+    }
+    QByteArray headerData;
+    if (headerSize > quint32(MaximumHeaderSize)
+            || !readAll(m_fd, &headerData, headerSize, &m_offset)) {
+        return invalidArchive;
+    }
+
+    quint32 version = 0;
+    QString pluginName;
+    QByteArray salt;
+    QDataStream in(headerData);
+    in.setVersion(QDataStream::Qt_5_6);
+    in >> version >> pluginName >> salt;
+    if (in.status() != QDataStream::Ok || version != ArchiveVersion) {
+        return invalidArchive;
+    }
+    if (pluginName != m_plugin->name()) {
+        return Result(Result::OperationNotSupportedError,
+                      QStringLiteral("Collection archive was encrypted by unavailable plugin %1").arg(pluginName));
+    }
+
+    result = deriveKeys(passphrase, salt);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    m_header = preamble + headerData;
+    QByteArray check;
+    if (!readAll(m_fd, &check, MacSize, &m_offset)) {
+        return invalidArchive;
+    }
+    if (!constantTimeEquals(check, QMessageAuthenticationCode::hash(
+                m_header, m_authenticationKey, QCryptographicHash::Sha256))) {
+        return Result(Result::IncorrectAuthenticationCodeError,
+                      QLatin1String("Incorrect collection archive passphrase"));
+    }
+
+    m_firstFrameOffset = m_offset;
+    return Result(Result::Succeeded);
+}
+
+Result CollectionArchiveReader::readFrame(QVector<ArchiveRecord> *records, bool *finalFrame)
+{
+    const Result invalidArchive(Result::SerializationError,
+                                QLatin1String("Collection archive is truncated or corrupt"));
+
+    QByteArray frameHeader;
+    if (!readAll(m_fd, &frameHeader, 2 * sizeof(quint32), &m_offset)) {
+        return invalidArchive;
+    }
+
+    quint32 flags = 0;
+    quint32 size = 0;
+    {
+        QDataStream in(frameHeader);
+        in >> flags >> size;
+    }
+
+    QByteArray ciphertext;
+    QByteArray mac;
+    if (size > quint32(MaximumFrameSize)
+            || !readAll(m_fd, &ciphertext, size, &m_offset)
+            || !readAll(m_fd, &mac, MacSize, &m_offset)
+            || !constantTimeEquals(mac, frameAuthenticationCode(flags, ciphertext))) {
+        return invalidArchive;
+    }
+
+    QByteArray plaintext;
+    Result result = m_plugin->decryptSecret(ciphertext, frameKey(), &plaintext);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    QVector<ArchiveRecord> frameRecords;
+    {
+        QDataStream in(plaintext);
+        in.setVersion(QDataStream::Qt_5_6);
+        quint32 count = 0;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            ArchiveRecord record;
+            in >> record.secretName
+               >> record.secretType
+               >> record.cryptoPluginName
+               >> record.data
+               >> static_cast<QMap<QString, QString> &>(record.filterData);
+            frameRecords.append(record);
+        }
+        if (in.status() != QDataStream::Ok) {
+            result = invalidArchive;
+        }
+    }
+    wipe(&plaintext);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    ++m_frameIndex;
+    *records = frameRecords;
+    *finalFrame = flags & FinalFrameFlag;
+    return Result(Result::Succeeded);
+}
+
+void CollectionArchiveReader::rewind()
+{
+    m_offset = m_firstFrameOffset;
+    m_frameIndex = 0;
+}
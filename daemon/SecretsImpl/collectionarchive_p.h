@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_APIIMPL_COLLECTIONARCHIVE_P_H
+#define SAILFISHSECRETS_APIIMPL_COLLECTIONARCHIVE_P_H
+
+#include "Secrets/Plugins/extensionplugins.h"
+
+#include "Secrets/secret.h"
+#include "Secrets/result.h"
+
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+namespace Daemon {
+
+namespace ApiImpl {
+
+// A single secret (or stored key) within a collection archive.
+struct ArchiveRecord {
+    QString secretName;
+    QString secretType;
+    QString cryptoPluginName;
+    QByteArray data;
+    Sailfish::Secrets::Secret::FilterData filterData;
+};
+
+// A collection archive is written to (or read from) a regular file as a
+// header followed by a sequence of frames, each of which holds a batch of
+// records.  Each frame is encrypted with its own key and authenticated
+// together with the header and its position in the stream, using keys
+// derived from a passphrase by the given encryption plugin.  The last
+// frame is flagged, so that a truncated archive is detected.
+class CollectionArchive
+{
+public:
+    enum {
+        FrameSize = 256 * 1024,         // plaintext size at which a frame is written
+        MaximumFrameSize = 64 * 1024 * 1024
+    };
+
+    CollectionArchive(Sailfish::Secrets::EncryptionPlugin *plugin, int fd);
+    ~CollectionArchive();
+
+protected:
+    Sailfish::Secrets::Result checkFileDescriptor() const;
+    Sailfish::Secrets::Result deriveKeys(const QByteArray &passphrase, const QByteArray &salt);
+    QByteArray frameKey() const;
+    QByteArray frameAuthenticationCode(quint32 flags, const QByteArray &ciphertext) const;
+
+    Sailfish::Secrets::EncryptionPlugin *m_plugin;
+    int m_fd;
+    qint64 m_offset;
+    quint64 m_frameIndex;
+    QByteArray m_header;
+    QByteArray m_encryptionKey;
+    QByteArray m_authenticationKey;
+};
+
+class CollectionArchiveWriter : public CollectionArchive
+{
+public:
+    CollectionArchiveWriter(Sailfish::Secrets::EncryptionPlugin *plugin, int fd);
+    ~CollectionArchiveWriter();
+
+    Sailfish::Secrets::Result begin(const QByteArray &passphrase);
+    Sailfish::Secrets::Result append(const ArchiveRecord &record);
+    Sailfish::Secrets::Result finish();
+
+private:
+    Sailfish::Secrets::Result writeFrame(bool finalFrame);
+
+    QByteArray m_buffer;
+    quint32 m_recordCount;
+};
+
+class CollectionArchiveReader : public CollectionArchive
+{
+public:
+    CollectionArchiveReader(Sailfish::Secrets::EncryptionPlugin *plugin, int fd);
+
+    Sailfish::Secrets::Result begin(const QByteArray &passphrase);
+    Sailfish::Secrets::Result readFrame(QVector<ArchiveRecord> *records, bool *finalFrame);
+    void rewind();
+
+private:
+    qint64 m_firstFrameOffset;
+};
+
+} // ApiImpl
+
+} // Daemon
+
+} // Secrets
+
+} // Sailfish
+
+#endif // SAILFISHSECRETS_APIIMPL_COLLECTIONARCHIVE_P_H
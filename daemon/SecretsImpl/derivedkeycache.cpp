@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "derivedkeycache_p.h"
+#include "logging_p.h"
+#include "util_p.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QMessageAuthenticationCode>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QMetaObject>
+#include <QtCore/QtEndian>
+
+using namespace Sailfish::Secrets::Daemon::ApiImpl;
+
+namespace {
+    const int IdentifierKeySize = 32;
+}
+
+DerivedKeyCache::DerivedKeyCache(QObject *parent)
+    : QObject(parent)
+{
+    // The entry identifiers are keyed with a per-process random key, so
+    // that they cannot be used to test candidate lock codes offline.
+    QFile urandom(QLatin1String("/dev/urandom"));
+    if (urandom.open(QIODevice::ReadOnly)) {
+        m_identifierKey = urandom.read(IdentifierKeySize);
+    }
+    if (m_identifierKey.size() != IdentifierKeySize) {
+        qCWarning(lcSailfishSecretsDaemon) << "Unable to generate derived key cache identifier key, caching is disabled";
+        m_identifierKey.clear();
+    }
+
+    m_clock.start();
+    m_expiryTimer.setSingleShot(true);
+    connect(&m_expiryTimer, &QTimer::timeout,
+            this, &DerivedKeyCache::expireEntries);
+}
+
+DerivedKeyCache::~DerivedKeyCache()
+{
+    clear();
+}
+
+QByteArray DerivedKeyCache::entryIdentifier(
+        const QString &pluginName,
+        const QByteArray &authenticationCode,
+        const QByteArray &salt,
+        const QByteArray &parameters) const
+{
+    const QByteArray name = pluginName.toUtf8();
+    QMessageAuthenticationCode mac(QCryptographicHash::Sha256, m_identifierKey);
+    for (const QByteArray *field : { &name, &salt, &parameters, &authenticationCode }) {
+        const quint32 size = qToBigEndian<quint32>(field->size());
+        mac.addData(reinterpret_cast<const char *>(&size), sizeof(size));
+        mac.addData(*field);
+    }
+    return mac.result();
+}
+
+bool DerivedKeyCache::lookup(
+        const QString &pluginName,
+        const QByteArray &authenticationCode,
+        const QByteArray &salt,
+        const QByteArray &parameters,
+        QByteArray *key)
+{
+    if (m_identifierKey.isEmpty()) {
+        return false;
+    }
+
+    const QByteArray identifier = entryIdentifier(pluginName, authenticationCode, salt, parameters);
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Entry>::const_iterator it = m_entries.constFind(identifier);
+    if (it == m_entries.constEnd()) {
+        return false;
+    } else if (it->expiry <= m_clock.elapsed()) {
+        removeEntry(identifier);
+        return false;
+    }
+
+    *key = QByteArray(it->data, it->length);
+    return true;
+}
+
+void DerivedKeyCache::insert(
+        const QString &pluginName,
+        const QByteArray &authenticationCode,
+        const QByteArray &salt,
+        const QByteArray &parameters,
+        const QByteArray &key)
+{
+    if (m_identifierKey.isEmpty() || key.isEmpty()) {
+        return;
+    }
+
+    const QByteArray identifier = entryIdentifier(pluginName, authenticationCode, salt, parameters);
+    {
+        QMutexLocker locker(&m_mutex);
+        removeEntry(identifier);
+        removeExpiredEntries();
+        if (m_entries.size() >= MaximumEntries) {
+            // evict the entry which would expire soonest.
+            QHash<QByteArray, Entry>::const_iterator oldest = m_entries.constBegin();
+            for (QHash<QByteArray, Entry>::const_iterator it = m_entries.constBegin();
+                    it != m_entries.constEnd(); ++it) {
+                if (it->expiry < oldest->expiry) {
+                    oldest = it;
+                }
+            }
+            removeEntry(oldest.key());
+        }
+
+        Entry entry;
+        entry.data = lockedKeyCopy(key);
+        entry.length = key.size();
+        entry.expiry = m_clock.elapsed() + TimeToLive;
+        if (!entry.data) {
+            return;
+        }
+        m_entries.insert(identifier, entry);
+    }
+
+    // (re)schedule the expiry timer from the thread which owns it.
+    QMetaObject::invokeMethod(this, "expireEntries", Qt::QueuedConnection);
+}
+
+void DerivedKeyCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    for (const Entry &entry : m_entries) {
+        wipeKey(entry.data, entry.length);
+    }
+    m_entries.clear();
+}
+
+void DerivedKeyCache::expireEntries()
+{
+    qint64 nextExpiry = -1;
+    {
+        QMutexLocker locker(&m_mutex);
+        nextExpiry = removeExpiredEntries();
+    }
+
+    if (nextExpiry < 0) {
+        m_expiryTimer.stop();
+    } else {
+        m_expiryTimer.start(qMax<qint64>(nextExpiry - m_clock.elapsed(), 0));
+    }
+}
+
+// requires m_mutex to be locked.
+void DerivedKeyCache::removeEntry(const QByteArray &identifier)
+{
+    QHash<QByteArray, Entry>::iterator it = m_entries.find(identifier);
+    if (it != m_entries.end()) {
+        wipeKey(it->data, it->length);
+        m_entries.erase(it);
+    }
+}
+
+// requires m_mutex to be locked.  Returns the expiry time of the
+// entry which will expire next, or -1 if the cache is empty.
+qint64 DerivedKeyCache::removeExpiredEntries()
+{
+    const qint64 now = m_clock.elapsed();
+    qint64 nextExpiry = -1;
+    QHash<QByteArray, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it->expiry <= now) {
+            wipeKey(it->data, it->length);
+            it = m_entries.erase(it);
+        } else {
+            if (nextExpiry < 0 || it->expiry < nextExpiry) {
+                nextExpiry = it->expiry;
+            }
+            ++it;
+        }
+    }
+    return nextExpiry;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_APIIMPL_DERIVEDKEYCACHE_P_H
+#define SAILFISHSECRETS_APIIMPL_DERIVEDKEYCACHE_P_H
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+namespace Daemon {
+
+namespace ApiImpl {
+
+// Caches the keys which plugins derive from lock codes, so that the
+// (deliberately expensive) derivation is not repeated every time a
+// custom lock collection is accessed with the same lock code.
+// Entries are identified by a keyed hash of the plugin name, salt, key
+// derivation parameters and lock code, so the lock code itself is never retained; the derived keys
+// are held in mlock()ed memory, and are wiped when they expire or when
+// the cache is cleared.  The cache may be used from any thread.
+class DerivedKeyCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        MaximumEntries = 16,
+        TimeToLive = 5 * 60 * 1000 // milliseconds
+    };
+
+    explicit DerivedKeyCache(QObject *parent = Q_NULLPTR);
+    ~DerivedKeyCache();
+
+    bool lookup(const QString &pluginName,
+                const QByteArray &authenticationCode,
+                const QByteArray &salt,
+                const QByteArray &parameters,
+                QByteArray *key);
+    void insert(const QString &pluginName,
+                const QByteArray &authenticationCode,
+                const QByteArray &salt,
+                const QByteArray &parameters,
+                const QByteArray &key);
+    void clear();
+
+private Q_SLOTS:
+    void expireEntries();
+
+private:
+    struct Entry {
+        char *data;
+        int length;
+        qint64 expiry;
+    };
+
+    QByteArray entryIdentifier(const QString &pluginName,
+                               const QByteArray &authenticationCode,
+                               const QByteArray &salt,
+                               const QByteArray &parameters) const;
+    void removeEntry(const QByteArray &identifier);
+    qint64 removeExpiredEntries();
+
+    QMutex m_mutex;
+    QHash<QByteArray, Entry> m_entries;
+    QByteArray m_identifierKey;
+    QElapsedTimer m_clock;
+    QTimer m_expiryTimer;
+};
+
+} // ApiImpl
+
+} // Daemon
+
+} // Secrets
+
+} // Sailfish
+
+#endif // SAILFISHSECRETS_APIIMPL_DERIVEDKEYCACHE_P_H
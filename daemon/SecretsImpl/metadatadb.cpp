@@ -6,6 +6,7 @@
  */
 
 #include "metadatadb_p.h"
+#include "metadatadbschema_p.h"
 #include "controller_p.h"
 
 using namespace Sailfish::Secrets;
@@ -18,62 +19,6 @@ static const char *setupEncryptionKey =
 static const char *setupReEncryptionKey =
         "\n PRAGMA rekey = \"x\'%1\'\";";
 
-static const char *setupEnforceForeignKeys =
-        "\n PRAGMA foreign_keys = ON;";
-
-static const char *setupEncoding =
-        "\n PRAGMA encoding = \"UTF-16\";";
-
-static const char *setupTempStore =
-        "\n PRAGMA temp_store = MEMORY;";
-
-static const char *setupJournal =
-        "\n PRAGMA journal_mode = WAL;";
-
-static const char *setupSynchronous =
-        "\n PRAGMA synchronous = FULL;";
-
-static const char *createCollectionsTable =
-        "\n CREATE TABLE Collections ("
-        "   CollectionId INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "   CollectionName TEXT NOT NULL,"
-        "   ApplicationId TEXT NOT NULL,"
-        "   UsesDeviceLockKey INTEGER NOT NULL,"
-        "   EncryptionPluginName TEXT NOT NULL,"
-        "   AuthenticationPluginName TEXT NOT NULL,"
-        "   UnlockSemantic INTEGER NOT NULL,"
-        "   AccessControlMode INTEGER NOT NULL,"
-        "   CONSTRAINT collectionNameUnique UNIQUE (CollectionName));";
-
-static const char *createSecretsTable =
-        "\n CREATE TABLE Secrets ("
-        "   SecretId INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "   CollectionName TEXT NOT NULL,"
-        "   SecretName TEXT NOT NULL,"
-        "   ApplicationId TEXT NOT NULL,"
-        "   UsesDeviceLockKey INTEGER NOT NULL,"
-        "   EncryptionPluginName TEXT NOT NULL,"
-        "   AuthenticationPluginName TEXT NOT NULL,"
-        "   UnlockSemantic INTEGER NOT NULL,"
-        "   AccessControlMode INTEGER NOT NULL,"
-        "   Type Text,"
-        "   CryptoPluginName TEXT,"
-        "   FOREIGN KEY (CollectionName) REFERENCES Collections(CollectionName) ON DELETE CASCADE,"
-        "   CONSTRAINT collectionSecretNameUnique UNIQUE (CollectionName, SecretName));";
-
-static const char *createStatements[] =
-{
-    createCollectionsTable,
-    createSecretsTable,
-    NULL
-};
-
-static Daemon::Sqlite::UpgradeOperation upgradeVersions[] = {
-    { 0, 0 },
-};
-
-static const int currentSchemaVersion = 1;
-
 Daemon::ApiImpl::MetadataDatabase::MetadataDatabase(
         const QString &defaultEncryptionPluginName,
         const QString &defaultAuthenticationPluginName,
@@ -127,6 +72,9 @@ bool Daemon::ApiImpl::MetadataDatabase::openDatabase(const QByteArray &hexKey)
                              m_autotestMode);
 
     if (success) {
+        // the request processor checkpoints the metadata database when idle.
+        m_db.enableIdleCheckpoints();
+
         QStringList cnames;
         Result result = collectionNames(&cnames, false);
         if (!cnames.contains(QStringLiteral("standalone"))) {
@@ -180,6 +128,21 @@ bool Daemon::ApiImpl::MetadataDatabase::withinTransaction()
     return m_db.withinTransaction();
 }
 
+QVariantMap Daemon::ApiImpl::MetadataDatabase::statementCacheStatistics() const
+{
+    return m_db.statementCacheStatistics();
+}
+
+bool Daemon::ApiImpl::MetadataDatabase::checkpointPending() const
+{
+    return m_db.checkpointPending();
+}
+
+bool Daemon::ApiImpl::MetadataDatabase::checkpoint()
+{
+    return m_db.checkpoint();
+}
+
 Result
 Daemon::ApiImpl::MetadataDatabase::isLocked(
         bool *locked) const
@@ -316,10 +279,11 @@ Daemon::ApiImpl::MetadataDatabase::insertCollectionMetadata(
                   "EncryptionPluginName,"
                   "AuthenticationPluginName,"
                   "UnlockSemantic,"
-                  "AccessControlMode"
+                  "AccessControlMode,"
+                  "KeyDerivationParameters"
                 ")"
                 " VALUES ("
-                  "?,?,?,?,?,?,?"
+                  "?,?,?,?,?,?,?,?"
                 ");");
 
     QString errorText;
@@ -336,7 +300,8 @@ Daemon::ApiImpl::MetadataDatabase::insertCollectionMetadata(
             << metadata.encryptionPluginName
             << metadata.authenticationPluginName
             << metadata.unlockSemantic
-            << static_cast<int>(metadata.accessControlMode);
+            << static_cast<int>(metadata.accessControlMode)
+            << metadata.keyDerivationParameters;
     iq.bindValues(ivalues);
 
     if (!m_db.execute(iq, &errorText)) {
@@ -431,7 +396,8 @@ Daemon::ApiImpl::MetadataDatabase::collectionMetadata(
                     " EncryptionPluginName,"
                     " AuthenticationPluginName,"
                     " UnlockSemantic,"
-                    " AccessControlMode"
+                    " AccessControlMode,"
+                    " KeyDerivationParameters"
                   " FROM Collections"
                   " WHERE CollectionName = ?;"
              );
@@ -461,6 +427,37 @@ Daemon::ApiImpl::MetadataDatabase::collectionMetadata(
         metadata->authenticationPluginName = sq.value(3).value<QString>();
         metadata->unlockSemantic = sq.value(4).value<int>();
         metadata->accessControlMode = static_cast<SecretManager::AccessControlMode>(sq.value(5).value<int>());
+        metadata->keyDerivationParameters = sq.value(6).value<QByteArray>();
+    }
+
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::ApiImpl::MetadataDatabase::updateCollectionKeyDerivationParameters(
+        const QString &collectionName,
+        const QByteArray &keyDerivationParameters)
+{
+    const QString updateCollectionQuery = QStringLiteral(
+                "UPDATE Collections"
+                " SET KeyDerivationParameters = ?"
+                " WHERE CollectionName = ?;");
+
+    QString errorText;
+    Daemon::Sqlite::Database::Query uq = m_db.prepare(updateCollectionQuery, &errorText);
+    if (!errorText.isEmpty()) {
+        return Result(Result::DatabaseQueryError,
+                      QString::fromLatin1("Unable to prepare update collection query: %1").arg(errorText));
+    }
+
+    QVariantList values;
+    values << QVariant::fromValue<QByteArray>(keyDerivationParameters);
+    values << QVariant::fromValue<QString>(collectionName);
+    uq.bindValues(values);
+
+    if (!m_db.execute(uq, &errorText)) {
+        return Result(Result::DatabaseQueryError,
+                      QString::fromLatin1("Unable to execute update collection query: %1").arg(errorText));
     }
 
     return Result(Result::Succeeded);
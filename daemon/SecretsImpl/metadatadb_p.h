@@ -41,6 +41,7 @@ public:
     QString authenticationPluginName;
     int unlockSemantic;
     Sailfish::Secrets::SecretManager::AccessControlMode accessControlMode;
+    QByteArray keyDerivationParameters; // empty if the plugin's original key derivation is used
 };
 
 class SecretMetadata
@@ -77,6 +78,10 @@ public:
     bool rollbackTransaction();
     bool withinTransaction();
 
+    QVariantMap statementCacheStatistics() const;
+    bool checkpointPending() const;
+    bool checkpoint();
+
     Sailfish::Secrets::Result isLocked(
             bool *locked) const;
 
@@ -105,6 +110,10 @@ public:
             CollectionMetadata *metadata,
             bool *exists);
 
+    Sailfish::Secrets::Result updateCollectionKeyDerivationParameters(
+            const QString &collectionName,
+            const QByteArray &keyDerivationParameters);
+
     Sailfish::Secrets::Result deleteCollectionMetadata(
             const QString &collectionName);
 
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_APIIMPL_METADATADBSCHEMA_P_H
+#define SAILFISHSECRETS_APIIMPL_METADATADBSCHEMA_P_H
+
+#include "database_p.h"
+
+static const char *setupEnforceForeignKeys =
+        "\n PRAGMA foreign_keys = ON;";
+
+static const char *setupEncoding =
+        "\n PRAGMA encoding = \"UTF-16\";";
+
+static const char *setupTempStore =
+        "\n PRAGMA temp_store = MEMORY;";
+
+static const char *setupJournal =
+        "\n PRAGMA journal_mode = WAL;";
+
+static const char *setupSynchronous =
+        "\n PRAGMA synchronous = FULL;";
+
+static const char *createCollectionsTable =
+        "\n CREATE TABLE Collections ("
+        "   CollectionId INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "   CollectionName TEXT NOT NULL,"
+        "   ApplicationId TEXT NOT NULL,"
+        "   UsesDeviceLockKey INTEGER NOT NULL,"
+        "   EncryptionPluginName TEXT NOT NULL,"
+        "   AuthenticationPluginName TEXT NOT NULL,"
+        "   UnlockSemantic INTEGER NOT NULL,"
+        "   AccessControlMode INTEGER NOT NULL,"
+        "   KeyDerivationParameters BLOB,"
+        "   CONSTRAINT collectionNameUnique UNIQUE (CollectionName));";
+
+static const char *createSecretsTable =
+        "\n CREATE TABLE Secrets ("
+        "   SecretId INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "   CollectionName TEXT NOT NULL,"
+        "   SecretName TEXT NOT NULL,"
+        "   ApplicationId TEXT NOT NULL,"
+        "   UsesDeviceLockKey INTEGER NOT NULL,"
+        "   EncryptionPluginName TEXT NOT NULL,"
+        "   AuthenticationPluginName TEXT NOT NULL,"
+        "   UnlockSemantic INTEGER NOT NULL,"
+        "   AccessControlMode INTEGER NOT NULL,"
+        "   Type Text,"
+        "   CryptoPluginName TEXT,"
+        "   FOREIGN KEY (CollectionName) REFERENCES Collections(CollectionName) ON DELETE CASCADE,"
+        "   CONSTRAINT collectionSecretNameUnique UNIQUE (CollectionName, SecretName));";
+
+static const char *createStatements[] =
+{
+    createCollectionsTable,
+    createSecretsTable,
+    NULL
+};
+
+static const char *upgradeVersion1[] = {
+    "\n ALTER TABLE Collections ADD COLUMN KeyDerivationParameters BLOB;",
+    "PRAGMA user_version=2",
+    NULL
+};
+
+static Sailfish::Secrets::Daemon::Sqlite::UpgradeOperation upgradeVersions[] = {
+    { 0, upgradeVersion1 },
+    { 0, 0 },
+};
+
+static const int currentSchemaVersion = 2;
+
+#endif // SAILFISHSECRETS_APIIMPL_METADATADBSCHEMA_P_H
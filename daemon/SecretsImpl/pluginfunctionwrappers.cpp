@@ -6,11 +6,249 @@
  */
 
 #include "pluginfunctionwrappers_p.h"
+#include "collectionarchive_p.h"
 #include "logging_p.h"
+#include "statistics_p.h"
+#include "plugin_p.h"
+
+#include <QtCore/QSet>
 
 using namespace Sailfish::Secrets;
 using namespace Sailfish::Secrets::Daemon::ApiImpl;
 
+namespace {
+    // Writes every secret in the collection into the archive, reading the
+    // (plaintext) data and filter data of each via the given readSecret.
+    template <typename ReadSecret>
+    Result exportCollectionSecrets(
+            PluginWrapper *plugin,
+            const CollectionArchiveInfo &archive,
+            const QString &collectionName,
+            ReadSecret readSecret)
+    {
+        QStringList secretNames;
+        Result result = plugin->secretNames(collectionName, &secretNames);
+        if (result.code() != Result::Succeeded) {
+            return result;
+        }
+
+        CollectionArchiveWriter writer(archive.encryptionPlugin, archive.fileDescriptor.fileDescriptor());
+        result = writer.begin(archive.passphrase);
+        if (result.code() != Result::Succeeded) {
+            return result;
+        }
+
+        for (const QString &secretName : secretNames) {
+            SecretMetadata metadata;
+            result = plugin->secretMetadata(collectionName, secretName, &metadata);
+            if (result.code() != Result::Succeeded) {
+                return result;
+            }
+
+            ArchiveRecord record;
+            record.secretName = secretName;
+            record.secretType = metadata.secretType;
+            record.cryptoPluginName = metadata.cryptoPluginName;
+            result = readSecret(secretName, &record.data, &record.filterData);
+            if (result.code() == Result::Succeeded) {
+                result = writer.append(record);
+            }
+            record.data.fill('\0');
+            if (result.code() != Result::Succeeded) {
+                return result;
+            }
+        }
+
+        return writer.finish();
+    }
+
+    // Reads the secrets from the archive into the collection, one frame at a
+    // time via the given writeSecrets.  The whole archive is authenticated,
+    // and checked for secrets which already exist in the collection, before
+    // anything is written, and any secrets which were imported are removed
+    // via the given removeSecret if a later frame cannot be written.
+    template <typename WriteSecrets, typename RemoveSecret>
+    Result importCollectionSecrets(
+            PluginWrapper *plugin,
+            const CollectionArchiveInfo &archive,
+            const CollectionMetadata &collectionMetadata,
+            WriteSecrets writeSecrets,
+            RemoveSecret removeSecret)
+    {
+        QStringList existingSecretNames;
+        Result result = plugin->secretNames(collectionMetadata.collectionName, &existingSecretNames);
+        if (result.code() != Result::Succeeded) {
+            return result;
+        }
+
+        CollectionArchiveReader reader(archive.encryptionPlugin, archive.fileDescriptor.fileDescriptor());
+        result = reader.begin(archive.passphrase);
+        if (result.code() != Result::Succeeded) {
+            return result;
+        }
+
+        QSet<QString> secretNames = existingSecretNames.toSet();
+        bool finalFrame = false;
+        while (!finalFrame) {
+            QVector<ArchiveRecord> records;
+            result = reader.readFrame(&records, &finalFrame);
+            if (result.code() != Result::Succeeded) {
+                return result;
+            }
+            for (ArchiveRecord &record : records) {
+                if (record.secretName.isEmpty()) {
+                    return Result(Result::SerializationError,
+                                  QLatin1String("Collection archive contains a secret without a name"));
+                } else if (secretNames.contains(record.secretName)) {
+                    return Result(Result::SecretAlreadyExistsError,
+                                  QStringLiteral("Secret %1 already exists in collection %2")
+                                  .arg(record.secretName, collectionMetadata.collectionName));
+                }
+                secretNames.insert(record.secretName);
+                record.data.fill('\0');
+            }
+        }
+
+        reader.rewind();
+        QStringList importedSecretNames;
+        finalFrame = false;
+        while (!finalFrame && result.code() == Result::Succeeded) {
+            QVector<ArchiveRecord> records;
+            result = reader.readFrame(&records, &finalFrame);
+            if (result.code() != Result::Succeeded) {
+                break;
+            }
+
+            QVector<SecretMetadata> metadata;
+            QVector<Secret> secrets;
+            for (ArchiveRecord &record : records) {
+                SecretMetadata secretMetadata;
+                secretMetadata.collectionName = collectionMetadata.collectionName;
+                secretMetadata.secretName = record.secretName;
+                secretMetadata.ownerApplicationId = collectionMetadata.ownerApplicationId;
+                secretMetadata.usesDeviceLockKey = collectionMetadata.usesDeviceLockKey;
+                secretMetadata.encryptionPluginName = collectionMetadata.encryptionPluginName;
+                secretMetadata.authenticationPluginName = collectionMetadata.authenticationPluginName;
+                secretMetadata.unlockSemantic = collectionMetadata.unlockSemantic;
+                secretMetadata.accessControlMode = collectionMetadata.accessControlMode;
+                secretMetadata.secretType = record.secretType;
+                secretMetadata.cryptoPluginName = record.cryptoPluginName;
+                metadata.append(secretMetadata);
+
+                Secret secret(record.secretName, collectionMetadata.collectionName, plugin->name());
+                secret.setData(record.data);
+                secret.setFilterData(record.filterData);
+                secrets.append(secret);
+                record.data.fill('\0');
+            }
+
+            result = writeSecrets(metadata, secrets);
+            if (result.code() == Result::Succeeded) {
+                for (const ArchiveRecord &record : records) {
+                    importedSecretNames.append(record.secretName);
+                }
+            }
+        }
+
+        if (result.code() != Result::Succeeded) {
+            for (const QString &secretName : importedSecretNames) {
+                Result removeResult = removeSecret(secretName);
+                if (removeResult.code() != Result::Succeeded) {
+                    qCWarning(lcSailfishSecretsDaemon) << "Unable to remove imported secret" << secretName
+                                                       << "after failed import:" << removeResult.errorMessage();
+                }
+            }
+        }
+
+        return result;
+    }
+
+    Result unlockCollection(
+            EncryptedStoragePluginWrapper *plugin,
+            const QString &collectionName,
+            const QByteArray &encryptionKey,
+            bool *originallyLocked)
+    {
+        bool locked = false;
+        Result pluginResult = plugin->isCollectionLocked(collectionName, &locked);
+        if (pluginResult.code() != Result::Succeeded) {
+            return pluginResult;
+        }
+
+        // if it's locked, attempt to unlock it
+        *originallyLocked = locked;
+        if (locked) {
+            pluginResult = plugin->setEncryptionKey(collectionName, encryptionKey);
+            if (pluginResult.code() != Result::Succeeded) {
+                // unable to apply the new encryptionKey.
+                plugin->setEncryptionKey(collectionName, QByteArray());
+                return Result(Result::SecretsPluginDecryptionError,
+                              QString::fromLatin1("Unable to decrypt collection %1 with the entered authentication key").arg(collectionName));
+            }
+            pluginResult = plugin->isCollectionLocked(collectionName, &locked);
+            if (pluginResult.code() != Result::Succeeded) {
+                plugin->setEncryptionKey(collectionName, QByteArray());
+                return Result(Result::SecretsPluginDecryptionError,
+                              QString::fromLatin1("Unable to check lock state of collection %1 after setting the entered authentication key").arg(collectionName));
+            }
+        }
+
+        if (locked) {
+            // still locked, even after applying the new encryptionKey?  The authenticationCode was wrong.
+            plugin->setEncryptionKey(collectionName, QByteArray());
+            return Result(Result::IncorrectAuthenticationCodeError,
+                          QString::fromLatin1("The authentication code entered for collection %1 was incorrect").arg(collectionName));
+        }
+
+        return Result(Result::Succeeded);
+    }
+
+    void relockCollectionIfRequired(
+            EncryptedStoragePluginWrapper *plugin,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &encryptionKey,
+            bool originallyLocked)
+    {
+        if (originallyLocked
+                && ((collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked)
+                    || (!collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked))) {
+            Result relockResult = plugin->relockCollection(collectionMetadata.collectionName, encryptionKey);
+            if (relockResult.code() != Result::Succeeded) {
+                qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << collectionMetadata.collectionName
+                                                   << relockResult.errorMessage();
+            }
+        }
+    }
+
+    // Stores a group of queued writes to one collection with a single call
+    // to setSecrets, i.e. in one transaction, and sets the result of each.
+    // If that fails (e.g. because one of the secrets already exists) nothing
+    // was stored, so the writes are then stored one at a time, so that each
+    // caller gets the result of its own write.
+    template <typename SetSecrets, typename SetSecret>
+    void storeSecretGroup(
+            const QVector<SecretWriteQueue::WritePointer> &writes,
+            const QVector<SecretMetadata> &metadata,
+            const QVector<Secret> &secrets,
+            SetSecrets setSecrets,
+            SetSecret setSecret)
+    {
+        if (writes.size() > 1) {
+            const Result result = setSecrets(metadata, secrets);
+            if (result.code() == Result::Succeeded) {
+                for (const SecretWriteQueue::WritePointer &write : writes) {
+                    write->result = result;
+                }
+                return;
+            }
+        }
+
+        for (int i = 0; i < writes.size(); ++i) {
+            writes[i]->result = setSecret(metadata[i], secrets[i]);
+        }
+    }
+}
+
 /* These methods are to be called via QtConcurrent */
 
 PluginState Daemon::ApiImpl::pluginState(PluginBase *plugin)
@@ -205,6 +443,7 @@ bool Daemon::ApiImpl::masterLockPlugins(
     auto lambda = [] (PluginWrapper *p,
                       const QString &type,
                       bool *succeeded) {
+        PluginCallTimer timer(p->name());
         if (!p->isMasterLocked()) {
             if (!p->masterLock()) {
                 qCWarning(lcSailfishSecretsDaemon) << "Failed to master-lock" << type << "plugin:" << p->name();
@@ -218,11 +457,34 @@ bool Daemon::ApiImpl::masterLockPlugins(
         lambda(splugin, QStringLiteral("storage"), &allSucceeded);
     }
     for (EncryptedStoragePluginWrapper *esplugin : encryptedStoragePlugins) {
+        // don't leave any collections open once the plugin is master-locked.
+        esplugin->relockWarmCollections(false);
         lambda(esplugin, QStringLiteral("encrypted storage"), &allSucceeded);
     }
     return allSucceeded;
 }
 
+void Daemon::ApiImpl::checkpointPlugins(
+        const QList<StoragePluginWrapper*> &storagePlugins,
+        const QList<EncryptedStoragePluginWrapper*> &encryptedStoragePlugins)
+{
+    auto lambda = [] (PluginWrapper *p) {
+        if (p->metadataCheckpointPending()) {
+            PluginCallTimer timer(p->name());
+            if (!p->checkpointMetadata()) {
+                qCWarning(lcSailfishSecretsDaemon) << "Failed to checkpoint metadata for plugin:" << p->name();
+            }
+        }
+    };
+
+    for (StoragePluginWrapper *splugin : storagePlugins) {
+        lambda(splugin);
+    }
+    for (EncryptedStoragePluginWrapper *esplugin : encryptedStoragePlugins) {
+        lambda(esplugin);
+    }
+}
+
 bool Daemon::ApiImpl::masterUnlockPlugins(
         const QList<StoragePluginWrapper*> &storagePlugins,
         const QList<EncryptedStoragePluginWrapper*> &encryptedStoragePlugins,
@@ -232,10 +494,14 @@ bool Daemon::ApiImpl::masterUnlockPlugins(
                       const QByteArray &key,
                       const QString &type,
                       bool *succeeded) {
+        PluginCallTimer timer(p->name());
         if (p->isMasterLocked()) {
             if (!p->masterUnlock(key)) {
                 qCWarning(lcSailfishSecretsDaemon) << "Failed to master-unlock" << type << "plugin:" << p->name();
+                PluginManager::instance()->setPluginAvailable(p->name(), false);
                 *succeeded = false;
+            } else {
+                PluginManager::instance()->setPluginAvailable(p->name(), true);
             }
         }
     };
@@ -261,6 +527,7 @@ bool Daemon::ApiImpl::modifyMasterLockPlugins(
                       const QByteArray &newKey,
                       const QString &type,
                       bool *succeeded) {
+        PluginCallTimer timer(p->name());
         if (p->isMasterLocked()) {
             if (!p->masterUnlock(oldKey)) {
                 qCWarning(lcSailfishSecretsDaemon) << "Failed to master-unlock" << type << "plugin:" << p->name();
@@ -292,6 +559,7 @@ IdentifiersResult Daemon::ApiImpl::storedKeyIdentifiers(
                       const QVariantMap &customParameters,
                       Result *result,
                       QVector<Secret::Identifier> *idents) {
+        PluginCallTimer timer(p->name());
         QMap<QString, bool> cnamesMap;
         QStringList cnames;
         QStringList knames;
@@ -368,9 +636,10 @@ IdentifiersResult Daemon::ApiImpl::storedKeyIdentifiersFromCollection(
     auto relockLambda = [] (EncryptedStoragePluginWrapper *p,
                             bool locked,
                             bool relock,
-                            const QString &cname) {
+                            const QString &cname,
+                            const QByteArray &key) {
         if (locked && relock) {
-            Result relockResult = p->setEncryptionKey(cname, QByteArray());
+            Result relockResult = p->relockCollection(cname, key);
             if (relockResult.code() != Result::Succeeded) {
                 qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << cname
                                                    << relockResult.errorMessage();
@@ -412,7 +681,8 @@ IdentifiersResult Daemon::ApiImpl::storedKeyIdentifiersFromCollection(
             }
             relockLambda(cryptoStoragePlugin, wasLocked,
                          collectionInfo.relockRequired,
-                         collectionInfo.collectionName);
+                         collectionInfo.collectionName,
+                         collectionInfo.collectionKey);
         }
     } else if (encryptedStoragePlugin) {
         bool wasLocked = false;
@@ -421,26 +691,30 @@ IdentifiersResult Daemon::ApiImpl::storedKeyIdentifiersFromCollection(
                      customParameters,
                      collectionInfo.collectionKey,
                      &wasLocked, &result, &idents);
-        relockLambda(cryptoStoragePlugin, wasLocked,
+        relockLambda(encryptedStoragePlugin, wasLocked,
                      collectionInfo.relockRequired,
-                     collectionInfo.collectionName);
+                     collectionInfo.collectionName,
+                     collectionInfo.collectionKey);
     }
     return IdentifiersResult(result, idents);
 }
 
 bool EncryptionPluginFunctionWrapper::isLocked(EncryptionPlugin *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->isLocked();
 }
 
 bool EncryptionPluginFunctionWrapper::lock(EncryptionPlugin *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->lock();
 }
 
 bool EncryptionPluginFunctionWrapper::unlock(EncryptionPlugin *plugin,
                                      const QByteArray &lockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->unlock(lockCode);
 }
 
@@ -448,26 +722,49 @@ bool setLockCode(EncryptionPlugin *plugin,
                  const QByteArray &oldLockCode,
                  const QByteArray &newLockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setLockCode(oldLockCode, newLockCode);
 }
 
 DerivedKeyResult
 EncryptionPluginFunctionWrapper::deriveKeyFromCode(
         EncryptionPlugin *plugin,
+        DerivedKeyCache *cache,
         const QByteArray &authenticationCode,
-        const QByteArray &salt)
+        const QByteArray &salt,
+        const QByteArray &parameters)
 {
     QByteArray key;
-    Result result = plugin->deriveKeyFromCode(authenticationCode, salt, &key);
+    if (cache->lookup(plugin->name(), authenticationCode, salt, parameters, &key)) {
+        return DerivedKeyResult(Result(Result::Succeeded), key);
+    }
+
+    PluginCallTimer timer(plugin->name());
+    Result result = plugin->deriveKeyFromCodeWithParameters(authenticationCode, salt, parameters, &key);
+    if (result.code() == Result::Succeeded) {
+        cache->insert(plugin->name(), authenticationCode, salt, parameters, key);
+    }
     return DerivedKeyResult(result, key);
 }
 
+KeyDerivationParametersResult
+EncryptionPluginFunctionWrapper::calibrateKeyDerivation(
+        EncryptionPlugin *plugin,
+        int targetDuration)
+{
+    PluginCallTimer timer(plugin->name());
+    QByteArray parameters;
+    Result result = plugin->calibrateKeyDerivation(targetDuration, &parameters);
+    return KeyDerivationParametersResult(result, parameters);
+}
+
 EncryptionPluginFunctionWrapper::DataResult
 EncryptionPluginFunctionWrapper::encryptSecret(
         EncryptionPlugin *plugin,
         const QByteArray &plaintext,
         const QByteArray &key)
 {
+    PluginCallTimer timer(plugin->name());
     QByteArray ciphertext;
     Result result = plugin->encryptSecret(plaintext, key, &ciphertext);
     return EncryptionPluginFunctionWrapper::DataResult(result, ciphertext);
@@ -479,6 +776,7 @@ EncryptionPluginFunctionWrapper::decryptSecret(
         const QByteArray &encrypted,
         const QByteArray &key)
 {
+    PluginCallTimer timer(plugin->name());
     QByteArray plaintext;
     Result result = plugin->decryptSecret(encrypted, key, &plaintext);
     return EncryptionPluginFunctionWrapper::DataResult(result, plaintext);
@@ -486,11 +784,13 @@ EncryptionPluginFunctionWrapper::decryptSecret(
 
 bool StoragePluginFunctionWrapper::isLocked(StoragePluginWrapper *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->isLocked();
 }
 
 bool StoragePluginFunctionWrapper::lock(StoragePluginWrapper *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->lock();
 }
 
@@ -498,6 +798,7 @@ bool StoragePluginFunctionWrapper::unlock(
         StoragePluginWrapper *plugin,
         const QByteArray &lockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->unlock(lockCode);
 }
 
@@ -506,6 +807,7 @@ bool StoragePluginFunctionWrapper::setLockCode(
         const QByteArray &oldLockCode,
         const QByteArray &newLockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setLockCode(oldLockCode, newLockCode);
 }
 
@@ -513,6 +815,7 @@ CollectionMetadataResult StoragePluginFunctionWrapper::collectionMetadata(
         StoragePluginWrapper *plugin,
         const QString &collectionName)
 {
+    PluginCallTimer timer(plugin->name());
     CollectionMetadata metadata;
     Result result = plugin->collectionMetadata(collectionName, &metadata);
     return CollectionMetadataResult(result, metadata);
@@ -523,6 +826,7 @@ SecretMetadataResult StoragePluginFunctionWrapper::secretMetadata(
         const QString &collectionName,
         const QString &secretName)
 {
+    PluginCallTimer timer(plugin->name());
     SecretMetadata metadata;
     Result result = plugin->secretMetadata(collectionName, secretName, &metadata);
     return SecretMetadataResult(result, metadata);
@@ -531,6 +835,7 @@ SecretMetadataResult StoragePluginFunctionWrapper::secretMetadata(
 CollectionNamesResult StoragePluginFunctionWrapper::collectionNames(
         StoragePluginWrapper *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     QMap<QString, bool> cnamesMap;
     Result result = plugin->collectionNames(&cnamesMap);
     return CollectionNamesResult(result, cnamesMap);
@@ -540,6 +845,7 @@ Result StoragePluginFunctionWrapper::createCollection(
         StoragePluginWrapper *plugin,
         const CollectionMetadata &metadata)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->createCollection(metadata);
 }
 
@@ -547,6 +853,7 @@ Result StoragePluginFunctionWrapper::removeCollection(
         StoragePluginWrapper *plugin,
         const QString &collectionName)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->removeCollection(collectionName);
 }
 
@@ -556,6 +863,7 @@ Result StoragePluginFunctionWrapper::setSecret(
         const QByteArray &secret,
         const Secret::FilterData &filterData)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setSecret(secretMetadata,
                              secret,
                              filterData);
@@ -567,6 +875,7 @@ StoragePluginFunctionWrapper::getSecret(
         const QString &collectionName,
         const QString &secretName)
 {
+    PluginCallTimer timer(plugin->name());
     QByteArray secret;
     Secret::FilterData filterData;
     Result result = plugin->getSecret(collectionName,
@@ -582,6 +891,7 @@ Result StoragePluginFunctionWrapper::removeSecret(
         const QString &collectionName,
         const QString &secretName)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->removeSecret(collectionName,
                                 secretName);
 }
@@ -594,6 +904,7 @@ Result StoragePluginFunctionWrapper::reencrypt(
         const QByteArray &newkey,
         EncryptionPlugin *encryptionPlugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->reencrypt(collectionName,
                              secretNames,
                              oldkey,
@@ -608,6 +919,7 @@ Result StoragePluginFunctionWrapper::encryptAndStoreSecret(
         const Secret &secret,
         const QByteArray &encryptionKey)
 {
+    PluginCallTimer timer(storagePlugin->name());
     QByteArray encrypted;
     Result pluginResult = encryptionPlugin->encryptSecret(
                 secret.data(), encryptionKey, &encrypted);
@@ -620,12 +932,52 @@ Result StoragePluginFunctionWrapper::encryptAndStoreSecret(
     return pluginResult;
 }
 
+Result StoragePluginFunctionWrapper::encryptAndStoreQueuedSecrets(
+        EncryptionPlugin *encryptionPlugin,
+        StoragePluginWrapper *storagePlugin,
+        const SecretWriteQueue::WritePointer &write)
+{
+    SecretWriteQueue *queue = storagePlugin->secretWriteQueue();
+    const QVector<SecretWriteQueue::WritePointer> group = queue->takeGroup(write);
+    if (!group.isEmpty()) {
+        PluginCallTimer timer(storagePlugin->name());
+        QVector<SecretWriteQueue::WritePointer> encryptedWrites;
+        QVector<SecretMetadata> metadata;
+        QVector<Secret> secrets;
+        for (const SecretWriteQueue::WritePointer &queued : group) {
+            QByteArray encrypted;
+            queued->result = encryptionPlugin->encryptSecret(
+                        queued->secret.data(), queued->encryptionKey, &encrypted);
+            if (queued->result.code() == Result::Succeeded) {
+                Secret secret(queued->secret);
+                secret.setData(encrypted);
+                encryptedWrites.append(queued);
+                metadata.append(queued->metadata);
+                secrets.append(secret);
+            }
+        }
+
+        storeSecretGroup(
+                    encryptedWrites, metadata, secrets,
+                    [storagePlugin] (const QVector<SecretMetadata> &groupMetadata, const QVector<Secret> &groupSecrets) {
+                        return storagePlugin->setSecrets(groupMetadata, groupSecrets);
+                    },
+                    [storagePlugin] (const SecretMetadata &secretMetadata, const Secret &secret) {
+                        return storagePlugin->setSecret(secretMetadata, secret.data(), secret.filterData());
+                    });
+        queue->finishGroup(group);
+    }
+
+    return queue->waitForResult(write);
+}
+
 SecretResult StoragePluginFunctionWrapper::getAndDecryptSecret(
         EncryptionPlugin *encryptionPlugin,
         StoragePluginWrapper *storagePlugin,
         const Secret::Identifier &identifier,
         const QByteArray &encryptionKey)
 {
+    PluginCallTimer timer(storagePlugin->name());
     Secret secret;
     QByteArray encrypted;
     Secret::FilterData filterData;
@@ -652,6 +1004,7 @@ StoragePluginFunctionWrapper::findSecrets(
         const Sailfish::Secrets::Secret::FilterData &filter,
         Sailfish::Secrets::StoragePlugin::FilterOperator filterOp)
 {
+    PluginCallTimer timer(storagePlugin->name());
     QVector<Secret::Identifier> identifiers;
     QStringList secretNames;
     Result pluginResult = storagePlugin->findSecrets(collectionName, filter, filterOp, &secretNames);
@@ -662,6 +1015,54 @@ StoragePluginFunctionWrapper::findSecrets(
     return IdentifiersResult(pluginResult, identifiers);
 }
 
+Result StoragePluginFunctionWrapper::exportCollection(
+        EncryptionPlugin *encryptionPlugin,
+        StoragePluginWrapper *storagePlugin,
+        const CollectionArchiveInfo &archive,
+        const QString &collectionName,
+        const QByteArray &encryptionKey)
+{
+    PluginCallTimer timer(storagePlugin->name());
+    return exportCollectionSecrets(
+                storagePlugin, archive, collectionName,
+                [encryptionPlugin, storagePlugin, &collectionName, &encryptionKey] (
+                        const QString &secretName, QByteArray *data, Secret::FilterData *filterData) {
+                    QByteArray encrypted;
+                    Result result = storagePlugin->getSecret(collectionName, secretName, &encrypted, filterData);
+                    if (result.code() == Result::Succeeded) {
+                        result = encryptionPlugin->decryptSecret(encrypted, encryptionKey, data);
+                    }
+                    return result;
+                });
+}
+
+Result StoragePluginFunctionWrapper::importCollection(
+        EncryptionPlugin *encryptionPlugin,
+        StoragePluginWrapper *storagePlugin,
+        const CollectionArchiveInfo &archive,
+        const CollectionMetadata &collectionMetadata,
+        const QByteArray &encryptionKey)
+{
+    PluginCallTimer timer(storagePlugin->name());
+    return importCollectionSecrets(
+                storagePlugin, archive, collectionMetadata,
+                [encryptionPlugin, storagePlugin, &encryptionKey] (
+                        const QVector<SecretMetadata> &metadata, QVector<Secret> secrets) {
+                    for (Secret &secret : secrets) {
+                        QByteArray encrypted;
+                        Result result = encryptionPlugin->encryptSecret(secret.data(), encryptionKey, &encrypted);
+                        if (result.code() != Result::Succeeded) {
+                            return result;
+                        }
+                        secret.setData(encrypted);
+                    }
+                    return storagePlugin->setSecrets(metadata, secrets);
+                },
+                [storagePlugin, &collectionMetadata] (const QString &secretName) {
+                    return storagePlugin->removeSecret(collectionMetadata.collectionName, secretName);
+                });
+}
+
 Result
 StoragePluginFunctionWrapper::reencryptDeviceLockedCollectionsAndSecrets(
         StoragePluginWrapper *plugin,
@@ -669,6 +1070,7 @@ StoragePluginFunctionWrapper::reencryptDeviceLockedCollectionsAndSecrets(
         const QByteArray &oldEncryptionKey,
         const QByteArray &newEncryptionKey)
 {
+    PluginCallTimer timer(plugin->name());
     // get collection names
     // foreach collection, get metadata
     // if usesDeviceLockKey, re-encrypt
@@ -757,6 +1159,7 @@ StoragePluginFunctionWrapper::collectionSecretPreCheck(
         const QString &secretName,
         bool newSecret)
 {
+    PluginCallTimer timer(plugin->name());
     QStringList cnames;
     QMap<QString, bool> cnamesMap;
     Result result = plugin->collectionNames(&cnamesMap);
@@ -800,18 +1203,27 @@ StoragePluginFunctionWrapper::collectionSecretPreCheck(
 
 bool EncryptedStoragePluginFunctionWrapper::isLocked(EncryptedStoragePluginWrapper *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->isLocked();
 }
 
 bool EncryptedStoragePluginFunctionWrapper::lock(EncryptedStoragePluginWrapper *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->lock();
 }
 
+void EncryptedStoragePluginFunctionWrapper::relockWarmCollections(EncryptedStoragePluginWrapper *plugin)
+{
+    PluginCallTimer timer(plugin->name());
+    plugin->relockWarmCollections(true);
+}
+
 bool EncryptedStoragePluginFunctionWrapper::unlock(
         EncryptedStoragePluginWrapper *plugin,
         const QByteArray &lockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->unlock(lockCode);
 }
 
@@ -820,6 +1232,7 @@ bool EncryptedStoragePluginFunctionWrapper::setLockCode(
         const QByteArray &oldLockCode,
         const QByteArray &newLockCode)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setLockCode(oldLockCode, newLockCode);
 }
 
@@ -827,6 +1240,7 @@ CollectionMetadataResult EncryptedStoragePluginFunctionWrapper::collectionMetada
         EncryptedStoragePluginWrapper *plugin,
         const QString &collectionName)
 {
+    PluginCallTimer timer(plugin->name());
     CollectionMetadata metadata;
     Result result = plugin->collectionMetadata(collectionName, &metadata);
     metadata.collectionName = collectionName;
@@ -838,6 +1252,7 @@ SecretMetadataResult EncryptedStoragePluginFunctionWrapper::secretMetadata(
         const QString &collectionName,
         const QString &secretName)
 {
+    PluginCallTimer timer(plugin->name());
     SecretMetadata metadata;
     Result result = plugin->secretMetadata(collectionName, secretName, &metadata);
     metadata.collectionName = collectionName;
@@ -848,6 +1263,7 @@ SecretMetadataResult EncryptedStoragePluginFunctionWrapper::secretMetadata(
 CollectionNamesResult EncryptedStoragePluginFunctionWrapper::collectionNames(
         EncryptedStoragePluginWrapper *plugin)
 {
+    PluginCallTimer timer(plugin->name());
     QMap<QString, bool> cnamesMap;
     Result result = plugin->collectionNames(&cnamesMap);
     return CollectionNamesResult(result, cnamesMap);
@@ -858,6 +1274,7 @@ Result EncryptedStoragePluginFunctionWrapper::createCollection(
         const CollectionMetadata &metadata,
         const QByteArray &key)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->createCollection(metadata, key);
 }
 
@@ -865,6 +1282,7 @@ Result EncryptedStoragePluginFunctionWrapper::removeCollection(
         EncryptedStoragePluginWrapper *plugin,
         const QString &collectionName)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->removeCollection(collectionName);
 }
 
@@ -873,6 +1291,7 @@ EncryptedStoragePluginFunctionWrapper::isCollectionLocked(
         EncryptedStoragePluginWrapper *plugin,
         const QString &collectionName)
 {
+    PluginCallTimer timer(plugin->name());
     bool locked = false;
     Result result = plugin->isCollectionLocked(collectionName, &locked);
     return LockedResult(result, locked);
@@ -881,19 +1300,41 @@ EncryptedStoragePluginFunctionWrapper::isCollectionLocked(
 DerivedKeyResult
 EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode(
         EncryptedStoragePluginWrapper *plugin,
+        DerivedKeyCache *cache,
         const QByteArray &authenticationCode,
-        const QByteArray &salt)
+        const QByteArray &salt,
+        const QByteArray &parameters)
 {
     QByteArray key;
-    Result result = plugin->deriveKeyFromCode(authenticationCode, salt, &key);
+    if (cache->lookup(plugin->name(), authenticationCode, salt, parameters, &key)) {
+        return DerivedKeyResult(Result(Result::Succeeded), key);
+    }
+
+    PluginCallTimer timer(plugin->name());
+    Result result = plugin->deriveKeyFromCodeWithParameters(authenticationCode, salt, parameters, &key);
+    if (result.code() == Result::Succeeded) {
+        cache->insert(plugin->name(), authenticationCode, salt, parameters, key);
+    }
     return DerivedKeyResult(result, key);
 }
 
+KeyDerivationParametersResult
+EncryptedStoragePluginFunctionWrapper::calibrateKeyDerivation(
+        EncryptedStoragePluginWrapper *plugin,
+        int targetDuration)
+{
+    PluginCallTimer timer(plugin->name());
+    QByteArray parameters;
+    Result result = plugin->calibrateKeyDerivation(targetDuration, &parameters);
+    return KeyDerivationParametersResult(result, parameters);
+}
+
 Result EncryptedStoragePluginFunctionWrapper::setEncryptionKey(
         EncryptedStoragePluginWrapper *plugin,
         const QString &collectionName,
         const QByteArray &key)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setEncryptionKey(collectionName, key);
 }
 
@@ -903,17 +1344,33 @@ Result EncryptedStoragePluginFunctionWrapper::reencrypt(
         const QByteArray &oldkey,
         const QByteArray &newkey)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->reencrypt(collectionName,
                              oldkey,
                              newkey);
 }
 
+Result EncryptedStoragePluginFunctionWrapper::reencryptCollection(
+        EncryptedStoragePluginWrapper *plugin,
+        const QString &collectionName,
+        const QByteArray &oldkey,
+        const QByteArray &newkey,
+        const QByteArray &keyDerivationParameters)
+{
+    PluginCallTimer timer(plugin->name());
+    return plugin->reencryptCollection(collectionName,
+                                       oldkey,
+                                       newkey,
+                                       keyDerivationParameters);
+}
+
 Result EncryptedStoragePluginFunctionWrapper::setSecret(
         EncryptedStoragePluginWrapper *plugin,
         const SecretMetadata &secretMetadata,
         const QByteArray &secret,
         const Secret::FilterData &filterData)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setSecret(secretMetadata,
                              secret,
                              filterData);
@@ -925,6 +1382,7 @@ EncryptedStoragePluginFunctionWrapper::getSecret(
         const QString &collectionName,
         const QString &secretName)
 {
+    PluginCallTimer timer(plugin->name());
     QByteArray secret;
     Secret::FilterData filterData;
     Result result = plugin->getSecret(collectionName,
@@ -942,6 +1400,7 @@ EncryptedStoragePluginFunctionWrapper::findSecrets(
         const Secret::FilterData &filter,
         StoragePlugin::FilterOperator filterOperator)
 {
+    PluginCallTimer timer(plugin->name());
     QVector<Secret::Identifier> identifiers;
     Result result = plugin->findSecrets(collectionName,
                                         filter,
@@ -955,6 +1414,7 @@ Result EncryptedStoragePluginFunctionWrapper::removeSecret(
         const QString &collectionName,
         const QString &secretName)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->removeSecret(collectionName,
                                 secretName);
 }
@@ -965,6 +1425,7 @@ Result EncryptedStoragePluginFunctionWrapper::setStandaloneSecret(
         const Secret &secret,
         const QByteArray &key)
 {
+    PluginCallTimer timer(plugin->name());
     return plugin->setSecret(secretMetadata,
                              secret.data(),
                              secret.filterData(),
@@ -977,6 +1438,7 @@ EncryptedStoragePluginFunctionWrapper::accessStandaloneSecret(
         const QString &secretName,
         const QByteArray &key)
 {
+    PluginCallTimer timer(plugin->name());
     QByteArray secret;
     Secret::FilterData filterData;
     Result result = plugin->accessSecret(secretName,
@@ -987,56 +1449,50 @@ EncryptedStoragePluginFunctionWrapper::accessStandaloneSecret(
                 result, secret, filterData);
 }
 
-Result EncryptedStoragePluginFunctionWrapper::unlockCollectionAndStoreSecret(
+Result EncryptedStoragePluginFunctionWrapper::unlockCollectionAndStoreQueuedSecrets(
         EncryptedStoragePluginWrapper *plugin,
-        const SecretMetadata &secretMetadata,
-        const Secret &secret,
-        const QByteArray &encryptionKey)
+        const SecretWriteQueue::WritePointer &write)
 {
-    bool originallyLocked = false;
-    bool locked = false;
-    Result pluginResult = plugin->isCollectionLocked(secret.identifier().collectionName(), &locked);
-    if (pluginResult.code() == Result::Succeeded) {
-        originallyLocked = locked;
-        if (locked) {
-            pluginResult = plugin->setEncryptionKey(secret.identifier().collectionName(), encryptionKey);
-            if (pluginResult.code() != Result::Succeeded) {
-                // unable to apply the new encryptionKey.
-                plugin->setEncryptionKey(secret.identifier().collectionName(), QByteArray());
-                return Result(Result::SecretsPluginDecryptionError,
-                              QString::fromLatin1("Unable to decrypt collection %1 with the entered authentication key").arg(secret.identifier().collectionName()));
-
+    SecretWriteQueue *queue = plugin->secretWriteQueue();
+    const QVector<SecretWriteQueue::WritePointer> group = queue->takeGroup(write);
+    if (!group.isEmpty()) {
+        PluginCallTimer timer(plugin->name());
+        // every write in the group is to the same collection with the same key.
+        CollectionMetadata collectionMetadata;
+        collectionMetadata.collectionName = write->metadata.collectionName;
+        collectionMetadata.usesDeviceLockKey = write->metadata.usesDeviceLockKey;
+        collectionMetadata.unlockSemantic = write->metadata.unlockSemantic;
+
+        bool originallyLocked = false;
+        const Result unlockResult = unlockCollection(plugin, collectionMetadata.collectionName,
+                                                     write->encryptionKey, &originallyLocked);
+        if (unlockResult.code() != Result::Succeeded) {
+            for (const SecretWriteQueue::WritePointer &queued : group) {
+                queued->result = unlockResult;
             }
-            pluginResult = plugin->isCollectionLocked(secret.identifier().collectionName(), &locked);
-            if (pluginResult.code() != Result::Succeeded) {
-                plugin->setEncryptionKey(secret.identifier().collectionName(), QByteArray());
-                return Result(Result::SecretsPluginDecryptionError,
-                              QString::fromLatin1("Unable to check lock state of collection %1 after setting the entered authentication key").arg(secret.identifier().collectionName()));
-
-            }
-        }
-        if (locked) {
-            // still locked, even after applying the new encryptionKey?  The authenticationCode was wrong.
-            plugin->setEncryptionKey(secret.identifier().collectionName(), QByteArray());
-            return Result(Result::IncorrectAuthenticationCodeError,
-                          QString::fromLatin1("The authentication code entered for collection %1 was incorrect").arg(secret.identifier().collectionName()));
         } else {
-            // successfully unlocked the encrypted storage collection.  write the secret.
-            pluginResult = plugin->setSecret(secretMetadata, secret.data(), secret.filterData());
-
-            // relock the collection if we need to.
-            if (originallyLocked
-                    && ((secretMetadata.usesDeviceLockKey && secretMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked)
-                        || (!secretMetadata.usesDeviceLockKey && secretMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked))) {
-                Result relockResult = plugin->setEncryptionKey(secret.identifier().collectionName(), QByteArray());
-                if (relockResult.code() != Result::Succeeded) {
-                    qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << secret.identifier().collectionName()
-                                                       << relockResult.errorMessage();
-                }
+            QVector<SecretMetadata> metadata;
+            QVector<Secret> secrets;
+            for (const SecretWriteQueue::WritePointer &queued : group) {
+                metadata.append(queued->metadata);
+                secrets.append(queued->secret);
             }
+
+            storeSecretGroup(
+                        group, metadata, secrets,
+                        [plugin] (const QVector<SecretMetadata> &groupMetadata, const QVector<Secret> &groupSecrets) {
+                            return plugin->setSecrets(groupMetadata, groupSecrets);
+                        },
+                        [plugin] (const SecretMetadata &secretMetadata, const Secret &secret) {
+                            return plugin->setSecret(secretMetadata, secret.data(), secret.filterData());
+                        });
+
+            relockCollectionIfRequired(plugin, collectionMetadata, write->encryptionKey, originallyLocked);
         }
+        queue->finishGroup(group);
     }
-    return pluginResult;
+
+    return queue->waitForResult(write);
 }
 
 SecretResult EncryptedStoragePluginFunctionWrapper::unlockCollectionAndReadSecret(
@@ -1045,6 +1501,7 @@ SecretResult EncryptedStoragePluginFunctionWrapper::unlockCollectionAndReadSecre
         const Secret::Identifier &identifier,
         const QByteArray &encryptionKey)
 {
+    PluginCallTimer timer(plugin->name());
     Secret secret;
     bool originallyLocked = false;
     bool locked = false;
@@ -1098,7 +1555,7 @@ SecretResult EncryptedStoragePluginFunctionWrapper::unlockCollectionAndReadSecre
     if (originallyLocked
             && ((collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked)
                 || (!collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked))) {
-        Result relockResult = plugin->setEncryptionKey(identifier.collectionName(), QByteArray());
+        Result relockResult = plugin->relockCollection(identifier.collectionName(), encryptionKey);
         if (relockResult.code() != Result::Succeeded) {
             qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << identifier.collectionName()
                                                << relockResult.errorMessage();
@@ -1114,6 +1571,7 @@ Result EncryptedStoragePluginFunctionWrapper::unlockCollectionAndRemoveSecret(
         const Secret::Identifier &identifier,
         const QByteArray &encryptionKey)
 {
+    PluginCallTimer timer(plugin->name());
     bool originallyLocked = false;
     bool locked = false;
     Result pluginResult = plugin->isCollectionLocked(identifier.collectionName(), &locked);
@@ -1154,7 +1612,7 @@ Result EncryptedStoragePluginFunctionWrapper::unlockCollectionAndRemoveSecret(
     if (originallyLocked
             && ((collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked)
                 || (!collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked))) {
-        Result relockResult = plugin->setEncryptionKey(identifier.collectionName(), QByteArray());
+        Result relockResult = plugin->relockCollection(identifier.collectionName(), encryptionKey);
         if (relockResult.code() != Result::Succeeded) {
             qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << identifier.collectionName()
                                                << relockResult.errorMessage();
@@ -1172,6 +1630,7 @@ EncryptedStoragePluginFunctionWrapper::unlockAndFindSecrets(
         StoragePlugin::FilterOperator filterOperator,
         const QByteArray &encryptionKey)
 {
+    PluginCallTimer timer(plugin->name());
     QVector<Secret::Identifier> identifiers;
     bool originallyLocked = false;
     bool locked = false;
@@ -1220,7 +1679,7 @@ EncryptedStoragePluginFunctionWrapper::unlockAndFindSecrets(
     if (originallyLocked
             && ((collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked)
                 || (!collectionMetadata.usesDeviceLockKey && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked))) {
-        Result relockResult = plugin->setEncryptionKey(collectionMetadata.collectionName, QByteArray());
+        Result relockResult = plugin->relockCollection(collectionMetadata.collectionName, encryptionKey);
         if (relockResult.code() != Result::Succeeded) {
             qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << collectionMetadata.collectionName
                                                << relockResult.errorMessage();
@@ -1230,11 +1689,64 @@ EncryptedStoragePluginFunctionWrapper::unlockAndFindSecrets(
     return IdentifiersResult(pluginResult, identifiers);
 }
 
+Result EncryptedStoragePluginFunctionWrapper::unlockAndExportCollection(
+        EncryptedStoragePluginWrapper *plugin,
+        const CollectionArchiveInfo &archive,
+        const CollectionMetadata &collectionMetadata,
+        const QByteArray &encryptionKey)
+{
+    PluginCallTimer timer(plugin->name());
+    bool originallyLocked = false;
+    Result pluginResult = unlockCollection(plugin, collectionMetadata.collectionName, encryptionKey, &originallyLocked);
+    if (pluginResult.code() != Result::Succeeded) {
+        return pluginResult;
+    }
+
+    // successfully unlocked the encrypted storage collection.  export its secrets.
+    pluginResult = exportCollectionSecrets(
+                plugin, archive, collectionMetadata.collectionName,
+                [plugin, &collectionMetadata] (
+                        const QString &secretName, QByteArray *data, Secret::FilterData *filterData) {
+                    return plugin->getSecret(collectionMetadata.collectionName, secretName, data, filterData);
+                });
+
+    relockCollectionIfRequired(plugin, collectionMetadata, encryptionKey, originallyLocked);
+    return pluginResult;
+}
+
+Result EncryptedStoragePluginFunctionWrapper::unlockAndImportCollection(
+        EncryptedStoragePluginWrapper *plugin,
+        const CollectionArchiveInfo &archive,
+        const CollectionMetadata &collectionMetadata,
+        const QByteArray &encryptionKey)
+{
+    PluginCallTimer timer(plugin->name());
+    bool originallyLocked = false;
+    Result pluginResult = unlockCollection(plugin, collectionMetadata.collectionName, encryptionKey, &originallyLocked);
+    if (pluginResult.code() != Result::Succeeded) {
+        return pluginResult;
+    }
+
+    // successfully unlocked the encrypted storage collection.  import the secrets.
+    pluginResult = importCollectionSecrets(
+                plugin, archive, collectionMetadata,
+                [plugin] (const QVector<SecretMetadata> &metadata, const QVector<Secret> &secrets) {
+                    return plugin->setSecrets(metadata, secrets);
+                },
+                [plugin, &collectionMetadata] (const QString &secretName) {
+                    return plugin->removeSecret(collectionMetadata.collectionName, secretName);
+                });
+
+    relockCollectionIfRequired(plugin, collectionMetadata, encryptionKey, originallyLocked);
+    return pluginResult;
+}
+
 Result EncryptedStoragePluginFunctionWrapper::unlockDeviceLockedCollectionsAndReencrypt(
         EncryptedStoragePluginWrapper *plugin,
         const QByteArray &oldEncryptionKey,
         const QByteArray &newEncryptionKey)
 {
+    PluginCallTimer timer(plugin->name());
     // find out which collections are device-locked
     QStringList cnames;
     QMap<QString, bool> cnamesMap;
@@ -1290,6 +1802,7 @@ Result EncryptedStoragePluginFunctionWrapper::unlockAndRemoveCollection(
         const QString &collectionName,
         const QByteArray &encryptionKey)
 {
+    PluginCallTimer timer(plugin->name());
     bool locked = false;
     Result result = plugin->isCollectionLocked(collectionName, &locked);
     if (result.code() != Result::Succeeded) {
@@ -1321,6 +1834,7 @@ Result EncryptedStoragePluginFunctionWrapper::deriveKeyUnlockAndRemoveCollection
         const QByteArray &lockCode,
         const QByteArray &salt)
 {
+    PluginCallTimer timer(plugin->name());
     bool locked = false;
     Result result = plugin->isCollectionLocked(collectionName, &locked);
     if (result.code() != Result::Succeeded) {
@@ -1328,8 +1842,14 @@ Result EncryptedStoragePluginFunctionWrapper::deriveKeyUnlockAndRemoveCollection
     }
 
     if (locked) {
+        CollectionMetadata metadata;
+        result = plugin->collectionMetadata(collectionName, &metadata);
+        if (result.code() != Result::Succeeded) {
+            return result;
+        }
+
         QByteArray derivedKey;
-        result = plugin->deriveKeyFromCode(lockCode, salt, &derivedKey);
+        result = plugin->deriveKeyFromCodeWithParameters(lockCode, salt, metadata.keyDerivationParameters, &derivedKey);
         if (result.code() != Result::Succeeded) {
             return result;
         }
@@ -1358,6 +1878,7 @@ Result EncryptedStoragePluginFunctionWrapper::collectionSecretPreCheck(
         const QString &secretName,
         bool newSecret)
 {
+    PluginCallTimer timer(plugin->name());
     QStringList cnames;
     QMap<QString, bool> cnamesMap;
     Result result = plugin->collectionNames(&cnamesMap);
@@ -1401,7 +1922,7 @@ Result EncryptedStoragePluginFunctionWrapper::collectionSecretPreCheck(
 
     // relock if required.
     if (originallyLocked && collectionInfo.relockRequired) {
-        Result relockResult = plugin->setEncryptionKey(collectionInfo.collectionName, QByteArray());
+        Result relockResult = plugin->relockCollection(collectionInfo.collectionName, collectionInfo.collectionKey);
         if (relockResult.code() != Result::Succeeded) {
             qCWarning(lcSailfishSecretsDaemon) << "Error relocking collection:" << collectionInfo.collectionName
                                                << relockResult.errorMessage();
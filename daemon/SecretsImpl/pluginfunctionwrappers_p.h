@@ -11,6 +11,7 @@
 #include "CryptoImpl/cryptopluginwrapper_p.h"
 #include "SecretsImpl/pluginwrapper_p.h"
 #include "SecretsImpl/metadatadb_p.h"
+#include "SecretsImpl/derivedkeycache_p.h"
 
 #include "Secrets/Plugins/extensionplugins.h"
 
@@ -23,6 +24,8 @@
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
 
+#include <QtDBus/QDBusUnixFileDescriptor>
+
 namespace Sailfish {
 
 namespace Secrets {
@@ -91,6 +94,16 @@ struct DerivedKeyResult {
     QByteArray key;
 };
 
+struct KeyDerivationParametersResult {
+    KeyDerivationParametersResult(const Sailfish::Secrets::Result &r = Sailfish::Secrets::Result(),
+                                  const QByteArray &p = QByteArray())
+        : result(r), parameters(p) {}
+    KeyDerivationParametersResult(const KeyDerivationParametersResult &other)
+        : result(other.result), parameters(other.parameters) {}
+    Sailfish::Secrets::Result result;
+    QByteArray parameters;
+};
+
 struct FoundResult {
     FoundResult(bool f = false, const Sailfish::Secrets::Result &r = Sailfish::Secrets::Result())
         : found(f), result(r) {}
@@ -158,6 +171,20 @@ struct CollectionInfo {
     bool relockRequired;
 };
 
+struct CollectionArchiveInfo {
+    CollectionArchiveInfo(const QDBusUnixFileDescriptor &fd = QDBusUnixFileDescriptor(),
+                          const QByteArray &p = QByteArray(),
+                          Sailfish::Secrets::EncryptionPlugin *ep = Q_NULLPTR)
+        : fileDescriptor(fd), passphrase(p), encryptionPlugin(ep) {}
+    CollectionArchiveInfo(const CollectionArchiveInfo &other)
+        : fileDescriptor(other.fileDescriptor)
+        , passphrase(other.passphrase)
+        , encryptionPlugin(other.encryptionPlugin) {}
+    QDBusUnixFileDescriptor fileDescriptor;
+    QByteArray passphrase;
+    Sailfish::Secrets::EncryptionPlugin *encryptionPlugin; // encrypts the archive
+};
+
 struct PluginState {
     PluginState(bool a = false, bool l = false)
         : available(a), locked(l) {}
@@ -200,6 +227,10 @@ bool masterLockPlugins(
         const QList<StoragePluginWrapper*> &storagePlugins,
         const QList<EncryptedStoragePluginWrapper*> &encryptedStoragePlugins);
 
+void checkpointPlugins(
+        const QList<StoragePluginWrapper*> &storagePlugins,
+        const QList<EncryptedStoragePluginWrapper*> &encryptedStoragePlugins);
+
 bool masterUnlockPlugins(
         const QList<StoragePluginWrapper*> &storagePlugins,
         const QList<EncryptedStoragePluginWrapper*> &encryptedStoragePlugins,
@@ -244,8 +275,13 @@ namespace EncryptionPluginFunctionWrapper {
                      const QByteArray &newLockCode);
     DerivedKeyResult deriveKeyFromCode(
             Sailfish::Secrets::EncryptionPlugin *plugin,
+            DerivedKeyCache *cache,
             const QByteArray &authenticationCode,
-            const QByteArray &salt);
+            const QByteArray &salt,
+            const QByteArray &parameters);
+    KeyDerivationParametersResult calibrateKeyDerivation(
+            Sailfish::Secrets::EncryptionPlugin *plugin,
+            int targetDuration);
     DataResult encryptSecret(
             Sailfish::Secrets::EncryptionPlugin *plugin,
             const QByteArray &plaintext,
@@ -330,12 +366,31 @@ namespace StoragePluginFunctionWrapper {
             const Secret &secret,
             const QByteArray &encryptionKey);
 
+    Sailfish::Secrets::Result encryptAndStoreQueuedSecrets(
+            Sailfish::Secrets::EncryptionPlugin *encryptionPlugin,
+            StoragePluginWrapper *storagePlugin,
+            const SecretWriteQueue::WritePointer &write);
+
     SecretResult getAndDecryptSecret(
             Sailfish::Secrets::EncryptionPlugin *encryptionPlugin,
             StoragePluginWrapper *storagePlugin,
             const Sailfish::Secrets::Secret::Identifier &identifier,
             const QByteArray &encryptionKey);
 
+    Sailfish::Secrets::Result exportCollection(
+            Sailfish::Secrets::EncryptionPlugin *encryptionPlugin,
+            StoragePluginWrapper *storagePlugin,
+            const CollectionArchiveInfo &archive,
+            const QString &collectionName,
+            const QByteArray &encryptionKey);
+
+    Sailfish::Secrets::Result importCollection(
+            Sailfish::Secrets::EncryptionPlugin *encryptionPlugin,
+            StoragePluginWrapper *storagePlugin,
+            const CollectionArchiveInfo &archive,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &encryptionKey);
+
     Sailfish::Secrets::Result reencryptDeviceLockedCollectionsAndSecrets(
             StoragePluginWrapper *plugin,
             const QMap<QString, EncryptionPlugin*> encryptionPlugins,
@@ -353,6 +408,7 @@ namespace StoragePluginFunctionWrapper {
 namespace EncryptedStoragePluginFunctionWrapper {
     bool isLocked(EncryptedStoragePluginWrapper *plugin);
     bool lock(EncryptedStoragePluginWrapper *plugin);
+    void relockWarmCollections(EncryptedStoragePluginWrapper *plugin);
     bool unlock(
             EncryptedStoragePluginWrapper *plugin,
             const QByteArray &lockCode);
@@ -386,8 +442,13 @@ namespace EncryptedStoragePluginFunctionWrapper {
             const QString &collectionName);
     DerivedKeyResult deriveKeyFromCode(
             EncryptedStoragePluginWrapper *plugin,
+            DerivedKeyCache *cache,
             const QByteArray &authenticationCode,
-            const QByteArray &salt);
+            const QByteArray &salt,
+            const QByteArray &parameters);
+    KeyDerivationParametersResult calibrateKeyDerivation(
+            EncryptedStoragePluginWrapper *plugin,
+            int targetDuration);
     Sailfish::Secrets::Result setEncryptionKey(
             EncryptedStoragePluginWrapper *plugin,
             const QString &collectionName,
@@ -397,6 +458,12 @@ namespace EncryptedStoragePluginFunctionWrapper {
             const QString &collectionName,
             const QByteArray &oldkey,
             const QByteArray &newkey);
+    Sailfish::Secrets::Result reencryptCollection(
+            EncryptedStoragePluginWrapper *plugin,
+            const QString &collectionName,
+            const QByteArray &oldkey,
+            const QByteArray &newkey,
+            const QByteArray &keyDerivationParameters);
 
     Sailfish::Secrets::Result setSecret(
             EncryptedStoragePluginWrapper *plugin,
@@ -429,11 +496,9 @@ namespace EncryptedStoragePluginFunctionWrapper {
             const QByteArray &key);
 
     // compound operations.
-    Sailfish::Secrets::Result unlockCollectionAndStoreSecret(
+    Sailfish::Secrets::Result unlockCollectionAndStoreQueuedSecrets(
             EncryptedStoragePluginWrapper *plugin,
-            const SecretMetadata &secretMetadata,
-            const Sailfish::Secrets::Secret &secret,
-            const QByteArray &encryptionKey);
+            const SecretWriteQueue::WritePointer &write);
 
     SecretResult unlockCollectionAndReadSecret(
             EncryptedStoragePluginWrapper *plugin,
@@ -454,6 +519,18 @@ namespace EncryptedStoragePluginFunctionWrapper {
             Sailfish::Secrets::StoragePlugin::FilterOperator filterOperator,
             const QByteArray &encryptionKey);
 
+    Sailfish::Secrets::Result unlockAndExportCollection(
+            EncryptedStoragePluginWrapper *plugin,
+            const CollectionArchiveInfo &archive,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &encryptionKey);
+
+    Sailfish::Secrets::Result unlockAndImportCollection(
+            EncryptedStoragePluginWrapper *plugin,
+            const CollectionArchiveInfo &archive,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &encryptionKey);
+
     Sailfish::Secrets::Result unlockDeviceLockedCollectionsAndReencrypt(
             EncryptedStoragePluginWrapper *plugin,
             const QByteArray &oldEncryptionKey,
@@ -7,10 +7,29 @@
 
 #include "pluginwrapper_p.h"
 #include "logging_p.h"
+#include "util_p.h"
+
+#include <QtCore/QMetaObject>
+#include <QtCore/QStringList>
 
 using namespace Sailfish::Secrets;
 using namespace Sailfish::Secrets::Daemon::ApiImpl;
 
+namespace {
+    bool keyMatches(const char *data, int length, const QByteArray &key)
+    {
+        if (!data || length != key.size()) {
+            return false;
+        }
+        // compare in constant time, to avoid leaking information about the key.
+        unsigned char difference = 0;
+        for (int i = 0; i < length; ++i) {
+            difference |= static_cast<unsigned char>(data[i] ^ key.at(i));
+        }
+        return difference == 0;
+    }
+}
+
 PluginWrapper::PluginWrapper(const QString &defaultEncryptionPluginName,
                              const QString &defaultAuthPluginName,
                              Sailfish::Secrets::PluginBase *plugin,
@@ -103,6 +122,82 @@ bool PluginWrapper::setMasterLockKey(const QByteArray &oldMasterLockKey, const Q
     return initialize(newMasterLockKey); // may need to synchronize data between metadataDb and plugin.
 }
 
+QVariantMap PluginWrapper::metadataStatistics() const
+{
+    return m_metadataDb.statementCacheStatistics();
+}
+
+bool PluginWrapper::metadataCheckpointPending() const
+{
+    return m_metadataDb.checkpointPending();
+}
+
+bool PluginWrapper::checkpointMetadata()
+{
+    return m_metadataDb.checkpoint();
+}
+
+SecretWriteQueue *PluginWrapper::secretWriteQueue()
+{
+    return &m_secretWriteQueue;
+}
+
+// Writes the secrets to the plugin and their metadata to the metadata database
+// in two phases, within the metadata transaction which the caller has begun:
+// the metadata is inserted first but only committed once the plugin has
+// committed the secrets, and the plugin write is undone if that commit fails
+// (in which case the metadata transaction has already been rolled back).
+// Any transaction is finished before returning.
+// The plugin and the metadata database are separate databases, so this is
+// still two commits, each synced according to its database's durability.
+template <typename WriteSecrets, typename RemoveSecrets>
+Result PluginWrapper::writeSecretsAndMetadata(
+        const QVector<SecretMetadata> &metadata,
+        WriteSecrets writeSecrets,
+        RemoveSecrets removeSecrets)
+{
+    for (const SecretMetadata &secretMetadata : metadata) {
+        Result result = m_metadataDb.insertSecretMetadata(secretMetadata);
+        if (result.code() != Result::Succeeded) {
+            m_metadataDb.rollbackTransaction();
+            return result;
+        }
+    }
+
+    Result result = writeSecrets();
+    if (result.code() != Result::Succeeded) {
+        m_metadataDb.rollbackTransaction();
+        return result;
+    }
+
+    if (!m_metadataDb.commitTransaction()) {
+        Result removeResult = removeSecrets();
+        if (removeResult.code() != Result::Succeeded) {
+            qCWarning(lcSailfishSecretsDaemon) << "Unable to remove" << metadata.size()
+                                               << "secrets after failing to commit their metadata:"
+                                               << removeResult.errorMessage();
+        }
+        return metadata.size() == 1
+                ? Result(Result::DatabaseTransactionError,
+                         QStringLiteral("Unable to commit metadata for secret %1").arg(metadata.first().secretName))
+                : Result(Result::DatabaseTransactionError,
+                         QStringLiteral("Unable to commit metadata for %1 secrets").arg(metadata.size()));
+    }
+
+    return Result(Result::Succeeded);
+}
+
+template <typename WriteSecret, typename RemoveSecret>
+Result PluginWrapper::writeSecretAndMetadata(
+        const SecretMetadata &metadata,
+        WriteSecret writeSecret,
+        RemoveSecret removeSecret)
+{
+    return writeSecretsAndMetadata(QVector<SecretMetadata>() << metadata,
+                                   writeSecret,
+                                   removeSecret);
+}
+
 bool PluginWrapper::supportsLocking() const
 {
     return m_plugin->supportsLocking();
@@ -423,14 +518,23 @@ Result StoragePluginWrapper::setSecret(
                       QStringLiteral("Plugin %1 is master-locked").arg(m_storagePlugin->name()));
     }
 
+    // perform the checks within the write transaction, so that the
+    // metadata database is locked once for the whole operation.
+    if (!m_metadataDb.beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QStringLiteral("Unable to start metadata db transaction for setSecret"));
+    }
+
     bool exists = false;
     CollectionMetadata collectionMetadata;
     Result result = m_metadataDb.collectionMetadata(metadata.collectionName,
                                                     &collectionMetadata,
                                                     &exists);
     if (result.code() != Result::Succeeded) {
+        m_metadataDb.rollbackTransaction();
         return result;
     } else if (!exists) {
+        m_metadataDb.rollbackTransaction();
         return Result(Result::InvalidCollectionError,
                       QStringLiteral("Collection %1 does not exist").arg(metadata.collectionName));
     }
@@ -442,38 +546,105 @@ Result StoragePluginWrapper::setSecret(
                                          &currentMetadata,
                                          &exists);
     if (result.code() != Result::Succeeded) {
+        m_metadataDb.rollbackTransaction();
         return result;
     }
 
     if (exists) {
         // don't allow overwriting existing secrets.
         // TODO: allow this, but only if the encryption key matches
+        m_metadataDb.rollbackTransaction();
         return Result(Result::SecretAlreadyExistsError,
                       QStringLiteral("Cannot overwrite existing secret"));
     }
 
+    StoragePlugin *plugin = m_storagePlugin;
+    return writeSecretAndMetadata(
+                metadata,
+                [plugin, &metadata, &secret, &filterData] () {
+                    return plugin->setSecret(metadata.collectionName,
+                                             metadata.secretName,
+                                             secret,
+                                             filterData);
+                },
+                [plugin, &metadata] () {
+                    return plugin->removeSecret(metadata.collectionName,
+                                                metadata.secretName);
+                });
+}
+
+Result StoragePluginWrapper::setSecrets(
+        const QVector<SecretMetadata> &metadata,
+        const QVector<Secret> &secrets)
+{
+    if (m_storagePlugin->isLocked()) {
+        return Result(Result::SecretsPluginIsLockedError,
+                      QStringLiteral("Plugin %1 is locked").arg(m_storagePlugin->name()));
+    }
+
+    if (isMasterLocked()) {
+        return Result(Result::SecretsPluginIsLockedError,
+                      QStringLiteral("Plugin %1 is master-locked").arg(m_storagePlugin->name()));
+    }
+
+    if (metadata.isEmpty()) {
+        return Result(Result::Succeeded);
+    }
+
+    // all of the secrets must belong to the same collection.
+    const QString collectionName = metadata.first().collectionName;
     if (!m_metadataDb.beginTransaction()) {
         return Result(Result::DatabaseTransactionError,
-                      QStringLiteral("Unable to start metadata db transaction for createCollection"));
+                      QStringLiteral("Unable to start metadata db transaction for setSecrets"));
     }
 
-    result = m_metadataDb.insertSecretMetadata(metadata);
+    bool exists = false;
+    CollectionMetadata collectionMetadata;
+    Result result = m_metadataDb.collectionMetadata(collectionName,
+                                                    &collectionMetadata,
+                                                    &exists);
     if (result.code() != Result::Succeeded) {
         m_metadataDb.rollbackTransaction();
         return result;
+    } else if (!exists) {
+        m_metadataDb.rollbackTransaction();
+        return Result(Result::InvalidCollectionError,
+                      QStringLiteral("Collection %1 does not exist").arg(collectionName));
     }
 
-    result = m_storagePlugin->setSecret(metadata.collectionName,
-                                        metadata.secretName,
-                                        secret,
-                                        filterData);
-    if (result.code() != Result::Succeeded) {
-        m_metadataDb.rollbackTransaction();
-        return result;
+    for (const SecretMetadata &secretMetadata : metadata) {
+        exists = false;
+        SecretMetadata currentMetadata;
+        result = m_metadataDb.secretMetadata(collectionName,
+                                             secretMetadata.secretName,
+                                             &currentMetadata,
+                                             &exists);
+        if (result.code() != Result::Succeeded) {
+            m_metadataDb.rollbackTransaction();
+            return result;
+        } else if (exists) {
+            m_metadataDb.rollbackTransaction();
+            return Result(Result::SecretAlreadyExistsError,
+                          QStringLiteral("Cannot overwrite existing secret %1").arg(secretMetadata.secretName));
+        }
     }
 
-    m_metadataDb.commitTransaction();
-    return Result(Result::Succeeded);
+    StoragePlugin *plugin = m_storagePlugin;
+    return writeSecretsAndMetadata(
+                metadata,
+                [plugin, &collectionName, &secrets] () {
+                    return plugin->setSecrets(collectionName, secrets);
+                },
+                [plugin, &collectionName, &secrets] () {
+                    Result result(Result::Succeeded);
+                    for (const Secret &secret : secrets) {
+                        Result removeResult = plugin->removeSecret(collectionName, secret.name());
+                        if (removeResult.code() != Result::Succeeded) {
+                            result = removeResult;
+                        }
+                    }
+                    return result;
+                });
 }
 
 Result StoragePluginWrapper::removeSecret(
@@ -521,11 +692,17 @@ EncryptedStoragePluginWrapper::EncryptedStoragePluginWrapper(
                     defaultAuthPluginName,
                     plugin, true, autotestMode)
     , m_encryptedStoragePlugin(plugin)
+    , m_warmCollectionTimeout(0)
+    , m_warmCollectionOperations(0)
+    , m_relockTimer(Q_NULLPTR)
 {
 }
 
 EncryptedStoragePluginWrapper::~EncryptedStoragePluginWrapper()
 {
+    for (const WarmCollection &collection : m_warmCollections) {
+        wipeKey(collection.key, collection.keyLength);
+    }
 }
 
 bool EncryptedStoragePluginWrapper::initialize(const QByteArray &masterLockKey)
@@ -628,7 +805,7 @@ Result EncryptedStoragePluginWrapper::collectionNames(
                 // assume locked, otherwise ignore the error.
                 locked = true;
             }
-            names->insert(cname, locked);
+            names->insert(cname, locked || isWarmCollection(cname));
         }
     }
     return result;
@@ -654,15 +831,27 @@ Result EncryptedStoragePluginWrapper::isCollectionLocked(
         const QString &collectionName,
         bool *locked)
 {
+    if (isWarmCollection(collectionName)) {
+        *locked = true;
+        return Result(Result::Succeeded);
+    }
     return m_encryptedStoragePlugin->isCollectionLocked(collectionName, locked);
 }
 
-Result EncryptedStoragePluginWrapper::deriveKeyFromCode(
+Result EncryptedStoragePluginWrapper::deriveKeyFromCodeWithParameters(
         const QByteArray &authenticationCode,
         const QByteArray &salt,
+        const QByteArray &parameters,
         QByteArray *key)
 {
-    return m_encryptedStoragePlugin->deriveKeyFromCode(authenticationCode, salt, key);
+    return m_encryptedStoragePlugin->deriveKeyFromCodeWithParameters(authenticationCode, salt, parameters, key);
+}
+
+Result EncryptedStoragePluginWrapper::calibrateKeyDerivation(
+        int targetDuration,
+        QByteArray *parameters)
+{
+    return m_encryptedStoragePlugin->calibrateKeyDerivation(targetDuration, parameters);
 }
 
 Result EncryptedStoragePluginWrapper::setEncryptionKey(
@@ -677,6 +866,18 @@ Result EncryptedStoragePluginWrapper::setEncryptionKey(
                       .arg(m_encryptedStoragePlugin->name()));
     }
 
+    QHash<QString, WarmCollection>::iterator it = m_warmCollections.find(collectionName);
+    if (it != m_warmCollections.end()) {
+        if (!key.isEmpty() && !it->inUse && !isExpired(*it)
+                && keyMatches(it->key, it->keyLength, key)) {
+            // the collection is still open with this key, no need to reopen it.
+            it->inUse = true;
+            it->remainingOperations--;
+            return Result(Result::Succeeded);
+        }
+        evictWarmCollection(collectionName, !key.isEmpty());
+    }
+
     Result result = m_encryptedStoragePlugin->setEncryptionKey(collectionName, key);
     // We have unlocked a collection, and may be able to retrieve more data
     // from the plugin.  Ensure that our metadata is in sync.
@@ -684,20 +885,189 @@ Result EncryptedStoragePluginWrapper::setEncryptionKey(
     return result;
 }
 
+bool EncryptedStoragePluginWrapper::lock()
+{
+    relockWarmCollections(false);
+    return PluginWrapper::lock();
+}
+
+void EncryptedStoragePluginWrapper::setWarmCollectionLimits(
+        int timeout,
+        int maxOperations,
+        QTimer *relockTimer)
+{
+    m_warmCollectionTimeout = timeout;
+    m_warmCollectionOperations = maxOperations;
+    m_relockTimer = relockTimer;
+}
+
+bool EncryptedStoragePluginWrapper::hasWarmCollections() const
+{
+    return m_warmCollectionCount.load() > 0;
+}
+
+bool EncryptedStoragePluginWrapper::isWarmCollection(const QString &collectionName) const
+{
+    QHash<QString, WarmCollection>::const_iterator it = m_warmCollections.constFind(collectionName);
+    return it != m_warmCollections.constEnd() && !it->inUse;
+}
+
+bool EncryptedStoragePluginWrapper::isExpired(const WarmCollection &collection) const
+{
+    return collection.remainingOperations <= 0
+            || collection.timer.hasExpired(m_warmCollectionTimeout);
+}
+
+void EncryptedStoragePluginWrapper::scheduleRelock()
+{
+    // the timer lives in the main thread, while we are called from the secrets thread.
+    if (m_relockTimer) {
+        QMetaObject::invokeMethod(m_relockTimer, "start", Qt::QueuedConnection);
+    }
+}
+
+void EncryptedStoragePluginWrapper::evictWarmCollection(
+        const QString &collectionName,
+        bool relock)
+{
+    QHash<QString, WarmCollection>::iterator it = m_warmCollections.find(collectionName);
+    if (it == m_warmCollections.end()) {
+        return;
+    }
+
+    wipeKey(it->key, it->keyLength);
+    m_warmCollections.erase(it);
+    m_warmCollectionCount.store(m_warmCollections.size());
+
+    if (relock) {
+        Result result = m_encryptedStoragePlugin->setEncryptionKey(collectionName, QByteArray());
+        if (result.code() != Result::Succeeded) {
+            qCWarning(lcSailfishSecretsDaemon) << "Failed to relock warm collection:" << collectionName
+                                               << result.errorCode() << result.errorMessage();
+        }
+    }
+}
+
+Result EncryptedStoragePluginWrapper::relockCollection(
+        const QString &collectionName,
+        const QByteArray &key)
+{
+    QHash<QString, WarmCollection>::iterator it = m_warmCollections.find(collectionName);
+    if (it != m_warmCollections.end()) {
+        if (it->inUse && !isExpired(*it) && keyMatches(it->key, it->keyLength, key)) {
+            it->inUse = false;
+            return Result(Result::Succeeded);
+        }
+    } else if (m_warmCollectionTimeout > 0 && m_warmCollectionOperations > 0 && !key.isEmpty()) {
+        bool locked = true;
+        Result result = m_encryptedStoragePlugin->isCollectionLocked(collectionName, &locked);
+        if (result.code() == Result::Succeeded && !locked) {
+            WarmCollection collection;
+            collection.key = lockedKeyCopy(key);
+            collection.keyLength = key.size();
+            collection.remainingOperations = m_warmCollectionOperations;
+            collection.inUse = false;
+            collection.timer.start();
+            if (collection.key) {
+                m_warmCollections.insert(collectionName, collection);
+                m_warmCollectionCount.store(m_warmCollections.size());
+                scheduleRelock();
+                return Result(Result::Succeeded);
+            }
+        }
+    }
+
+    return setEncryptionKey(collectionName, QByteArray());
+}
+
+void EncryptedStoragePluginWrapper::relockWarmCollections(bool expiredOnly)
+{
+    const QStringList collectionNames = m_warmCollections.keys();
+    for (const QString &collectionName : collectionNames) {
+        const WarmCollection collection = m_warmCollections.value(collectionName);
+        if (!expiredOnly || (!collection.inUse && isExpired(collection))) {
+            evictWarmCollection(collectionName, true);
+        }
+    }
+
+    if (hasWarmCollections()) {
+        scheduleRelock();
+    }
+}
+
 Result EncryptedStoragePluginWrapper::reencrypt(
         const QString &collectionName,
         const QByteArray &oldkey,
         const QByteArray &newkey)
 {
+    evictWarmCollection(collectionName, true);
     return m_encryptedStoragePlugin->reencrypt(collectionName, oldkey, newkey);
 }
 
+// Re-encrypt the collection with a key derived with different key derivation
+// parameters, and record those parameters in its metadata.  The plugin will
+// only rekey the collection if it can be opened with the old key, so this
+// also verifies the old key.  The collection is left locked if it was locked.
+Result EncryptedStoragePluginWrapper::reencryptCollection(
+        const QString &collectionName,
+        const QByteArray &oldkey,
+        const QByteArray &newkey,
+        const QByteArray &keyDerivationParameters)
+{
+    if (isMasterLocked()) {
+        return Result(Result::SecretsPluginIsLockedError,
+                      QStringLiteral("Plugin %1 is master-locked")
+                      .arg(m_encryptedStoragePlugin->name()));
+    }
+
+    evictWarmCollection(collectionName, true);
+    bool locked = true;
+    Result result = m_encryptedStoragePlugin->isCollectionLocked(collectionName, &locked);
+    if (result.code() != Result::Succeeded) {
+        return result;
+    }
+
+    if (!m_metadataDb.beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QStringLiteral("Unable to start metadata db transaction for reencryptCollection"));
+    }
+
+    result = m_metadataDb.updateCollectionKeyDerivationParameters(collectionName, keyDerivationParameters);
+    if (result.code() == Result::Succeeded) {
+        result = m_encryptedStoragePlugin->reencrypt(collectionName, oldkey, newkey);
+    }
+
+    if (result.code() != Result::Succeeded) {
+        m_metadataDb.rollbackTransaction();
+    } else if (!m_metadataDb.commitTransaction()) {
+        m_metadataDb.rollbackTransaction();
+        result = m_encryptedStoragePlugin->reencrypt(collectionName, newkey, oldkey);
+        if (result.code() != Result::Succeeded) {
+            qCWarning(lcSailfishSecretsDaemon) << "Failed to revert reencryption of collection:" << collectionName
+                                               << result.errorCode() << result.errorMessage();
+        }
+        result = Result(Result::DatabaseTransactionError,
+                        QStringLiteral("Unable to commit metadata db transaction for reencryptCollection"));
+    }
+
+    if (locked) {
+        m_encryptedStoragePlugin->setEncryptionKey(collectionName, QByteArray());
+    }
+
+    return result;
+}
+
 Result EncryptedStoragePluginWrapper::getSecret(
         const QString &collectionName,
         const QString &secretName,
         QByteArray *secret,
         Secret::FilterData *filterData)
 {
+    if (isWarmCollection(collectionName)) {
+        return Result(Result::CollectionIsLockedError,
+                      QStringLiteral("Collection %1 in plugin %2 is locked")
+                      .arg(collectionName, m_encryptedStoragePlugin->name()));
+    }
     return m_encryptedStoragePlugin->getSecret(collectionName, secretName, secret, filterData);
 }
 
@@ -707,6 +1077,11 @@ Result EncryptedStoragePluginWrapper::findSecrets(
         StoragePlugin::FilterOperator filterOperator,
         QVector<Secret::Identifier> *identifiers)
 {
+    if (isWarmCollection(collectionName)) {
+        return Result(Result::CollectionIsLockedError,
+                      QStringLiteral("Collection %1 in plugin %2 is locked")
+                      .arg(collectionName, m_encryptedStoragePlugin->name()));
+    }
     return m_encryptedStoragePlugin->findSecrets(collectionName, filter, filterOperator, identifiers);
 }
 
@@ -832,6 +1207,7 @@ Result EncryptedStoragePluginWrapper::removeCollection(
                       QStringLiteral("Unable to start metadata db transaction for deleteCollection"));
     }
 
+    evictWarmCollection(collectionName, true);
     Result result = m_metadataDb.deleteCollectionMetadata(collectionName);
     if (result.code() != Result::Succeeded) {
         m_metadataDb.rollbackTransaction();
@@ -866,7 +1242,7 @@ Result EncryptedStoragePluginWrapper::setSecret(
     }
 
     bool locked = false;
-    Result result = m_encryptedStoragePlugin->isCollectionLocked(metadata.collectionName, &locked);
+    Result result = isCollectionLocked(metadata.collectionName, &locked);
     if (locked) {
         return Result(Result::CollectionIsLockedError,
                       QStringLiteral("Collection %1 from plugin %2 is locked")
@@ -877,24 +1253,77 @@ Result EncryptedStoragePluginWrapper::setSecret(
 
     if (!m_metadataDb.beginTransaction()) {
         return Result(Result::DatabaseTransactionError,
-                      QStringLiteral("Unable to start metadata db transaction for createCollection"));
+                      QStringLiteral("Unable to start metadata db transaction for setSecret"));
+    }
+
+    EncryptedStoragePlugin *plugin = m_encryptedStoragePlugin;
+    return writeSecretAndMetadata(
+                metadata,
+                [plugin, &metadata, &secret, &filterData] () {
+                    return plugin->setSecret(metadata.collectionName,
+                                             metadata.secretName,
+                                             secret,
+                                             filterData);
+                },
+                [plugin, &metadata] () {
+                    return plugin->removeSecret(metadata.collectionName,
+                                                metadata.secretName);
+                });
+}
+
+Result EncryptedStoragePluginWrapper::setSecrets(
+        const QVector<SecretMetadata> &metadata,
+        const QVector<Secret> &secrets)
+{
+    if (m_encryptedStoragePlugin->isLocked()) {
+        return Result(Result::SecretsPluginIsLockedError,
+                      QStringLiteral("Plugin %1 is locked")
+                      .arg(m_encryptedStoragePlugin->name()));
     }
 
-    result = m_metadataDb.insertSecretMetadata(metadata);
-    if (result.code() != Result::Succeeded) {
-        m_metadataDb.rollbackTransaction();
-        return result;
+    if (isMasterLocked()) {
+        return Result(Result::SecretsPluginIsLockedError,
+                      QStringLiteral("Plugin %1 is master-locked")
+                      .arg(m_encryptedStoragePlugin->name()));
     }
 
-    result = m_encryptedStoragePlugin->setSecret(
-                metadata.collectionName, metadata.secretName, secret, filterData);
-    if (result.code() != Result::Succeeded) {
-        m_metadataDb.rollbackTransaction();
+    if (metadata.isEmpty()) {
+        return Result(Result::Succeeded);
+    }
+
+    // all of the secrets must belong to the same collection.
+    const QString collectionName = metadata.first().collectionName;
+    bool locked = false;
+    Result result = isCollectionLocked(collectionName, &locked);
+    if (locked) {
+        return Result(Result::CollectionIsLockedError,
+                      QStringLiteral("Collection %1 from plugin %2 is locked")
+                      .arg(collectionName, m_encryptedStoragePlugin->name()));
+    } else if (result.code() != Result::Succeeded) {
         return result;
     }
 
-    m_metadataDb.commitTransaction();
-    return Result(Result::Succeeded);
+    if (!m_metadataDb.beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QStringLiteral("Unable to start metadata db transaction for setSecrets"));
+    }
+
+    EncryptedStoragePlugin *plugin = m_encryptedStoragePlugin;
+    return writeSecretsAndMetadata(
+                metadata,
+                [plugin, &collectionName, &secrets] () {
+                    return plugin->setSecrets(collectionName, secrets);
+                },
+                [plugin, &collectionName, &secrets] () {
+                    Result result(Result::Succeeded);
+                    for (const Secret &secret : secrets) {
+                        Result removeResult = plugin->removeSecret(collectionName, secret.name());
+                        if (removeResult.code() != Result::Succeeded) {
+                            result = removeResult;
+                        }
+                    }
+                    return result;
+                });
 }
 
 Result EncryptedStoragePluginWrapper::removeSecret(
@@ -914,7 +1343,7 @@ Result EncryptedStoragePluginWrapper::removeSecret(
     }
 
     bool locked = false;
-    Result result = m_encryptedStoragePlugin->isCollectionLocked(collectionName, &locked);
+    Result result = isCollectionLocked(collectionName, &locked);
     if (locked) {
         return Result(Result::CollectionIsLockedError,
                       QStringLiteral("Collection %1 in plugin %2 is locked")
@@ -962,14 +1391,23 @@ Result EncryptedStoragePluginWrapper::setSecret(
                       .arg(m_encryptedStoragePlugin->name()));
     }
 
+    // perform the checks within the write transaction, so that the
+    // metadata database is locked once for the whole operation.
+    if (!m_metadataDb.beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QStringLiteral("Unable to start metadata db transaction for setSecret"));
+    }
+
     bool exists = false;
     CollectionMetadata collectionMetadata;
     Result result = m_metadataDb.collectionMetadata(metadata.collectionName,
                                                     &collectionMetadata,
                                                     &exists);
     if (result.code() != Result::Succeeded) {
+        m_metadataDb.rollbackTransaction();
         return result;
     } else if (!exists) {
+        m_metadataDb.rollbackTransaction();
         return Result(Result::InvalidCollectionError,
                       QStringLiteral("Collection %1 does not exist").arg(metadata.collectionName));
     }
@@ -981,34 +1419,25 @@ Result EncryptedStoragePluginWrapper::setSecret(
                                          &currentMetadata,
                                          &exists);
     if (result.code() != Result::Succeeded) {
+        m_metadataDb.rollbackTransaction();
         return result;
     }
 
     if (exists) {
         // don't allow overwriting existing secrets.
         // TODO: allow this, but only if the encryption key matches
+        m_metadataDb.rollbackTransaction();
         return Result(Result::SecretAlreadyExistsError,
                       QStringLiteral("Cannot overwrite existing secret"));
     }
 
-    if (!m_metadataDb.beginTransaction()) {
-        return Result(Result::DatabaseTransactionError,
-                      QStringLiteral("Unable to start metadata db transaction for removeSecret"));
-    }
-
-    result = m_metadataDb.insertSecretMetadata(metadata);
-    if (result.code() != Result::Succeeded) {
-        m_metadataDb.rollbackTransaction();
-        return result;
-    }
-
-    result = m_encryptedStoragePlugin->setSecret(
-                metadata.secretName, secret, filterData, key);
-    if (result.code() != Result::Succeeded) {
-        m_metadataDb.rollbackTransaction();
-        return result;
-    }
-
-    m_metadataDb.commitTransaction();
-    return Result(Result::Succeeded);
+    EncryptedStoragePlugin *plugin = m_encryptedStoragePlugin;
+    return writeSecretAndMetadata(
+                metadata,
+                [plugin, &metadata, &secret, &filterData, &key] () {
+                    return plugin->setSecret(metadata.secretName, secret, filterData, key);
+                },
+                [plugin, &metadata] () {
+                    return plugin->removeSecret(metadata.secretName);
+                });
 }
@@ -9,6 +9,7 @@
 #define SAILFISHSECRETS_APIIMPL_PLUGINWRAPPER_P_H
 
 #include "SecretsImpl/metadatadb_p.h"
+#include "SecretsImpl/secretwritequeue_p.h"
 
 #include "Secrets/Plugins/extensionplugins.h"
 
@@ -19,6 +20,10 @@
 
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
 
 namespace Sailfish {
 
@@ -67,12 +72,30 @@ public:
     bool masterUnlock(const QByteArray &masterLockKey);
     bool setMasterLockKey(const QByteArray &oldMasterLockKey, const QByteArray &newMasterLockKey);
 
+    QVariantMap metadataStatistics() const;
+    bool metadataCheckpointPending() const;
+    bool checkpointMetadata();
+
+    SecretWriteQueue *secretWriteQueue();
+
 protected:
+    template <typename WriteSecrets, typename RemoveSecrets>
+    Sailfish::Secrets::Result writeSecretsAndMetadata(
+            const QVector<SecretMetadata> &metadata,
+            WriteSecrets writeSecrets,
+            RemoveSecrets removeSecrets);
+    template <typename WriteSecret, typename RemoveSecret>
+    Sailfish::Secrets::Result writeSecretAndMetadata(
+            const SecretMetadata &metadata,
+            WriteSecret writeSecret,
+            RemoveSecret removeSecret);
+
     MetadataDatabase m_metadataDb;
     bool m_initialized;
 
 private:
     Sailfish::Secrets::PluginBase *m_plugin;
+    SecretWriteQueue m_secretWriteQueue;
 };
 
 class StoragePluginWrapper : public PluginWrapper
@@ -96,6 +119,7 @@ public:
     Sailfish::Secrets::Result createCollection(const CollectionMetadata &metadata);
     Sailfish::Secrets::Result removeCollection(const QString &collectionName);
     Sailfish::Secrets::Result setSecret(const SecretMetadata &metadata, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData);
+    Sailfish::Secrets::Result setSecrets(const QVector<SecretMetadata> &metadata, const QVector<Sailfish::Secrets::Secret> &secrets);
     Sailfish::Secrets::Result getSecret(const QString &collectionName, const QString &secretName, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData);
     Sailfish::Secrets::Result findSecrets(const QString &collectionName, const Sailfish::Secrets::Secret::FilterData &filter, Sailfish::Secrets::StoragePlugin::FilterOperator filterOperator, QStringList *secretNames);
     Sailfish::Secrets::Result removeSecret(const QString &collectionName, const QString &secretName);
@@ -134,11 +158,14 @@ public:
     Sailfish::Secrets::Result removeCollection(const QString &collectionName);
 
     Sailfish::Secrets::Result isCollectionLocked(const QString &collectionName, bool *locked);
-    Sailfish::Secrets::Result deriveKeyFromCode(const QByteArray &authenticationCode, const QByteArray &salt, QByteArray *key);
+    Sailfish::Secrets::Result deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key);
+    Sailfish::Secrets::Result calibrateKeyDerivation(int targetDuration, QByteArray *parameters);
     Sailfish::Secrets::Result setEncryptionKey(const QString &collectionName, const QByteArray &key);
     Sailfish::Secrets::Result reencrypt(const QString &collectionName, const QByteArray &oldkey, const QByteArray &newkey);
+    Sailfish::Secrets::Result reencryptCollection(const QString &collectionName, const QByteArray &oldkey, const QByteArray &newkey, const QByteArray &keyDerivationParameters);
 
     Sailfish::Secrets::Result setSecret(const SecretMetadata &metadata, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData);
+    Sailfish::Secrets::Result setSecrets(const QVector<SecretMetadata> &metadata, const QVector<Sailfish::Secrets::Secret> &secrets);
     Sailfish::Secrets::Result getSecret(const QString &collectionName, const QString &secretName, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData);
     Sailfish::Secrets::Result findSecrets(const QString &collectionName, const Sailfish::Secrets::Secret::FilterData &filter, Sailfish::Secrets::StoragePlugin::FilterOperator filterOperator, QVector<Sailfish::Secrets::Secret::Identifier> *identifiers);
     Sailfish::Secrets::Result removeSecret(const QString &collectionName, const QString &secretName);
@@ -146,8 +173,39 @@ public:
     Sailfish::Secrets::Result setSecret(const SecretMetadata &metadata, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData, const QByteArray &key);
     Sailfish::Secrets::Result accessSecret(const QString &secretName, const QByteArray &key, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData);
 
+    bool lock() Q_DECL_OVERRIDE;
+
+    // collections which must be relocked after every access may instead be kept
+    // open ("warm") for a short time, so that subsequent accesses with the same key
+    // don't need to reopen them.  Warm collections are reported as locked.
+    void setWarmCollectionLimits(int timeout, int maxOperations, QTimer *relockTimer);
+    Sailfish::Secrets::Result relockCollection(const QString &collectionName, const QByteArray &key);
+    void relockWarmCollections(bool expiredOnly);
+    bool hasWarmCollections() const;
+
 protected:
+    bool isWarmCollection(const QString &collectionName) const;
+    void evictWarmCollection(const QString &collectionName, bool relock);
+
     Sailfish::Secrets::EncryptedStoragePlugin *m_encryptedStoragePlugin;
+
+private:
+    struct WarmCollection {
+        char *key;
+        int keyLength;
+        int remainingOperations;
+        bool inUse;
+        QElapsedTimer timer;
+    };
+
+    bool isExpired(const WarmCollection &collection) const;
+    void scheduleRelock();
+
+    QHash<QString, WarmCollection> m_warmCollections;
+    QAtomicInt m_warmCollectionCount;
+    int m_warmCollectionTimeout;
+    int m_warmCollectionOperations;
+    QTimer *m_relockTimer;
 };
 
 } // ApiImpl
@@ -12,6 +12,7 @@
 #include "../CryptoImpl/crypto_p.h"
 #include "../CryptoImpl/cryptopluginfunctionwrappers_p.h"
 
+#include "Secrets/batchrequest.h"
 #include "Secrets/result.h"
 #include "Secrets/secretmanager.h"
 #include "Secrets/secretsdaemonconnection_p.h"
@@ -27,6 +28,7 @@
 #include <QtCore/QStandardPaths>
 #include <QtCore/QByteArray>
 #include <QtCore/QDateTime>
+#include <QtCore/QDataStream>
 #include <QtCore/QFile>
 #include <QtCore/QDir>
 #include <QtCore/QCryptographicHash>
@@ -150,6 +152,21 @@ void Daemon::ApiImpl::SecretsDBusObject::getHealthInfo(
                                   result);
 }
 
+// retrieve request, plugin and queue statistics of the daemon
+void Daemon::ApiImpl::SecretsDBusObject::getDaemonStatistics(
+        const QDBusMessage &message,
+        Result &result,
+        QVariantMap &statistics)
+{
+    Q_UNUSED(statistics);               // outparam, set in handlePendingRequest
+    QList<QVariant> inParams;
+    m_requestQueue->handleRequest(Daemon::ApiImpl::GetDaemonStatisticsRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
 // retrieve user input for the client (daemon)
 void Daemon::ApiImpl::SecretsDBusObject::userInput(
         const InteractionParameters &uiParams,
@@ -424,6 +441,36 @@ void Daemon::ApiImpl::SecretsDBusObject::deleteSecret(
                                   result);
 }
 
+// perform a batch of operations on secrets
+void Daemon::ApiImpl::SecretsDBusObject::batch(
+        const QVector<int> &operations,
+        const QVector<Secret> &secrets,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
+        const QDBusMessage &message,
+        Result &result,
+        QVector<Result> &results,
+        QVector<Secret> &outSecrets)
+{
+    Q_UNUSED(results);      // outparam, set in handlePendingRequest / handleFinishedRequest
+    Q_UNUSED(outSecrets);   // outparam, set in handlePendingRequest / handleFinishedRequest
+    QVector<Secret> mappedSecrets;
+    mappedSecrets.reserve(secrets.size());
+    for (const Secret &secret : secrets) {
+        mappedSecrets.append(MAP_PLUGIN_NAMES(secret));
+    }
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QVector<int> >(operations)
+             << QVariant::fromValue<QVector<Secret> >(mappedSecrets)
+             << QVariant::fromValue<SecretManager::UserInteractionMode>(userInteractionMode)
+             << QVariant::fromValue<QString>(interactionServiceAddress);
+    m_requestQueue->handleRequest(Daemon::ApiImpl::BatchOperationsRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
 // query lock status of a plugin or metadata db
 void Daemon::ApiImpl::SecretsDBusObject::queryLockStatus(
         LockCodeRequest::LockCodeTargetType lockCodeTargetType,
@@ -512,6 +559,54 @@ void Daemon::ApiImpl::SecretsDBusObject::forgetLockCode(
                                   result);
 }
 
+void Daemon::ApiImpl::SecretsDBusObject::exportCollection(
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const QDBusUnixFileDescriptor &fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
+        const QDBusMessage &message,
+        Result &result)
+{
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QString>(collectionName)
+             << QVariant::fromValue<QString>(MAP_PLUGIN_NAMES(storagePluginName))
+             << QVariant::fromValue<QDBusUnixFileDescriptor>(fileDescriptor)
+             << QVariant::fromValue<QByteArray>(passphrase)
+             << QVariant::fromValue<SecretManager::UserInteractionMode>(userInteractionMode)
+             << QVariant::fromValue<QString>(interactionServiceAddress);
+    m_requestQueue->handleRequest(Daemon::ApiImpl::ExportCollectionRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
+void Daemon::ApiImpl::SecretsDBusObject::importCollection(
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const QDBusUnixFileDescriptor &fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
+        const QDBusMessage &message,
+        Result &result)
+{
+    QList<QVariant> inParams;
+    inParams << QVariant::fromValue<QString>(collectionName)
+             << QVariant::fromValue<QString>(MAP_PLUGIN_NAMES(storagePluginName))
+             << QVariant::fromValue<QDBusUnixFileDescriptor>(fileDescriptor)
+             << QVariant::fromValue<QByteArray>(passphrase)
+             << QVariant::fromValue<SecretManager::UserInteractionMode>(userInteractionMode)
+             << QVariant::fromValue<QString>(interactionServiceAddress);
+    m_requestQueue->handleRequest(Daemon::ApiImpl::ImportCollectionRequest,
+                                  inParams,
+                                  connection(),
+                                  message,
+                                  result);
+}
+
 //-----------------------------------
 
 Daemon::ApiImpl::SecretsRequestQueue::SecretsRequestQueue(
@@ -522,7 +617,7 @@ Daemon::ApiImpl::SecretsRequestQueue::SecretsRequestQueue(
           QLatin1String("org.sailfishos.secrets"),
           parent,
           autotestMode)
-    , m_appPermissions(Q_NULLPTR)
+    , m_appPermissions(parent->applicationPermissions())
     , m_requestProcessor(Q_NULLPTR)
     , m_controller(parent)
     , m_autotestMode(autotestMode)
@@ -538,7 +633,11 @@ Daemon::ApiImpl::SecretsRequestQueue::SecretsRequestQueue(
     m_secretsThreadPool = QSharedPointer<QThreadPool>::create();
     m_secretsThreadPool->setMaxThreadCount(1);
     m_secretsThreadPool->setExpiryTimeout(-1);
-    m_appPermissions = new Daemon::ApiImpl::ApplicationPermissions(this);
+    // Key derivation is deliberately slow, and does not depend upon plugin
+    // state, so it is performed by a separate thread to avoid blocking
+    // other plugin operations.
+    m_kdfThreadPool = QSharedPointer<QThreadPool>::create();
+    m_kdfThreadPool->setMaxThreadCount(1);
     m_requestProcessor = new Daemon::ApiImpl::RequestProcessor(m_appPermissions, autotestMode, this);
 
     setDBusObject(new Daemon::ApiImpl::SecretsDBusObject(this));
@@ -560,6 +659,21 @@ QWeakPointer<QThreadPool> Daemon::ApiImpl::SecretsRequestQueue::secretsThreadPoo
     return m_secretsThreadPool.toWeakRef();
 }
 
+QWeakPointer<QThreadPool> Daemon::ApiImpl::SecretsRequestQueue::kdfThreadPool()
+{
+    return m_kdfThreadPool.toWeakRef();
+}
+
+Daemon::ApiImpl::DerivedKeyCache *Daemon::ApiImpl::SecretsRequestQueue::derivedKeyCache()
+{
+    return &m_derivedKeyCache;
+}
+
+Daemon::ApiImpl::StoredKeyCache *Daemon::ApiImpl::SecretsRequestQueue::storedKeyCache()
+{
+    return &m_storedKeyCache;
+}
+
 bool Daemon::ApiImpl::SecretsRequestQueue::generateKeyData(
         const QByteArray &lockCode,
         const QString &cipherPluginName,
@@ -789,6 +903,9 @@ bool Daemon::ApiImpl::SecretsRequestQueue::initialize(
         return false;
     }
 
+    // cached stored keys must not outlive a lock or lock code change.
+    m_storedKeyCache.clear();
+
     if (mode == SecretsRequestQueue::UnlockMode || mode == SecretsRequestQueue::ModifyLockMode) {
         m_locked = false;
         if (lockCode.isEmpty()) {
@@ -798,14 +915,20 @@ bool Daemon::ApiImpl::SecretsRequestQueue::initialize(
         }
     } else {
         m_locked = true;
+        m_derivedKeyCache.clear();
     }
 
     return true;
 }
 
-bool Daemon::ApiImpl::SecretsRequestQueue::initializePlugins()
+void Daemon::ApiImpl::SecretsRequestQueue::initializePlugins()
 {
-    return m_requestProcessor->initializePlugins();
+    m_requestProcessor->initializePlugins();
+}
+
+QVariantMap Daemon::ApiImpl::SecretsRequestQueue::metadataStatistics() const
+{
+    return m_requestProcessor->metadataStatistics();
 }
 
 bool Daemon::ApiImpl::SecretsRequestQueue::masterLocked() const
@@ -1032,6 +1155,73 @@ QByteArray Daemon::ApiImpl::SecretsRequestQueue::saltData() const
     return saltData;
 }
 
+bool Daemon::ApiImpl::SecretsRequestQueue::keyDerivationParameters(
+        int *targetDuration,
+        QMap<QString, QByteArray> *parameters) const
+{
+    QDir secretsDir(secretsDirPath);
+    if (!secretsDir.mkpath(secretsDirPath)) {
+        qCWarning(lcSailfishSecretsDaemon) << "Permissions error: unable to create secrets directory:" << secretsDirPath;
+        return false;
+    }
+
+    const QString kdfDirName = m_autotestMode
+            ? QLatin1String("kdfparameters-test")
+            : QLatin1String("kdfparameters");
+    DataProtector dataProtector(secretsDir.absoluteFilePath(kdfDirName));
+    QByteArray data;
+    DataProtector::Status s = dataProtector.getData(&data);
+    if (s != DataProtector::Success) {
+        // the parameters will be recalibrated, this doesn't affect existing collections.
+        qCWarning(lcSailfishSecretsDaemon) << "keyDerivationParameters: can't read key derivation parameters. DataProtector returned:" << s;
+        return false;
+    }
+
+    qint32 storedTargetDuration = 0;
+    QMap<QString, QByteArray> storedParameters;
+    if (!data.isEmpty()) {
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_5_0);
+        in >> storedTargetDuration >> storedParameters;
+        if (in.status() != QDataStream::Ok) {
+            qCWarning(lcSailfishSecretsDaemon) << "keyDerivationParameters: invalid key derivation parameters";
+            return false;
+        }
+    }
+
+    *targetDuration = storedTargetDuration;
+    *parameters = storedParameters;
+    return true;
+}
+
+bool Daemon::ApiImpl::SecretsRequestQueue::setKeyDerivationParameters(
+        int targetDuration,
+        const QMap<QString, QByteArray> &parameters) const
+{
+    QDir secretsDir(secretsDirPath);
+    if (!secretsDir.mkpath(secretsDirPath)) {
+        qCWarning(lcSailfishSecretsDaemon) << "Permissions error: unable to create secrets directory:" << secretsDirPath;
+        return false;
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << static_cast<qint32>(targetDuration) << parameters;
+
+    const QString kdfDirName = m_autotestMode
+            ? QLatin1String("kdfparameters-test")
+            : QLatin1String("kdfparameters");
+    DataProtector dataProtector(secretsDir.absoluteFilePath(kdfDirName));
+    DataProtector::Status s = dataProtector.putData(data);
+    if (s != DataProtector::Success) {
+        qCWarning(lcSailfishSecretsDaemon) << "setKeyDerivationParameters: Can't write key derivation parameters. DataProtector returned:" << s;
+        return false;
+    }
+
+    return true;
+}
+
 bool Daemon::ApiImpl::SecretsRequestQueue::noLockCode() const
 {
     return m_noLockCode;
@@ -1185,6 +1375,7 @@ QString Daemon::ApiImpl::SecretsRequestQueue::requestTypeToString(int type) cons
         case InvalidRequest:                        return QLatin1String("InvalidRequest");
         case GetPluginInfoRequest:                  return QLatin1String("GetPluginInfoRequest");
         case GetHealthInfoRequest:                  return QLatin1String("GetHealthInfoRequest");
+        case GetDaemonStatisticsRequest:            return QLatin1String("GetDaemonStatisticsRequest");
         case UserInputRequest:                      return QLatin1String("UserInputRequest");
         case CollectionNamesRequest:                return QLatin1String("CollectionNamesRequest");
         case CreateDeviceLockCollectionRequest:     return QLatin1String("CreateDeviceLockCollectionRequest");
@@ -1203,15 +1394,34 @@ QString Daemon::ApiImpl::SecretsRequestQueue::requestTypeToString(int type) cons
         case ModifyLockCodeRequest:                 return QLatin1String("ModifyLockCodeRequest");
         case ProvideLockCodeRequest:                return QLatin1String("ProvideLockCodeRequest");
         case ForgetLockCodeRequest:                 return QLatin1String("ForgetLockCodeRequest");
+        case ExportCollectionRequest:               return QLatin1String("ExportCollectionRequest");
+        case ImportCollectionRequest:               return QLatin1String("ImportCollectionRequest");
         case UseCollectionKeyPreCheckRequest:       return QLatin1String("UseCollectionKeyPreCheckRequest");
         case SetCollectionKeyPreCheckRequest:       return QLatin1String("SetCollectionKeyPreCheckRequest");
         case SetCollectionKeyRequest:               return QLatin1String("SetCollectionKeyRequest");
         case StoredKeyIdentifiersRequest:           return QLatin1String("StoredKeyIdentifiersRequest");
+        case BatchOperationsRequest:                return QLatin1String("BatchOperationsRequest");
         default: break;
     }
     return QLatin1String("Unknown Secrets Request!");
 }
 
+bool Daemon::ApiImpl::SecretsRequestQueue::isBulkRequest(int type) const
+{
+    // Requests which create, destroy or transfer whole collections
+    // can be expensive, so should not delay interactive requests.
+    switch (type) {
+        case CreateDeviceLockCollectionRequest:     // fall through
+        case CreateCustomLockCollectionRequest:     // fall through
+        case DeleteCollectionRequest:               // fall through
+        case ExportCollectionRequest:               // fall through
+        case ImportCollectionRequest:               // fall through
+        case BatchOperationsRequest:                return true;
+        default: break;
+    }
+    return false;
+}
+
 void Daemon::ApiImpl::SecretsRequestQueue::handleCancelation(
         Daemon::ApiImpl::RequestQueue::RequestData *request)
 {
@@ -1274,6 +1484,26 @@ void Daemon::ApiImpl::SecretsRequestQueue::handlePendingRequest(
             break;
 
         }
+        case GetDaemonStatisticsRequest: {
+            qCDebug(lcSailfishSecretsDaemon) << "Handling GetDaemonStatisticsRequest from client:" << request->remotePid << ", request number:" << request->requestId;
+
+            // the statistics reveal information about the usage of the daemon
+            // by other applications, so only platform applications may read them.
+            QVariantMap statistics;
+            Result result(Result::Succeeded);
+            if (!m_autotestMode
+                    && !m_controller->applicationPermissions()->applicationIsPlatformApplication(request->remotePid)) {
+                result = Result(Result::PermissionsError,
+                                QLatin1String("Only platform applications may read the daemon statistics"));
+            } else {
+                statistics = m_controller->daemonStatistics();
+            }
+
+            request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
+                                                                    << QVariant::fromValue<QVariantMap>(statistics));
+            *completed = true;
+            break;
+        }
         case CollectionNamesRequest: {
             qCDebug(lcSailfishSecretsDaemon) << "Handling CollectionNamesRequest from client:" << request->remotePid << ", request number:" << request->requestId;
             QString storagePluginName = request->inParams.size() ? request->inParams.takeFirst().value<QString>() : QString();
@@ -1943,6 +2173,61 @@ void Daemon::ApiImpl::SecretsRequestQueue::handlePendingRequest(
             }
             break;
         }
+        case ExportCollectionRequest:
+        case ImportCollectionRequest: {
+            const bool exporting = request->type == ExportCollectionRequest;
+            qCDebug(lcSailfishSecretsDaemon) << "Handling" << requestTypeToString(request->type)
+                                             << "from client:" << request->remotePid << ", request number:" << request->requestId;
+            QString collectionName = request->inParams.size()
+                    ? request->inParams.takeFirst().value<QString>()
+                    : QString();
+            QString storagePluginName = request->inParams.size()
+                    ? request->inParams.takeFirst().value<QString>()
+                    : QString();
+            QDBusUnixFileDescriptor fileDescriptor = request->inParams.size()
+                    ? request->inParams.takeFirst().value<QDBusUnixFileDescriptor>()
+                    : QDBusUnixFileDescriptor();
+            QByteArray passphrase = request->inParams.size()
+                    ? request->inParams.takeFirst().value<QByteArray>()
+                    : QByteArray();
+            SecretManager::UserInteractionMode userInteractionMode = request->inParams.size()
+                    ? request->inParams.takeFirst().value<SecretManager::UserInteractionMode>()
+                    : SecretManager::PreventInteraction;
+            QString interactionServiceAddress = request->inParams.size()
+                    ? request->inParams.takeFirst().value<QString>()
+                    : QString();
+            Result result = masterLocked()
+                    ? Result(Result::SecretsDaemonLockedError,
+                             QLatin1String("The secrets database is locked"))
+                    : exporting
+                    ? m_requestProcessor->exportCollection(
+                                      request->remotePid,
+                                      request->requestId,
+                                      collectionName,
+                                      storagePluginName,
+                                      fileDescriptor,
+                                      passphrase,
+                                      userInteractionMode,
+                                      interactionServiceAddress)
+                    : m_requestProcessor->importCollection(
+                                      request->remotePid,
+                                      request->requestId,
+                                      collectionName,
+                                      storagePluginName,
+                                      fileDescriptor,
+                                      passphrase,
+                                      userInteractionMode,
+                                      interactionServiceAddress);
+            // send the reply to the calling peer.
+            if (result.code() == Result::Pending) {
+                // waiting for asynchronous flow to complete
+                *completed = false;
+            } else {
+                request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result));
+                *completed = true;
+            }
+            break;
+        }
         case UseCollectionKeyPreCheckRequest: {
             qCDebug(lcSailfishSecretsDaemon) << "Handling UseCollectionKeyPreCheckRequest from client:" << request->remotePid << ", request number:" << request->requestId;
             Secret::Identifier identifier = request->inParams.size()
@@ -2112,6 +2397,11 @@ void Daemon::ApiImpl::SecretsRequestQueue::handlePendingRequest(
             }
             break;
         }
+        case BatchOperationsRequest: {
+            qCDebug(lcSailfishSecretsDaemon) << "Handling BatchOperationsRequest from client:" << request->remotePid << ", request number:" << request->requestId;
+            handleBatchRequest(request, false, completed);
+            break;
+        }
         default: {
             qCWarning(lcSailfishSecretsDaemon) << "Cannot handle request:" << request->requestId
                                                << "with invalid type:" << requestTypeToString(request->type);
@@ -2170,6 +2460,11 @@ void Daemon::ApiImpl::SecretsRequestQueue::handleFinishedRequest(
             // and always completes, so we do not need to handle this request here.
             break;
         }
+        case GetDaemonStatisticsRequest: {
+            // The implementation in handlePendingRequest() for the GetDaemonStatisticsRequest is purely synchronous
+            // and always completes, so we do not need to handle this request here.
+            break;
+        }
         case CollectionNamesRequest: {
             Result result = request->outParams.size()
                     ? request->outParams.takeFirst().value<Result>()
@@ -2321,8 +2616,13 @@ void Daemon::ApiImpl::SecretsRequestQueue::handleFinishedRequest(
                 Secret secret = request->outParams.size()
                         ? request->outParams.takeFirst().value<Secret>()
                         : Secret();
+                const bool cacheable = request->outParams.size()
+                        ? request->outParams.takeFirst().value<bool>()
+                        : false;
                 if (request->isSecretsCryptoRequest) {
-                    asynchronousCryptoRequestCompleted(request->cryptoRequestId, result, QVariantList() << QVariant::fromValue<Secret>(secret));
+                    asynchronousCryptoRequestCompleted(request->cryptoRequestId, result,
+                                                       QVariantList() << QVariant::fromValue<Secret>(secret)
+                                                                      << QVariant::fromValue<bool>(cacheable));
                 } else {
                     request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
                                                                             << QVariant::fromValue<Secret>(secret));
@@ -2518,6 +2818,23 @@ void Daemon::ApiImpl::SecretsRequestQueue::handleFinishedRequest(
             }
             break;
         }
+        case ExportCollectionRequest:
+        case ImportCollectionRequest: {
+            Result result = request->outParams.size()
+                    ? request->outParams.takeFirst().value<Result>()
+                    : Result(Result::UnknownError,
+                             QStringLiteral("Unable to determine result of %1 request")
+                             .arg(requestTypeToString(request->type)));
+            if (result.code() == Result::Pending) {
+                // shouldn't happen!
+                qCWarning(lcSailfishSecretsDaemon) << requestTypeToString(request->type) << request->requestId << "finished as pending!";
+                *completed = true;
+            } else {
+                request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result));
+                *completed = true;
+            }
+            break;
+        }
         case UserInputRequest: {
             const Result result = request->outParams.size()
                     ? request->outParams.takeFirst().value<Result>()
@@ -2635,6 +2952,10 @@ void Daemon::ApiImpl::SecretsRequestQueue::handleFinishedRequest(
             }
             break;
         }
+        case BatchOperationsRequest: {
+            handleBatchRequest(request, true, completed);
+            break;
+        }
         default: {
             qCWarning(lcSailfishSecretsDaemon) << "Cannot handle synchronous request:" << request->requestId << "with type:" << requestTypeToString(request->type) << "in an asynchronous fashion";
             *completed = false;
@@ -2643,6 +2964,152 @@ void Daemon::ApiImpl::SecretsRequestQueue::handleFinishedRequest(
     }
 }
 
+void Daemon::ApiImpl::SecretsRequestQueue::handleBatchRequest(
+        Daemon::ApiImpl::RequestQueue::RequestData *request,
+        bool operationFinished,
+        bool *completed)
+{
+    // The operations of the batch are performed one after another,
+    // all as part of the single queued request.  The progress of the
+    // batch is kept in the inParams of the request, so that it can be
+    // resumed each time an asynchronous operation finishes:
+    // operations, secrets, userInteractionMode, interactionServiceAddress,
+    // and then the results and output secrets of completed operations.
+    const QVector<int> operations = request->inParams.value(0).value<QVector<int> >();
+    const QVector<Secret> secrets = request->inParams.value(1).value<QVector<Secret> >();
+    const SecretManager::UserInteractionMode userInteractionMode = request->inParams.size() > 2
+            ? request->inParams.at(2).value<SecretManager::UserInteractionMode>()
+            : SecretManager::PreventInteraction;
+    const QString interactionServiceAddress = request->inParams.value(3).value<QString>();
+    QVector<Result> results = request->inParams.value(4).value<QVector<Result> >();
+    QVector<Secret> outSecrets = request->inParams.value(5).value<QVector<Secret> >();
+
+    if (operations.size() != secrets.size()) {
+        Result result(Result::InvalidSecretError,
+                      QLatin1String("Each operation in the batch must have exactly one secret"));
+        request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(result)
+                                                                << QVariant::fromValue<QVector<Result> >(QVector<Result>())
+                                                                << QVariant::fromValue<QVector<Secret> >(QVector<Secret>()));
+        *completed = true;
+        return;
+    }
+
+    if (operationFinished) {
+        // the previous operation of the batch has finished asynchronously.
+        const int index = results.size();
+        Result result = request->outParams.size()
+                ? request->outParams.takeFirst().value<Result>()
+                : Result(Result::UnknownError,
+                         QLatin1String("Unable to determine result of BatchOperationsRequest operation"));
+        Secret secret = request->outParams.size()
+                ? request->outParams.takeFirst().value<Secret>()
+                : Secret(secrets.value(index).identifier());
+        results.append(result);
+        outSecrets.append(secret);
+    }
+
+    while (results.size() < operations.size()) {
+        const int index = results.size();
+        Secret secret(secrets.at(index).identifier());
+        Result result = masterLocked()
+                ? Result(Result::SecretsDaemonLockedError,
+                         QLatin1String("The secrets database is locked"))
+                : performBatchOperation(request,
+                                        operations.at(index),
+                                        secrets.at(index),
+                                        userInteractionMode,
+                                        interactionServiceAddress,
+                                        &secret);
+        if (result.code() == Result::Pending) {
+            // waiting for asynchronous flow to complete
+            request->inParams = QList<QVariant>()
+                    << QVariant::fromValue<QVector<int> >(operations)
+                    << QVariant::fromValue<QVector<Secret> >(secrets)
+                    << QVariant::fromValue<SecretManager::UserInteractionMode>(userInteractionMode)
+                    << QVariant::fromValue<QString>(interactionServiceAddress)
+                    << QVariant::fromValue<QVector<Result> >(results)
+                    << QVariant::fromValue<QVector<Secret> >(outSecrets);
+            setRequestInProgress(request, true);
+            *completed = false;
+            return;
+        }
+        results.append(result);
+        outSecrets.append(secret);
+    }
+
+    // send the reply to the calling peer.
+    request->connection.send(request->message.createReply() << QVariant::fromValue<Result>(Result(Result::Succeeded))
+                                                            << QVariant::fromValue<QVector<Result> >(results)
+                                                            << QVariant::fromValue<QVector<Secret> >(outSecrets));
+    *completed = true;
+}
+
+Result Daemon::ApiImpl::SecretsRequestQueue::performBatchOperation(
+        Daemon::ApiImpl::RequestQueue::RequestData *request,
+        int operation,
+        const Secret &secret,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
+        Secret *outSecret)
+{
+    const Secret::Identifier identifier = secret.identifier();
+    if (!identifier.isValid()) {
+        return Result(Result::InvalidSecretIdentifierError,
+                      QLatin1String("The given identifier is invalid"));
+    }
+
+    switch (operation) {
+        case Sailfish::Secrets::BatchRequest::StoreSecretOperation: {
+            if (identifier.identifiesStandaloneSecret()) {
+                return Result(Result::InvalidSecretIdentifierError,
+                              QLatin1String("Standalone secrets cannot be stored via a batch"));
+            }
+            return m_requestProcessor->setCollectionSecret(
+                        request->remotePid,
+                        request->requestId,
+                        secret,
+                        InteractionParameters(),
+                        userInteractionMode,
+                        interactionServiceAddress);
+        }
+        case Sailfish::Secrets::BatchRequest::StoredSecretOperation: {
+            return identifier.identifiesStandaloneSecret()
+                    ? m_requestProcessor->getStandaloneSecret(
+                                      request->remotePid,
+                                      request->requestId,
+                                      identifier,
+                                      userInteractionMode,
+                                      interactionServiceAddress,
+                                      outSecret)
+                    : m_requestProcessor->getCollectionSecret(
+                                      request->remotePid,
+                                      request->requestId,
+                                      identifier,
+                                      userInteractionMode,
+                                      interactionServiceAddress,
+                                      outSecret);
+        }
+        case Sailfish::Secrets::BatchRequest::DeleteSecretOperation: {
+            return identifier.identifiesStandaloneSecret()
+                    ? m_requestProcessor->deleteStandaloneSecret(
+                                      request->remotePid,
+                                      request->requestId,
+                                      identifier,
+                                      userInteractionMode)
+                    : m_requestProcessor->deleteCollectionSecret(
+                                      request->remotePid,
+                                      request->requestId,
+                                      identifier,
+                                      userInteractionMode,
+                                      interactionServiceAddress);
+        }
+        default: break;
+    }
+
+    return Result(Result::OperationNotSupportedError,
+                  QStringLiteral("Unknown batch operation: %1").arg(operation));
+}
+
 void Daemon::ApiImpl::SecretsRequestQueue::dealWithDataCorruption() const
 {
     // NOTE: Right now we just delete all corrupted data.
@@ -10,6 +10,8 @@
 
 #include "requestqueue_p.h"
 #include "applicationpermissions_p.h"
+#include "derivedkeycache_p.h"
+#include "storedkeycache_p.h"
 
 #include "Secrets/secret.h"
 #include "Secrets/interactionparameters.h"
@@ -26,6 +28,7 @@
 #include <QtCore/QThreadPool>
 #include <QtCore/QSharedPointer>
 #include <QtDBus/QDBusContext>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 // the environment variable which can be used to specify the name
 // of the crypto plugin to use when deriving the master lock keys.
@@ -75,6 +78,12 @@ class SecretsDBusObject : public DBusObject
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"Sailfish::Secrets::HealthCheckRequest::Health\" />\n"
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out2\" value=\"Sailfish::Secrets::HealthCheckRequest::Health\" />\n"
     "      </method>\n"
+    "      <method name=\"getDaemonStatistics\">\n"
+    "          <arg name=\"result\" type=\"(iis)\" direction=\"out\" />\n"
+    "          <arg name=\"statistics\" type=\"a{sv}\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Secrets::Result\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"QVariantMap\" />\n"
+    "      </method>\n"
     "      <method name=\"userInput\">\n"
     "          <arg name=\"uiParams\" type=\"(ssss(i)sa{is}(i)(i))\" direction=\"in\" />\n"
     "          <arg name=\"result\" type=\"(iis)\" direction=\"out\" />\n"
@@ -202,6 +211,21 @@ class SecretsDBusObject : public DBusObject
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In1\" value=\"Sailfish::Secrets::SecretManager::UserInteractionMode\" />\n"
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Secrets::Result\" />\n"
     "      </method>\n"
+    "      <method name=\"batch\">\n"
+    "          <arg name=\"operations\" type=\"ai\" direction=\"in\" />\n"
+    "          <arg name=\"secrets\" type=\"a((sss)aya{sv})\" direction=\"in\" />\n"
+    "          <arg name=\"userInteractionMode\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"interactionServiceAddress\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iis)\" direction=\"out\" />\n"
+    "          <arg name=\"results\" type=\"a(iis)\" direction=\"out\" />\n"
+    "          <arg name=\"secrets\" type=\"a((sss)aya{sv})\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In0\" value=\"QVector<int>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In1\" value=\"QVector<Sailfish::Secrets::Secret>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In2\" value=\"Sailfish::Secrets::SecretManager::UserInteractionMode\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Secrets::Result\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out1\" value=\"QVector<Sailfish::Secrets::Result>\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out2\" value=\"QVector<Sailfish::Secrets::Secret>\" />\n"
+    "      </method>\n"
     "      <method name=\"queryLockStatus\">\n"
     "          <arg name=\"lockCodeTargetType\" type=\"(i)\" direction=\"in\" />\n"
     "          <arg name=\"lockCodeTarget\" type=\"s\" direction=\"in\" />\n"
@@ -247,6 +271,28 @@ class SecretsDBusObject : public DBusObject
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In3\" value=\"Sailfish::Secrets::SecretManager::UserInteractionMode\" />\n"
     "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Secrets::Result\" />\n"
     "      </method>\n"
+    "      <method name=\"exportCollection\">\n"
+    "          <arg name=\"collectionName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"storagePluginName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"fileDescriptor\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"passphrase\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"userInteractionMode\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"interactionServiceAddress\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iis)\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In4\" value=\"Sailfish::Secrets::SecretManager::UserInteractionMode\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Secrets::Result\" />\n"
+    "      </method>\n"
+    "      <method name=\"importCollection\">\n"
+    "          <arg name=\"collectionName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"storagePluginName\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"fileDescriptor\" type=\"h\" direction=\"in\" />\n"
+    "          <arg name=\"passphrase\" type=\"ay\" direction=\"in\" />\n"
+    "          <arg name=\"userInteractionMode\" type=\"(i)\" direction=\"in\" />\n"
+    "          <arg name=\"interactionServiceAddress\" type=\"s\" direction=\"in\" />\n"
+    "          <arg name=\"result\" type=\"(iis)\" direction=\"out\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.In4\" value=\"Sailfish::Secrets::SecretManager::UserInteractionMode\" />\n"
+    "          <annotation name=\"org.qtproject.QtDBus.QtTypeName.Out0\" value=\"Sailfish::Secrets::Result\" />\n"
+    "      </method>\n"
     "  </interface>\n"
     "")
 
@@ -270,6 +316,12 @@ public Q_SLOTS:
             Sailfish::Secrets::HealthCheckRequest::Health &saltDataHealth,
             Sailfish::Secrets::HealthCheckRequest::Health &masterlockHealth);
 
+    // retrieve request, plugin and queue statistics of the daemon
+    void getDaemonStatistics(
+            const QDBusMessage &message,
+            Sailfish::Secrets::Result &result,
+            QVariantMap &statistics);
+
     // retrieve user input for the client (daemon)
     void userInput(
             const Sailfish::Secrets::InteractionParameters &uiParams,
@@ -379,6 +431,17 @@ public Q_SLOTS:
             const QDBusMessage &message,
             Sailfish::Secrets::Result &result);
 
+    // perform a batch of operations on secrets
+    void batch(
+            const QVector<int> &operations,
+            const QVector<Sailfish::Secrets::Secret> &secrets,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress,
+            const QDBusMessage &message,
+            Sailfish::Secrets::Result &result,
+            QVector<Sailfish::Secrets::Result> &results,
+            QVector<Sailfish::Secrets::Secret> &outSecrets);
+
     // query lock status of a plugin or metadata db
     void queryLockStatus(
             Sailfish::Secrets::LockCodeRequest::LockCodeTargetType lockCodeTargetType,
@@ -416,6 +479,28 @@ public Q_SLOTS:
             const QString &interactionServiceAddress,
             const QDBusMessage &message,
             Sailfish::Secrets::Result &result);
+
+    // export the secrets of a collection into an archive file
+    void exportCollection(
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const QDBusUnixFileDescriptor &fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress,
+            const QDBusMessage &message,
+            Sailfish::Secrets::Result &result);
+
+    // import the secrets of an archive file into a collection
+    void importCollection(
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const QDBusUnixFileDescriptor &fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress,
+            const QDBusMessage &message,
+            Sailfish::Secrets::Result &result);
 };
 
 class RequestProcessor;
@@ -435,13 +520,18 @@ public:
 
     Sailfish::Secrets::Daemon::Controller *controller() const;
     QWeakPointer<QThreadPool> secretsThreadPool();
+    QWeakPointer<QThreadPool> kdfThreadPool();
+    Sailfish::Secrets::Daemon::ApiImpl::DerivedKeyCache *derivedKeyCache();
+    Sailfish::Secrets::Daemon::ApiImpl::StoredKeyCache *storedKeyCache();
     bool initialize(const QByteArray &lockCode, InitializationMode mode);
-    bool initializePlugins();
+    void initializePlugins();
+    QVariantMap metadataStatistics() const;
 
     void handleCancelation(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request) Q_DECL_OVERRIDE;
     void handlePendingRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool *completed) Q_DECL_OVERRIDE;
     void handleFinishedRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool *completed) Q_DECL_OVERRIDE;
     QString requestTypeToString(int type) const Q_DECL_OVERRIDE;
+    bool isBulkRequest(int type) const Q_DECL_OVERRIDE;
 
 public: // helpers for crypto API: secretscryptohelpers.cpp
     QMap<QString, QObject*> potentialCryptoStoragePlugins() const;
@@ -452,6 +542,9 @@ public: // helpers for crypto API: secretscryptohelpers.cpp
 
 private:
     QSharedPointer<QThreadPool> m_secretsThreadPool;
+    QSharedPointer<QThreadPool> m_kdfThreadPool;
+    Sailfish::Secrets::Daemon::ApiImpl::DerivedKeyCache m_derivedKeyCache;
+    Sailfish::Secrets::Daemon::ApiImpl::StoredKeyCache m_storedKeyCache;
     Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions *m_appPermissions;
     Sailfish::Secrets::Daemon::ApiImpl::RequestProcessor *m_requestProcessor;
     Sailfish::Secrets::Daemon::Controller *m_controller;
@@ -468,6 +561,11 @@ private:
     bool generateKeyData(const QByteArray &lockCode, const QString &cipherPluginName, QByteArray *bkdbKey, QByteArray *deviceLockKey, QByteArray *testCipherText, QString *usedCipherPluginName) const;
     bool initializeKeyData(const QByteArray &bkdkKey, const QByteArray &deviceLockKey);
     void dealWithDataCorruption() const;
+    void handleBatchRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool operationFinished, bool *completed);
+    Sailfish::Secrets::Result performBatchOperation(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request,
+                                                    int operation, const Sailfish::Secrets::Secret &secret,
+                                                    Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+                                                    const QString &interactionServiceAddress, Sailfish::Secrets::Secret *outSecret);
 
 public: // For use by the secrets request processor to handle device-locked collection/secret semantics
     bool masterLocked() const;
@@ -476,6 +574,8 @@ public: // For use by the secrets request processor to handle device-locked coll
     bool writeTestCipherText(const QByteArray &testCipherText, const QString &cipherPluginName) const; // the testCipherText file should be considered mutable.
     bool determineTestCipherPlugin(QString *cipherPluginName) const;
     QByteArray saltData() const;
+    bool keyDerivationParameters(int *targetDuration, QMap<QString, QByteArray> *parameters) const;
+    bool setKeyDerivationParameters(int targetDuration, const QMap<QString, QByteArray> &parameters) const;
     bool noLockCode() const;
     void setNoLockCode(bool value);
     const QByteArray bkdbLockKey() const;
@@ -534,12 +634,19 @@ private:
         ForgetLockCodeCryptoApiHelperRequest
     };
     QMap<quint64, CryptoApiHelperRequestType> m_cryptoApiHelperRequests; // crypto request id to crypto api call type.
+    struct PendingStoredKey {
+        Sailfish::Crypto::Key::Identifier identifier;
+        QString applicationId;
+        quint64 generation;
+    };
+    QMap<quint64, PendingStoredKey> m_pendingStoredKeys; // crypto request id to stored key cache entry context.
 };
 
 enum RequestType {
     InvalidRequest = 0,
     GetPluginInfoRequest,
     GetHealthInfoRequest,
+    GetDaemonStatisticsRequest,
     UserInputRequest,
     CollectionNamesRequest,
     CreateDeviceLockCollectionRequest,
@@ -558,6 +665,8 @@ enum RequestType {
     ModifyLockCodeRequest,
     ProvideLockCodeRequest,
     ForgetLockCodeRequest,
+    ExportCollectionRequest,
+    ImportCollectionRequest,
     // Internal user input request types:
     SetCollectionUserInputSecretRequest,
     SetStandaloneDeviceLockUserInputSecretRequest,
@@ -566,7 +675,9 @@ enum RequestType {
     UseCollectionKeyPreCheckRequest,
     SetCollectionKeyPreCheckRequest,
     SetCollectionKeyRequest,
-    StoredKeyIdentifiersRequest
+    StoredKeyIdentifiersRequest,
+    // Batched request types:
+    BatchOperationsRequest
 };
 
 } // ApiImpl
@@ -289,8 +289,15 @@ Daemon::ApiImpl::SecretsRequestQueue::storedKey(
         QByteArray *serializedKey,
         QMap<QString, QString> *filterData)
 {
-    Q_UNUSED(serializedKey); // this request is always asynchronous
-    Q_UNUSED(filterData);
+    // keys which were recently read by the same application from
+    // a collection which remains unlocked can be returned synchronously.
+    const QString callerApplicationId = m_appPermissions->applicationIsPlatformApplication(callerPid)
+                ? m_appPermissions->platformApplicationId()
+                : m_appPermissions->applicationId(callerPid);
+    if (!masterLocked()
+            && m_storedKeyCache.lookup(identifier, callerApplicationId, serializedKey, filterData)) {
+        return Result(Result::Succeeded);
+    }
 
     // perform the "get collection secret" request, as a secrets-for-crypto request.
     QList<QVariant> inParams;
@@ -310,6 +317,7 @@ Daemon::ApiImpl::SecretsRequestQueue::storedKey(
         return enqueueResult;
     }
     m_cryptoApiHelperRequests.insert(cryptoRequestId, Daemon::ApiImpl::SecretsRequestQueue::StoredKeyCryptoApiHelperRequest);
+    m_pendingStoredKeys.insert(cryptoRequestId, { identifier, callerApplicationId, m_storedKeyCache.generation() });
     return Result(Result::Pending);
 }
 
@@ -462,6 +470,14 @@ Daemon::ApiImpl::SecretsRequestQueue::asynchronousCryptoRequestCompleted(
     switch (type) {
         case StoredKeyCryptoApiHelperRequest: {
             Secret secret = parameters.size() ? parameters.first().value<Secret>() : Secret();
+            if (result.code() == Result::Succeeded
+                    && parameters.value(1).value<bool>()
+                    && m_pendingStoredKeys.contains(cryptoRequestId)) {
+                const PendingStoredKey &pending(m_pendingStoredKeys[cryptoRequestId]);
+                m_storedKeyCache.insert(pending.identifier, pending.applicationId,
+                                        secret.data(), secret.filterData(), pending.generation);
+            }
+            m_pendingStoredKeys.remove(cryptoRequestId);
             emit storedKeyCompleted(cryptoRequestId, result, secret.data(), secret.filterData());
             break;
         }
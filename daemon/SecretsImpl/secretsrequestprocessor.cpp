@@ -11,6 +11,7 @@
 #include "logging_p.h"
 #include "util_p.h"
 #include "plugin_p.h"
+#include "statistics_p.h"
 #include "dataprotector_p.h"
 
 #include "Secrets/result.h"
@@ -29,6 +30,8 @@
 #include <QtCore/QSet>
 #include <QtCore/QDir>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSharedPointer>
 #include <QtConcurrent>
 
 using namespace Sailfish::Secrets;
@@ -168,25 +171,291 @@ Daemon::ApiImpl::RequestProcessor::RequestProcessor(
                             autotestMode));
         }
     }
+
+    // Collections which are relocked after every access may be kept open
+    // for a short time, so that a burst of accesses doesn't reopen the
+    // collection (and rederive its page keys) every time.
+    // The relock timer closes them again once they have expired.
+    bool ok = false;
+    int relockCacheTimeout = QString::fromUtf8(qgetenv(ENV_RELOCK_CACHE_TIMEOUT)).toInt(&ok);
+    if (!ok || relockCacheTimeout < 0) {
+        relockCacheTimeout = 2000;
+    }
+    int relockCacheOperations = QString::fromUtf8(qgetenv(ENV_RELOCK_CACHE_OPERATIONS)).toInt(&ok);
+    if (!ok || relockCacheOperations < 0) {
+        relockCacheOperations = 16;
+    }
+    m_relockTimer.setSingleShot(true);
+    m_relockTimer.setInterval(relockCacheTimeout);
+    connect(&m_relockTimer, &QTimer::timeout,
+            this, &Daemon::ApiImpl::RequestProcessor::relockWarmCollections);
+    for (EncryptedStoragePluginWrapper *plugin : m_encryptedStoragePlugins.values()) {
+        plugin->setWarmCollectionLimits(relockCacheTimeout, relockCacheOperations, &m_relockTimer);
+    }
+
+    // Unless every commit is synced, the metadata databases are checkpointed
+    // periodically from the secrets thread pool, between requests, rather than
+    // by SQLite inline with whichever write happens to fill the WAL.
+    if (Daemon::Sqlite::Database::defaultDurability() != Daemon::Sqlite::Database::FullDurability) {
+        m_checkpointTimer.setInterval(30000);
+        connect(&m_checkpointTimer, &QTimer::timeout,
+                this, &Daemon::ApiImpl::RequestProcessor::checkpointMetadataDatabases);
+        m_checkpointTimer.start();
+    }
+
+    calibrateKeyDerivation();
 }
 
-bool Daemon::ApiImpl::RequestProcessor::initializePlugins()
+Daemon::ApiImpl::RequestProcessor::~RequestProcessor()
 {
-    QFuture<bool> future = QtConcurrent::run(
+    // the plugins must not be initialized after their wrappers are gone.
+    m_initializationThreadPool.waitForDone();
+}
+
+// The key derivation parameters used for new collections are calibrated
+// once per device, so that deriving a collection key from its lock code
+// takes approximately the target duration, and are then persisted.
+// They are recalibrated only if the target duration changes.
+void Daemon::ApiImpl::RequestProcessor::calibrateKeyDerivation()
+{
+    bool ok = false;
+    int targetDuration = QString::fromUtf8(qgetenv(ENV_KDF_TARGET_DURATION)).toInt(&ok);
+    if (!ok || targetDuration <= 0) {
+        targetDuration = m_autotestMode ? 25 : 250;
+    }
+
+    int storedTargetDuration = 0;
+    if (!m_requestQueue->keyDerivationParameters(&storedTargetDuration, &m_keyDerivationParameters)
+            || storedTargetDuration != targetDuration) {
+        m_keyDerivationParameters.clear();
+    }
+
+    QMap<QString, QFuture<KeyDerivationParametersResult> > futures;
+    for (const QString &pluginName : m_encryptionPlugins.keys()) {
+        if (!m_keyDerivationParameters.contains(pluginName)) {
+            futures.insert(pluginName, QtConcurrent::run(
+                    m_requestQueue->kdfThreadPool().data(),
+                    EncryptionPluginFunctionWrapper::calibrateKeyDerivation,
+                    m_encryptionPlugins.value(pluginName),
+                    targetDuration));
+        }
+    }
+    for (const QString &pluginName : m_encryptedStoragePlugins.keys()) {
+        if (!m_keyDerivationParameters.contains(pluginName)) {
+            futures.insert(pluginName, QtConcurrent::run(
+                    m_requestQueue->kdfThreadPool().data(),
+                    EncryptedStoragePluginFunctionWrapper::calibrateKeyDerivation,
+                    m_encryptedStoragePlugins.value(pluginName),
+                    targetDuration));
+        }
+    }
+
+    // until calibration completes, new collections use the original parameters.
+    for (const QString &pluginName : futures.keys()) {
+        QFutureWatcher<KeyDerivationParametersResult> *watcher
+                = new QFutureWatcher<KeyDerivationParametersResult>(this);
+        connect(watcher, &QFutureWatcher<KeyDerivationParametersResult>::finished, [=] {
+            watcher->deleteLater();
+            KeyDerivationParametersResult kpr = watcher->future().result();
+            if (kpr.result.code() != Result::Succeeded) {
+                qCWarning(lcSailfishSecretsDaemon) << "Failed to calibrate key derivation for plugin:"
+                                                   << pluginName << kpr.result.errorMessage();
+                return;
+            }
+            m_keyDerivationParameters.insert(pluginName, kpr.parameters);
+            m_requestQueue->setKeyDerivationParameters(targetDuration, m_keyDerivationParameters);
+        });
+        watcher->setFuture(futures.value(pluginName));
+    }
+}
+
+// Collections created before the key derivation parameters were calibrated
+// are upgraded lazily: once a collection has been unlocked with its lock code,
+// a new key is derived with the calibrated parameters and the collection is
+// reencrypted with it, in the background.
+// Only encrypted storage collections are upgraded, as only encrypted storage
+// plugins verify the old key before reencrypting.
+void Daemon::ApiImpl::RequestProcessor::upgradeCollectionKeyDerivation(
+        const QString &storagePluginName,
+        const CollectionMetadata &collectionMetadata,
+        const QByteArray &authenticationCode,
+        const QByteArray &collectionKey)
+{
+    if (collectionMetadata.usesDeviceLockKey
+            || !m_encryptedStoragePlugins.contains(storagePluginName)) {
+        return;
+    }
+
+    const bool encryptedStorage = storagePluginName == collectionMetadata.encryptionPluginName
+            || collectionMetadata.encryptionPluginName.isEmpty();
+    const QByteArray keyDerivationParameters = m_keyDerivationParameters.value(
+            encryptedStorage ? storagePluginName : collectionMetadata.encryptionPluginName);
+    if (keyDerivationParameters.isEmpty()
+            || keyDerivationParameters == collectionMetadata.keyDerivationParameters) {
+        return;
+    }
+
+    const QString collectionName = collectionMetadata.collectionName;
+    const QString hashedCollectionName = calculateSecretNameHash(
+                Secret::Identifier(QString(), collectionName, storagePluginName));
+    if (m_pendingKeyDerivationUpgrades.contains(hashedCollectionName)) {
+        return;
+    }
+    m_pendingKeyDerivationUpgrades.insert(hashedCollectionName);
+
+    QFutureWatcher<DerivedKeyResult> *watcher
+            = new QFutureWatcher<DerivedKeyResult>(this);
+    QFuture<DerivedKeyResult> future;
+    if (encryptedStorage) {
+        future = QtConcurrent::run(
+                    m_requestQueue->kdfThreadPool().data(),
+                    EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
+                    m_encryptedStoragePlugins[storagePluginName],
+                    m_requestQueue->derivedKeyCache(),
+                    authenticationCode,
+                    m_requestQueue->saltData(),
+                    keyDerivationParameters);
+    } else {
+        future = QtConcurrent::run(
+                    m_requestQueue->kdfThreadPool().data(),
+                    EncryptionPluginFunctionWrapper::deriveKeyFromCode,
+                    m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
+                    authenticationCode,
+                    m_requestQueue->saltData(),
+                    keyDerivationParameters);
+    }
+
+    connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
+        watcher->deleteLater();
+        DerivedKeyResult dkr = watcher->future().result();
+        if (dkr.result.code() != Result::Succeeded) {
+            qCWarning(lcSailfishSecretsDaemon) << "Failed to derive upgraded key for collection:"
+                                               << collectionName << dkr.result.errorMessage();
+            m_pendingKeyDerivationUpgrades.remove(hashedCollectionName);
+            return;
+        }
+
+        QFutureWatcher<Result> *reencryptWatcher = new QFutureWatcher<Result>(this);
+        QFuture<Result> reencryptFuture = QtConcurrent::run(
+                    m_requestQueue->secretsThreadPool().data(),
+                    EncryptedStoragePluginFunctionWrapper::reencryptCollection,
+                    m_encryptedStoragePlugins[storagePluginName],
+                    collectionName,
+                    collectionKey,
+                    dkr.key,
+                    keyDerivationParameters);
+        connect(reencryptWatcher, &QFutureWatcher<Result>::finished, [=] {
+            reencryptWatcher->deleteLater();
+            m_pendingKeyDerivationUpgrades.remove(hashedCollectionName);
+            Result result = reencryptWatcher->future().result();
+            if (result.code() != Result::Succeeded) {
+                qCWarning(lcSailfishSecretsDaemon) << "Failed to upgrade key derivation for collection:"
+                                                   << collectionName << result.errorMessage();
+            } else if (m_collectionEncryptionKeys.contains(hashedCollectionName)) {
+                m_collectionEncryptionKeys.insert(hashedCollectionName, dkr.key);
+            }
+        });
+        reencryptWatcher->setFuture(reencryptFuture);
+    });
+    watcher->setFuture(future);
+}
+
+QVariantMap Daemon::ApiImpl::RequestProcessor::metadataStatistics() const
+{
+    // prepared statement cache statistics of the per-plugin metadata databases.
+    QVariantMap retn;
+    for (StoragePluginWrapper *plugin : m_storagePlugins.values()) {
+        retn.insert(plugin->name(), plugin->metadataStatistics());
+    }
+    for (EncryptedStoragePluginWrapper *plugin : m_encryptedStoragePlugins.values()) {
+        retn.insert(plugin->name(), plugin->metadataStatistics());
+    }
+    return retn;
+}
+
+void Daemon::ApiImpl::RequestProcessor::checkpointMetadataDatabases()
+{
+    bool pending = false;
+    for (StoragePluginWrapper *plugin : m_storagePlugins.values()) {
+        pending = pending || plugin->metadataCheckpointPending();
+    }
+    for (EncryptedStoragePluginWrapper *plugin : m_encryptedStoragePlugins.values()) {
+        pending = pending || plugin->metadataCheckpointPending();
+    }
+
+    if (pending) {
+        QtConcurrent::run(
                 m_requestQueue->secretsThreadPool().data(),
-                &Daemon::ApiImpl::masterUnlockPlugins,
+                &Daemon::ApiImpl::checkpointPlugins,
                 m_storagePlugins.values(),
-                m_encryptedStoragePlugins.values(),
-                m_requestQueue->bkdbLockKey());
-    future.waitForFinished();
-    if (!future.result()) {
-        // TODO: FIXME: how can we recover from this?
-        // This is symptomatic of a power-loss halfway through previous re-encryption,
-        // meaning that some metadata databases will have been encrypted with
-        // the OLD lock code, and some with the NEW lock code...
-        qCWarning(lcSailfishSecretsDaemon) << "Critical Error! Failed to initialize metadata plugins";
+                m_encryptedStoragePlugins.values());
+    }
+}
+
+void Daemon::ApiImpl::RequestProcessor::relockWarmCollections()
+{
+    for (EncryptedStoragePluginWrapper *plugin : m_encryptedStoragePlugins.values()) {
+        if (plugin->hasWarmCollections()) {
+            QtConcurrent::run(
+                    m_requestQueue->secretsThreadPool().data(),
+                    EncryptedStoragePluginFunctionWrapper::relockWarmCollections,
+                    plugin);
+        }
+    }
+}
+
+void Daemon::ApiImpl::RequestProcessor::initializePlugins()
+{
+    // Opening the metadata database of a plugin and synchronizing it with
+    // the plugin data can be slow, so each plugin is initialized in parallel
+    // on the initialization thread pool, rather than blocking startup.
+    // Requests which target a plugin are held back by the request queues
+    // until it has been initialized, and are handled once it is ready.
+    QList<PluginWrapper*> plugins;
+    for (StoragePluginWrapper *plugin : m_storagePlugins.values()) {
+        plugins.append(plugin);
+    }
+    for (EncryptedStoragePluginWrapper *plugin : m_encryptedStoragePlugins.values()) {
+        plugins.append(plugin);
+    }
+
+    struct InitializationState {
+        QAtomicInt remaining;
+        QElapsedTimer timer;
+    };
+    QSharedPointer<InitializationState> state = QSharedPointer<InitializationState>::create();
+    state->remaining = plugins.size();
+    state->timer.start();
+
+    Sailfish::Secrets::Daemon::Controller *controller = m_requestQueue->controller();
+    const QByteArray masterLockKey = m_requestQueue->bkdbLockKey();
+    for (PluginWrapper *plugin : plugins) {
+        Daemon::ApiImpl::PluginManager::instance()->setPluginInitializing(plugin->name());
+        QtConcurrent::run(&m_initializationThreadPool, [plugin, masterLockKey, state, controller] {
+            QElapsedTimer timer;
+            timer.start();
+            if (plugin->isMasterLocked() && !plugin->masterUnlock(masterLockKey)) {
+                // This is symptomatic of a power-loss halfway through previous re-encryption,
+                // meaning that some metadata databases will have been encrypted with
+                // the OLD lock code, and some with the NEW lock code...
+                // The plugin is reported as unavailable, and its metadata remains
+                // locked so that requests which target it fail, until it can be
+                // master-unlocked (e.g. once the user provides the master lock code).
+                qCWarning(lcSailfishSecretsDaemon) << "Critical Error! Failed to initialize metadata for plugin:"
+                                                   << plugin->name();
+                Daemon::ApiImpl::PluginManager::instance()->setPluginAvailable(plugin->name(), false);
+            }
+            Daemon::ApiImpl::Statistics::instance()->recordPluginStartup(
+                    plugin->name(), timer.nsecsElapsed() / 1000);
+            Daemon::ApiImpl::PluginManager::instance()->setPluginInitialized(plugin->name());
+            QMetaObject::invokeMethod(controller, "handlePluginInitialized", Qt::QueuedConnection);
+            if (!state->remaining.deref()) {
+                Daemon::ApiImpl::Statistics::instance()->recordStartupPhase(
+                        QStringLiteral("pluginInitialization"), state->timer.nsecsElapsed() / 1000);
+            }
+        });
     }
-    return future.result();
 }
 
 // retrieve information about available plugins
@@ -511,23 +780,29 @@ Daemon::ApiImpl::RequestProcessor::createCustomLockCollectionWithAuthenticationC
         const QString &interactionServiceAddress,
         const QByteArray &authenticationCode)
 {
+    // new collections use the parameters calibrated for this device, if available.
+    const QByteArray keyDerivationParameters = m_keyDerivationParameters.value(encryptionPluginName);
     QFutureWatcher<DerivedKeyResult> *watcher
             = new QFutureWatcher<DerivedKeyResult>(this);
     QFuture<DerivedKeyResult> future;
     if (storagePluginName == encryptionPluginName) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -549,6 +824,7 @@ Daemon::ApiImpl::RequestProcessor::createCustomLockCollectionWithAuthenticationC
                         accessControlMode,
                         userInteractionMode,
                         interactionServiceAddress,
+                        keyDerivationParameters,
                         dkr.key);
         }
     });
@@ -569,6 +845,7 @@ Daemon::ApiImpl::RequestProcessor::createCustomLockCollectionWithEncryptionKey(
         SecretManager::AccessControlMode accessControlMode,
         SecretManager::UserInteractionMode userInteractionMode,
         const QString &interactionServiceAddress,
+        const QByteArray &keyDerivationParameters,
         const QByteArray &encryptionKey)
 {
     Q_UNUSED(userInteractionMode);
@@ -588,6 +865,7 @@ Daemon::ApiImpl::RequestProcessor::createCustomLockCollectionWithEncryptionKey(
     metadata.authenticationPluginName = authenticationPluginName;
     metadata.unlockSemantic = static_cast<int>(unlockSemantic);
     metadata.accessControlMode = accessControlMode;
+    metadata.keyDerivationParameters = keyDerivationParameters;
 
     QFutureWatcher<Result> *watcher = new QFutureWatcher<Result>(this);
     QFuture<Result> future;
@@ -656,6 +934,9 @@ Daemon::ApiImpl::RequestProcessor::deleteCollection(
                       QLatin1String("Empty collection name given"));
     }
 
+    // keys read from the collection must not outlive it.
+    m_requestQueue->storedKeyCache()->removeCollection(collectionName, storagePluginName);
+
     // Read the metadata about the target collection
     QFutureWatcher<CollectionMetadataResult> *watcher
             = new QFutureWatcher<CollectionMetadataResult>(this);
@@ -1225,18 +1506,22 @@ Daemon::ApiImpl::RequestProcessor::storedKeyIdentifiersWithAuthenticationCode(
     if (storagePluginName == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[storagePluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -1253,6 +1538,9 @@ Daemon::ApiImpl::RequestProcessor::storedKeyIdentifiersWithAuthenticationCode(
                         collectionName, storagePluginName, customParameters,
                         userInteractionMode, interactionServiceAddress,
                         collectionMetadata, dkr.key, true);
+            upgradeCollectionKeyDerivation(
+                        storagePluginName, collectionMetadata,
+                        authenticationCode, dkr.key);
         }
     });
     watcher->setFuture(future);
@@ -1399,6 +1687,9 @@ Daemon::ApiImpl::RequestProcessor::setCollectionSecret(
                       QLatin1String("Unknown storage plugin name given"));
     }
 
+    // a key read previously may be overwritten.
+    m_requestQueue->storedKeyCache()->removeKey(secret.identifier());
+
     // Read the metadata about the target collection
     QFutureWatcher<CollectionMetadataResult> *watcher
             = new QFutureWatcher<CollectionMetadataResult>(this);
@@ -1792,18 +2083,22 @@ Daemon::ApiImpl::RequestProcessor::setCollectionSecretWithAuthenticationCode(
     if (secret.identifier().storagePluginName() == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[secret.identifier().storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -1818,6 +2113,9 @@ Daemon::ApiImpl::RequestProcessor::setCollectionSecretWithAuthenticationCode(
                         callerPid, requestId, secret,
                         userInteractionMode, interactionServiceAddress,
                         collectionMetadata, dkr.key);
+            upgradeCollectionKeyDerivation(
+                        secret.identifier().storagePluginName(), collectionMetadata,
+                        authenticationCode, dkr.key);
         }
     });
     watcher->setFuture(future);
@@ -1852,17 +2150,18 @@ Daemon::ApiImpl::RequestProcessor::setCollectionSecretWithEncryptionKey(
     secretMetadata.accessControlMode = collectionMetadata.accessControlMode;
     secretMetadata.secretType = secret.type();
 
+    // the write is queued so that it can be group-committed with other
+    // writes to the collection which are dispatched before it is run.
     QFutureWatcher<Result> *watcher = new QFutureWatcher<Result>(this);
     QFuture<Result> future;
     if (secret.identifier().storagePluginName() == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
+        EncryptedStoragePluginWrapper *plugin = m_encryptedStoragePlugins[secret.identifier().storagePluginName()];
         future = QtConcurrent::run(
                 m_requestQueue->secretsThreadPool().data(),
-                EncryptedStoragePluginFunctionWrapper::unlockCollectionAndStoreSecret,
-                m_encryptedStoragePlugins[secret.identifier().storagePluginName()],
-                secretMetadata,
-                secret,
-                encryptionKey);
+                EncryptedStoragePluginFunctionWrapper::unlockCollectionAndStoreQueuedSecrets,
+                plugin,
+                plugin->secretWriteQueue()->enqueue(secretMetadata, secret, encryptionKey));
     } else {
         bool requiresRelock =
                 ((!secretMetadata.usesDeviceLockKey
@@ -1876,14 +2175,13 @@ Daemon::ApiImpl::RequestProcessor::setCollectionSecretWithEncryptionKey(
             m_collectionEncryptionKeys.insert(hashedCollectionName, encryptionKey);
         }
 
+        StoragePluginWrapper *plugin = m_storagePlugins[secret.identifier().storagePluginName()];
         future = QtConcurrent::run(
                 m_requestQueue->secretsThreadPool().data(),
-                StoragePluginFunctionWrapper::encryptAndStoreSecret,
+                StoragePluginFunctionWrapper::encryptAndStoreQueuedSecrets,
                 m_encryptionPlugins[secretMetadata.encryptionPluginName],
-                m_storagePlugins[secret.identifier().storagePluginName()],
-                secretMetadata,
-                secret,
-                encryptionKey);
+                plugin,
+                plugin->secretWriteQueue()->enqueue(secretMetadata, secret, encryptionKey));
     }
 
     connect(watcher, &QFutureWatcher<Result>::finished, [=] {
@@ -2390,18 +2688,22 @@ Daemon::ApiImpl::RequestProcessor::setStandaloneCustomLockSecretWithAuthenticati
     if (secret.identifier().storagePluginName() == secretMetadata.encryptionPluginName
             || secretMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[secret.identifier().storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    QByteArray());
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[secretMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    QByteArray());
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -2833,18 +3135,22 @@ Daemon::ApiImpl::RequestProcessor::getCollectionSecretWithAuthenticationCode(
     if (identifier.storagePluginName() == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[identifier.storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -2859,6 +3165,9 @@ Daemon::ApiImpl::RequestProcessor::getCollectionSecretWithAuthenticationCode(
                         callerPid, requestId, identifier,
                         userInteractionMode, interactionServiceAddress,
                         collectionMetadata, dkr.key);
+            upgradeCollectionKeyDerivation(
+                        identifier.storagePluginName(), collectionMetadata,
+                        authenticationCode, dkr.key);
         }
     });
     watcher->setFuture(future);
@@ -2882,6 +3191,11 @@ Daemon::ApiImpl::RequestProcessor::getCollectionSecretWithEncryptionKey(
     Q_UNUSED(userInteractionMode);
     Q_UNUSED(interactionServiceAddress);
 
+    bool requiresRelock =
+            ((!collectionMetadata.usesDeviceLockKey
+              && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked)
+            || (collectionMetadata.usesDeviceLockKey
+              && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked));
     QFutureWatcher<SecretResult> *watcher
             = new QFutureWatcher<SecretResult>(this);
     QFuture<SecretResult> future;
@@ -2895,11 +3209,6 @@ Daemon::ApiImpl::RequestProcessor::getCollectionSecretWithEncryptionKey(
                 identifier,
                 encryptionKey);
     } else {
-        bool requiresRelock =
-                ((!collectionMetadata.usesDeviceLockKey
-                  && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked)
-                || (collectionMetadata.usesDeviceLockKey
-                  && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked));
         const QString hashedCollectionName = calculateSecretNameHash(
                     Secret::Identifier(QString(), identifier.collectionName(), identifier.storagePluginName()));
         if (!m_collectionEncryptionKeys.contains(hashedCollectionName) && !requiresRelock) {
@@ -2922,6 +3231,8 @@ Daemon::ApiImpl::RequestProcessor::getCollectionSecretWithEncryptionKey(
         QVariantList outParams;
         outParams << QVariant::fromValue<Result>(sr.result);
         outParams << QVariant::fromValue<Secret>(sr.secret);
+        // whether the secret may be cached for the crypto API, as the collection remains unlocked.
+        outParams << QVariant::fromValue<bool>(!requiresRelock);
         m_requestQueue->requestFinished(requestId, outParams);
     });
     watcher->setFuture(future);
@@ -3154,18 +3465,22 @@ Daemon::ApiImpl::RequestProcessor::getStandaloneSecretWithAuthenticationCode(
     if (identifier.storagePluginName() == secretMetadata.encryptionPluginName
             || secretMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[identifier.storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    QByteArray());
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[secretMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    QByteArray());
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -3640,18 +3955,22 @@ Daemon::ApiImpl::RequestProcessor::findCollectionSecretsWithAuthenticationCode(
     if (storagePluginName == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[storagePluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -3668,6 +3987,9 @@ Daemon::ApiImpl::RequestProcessor::findCollectionSecretsWithAuthenticationCode(
                         filter, filterOperator,
                         userInteractionMode, interactionServiceAddress,
                         collectionMetadata, dkr.key);
+            upgradeCollectionKeyDerivation(
+                        storagePluginName, collectionMetadata,
+                        authenticationCode, dkr.key);
         }
     });
     watcher->setFuture(future);
@@ -3791,6 +4113,8 @@ Daemon::ApiImpl::RequestProcessor::deleteCollectionSecret(
                       QLatin1String("Unknown storage plugin name given"));
     }
 
+    m_requestQueue->storedKeyCache()->removeKey(identifier);
+
     // Read the metadata about the target collection
     QFutureWatcher<CollectionMetadataResult> *watcher
             = new QFutureWatcher<CollectionMetadataResult>(this);
@@ -4102,18 +4426,22 @@ Daemon::ApiImpl::RequestProcessor::deleteCollectionSecretWithAuthenticationCode(
     if (identifier.storagePluginName() == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[identifier.storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -4128,6 +4456,9 @@ Daemon::ApiImpl::RequestProcessor::deleteCollectionSecretWithAuthenticationCode(
                             callerPid, requestId, identifier,
                             userInteractionMode, interactionServiceAddress,
                             collectionMetadata, dkr.key);
+            upgradeCollectionKeyDerivation(
+                        identifier.storagePluginName(), collectionMetadata,
+                        authenticationCode, dkr.key);
         }
     });
     watcher->setFuture(future);
@@ -4404,6 +4735,9 @@ Daemon::ApiImpl::RequestProcessor::modifyLockCode(
         }
     }
 
+    // keys read from collections must not outlive a lock code change.
+    m_requestQueue->storedKeyCache()->clear();
+
     // Perform the first request "get old passphrase".
     // After it completes, perform the second request "get new passphrase"
     // Once both are complete, perform re-key operation.
@@ -4919,6 +5253,9 @@ Daemon::ApiImpl::RequestProcessor::forgetLockCode(
                 : m_appPermissions->applicationId(callerPid);
     Q_UNUSED(callerApplicationId); // TODO: access control?
 
+    // keys read from collections must not outlive a lock.
+    m_requestQueue->storedKeyCache()->clear();
+
     if (lockCodeTargetType == LockCodeRequest::ExtensionPlugin) {
         // check that the application is system settings.
         // if not, some malicious app is trying to lock the
@@ -4928,6 +5265,9 @@ Daemon::ApiImpl::RequestProcessor::forgetLockCode(
                           QLatin1String("Only the system settings application can unlock the plugin"));
         }
 
+        // keys derived from collection lock codes must not outlive the plugin lock.
+        m_requestQueue->derivedKeyCache()->clear();
+
         QFuture<FoundResult> future = QtConcurrent::run(
                     m_requestQueue->secretsThreadPool().data(),
                     &Daemon::ApiImpl::lockSpecificPlugin,
@@ -4989,51 +5329,110 @@ Daemon::ApiImpl::RequestProcessor::forgetLockCode(
     }
 }
 
+// export the secrets of a collection into an archive
 Result
-Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheck(
+Daemon::ApiImpl::RequestProcessor::exportCollection(
         pid_t callerPid,
         quint64 requestId,
-        const Secret::Identifier &identifier,
-        Sailfish::Crypto::CryptoManager::Operation operation,
-        const QString &cryptoPluginName,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const QDBusUnixFileDescriptor &fileDescriptor,
+        const QByteArray &passphrase,
         SecretManager::UserInteractionMode userInteractionMode,
-        QByteArray *collectionDecryptionKey)
+        const QString &interactionServiceAddress)
 {
-    Q_UNUSED(collectionDecryptionKey); // asynchronous out-params.
-    if (identifier.name().isEmpty()) {
-        return Result(Result::InvalidSecretError,
-                      QLatin1String("Empty secret name given"));
-    } else if (identifier.collectionName().isEmpty()) {
+    return transferCollection(callerPid, requestId,
+                              Daemon::ApiImpl::ExportCollectionRequest,
+                              collectionName, storagePluginName,
+                              fileDescriptor, passphrase,
+                              userInteractionMode, interactionServiceAddress);
+}
+
+// import the secrets of an archive into a collection
+Result
+Daemon::ApiImpl::RequestProcessor::importCollection(
+        pid_t callerPid,
+        quint64 requestId,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const QDBusUnixFileDescriptor &fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress)
+{
+    // an imported archive may overwrite keys in the collection.
+    m_requestQueue->storedKeyCache()->removeCollection(collectionName, storagePluginName);
+    return transferCollection(callerPid, requestId,
+                              Daemon::ApiImpl::ImportCollectionRequest,
+                              collectionName, storagePluginName,
+                              fileDescriptor, passphrase,
+                              userInteractionMode, interactionServiceAddress);
+}
+
+// Archives are always encrypted by the default encryption plugin,
+// so that they may be imported into a collection of any plugin.
+EncryptionPlugin *
+Daemon::ApiImpl::RequestProcessor::archiveEncryptionPlugin() const
+{
+    return m_encryptionPlugins.value(m_requestQueue->controller()->mappedPluginName(
+            m_autotestMode ? (SecretManager::DefaultEncryptionPluginName + QLatin1String(".test"))
+                           : SecretManager::DefaultEncryptionPluginName));
+}
+
+Result
+Daemon::ApiImpl::RequestProcessor::transferCollection(
+        pid_t callerPid,
+        quint64 requestId,
+        Daemon::ApiImpl::RequestType requestType,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const QDBusUnixFileDescriptor &fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress)
+{
+    if (storagePluginName.isEmpty()) {
+        return Result(Result::InvalidExtensionPluginError,
+                      QStringLiteral("Empty storage plugin name given"));
+    } else if (!m_encryptedStoragePlugins.contains(storagePluginName)
+               && !m_storagePlugins.contains(storagePluginName)) {
+        return Result(Result::InvalidExtensionPluginError,
+                      QStringLiteral("Unknown storage plugin name given"));
+    } else if (collectionName.isEmpty()) {
         return Result(Result::InvalidCollectionError,
                       QLatin1String("Empty collection name given"));
-    } else if (identifier.collectionName().compare(QStringLiteral("standalone"), Qt::CaseInsensitive) == 0) {
+    } else if (collectionName.compare(QStringLiteral("standalone"), Qt::CaseInsensitive) == 0) {
         return Result(Result::InvalidCollectionError,
                       QLatin1String("Reserved collection name given"));
-    } else if (identifier.storagePluginName().isEmpty()) {
-        return Result(Result::InvalidExtensionPluginError,
-                      QLatin1String("Empty storage plugin name given"));
-    } else if (!m_storagePlugins.contains(identifier.storagePluginName())
-               && !m_encryptedStoragePlugins.contains(identifier.storagePluginName())) {
+    } else if (!fileDescriptor.isValid()) {
+        return Result(Result::OperationNotSupportedError,
+                      QLatin1String("Invalid collection archive file descriptor given"));
+    } else if (passphrase.isEmpty()) {
+        return Result(Result::IncorrectAuthenticationCodeError,
+                      QLatin1String("Empty collection archive passphrase given"));
+    } else if (!archiveEncryptionPlugin()) {
         return Result(Result::InvalidExtensionPluginError,
-                      QLatin1String("Unknown storage plugin name given"));
+                      QLatin1String("No encryption plugin is available to encrypt the collection archive"));
     }
 
+    const CollectionArchiveInfo archive(fileDescriptor, passphrase, archiveEncryptionPlugin());
+
     // Read the metadata about the target collection
     QFutureWatcher<CollectionMetadataResult> *watcher
             = new QFutureWatcher<CollectionMetadataResult>(this);
     QFuture<CollectionMetadataResult> future;
-    if (m_encryptedStoragePlugins.contains(identifier.storagePluginName())) {
+    if (m_encryptedStoragePlugins.contains(storagePluginName)) {
         future = QtConcurrent::run(
                     m_requestQueue->secretsThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::collectionMetadata,
-                    m_encryptedStoragePlugins[identifier.storagePluginName()],
-                    identifier.collectionName());
+                    m_encryptedStoragePlugins[storagePluginName],
+                    collectionName);
     } else {
         future = QtConcurrent::run(
                     m_requestQueue->secretsThreadPool().data(),
                     StoragePluginFunctionWrapper::collectionMetadata,
-                    m_storagePlugins[identifier.storagePluginName()],
-                    identifier.collectionName());
+                    m_storagePlugins[storagePluginName],
+                    collectionName);
     }
 
     connect(watcher, &QFutureWatcher<CollectionMetadataResult>::finished, [=] {
@@ -5041,18 +5440,19 @@ Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheck(
         CollectionMetadataResult cmr = watcher->future().result();
         Result result = cmr.result.code() != Result::Succeeded
                 ? cmr.result
-                : useCollectionKeyPreCheckWithMetadata(
+                : transferCollectionWithMetadata(
                       callerPid,
                       requestId,
-                      identifier,
-                      operation,
-                      cryptoPluginName,
+                      requestType,
+                      collectionName,
+                      storagePluginName,
+                      archive,
                       userInteractionMode,
+                      interactionServiceAddress,
                       cmr.metadata);
         if (result.code() != Result::Pending) {
             QVariantList outParams;
             outParams << QVariant::fromValue<Result>(result);
-            outParams << QVariant::fromValue<QByteArray>(QByteArray());
             m_requestQueue->requestFinished(requestId, outParams);
         }
     });
@@ -5062,15 +5462,18 @@ Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheck(
 }
 
 Result
-Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheckWithMetadata(
+Daemon::ApiImpl::RequestProcessor::transferCollectionWithMetadata(
         pid_t callerPid,
         quint64 requestId,
-        const Secret::Identifier &identifier,
-        Sailfish::Crypto::CryptoManager::Operation operation,
-        const QString &cryptoPluginName,
+        Daemon::ApiImpl::RequestType requestType,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const CollectionArchiveInfo &archive,
         SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
         const CollectionMetadata &collectionMetadata)
 {
+    // TODO: perform access control request to see if the application has permission to access secure storage data.
     const bool applicationIsPlatformApplication = m_appPermissions->applicationIsPlatformApplication(callerPid);
     const QString callerApplicationId = applicationIsPlatformApplication
                 ? m_appPermissions->platformApplicationId()
@@ -5082,20 +5485,413 @@ Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheckWithMetadata(
                 callerApplicationId,
                 applicationIsPlatformApplication,
                 collectionMetadata.authenticationPluginName,
-                QString(),
+                interactionServiceAddress,
                 m_autotestMode);
 
     if (collectionMetadata.accessControlMode == SecretManager::SystemAccessControlMode) {
-        // TODO: perform access control request, to ask for permission to set the secret in the collection.
+        // TODO: perform access control request, to ask for permission to access the collection.
         return Result(Result::OperationNotSupportedError,
                       QLatin1String("Access control requests are not currently supported. TODO!"));
     } else if (collectionMetadata.accessControlMode == SecretManager::OwnerOnlyMode
                && collectionMetadata.ownerApplicationId != callerApplicationId) {
         return Result(Result::PermissionsError,
-                      QString::fromLatin1("Collection %1 in plugin %2 is owned by a different application")
-                      .arg(identifier.collectionName(), identifier.storagePluginName()));
-    }
-
+                      QString::fromLatin1("Collection %1 is owned by a different application")
+                      .arg(collectionName));
+    } else if (!collectionMetadata.encryptionPluginName.isEmpty()
+               && storagePluginName != collectionMetadata.encryptionPluginName
+               && !m_encryptionPlugins.contains(collectionMetadata.encryptionPluginName)) {
+        // TODO: stale data in the database?
+        return Result(Result::InvalidExtensionPluginError,
+                      QStringLiteral("Unknown collection encryption plugin: %1")
+                      .arg(collectionMetadata.encryptionPluginName));
+    }
+
+    const Sailfish::Secrets::InteractionParameters::PromptText promptText = requestType == Daemon::ApiImpl::ExportCollectionRequest
+        ? Sailfish::Secrets::InteractionParameters::PromptText({
+            //: This will be displayed to the user, prompting them to enter the lock code to unlock the collection in order to export its secrets. %1 is the application name, %2 is the collection name, %3 is the plugin name.
+            //% "%1 wants to export the secrets in collection %2 from plugin %3."
+            { InteractionParameters::Message, qtTrId("sailfish_secrets-export_collection-la-app_export")
+                             .arg(callerApplicationId,
+                                  collectionName,
+                                  m_requestQueue->controller()->displayNameForPlugin(storagePluginName)) },
+            { InteractionParameters::Instruction, qtTrId("sailfish_secrets-la-enter_collection_lock_code") }
+          })
+        : Sailfish::Secrets::InteractionParameters::PromptText({
+            //: This will be displayed to the user, prompting them to enter the lock code to unlock the collection in order to import secrets into it. %1 is the application name, %2 is the collection name, %3 is the plugin name.
+            //% "%1 wants to import secrets into collection %2 from plugin %3."
+            { InteractionParameters::Message, qtTrId("sailfish_secrets-import_collection-la-app_import")
+                             .arg(callerApplicationId,
+                                  collectionName,
+                                  m_requestQueue->controller()->displayNameForPlugin(storagePluginName)) },
+            { InteractionParameters::Instruction, qtTrId("sailfish_secrets-la-enter_collection_lock_code") }
+          });
+
+    bool locked = false;
+    QByteArray collectionKey;
+    if (storagePluginName == collectionMetadata.encryptionPluginName
+            || collectionMetadata.encryptionPluginName.isEmpty()) {
+        // TODO: make this asynchronous instead of blocking the main thread!
+        QFuture<LockedResult> future
+                = QtConcurrent::run(
+                        m_requestQueue->secretsThreadPool().data(),
+                        EncryptedStoragePluginFunctionWrapper::isCollectionLocked,
+                        m_encryptedStoragePlugins[storagePluginName],
+                        collectionName);
+        future.waitForFinished();
+        LockedResult lr = future.result();
+        if (lr.result.code() != Result::Succeeded) {
+            return lr.result;
+        }
+        locked = lr.locked;
+    } else {
+        const QString hashedCollectionName = calculateSecretNameHash(
+                    Secret::Identifier(QString(), collectionName, storagePluginName));
+        locked = !m_collectionEncryptionKeys.contains(hashedCollectionName);
+        collectionKey = m_collectionEncryptionKeys.value(hashedCollectionName);
+    }
+
+    if (!locked) {
+        transferCollectionWithEncryptionKey(
+                    callerPid,
+                    requestId,
+                    requestType,
+                    collectionName,
+                    storagePluginName,
+                    archive,
+                    userInteractionMode,
+                    interactionServiceAddress,
+                    collectionMetadata,
+                    collectionKey); // empty if the encrypted storage collection is unlocked already.
+        return Result(Result::Pending);
+    }
+
+    const QVariantList pendingParameters = QVariantList()
+            << collectionName
+            << storagePluginName
+            << QVariant::fromValue<QDBusUnixFileDescriptor>(archive.fileDescriptor)
+            << archive.passphrase
+            << userInteractionMode
+            << interactionServiceAddress
+            << QVariant::fromValue<CollectionMetadata>(collectionMetadata);
+
+    if (collectionMetadata.usesDeviceLockKey) {
+        // Perform a "verify" UI flow (if the user interaction mode allows).
+        // If that succeeds, unlock the collection with the stored devicelock key and continue.
+        if (userInteractionMode == Sailfish::Secrets::SecretManager::PreventInteraction) {
+            return Result(Result::CollectionIsLockedError,
+                          QString::fromLatin1("Collection %1 is locked and requires device lock authentication")
+                          .arg(collectionName));
+        }
+
+        // always use the system authentication plugin for device lock authentication requests.
+        const QString systemAuthenticationPlugin = m_requestQueue->controller()->mappedPluginName(
+                m_autotestMode ? (SecretManager::DefaultAuthenticationPluginName + QLatin1String(".test"))
+                               : SecretManager::DefaultAuthenticationPluginName);
+        Result result = m_authenticationPlugins[systemAuthenticationPlugin]->beginAuthentication(
+                    callerPid,
+                    requestId,
+                    promptText);
+        if (result.code() == Result::Failed) {
+            return result;
+        }
+
+        // calls transferCollectionWithEncryptionKey when finished
+        m_pendingRequests.insert(requestId,
+                                 Daemon::ApiImpl::RequestProcessor::PendingRequest(
+                                     callerPid,
+                                     requestId,
+                                     requestType,
+                                     pendingParameters));
+        return result;
+    }
+
+    if (userInteractionMode == SecretManager::PreventInteraction) {
+        return Result(Result::OperationRequiresUserInteraction,
+                      QString::fromLatin1("Authentication plugin %1 requires user interaction")
+                      .arg(authPluginName));
+    } else if (!m_authenticationPlugins.contains(authPluginName)) {
+        // TODO: stale data in metadata db?
+        return Result(Result::InvalidExtensionPluginError,
+                      QString::fromLatin1("Unknown authentication plugin %1 specified in collection metadata")
+                      .arg(authPluginName));
+    } else if (m_authenticationPlugins[authPluginName]->authenticationTypes() & AuthenticationPlugin::ApplicationSpecificAuthentication
+               && (userInteractionMode != SecretManager::ApplicationInteraction || interactionServiceAddress.isEmpty())) {
+        return Result(Result::OperationRequiresApplicationUserInteraction,
+                      QString::fromLatin1("Authentication plugin %1 requires in-process user interaction")
+                      .arg(authPluginName));
+    }
+
+    // perform the user input flow required to get the input key data which will be used
+    // to unlock the collection.
+    InteractionParameters promptParams;
+    promptParams.setApplicationId(callerApplicationId);
+    promptParams.setPluginName(storagePluginName);
+    promptParams.setCollectionName(collectionName);
+    promptParams.setSecretName(QString());
+    promptParams.setOperation(InteractionParameters::UnlockCollection);
+    promptParams.setInputType(InteractionParameters::AlphaNumericInput);
+    promptParams.setEchoMode(InteractionParameters::PasswordEcho);
+    promptParams.setPromptText(promptText);
+    Result interactionResult = m_authenticationPlugins[authPluginName]->beginUserInputInteraction(
+                callerPid,
+                requestId,
+                promptParams,
+                interactionServiceAddress);
+    if (interactionResult.code() == Result::Failed) {
+        return interactionResult;
+    }
+
+    // calls transferCollectionWithAuthenticationCode when finished
+    m_pendingRequests.insert(requestId,
+                             Daemon::ApiImpl::RequestProcessor::PendingRequest(
+                                 callerPid,
+                                 requestId,
+                                 requestType,
+                                 pendingParameters));
+    return Result(Result::Pending);
+}
+
+Result
+Daemon::ApiImpl::RequestProcessor::transferCollectionWithAuthenticationCode(
+        pid_t callerPid,
+        quint64 requestId,
+        Daemon::ApiImpl::RequestType requestType,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const CollectionArchiveInfo &archive,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
+        const CollectionMetadata &collectionMetadata,
+        const QByteArray &authenticationCode)
+{
+    // generate the encryption key from the authentication code
+    QFutureWatcher<DerivedKeyResult> *watcher
+            = new QFutureWatcher<DerivedKeyResult>(this);
+    QFuture<DerivedKeyResult> future;
+    if (storagePluginName == collectionMetadata.encryptionPluginName
+            || collectionMetadata.encryptionPluginName.isEmpty()) {
+        future = QtConcurrent::run(
+                    m_requestQueue->kdfThreadPool().data(),
+                    EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
+                    m_encryptedStoragePlugins[storagePluginName],
+                    m_requestQueue->derivedKeyCache(),
+                    authenticationCode,
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
+    } else {
+        future = QtConcurrent::run(
+                    m_requestQueue->kdfThreadPool().data(),
+                    EncryptionPluginFunctionWrapper::deriveKeyFromCode,
+                    m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
+                    authenticationCode,
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
+    }
+
+    connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
+        watcher->deleteLater();
+        DerivedKeyResult dkr = watcher->future().result();
+        if (dkr.result.code() != Result::Succeeded) {
+            QVariantList outParams;
+            outParams << QVariant::fromValue<Result>(dkr.result);
+            m_requestQueue->requestFinished(requestId, outParams);
+        } else {
+            transferCollectionWithEncryptionKey(
+                        callerPid, requestId, requestType,
+                        collectionName, storagePluginName, archive,
+                        userInteractionMode, interactionServiceAddress,
+                        collectionMetadata, dkr.key);
+            upgradeCollectionKeyDerivation(
+                        storagePluginName, collectionMetadata,
+                        authenticationCode, dkr.key);
+        }
+    });
+    watcher->setFuture(future);
+
+    return Result(Result::Pending);
+}
+
+void
+Daemon::ApiImpl::RequestProcessor::transferCollectionWithEncryptionKey(
+        pid_t callerPid,
+        quint64 requestId,
+        Daemon::ApiImpl::RequestType requestType,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const CollectionArchiveInfo &archive,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const QString &interactionServiceAddress,
+        const CollectionMetadata &collectionMetadata,
+        const QByteArray &encryptionKey)
+{
+    // might be required in future for access control requests.
+    Q_UNUSED(callerPid);
+    Q_UNUSED(userInteractionMode);
+    Q_UNUSED(interactionServiceAddress);
+
+    const bool exporting = requestType == Daemon::ApiImpl::ExportCollectionRequest;
+    QFutureWatcher<Result> *watcher = new QFutureWatcher<Result>(this);
+    QFuture<Result> future;
+    if (storagePluginName == collectionMetadata.encryptionPluginName
+            || collectionMetadata.encryptionPluginName.isEmpty()) {
+        future = QtConcurrent::run(
+                    m_requestQueue->secretsThreadPool().data(),
+                    exporting ? EncryptedStoragePluginFunctionWrapper::unlockAndExportCollection
+                              : EncryptedStoragePluginFunctionWrapper::unlockAndImportCollection,
+                    m_encryptedStoragePlugins[storagePluginName],
+                    archive,
+                    collectionMetadata,
+                    encryptionKey);
+    } else {
+        bool requiresRelock =
+                ((!collectionMetadata.usesDeviceLockKey
+                  && collectionMetadata.unlockSemantic != SecretManager::CustomLockKeepUnlocked)
+                || (collectionMetadata.usesDeviceLockKey
+                  && collectionMetadata.unlockSemantic != SecretManager::DeviceLockKeepUnlocked));
+        const QString hashedCollectionName = calculateSecretNameHash(Secret::Identifier(QString(), collectionName, storagePluginName));
+        if (!m_collectionEncryptionKeys.contains(hashedCollectionName) && !requiresRelock) {
+            // TODO: some way to "test" the encryptionKey!  also, if it's a custom lock, set the timeout, etc.
+            m_collectionEncryptionKeys.insert(hashedCollectionName, encryptionKey);
+        }
+
+        if (exporting) {
+            future = QtConcurrent::run(
+                        m_requestQueue->secretsThreadPool().data(),
+                        StoragePluginFunctionWrapper::exportCollection,
+                        m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                        m_storagePlugins[storagePluginName],
+                        archive,
+                        collectionName,
+                        encryptionKey);
+        } else {
+            future = QtConcurrent::run(
+                        m_requestQueue->secretsThreadPool().data(),
+                        StoragePluginFunctionWrapper::importCollection,
+                        m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                        m_storagePlugins[storagePluginName],
+                        archive,
+                        collectionMetadata,
+                        encryptionKey);
+        }
+    }
+
+    connect(watcher, &QFutureWatcher<Result>::finished, [=] {
+        watcher->deleteLater();
+        QVariantList outParams;
+        outParams << QVariant::fromValue<Result>(watcher->future().result());
+        m_requestQueue->requestFinished(requestId, outParams);
+    });
+    watcher->setFuture(future);
+}
+
+Result
+Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheck(
+        pid_t callerPid,
+        quint64 requestId,
+        const Secret::Identifier &identifier,
+        Sailfish::Crypto::CryptoManager::Operation operation,
+        const QString &cryptoPluginName,
+        SecretManager::UserInteractionMode userInteractionMode,
+        QByteArray *collectionDecryptionKey)
+{
+    Q_UNUSED(collectionDecryptionKey); // asynchronous out-params.
+    if (identifier.name().isEmpty()) {
+        return Result(Result::InvalidSecretError,
+                      QLatin1String("Empty secret name given"));
+    } else if (identifier.collectionName().isEmpty()) {
+        return Result(Result::InvalidCollectionError,
+                      QLatin1String("Empty collection name given"));
+    } else if (identifier.collectionName().compare(QStringLiteral("standalone"), Qt::CaseInsensitive) == 0) {
+        return Result(Result::InvalidCollectionError,
+                      QLatin1String("Reserved collection name given"));
+    } else if (identifier.storagePluginName().isEmpty()) {
+        return Result(Result::InvalidExtensionPluginError,
+                      QLatin1String("Empty storage plugin name given"));
+    } else if (!m_storagePlugins.contains(identifier.storagePluginName())
+               && !m_encryptedStoragePlugins.contains(identifier.storagePluginName())) {
+        return Result(Result::InvalidExtensionPluginError,
+                      QLatin1String("Unknown storage plugin name given"));
+    }
+
+    // Read the metadata about the target collection
+    QFutureWatcher<CollectionMetadataResult> *watcher
+            = new QFutureWatcher<CollectionMetadataResult>(this);
+    QFuture<CollectionMetadataResult> future;
+    if (m_encryptedStoragePlugins.contains(identifier.storagePluginName())) {
+        future = QtConcurrent::run(
+                    m_requestQueue->secretsThreadPool().data(),
+                    EncryptedStoragePluginFunctionWrapper::collectionMetadata,
+                    m_encryptedStoragePlugins[identifier.storagePluginName()],
+                    identifier.collectionName());
+    } else {
+        future = QtConcurrent::run(
+                    m_requestQueue->secretsThreadPool().data(),
+                    StoragePluginFunctionWrapper::collectionMetadata,
+                    m_storagePlugins[identifier.storagePluginName()],
+                    identifier.collectionName());
+    }
+
+    connect(watcher, &QFutureWatcher<CollectionMetadataResult>::finished, [=] {
+        watcher->deleteLater();
+        CollectionMetadataResult cmr = watcher->future().result();
+        Result result = cmr.result.code() != Result::Succeeded
+                ? cmr.result
+                : useCollectionKeyPreCheckWithMetadata(
+                      callerPid,
+                      requestId,
+                      identifier,
+                      operation,
+                      cryptoPluginName,
+                      userInteractionMode,
+                      cmr.metadata);
+        if (result.code() != Result::Pending) {
+            QVariantList outParams;
+            outParams << QVariant::fromValue<Result>(result);
+            outParams << QVariant::fromValue<QByteArray>(QByteArray());
+            m_requestQueue->requestFinished(requestId, outParams);
+        }
+    });
+    watcher->setFuture(future);
+
+    return Result(Result::Pending);
+}
+
+Result
+Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheckWithMetadata(
+        pid_t callerPid,
+        quint64 requestId,
+        const Secret::Identifier &identifier,
+        Sailfish::Crypto::CryptoManager::Operation operation,
+        const QString &cryptoPluginName,
+        SecretManager::UserInteractionMode userInteractionMode,
+        const CollectionMetadata &collectionMetadata)
+{
+    const bool applicationIsPlatformApplication = m_appPermissions->applicationIsPlatformApplication(callerPid);
+    const QString callerApplicationId = applicationIsPlatformApplication
+                ? m_appPermissions->platformApplicationId()
+                : m_appPermissions->applicationId(callerPid);
+
+    const QString authPluginName = determineAuthPlugin(
+                m_requestQueue->controller(),
+                collectionMetadata.ownerApplicationId,
+                callerApplicationId,
+                applicationIsPlatformApplication,
+                collectionMetadata.authenticationPluginName,
+                QString(),
+                m_autotestMode);
+
+    if (collectionMetadata.accessControlMode == SecretManager::SystemAccessControlMode) {
+        // TODO: perform access control request, to ask for permission to set the secret in the collection.
+        return Result(Result::OperationNotSupportedError,
+                      QLatin1String("Access control requests are not currently supported. TODO!"));
+    } else if (collectionMetadata.accessControlMode == SecretManager::OwnerOnlyMode
+               && collectionMetadata.ownerApplicationId != callerApplicationId) {
+        return Result(Result::PermissionsError,
+                      QString::fromLatin1("Collection %1 in plugin %2 is owned by a different application")
+                      .arg(identifier.collectionName(), identifier.storagePluginName()));
+    }
+
     //: This will be displayed to the user, prompting them to enter the passphrase to unlock the collection prior to using the key to sign data. %1 is the application name, %2 is the crypto plugin name, %3 is the key name, %4 is the collection name, %5 is the storage plugin name.
     //% "%1 wants to use plugin %2 to sign data using the key named %3 from collection %4 in plugin %5."
     const QString signMessage = qtTrId("sailfish_secrets-use_collection_key_precheck-la-sign_message")
@@ -5369,18 +6165,22 @@ Daemon::ApiImpl::RequestProcessor::useCollectionKeyPreCheckWithAuthenticationCod
     if (identifier.storagePluginName() == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[identifier.storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -5778,18 +6578,22 @@ Daemon::ApiImpl::RequestProcessor::setCollectionKeyPreCheckWithAuthenticationCod
     if (identifier.storagePluginName() == collectionMetadata.encryptionPluginName
             || collectionMetadata.encryptionPluginName.isEmpty()) {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptedStoragePluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptedStoragePlugins[identifier.storagePluginName()],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     } else {
         future = QtConcurrent::run(
-                    m_requestQueue->secretsThreadPool().data(),
+                    m_requestQueue->kdfThreadPool().data(),
                     EncryptionPluginFunctionWrapper::deriveKeyFromCode,
                     m_encryptionPlugins[collectionMetadata.encryptionPluginName],
+                    m_requestQueue->derivedKeyCache(),
                     authenticationCode,
-                    m_requestQueue->saltData());
+                    m_requestQueue->saltData(),
+                    collectionMetadata.keyDerivationParameters);
     }
 
     connect(watcher, &QFutureWatcher<DerivedKeyResult>::finished, [=] {
@@ -5876,6 +6680,12 @@ Daemon::ApiImpl::RequestProcessor::userInputInteractionCompleted(
     Q_UNUSED(interactionParameters)
     Q_UNUSED(interactionServiceAddress);
 
+    // record the time spent waiting for the user, for the daemon statistics.
+    if (m_pendingRequests.contains(requestId)) {
+        m_requestQueue->addInteractionTime(
+                requestId, m_pendingRequests.value(requestId).interactionTimer.nsecsElapsed() / 1000);
+    }
+
     bool returnUserInput = false;
     Secret secret;
     Result returnResult = result;
@@ -6048,6 +6858,34 @@ Daemon::ApiImpl::RequestProcessor::userInputInteractionCompleted(
                     }
                     break;
                 }
+                case ExportCollectionRequest:
+                case ImportCollectionRequest: {
+                    if (pr.parameters.size() != 7) {
+                        returnResult = Result(Result::UnknownError,
+                                              QLatin1String("Internal error: incorrect parameter count!"));
+                    } else {
+                        QString collectionName = pr.parameters.takeFirst().value<QString>();
+                        QString storagePluginName = pr.parameters.takeFirst().value<QString>();
+                        QDBusUnixFileDescriptor fileDescriptor = pr.parameters.takeFirst().value<QDBusUnixFileDescriptor>();
+                        QByteArray passphrase = pr.parameters.takeFirst().value<QByteArray>();
+                        SecretManager::UserInteractionMode userInteractionMode = static_cast<SecretManager::UserInteractionMode>(pr.parameters.takeFirst().value<int>());
+                        QString interactionServiceAddress = pr.parameters.takeFirst().value<QString>();
+                        CollectionMetadata collectionMetadata = pr.parameters.takeFirst().value<CollectionMetadata>();
+
+                        returnResult = transferCollectionWithAuthenticationCode(
+                                    pr.callerPid,
+                                    pr.requestId,
+                                    pr.requestType,
+                                    collectionName,
+                                    storagePluginName,
+                                    CollectionArchiveInfo(fileDescriptor, passphrase, archiveEncryptionPlugin()),
+                                    userInteractionMode,
+                                    interactionServiceAddress,
+                                    collectionMetadata,
+                                    userInput);
+                    }
+                    break;
+                }
                 case FindCollectionSecretsRequest: {
                     if (pr.parameters.size() != 7) {
                         returnResult = Result(Result::UnknownError,
@@ -6286,6 +7124,12 @@ void Daemon::ApiImpl::RequestProcessor::authenticationCompleted(
         qint64 requestId,
         const Result &result)
 {
+    // record the time spent waiting for the user, for the daemon statistics.
+    if (m_pendingRequests.contains(requestId)) {
+        m_requestQueue->addInteractionTime(
+                requestId, m_pendingRequests.value(requestId).interactionTimer.nsecsElapsed() / 1000);
+    }
+
     // the user has successfully authenticated themself.
     // we should unlock the device-locked collection and continue the operation.
     Result returnResult = result;
@@ -6410,6 +7254,35 @@ void Daemon::ApiImpl::RequestProcessor::authenticationCompleted(
                     }
                     break;
                 }
+                case ExportCollectionRequest:
+                case ImportCollectionRequest: {
+                    if (pr.parameters.size() != 7) {
+                        returnResult = Result(Result::UnknownError,
+                                              QLatin1String("Internal error: incorrect parameter count!"));
+                    } else {
+                        QString collectionName = pr.parameters.takeFirst().value<QString>();
+                        QString storagePluginName = pr.parameters.takeFirst().value<QString>();
+                        QDBusUnixFileDescriptor fileDescriptor = pr.parameters.takeFirst().value<QDBusUnixFileDescriptor>();
+                        QByteArray passphrase = pr.parameters.takeFirst().value<QByteArray>();
+                        SecretManager::UserInteractionMode userInteractionMode = static_cast<SecretManager::UserInteractionMode>(pr.parameters.takeFirst().value<int>());
+                        QString interactionServiceAddress = pr.parameters.takeFirst().value<QString>();
+                        CollectionMetadata collectionMetadata = pr.parameters.takeFirst().value<CollectionMetadata>();
+
+                        transferCollectionWithEncryptionKey(
+                                    pr.callerPid,
+                                    pr.requestId,
+                                    pr.requestType,
+                                    collectionName,
+                                    storagePluginName,
+                                    CollectionArchiveInfo(fileDescriptor, passphrase, archiveEncryptionPlugin()),
+                                    userInteractionMode,
+                                    interactionServiceAddress,
+                                    collectionMetadata,
+                                    m_requestQueue->deviceLockKey());
+                        returnResult = Result(Result::Pending);
+                    }
+                    break;
+                }
                 case FindCollectionSecretsRequest: {
                     if (pr.parameters.size() != 7) {
                         returnResult = Result(Result::UnknownError,
@@ -6542,6 +7415,8 @@ void Daemon::ApiImpl::RequestProcessor::cancelRequest(pid_t callerPid,
         case GetCollectionSecretRequest:
         case GetStandaloneSecretRequest:
         case FindCollectionSecretsRequest:
+        case ExportCollectionRequest:
+        case ImportCollectionRequest:
         case DeleteCollectionSecretRequest:
         case UseCollectionKeyPreCheckRequest:
         case SetCollectionKeyPreCheckRequest: {
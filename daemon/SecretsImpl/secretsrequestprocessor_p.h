@@ -18,8 +18,12 @@
 #include <QtCore/QSet>
 #include <QtCore/QPair>
 #include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QMultiMap>
 #include <QtCore/QTimer>
+#include <QtCore/QThreadPool>
+
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 #include <sys/types.h>
 
@@ -59,6 +63,7 @@ namespace Daemon {
 namespace ApiImpl {
 
 class Controller;
+struct CollectionArchiveInfo;
 
 // The RequestProcessor implements the Secrets Daemon API.
 // It processes requests from clients which are forwarded
@@ -73,8 +78,10 @@ public:
     RequestProcessor(Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions *appPermissions,
                      bool autotestMode,
                      Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue *parent = Q_NULLPTR);
+    ~RequestProcessor();
 
-    bool initializePlugins();
+    void initializePlugins();
+    QVariantMap metadataStatistics() const;
 
     // retrieve information about available plugins
     Sailfish::Secrets::Result getPluginInfo(
@@ -278,6 +285,28 @@ public:
             Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
             QByteArray *collectionDecryptionKey);
 
+    // export the secrets of a collection into an archive
+    Sailfish::Secrets::Result exportCollection(
+            pid_t callerPid,
+            quint64 requestId,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const QDBusUnixFileDescriptor &fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress);
+
+    // import the secrets of an archive into a collection
+    Sailfish::Secrets::Result importCollection(
+            pid_t callerPid,
+            quint64 requestId,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const QDBusUnixFileDescriptor &fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress);
+
 public: // helper methods for crypto API bridge (secretscryptohelpers)
     QMap<QString, QObject*> potentialCryptoStoragePlugins() const;
     Sailfish::Crypto::Daemon::ApiImpl::CryptoStoragePluginWrapper *cryptoStoragePluginWrapper(const QString &pluginName) const;
@@ -301,6 +330,8 @@ public: // helper methods for crypto API bridge (secretscryptohelpers)
     void cancelRequest(pid_t callerPid, quint64 requestId);
 
 private Q_SLOTS:
+    void relockWarmCollections();
+    void checkpointMetadataDatabases();
     void authenticationCompleted(
             uint callerPid,
             qint64 requestId,
@@ -314,6 +345,13 @@ private Q_SLOTS:
             const QByteArray &authenticationCode);
 
 private:
+    void calibrateKeyDerivation();
+    void upgradeCollectionKeyDerivation(
+            const QString &storagePluginName,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &authenticationCode,
+            const QByteArray &collectionKey);
+
     Sailfish::Secrets::Result deleteCollectionWithMetadata(
             pid_t callerPid,
             quint64 requestId,
@@ -367,6 +405,7 @@ private:
             Sailfish::Secrets::SecretManager::AccessControlMode accessControlMode,
             Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
             const QString &interactionServiceAddress,
+            const QByteArray &keyDerivationParameters,
             const QByteArray &encryptionKey);
 
     Sailfish::Secrets::Result setCollectionSecretWithMetadata(
@@ -681,18 +720,68 @@ private:
             const QByteArray &collectionKey,
             bool collectionWasLocked);
 
+    Sailfish::Secrets::Result transferCollection(
+            pid_t callerPid,
+            quint64 requestId,
+            Sailfish::Secrets::Daemon::ApiImpl::RequestType requestType,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const QDBusUnixFileDescriptor &fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress);
+
+    Sailfish::Secrets::Result transferCollectionWithMetadata(
+            pid_t callerPid,
+            quint64 requestId,
+            Sailfish::Secrets::Daemon::ApiImpl::RequestType requestType,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const CollectionArchiveInfo &archive,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress,
+            const CollectionMetadata &collectionMetadata);
+
+    Sailfish::Secrets::Result transferCollectionWithAuthenticationCode(
+            pid_t callerPid,
+            quint64 requestId,
+            Sailfish::Secrets::Daemon::ApiImpl::RequestType requestType,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const CollectionArchiveInfo &archive,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &authenticationCode);
+
+    void transferCollectionWithEncryptionKey(
+            pid_t callerPid,
+            quint64 requestId,
+            Sailfish::Secrets::Daemon::ApiImpl::RequestType requestType,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            const CollectionArchiveInfo &archive,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode,
+            const QString &interactionServiceAddress,
+            const CollectionMetadata &collectionMetadata,
+            const QByteArray &encryptionKey);
+
+    Sailfish::Secrets::EncryptionPlugin *archiveEncryptionPlugin() const;
+
 private:
     struct PendingRequest {
         PendingRequest()
             : callerPid(0), requestId(0), requestType(Sailfish::Secrets::Daemon::ApiImpl::InvalidRequest) {}
         PendingRequest(uint pid, quint64 rid, Sailfish::Secrets::Daemon::ApiImpl::RequestType rtype, QVariantList params)
-            : callerPid(pid), requestId(rid), requestType(rtype), parameters(params) {}
+            : callerPid(pid), requestId(rid), requestType(rtype), parameters(params) { interactionTimer.start(); }
         PendingRequest(const PendingRequest &other)
-            : callerPid(other.callerPid), requestId(other.requestId), requestType(other.requestType), parameters(other.parameters) {}
+            : callerPid(other.callerPid), requestId(other.requestId), requestType(other.requestType), parameters(other.parameters)
+            , interactionTimer(other.interactionTimer) {}
         uint callerPid;
         quint64 requestId;
         Sailfish::Secrets::Daemon::ApiImpl::RequestType requestType;
         QVariantList parameters;
+        QElapsedTimer interactionTimer;
     };
 
     Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue *m_requestQueue;
@@ -709,6 +798,12 @@ private:
     QMap<QString, QByteArray> m_standaloneSecretEncryptionKeys;
     QMap<quint64, Sailfish::Secrets::Daemon::ApiImpl::RequestProcessor::PendingRequest> m_pendingRequests;
 
+    QMap<QString, QByteArray> m_keyDerivationParameters;
+    QSet<QString> m_pendingKeyDerivationUpgrades;
+
+    QThreadPool m_initializationThreadPool;
+    QTimer m_relockTimer;
+    QTimer m_checkpointTimer;
     bool m_autotestMode;
 };
 
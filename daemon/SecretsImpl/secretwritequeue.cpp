@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "secretwritequeue_p.h"
+
+#include <QtCore/QMutexLocker>
+
+using namespace Sailfish::Secrets;
+using namespace Sailfish::Secrets::Daemon::ApiImpl;
+
+SecretWriteQueue::WritePointer
+SecretWriteQueue::enqueue(
+        const SecretMetadata &metadata,
+        const Secret &secret,
+        const QByteArray &encryptionKey)
+{
+    WritePointer write(new Write);
+    write->metadata = metadata;
+    write->secret = secret;
+    write->encryptionKey = encryptionKey;
+
+    QMutexLocker locker(&m_mutex);
+    m_pending.append(write);
+    return write;
+}
+
+QVector<SecretWriteQueue::WritePointer>
+SecretWriteQueue::takeGroup(const WritePointer &write)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QVector<WritePointer> group;
+    if (!m_pending.contains(write)) {
+        return group;
+    }
+
+    QVector<WritePointer> remaining;
+    for (const WritePointer &pending : m_pending) {
+        if (pending->metadata.collectionName == write->metadata.collectionName
+                && pending->metadata.encryptionPluginName == write->metadata.encryptionPluginName
+                && pending->encryptionKey == write->encryptionKey) {
+            group.append(pending);
+        } else {
+            remaining.append(pending);
+        }
+    }
+    m_pending = remaining;
+    return group;
+}
+
+void SecretWriteQueue::finishGroup(const QVector<WritePointer> &group)
+{
+    QMutexLocker locker(&m_mutex);
+    for (const WritePointer &write : group) {
+        write->done = true;
+    }
+    m_groupFinished.wakeAll();
+}
+
+Result SecretWriteQueue::waitForResult(const WritePointer &write)
+{
+    // the group may still be being written by another thread of a
+    // concurrent plugin's thread pool.
+    QMutexLocker locker(&m_mutex);
+    while (!write->done) {
+        m_groupFinished.wait(&m_mutex);
+    }
+    return write->result;
+}
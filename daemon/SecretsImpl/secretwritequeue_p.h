@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_APIIMPL_SECRETWRITEQUEUE_P_H
+#define SAILFISHSECRETS_APIIMPL_SECRETWRITEQUEUE_P_H
+
+#include "SecretsImpl/metadatadb_p.h"
+
+#include "Secrets/secret.h"
+#include "Secrets/result.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+namespace Daemon {
+
+namespace ApiImpl {
+
+// Group commit of the collection secret writes to a storage plugin.
+// Each write is queued when its request is dispatched to the plugin's
+// thread pool.  The first queued write to run takes every write which is
+// queued for the same collection with the same key (i.e. which arrived
+// while earlier writes were in flight) and stores them in one transaction.
+// The tasks of the other writes in the group then only return their result.
+class SecretWriteQueue
+{
+public:
+    struct Write {
+        Write() : done(false) {}
+        SecretMetadata metadata;
+        Sailfish::Secrets::Secret secret;
+        QByteArray encryptionKey;
+        Sailfish::Secrets::Result result;
+        bool done;
+    };
+    typedef QSharedPointer<Write> WritePointer;
+
+    // called from the request processor before the write is dispatched.
+    WritePointer enqueue(const SecretMetadata &metadata,
+                         const Sailfish::Secrets::Secret &secret,
+                         const QByteArray &encryptionKey);
+
+    // called from the plugin thread.  Returns the group containing the write,
+    // in queue order, or an empty group if it was taken by an earlier write.
+    // The caller stores the result of every write in the group before
+    // passing it to finishGroup().
+    QVector<WritePointer> takeGroup(const WritePointer &write);
+    void finishGroup(const QVector<WritePointer> &group);
+    Sailfish::Secrets::Result waitForResult(const WritePointer &write);
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_groupFinished;
+    QVector<WritePointer> m_pending;
+};
+
+} // ApiImpl
+
+} // Daemon
+
+} // Secrets
+
+} // Sailfish
+
+#endif // SAILFISHSECRETS_APIIMPL_SECRETWRITEQUEUE_P_H
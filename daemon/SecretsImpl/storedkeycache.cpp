@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "storedkeycache_p.h"
+#include "logging_p.h"
+#include "util_p.h"
+
+using namespace Sailfish::Secrets::Daemon::ApiImpl;
+
+StoredKeyCache::StoredKeyCache(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+{
+    m_clock.start();
+    m_expiryTimer.setSingleShot(true);
+    connect(&m_expiryTimer, &QTimer::timeout,
+            this, &StoredKeyCache::expireEntries);
+}
+
+StoredKeyCache::~StoredKeyCache()
+{
+    clear();
+}
+
+QString StoredKeyCache::entryIdentifier(
+        const QString &name,
+        const QString &collectionName,
+        const QString &storagePluginName)
+{
+    return storagePluginName + QChar(0) + collectionName + QChar(0) + name;
+}
+
+bool StoredKeyCache::lookup(
+        const Sailfish::Crypto::Key::Identifier &identifier,
+        const QString &applicationId,
+        QByteArray *serializedKey,
+        QMap<QString, QString> *filterData)
+{
+    const QString entryId = entryIdentifier(identifier.name(),
+                                            identifier.collectionName(),
+                                            identifier.storagePluginName());
+    QHash<QString, Entry>::iterator it = m_entries.find(entryId);
+    if (it == m_entries.end()) {
+        return false;
+    } else if (it->expiry <= m_clock.elapsed()) {
+        removeEntry(entryId);
+        return false;
+    } else if (it->applicationId != applicationId) {
+        return false;
+    }
+
+    it->lastUsed = m_clock.elapsed();
+    *serializedKey = QByteArray(it->data, it->length);
+    *filterData = it->filterData;
+    return true;
+}
+
+void StoredKeyCache::insert(
+        const Sailfish::Crypto::Key::Identifier &identifier,
+        const QString &applicationId,
+        const QByteArray &serializedKey,
+        const QMap<QString, QString> &filterData,
+        quint64 generation)
+{
+    if (generation != m_generation || serializedKey.isEmpty()) {
+        return;
+    }
+
+    const QString entryId = entryIdentifier(identifier.name(),
+                                            identifier.collectionName(),
+                                            identifier.storagePluginName());
+    removeEntry(entryId);
+    removeExpiredEntries();
+    if (m_entries.size() >= MaximumEntries) {
+        // evict the least recently used entry.
+        QHash<QString, Entry>::const_iterator oldest = m_entries.constBegin();
+        for (QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+                it != m_entries.constEnd(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        removeEntry(oldest.key());
+    }
+
+    Entry entry;
+    entry.collectionName = identifier.collectionName();
+    entry.storagePluginName = identifier.storagePluginName();
+    entry.applicationId = applicationId;
+    entry.filterData = filterData;
+    entry.data = lockedKeyCopy(serializedKey);
+    entry.length = serializedKey.size();
+    entry.lastUsed = m_clock.elapsed();
+    entry.expiry = entry.lastUsed + TimeToLive;
+    if (!entry.data) {
+        return;
+    }
+    m_entries.insert(entryId, entry);
+
+    if (!m_expiryTimer.isActive()) {
+        m_expiryTimer.start(TimeToLive);
+    }
+}
+
+void StoredKeyCache::removeKey(const Sailfish::Secrets::Secret::Identifier &identifier)
+{
+    ++m_generation;
+    removeEntry(entryIdentifier(identifier.name(),
+                                identifier.collectionName(),
+                                identifier.storagePluginName()));
+}
+
+void StoredKeyCache::removeCollection(const QString &collectionName, const QString &storagePluginName)
+{
+    ++m_generation;
+    QHash<QString, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it->collectionName == collectionName && it->storagePluginName == storagePluginName) {
+            wipeKey(it->data, it->length);
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void StoredKeyCache::clear()
+{
+    ++m_generation;
+    for (const Entry &entry : m_entries) {
+        wipeKey(entry.data, entry.length);
+    }
+    m_entries.clear();
+    m_expiryTimer.stop();
+}
+
+void StoredKeyCache::expireEntries()
+{
+    const qint64 nextExpiry = removeExpiredEntries();
+    if (nextExpiry >= 0) {
+        m_expiryTimer.start(qMax<qint64>(nextExpiry - m_clock.elapsed(), 0));
+    }
+}
+
+void StoredKeyCache::removeEntry(const QString &identifier)
+{
+    QHash<QString, Entry>::iterator it = m_entries.find(identifier);
+    if (it != m_entries.end()) {
+        wipeKey(it->data, it->length);
+        m_entries.erase(it);
+    }
+}
+
+// Returns the expiry time of the entry which will expire next,
+// or -1 if the cache is empty.
+qint64 StoredKeyCache::removeExpiredEntries()
+{
+    const qint64 now = m_clock.elapsed();
+    qint64 nextExpiry = -1;
+    QHash<QString, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it->expiry <= now) {
+            wipeKey(it->data, it->length);
+            it = m_entries.erase(it);
+        } else {
+            if (nextExpiry < 0 || it->expiry < nextExpiry) {
+                nextExpiry = it->expiry;
+            }
+            ++it;
+        }
+    }
+    return nextExpiry;
+}
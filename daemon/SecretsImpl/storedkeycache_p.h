@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_APIIMPL_STOREDKEYCACHE_P_H
+#define SAILFISHSECRETS_APIIMPL_STOREDKEYCACHE_P_H
+
+#include "Secrets/secret.h"
+
+#include "Crypto/key.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+namespace Daemon {
+
+namespace ApiImpl {
+
+// Caches the serialized keys which the crypto daemon retrieves from
+// collections in order to perform operations with key references,
+// so that repeated operations with the same key do not each require
+// a full secrets request (metadata lookup, plugin read and decryption).
+// Only keys read from collections which remain unlocked are cached, and
+// an entry is only returned to the application which originally read it.
+// The serialized keys are held in mlock()ed memory, and are wiped when
+// they expire, are evicted, or are invalidated by a write, deletion or
+// lock operation.  The cache must only be used from the main thread.
+class StoredKeyCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        MaximumEntries = 32,
+        TimeToLive = 5 * 60 * 1000 // milliseconds
+    };
+
+    explicit StoredKeyCache(QObject *parent = Q_NULLPTR);
+    ~StoredKeyCache();
+
+    bool lookup(const Sailfish::Crypto::Key::Identifier &identifier,
+                const QString &applicationId,
+                QByteArray *serializedKey,
+                QMap<QString, QString> *filterData);
+    void insert(const Sailfish::Crypto::Key::Identifier &identifier,
+                const QString &applicationId,
+                const QByteArray &serializedKey,
+                const QMap<QString, QString> &filterData,
+                quint64 generation);
+
+    // Each invalidation increments the generation, so that a key which
+    // was read before an invalidation is not inserted after it.
+    quint64 generation() const { return m_generation; }
+    void removeKey(const Sailfish::Secrets::Secret::Identifier &identifier);
+    void removeCollection(const QString &collectionName, const QString &storagePluginName);
+    void clear();
+
+private Q_SLOTS:
+    void expireEntries();
+
+private:
+    struct Entry {
+        QString collectionName;
+        QString storagePluginName;
+        QString applicationId;
+        QMap<QString, QString> filterData;
+        char *data;
+        int length;
+        qint64 expiry;
+        qint64 lastUsed;
+    };
+
+    static QString entryIdentifier(const QString &name,
+                                   const QString &collectionName,
+                                   const QString &storagePluginName);
+    void removeEntry(const QString &identifier);
+    qint64 removeExpiredEntries();
+
+    QHash<QString, Entry> m_entries;
+    quint64 m_generation;
+    QElapsedTimer m_clock;
+    QTimer m_expiryTimer;
+};
+
+} // ApiImpl
+
+} // Daemon
+
+} // Secrets
+
+} // Sailfish
+
+#endif // SAILFISHSECRETS_APIIMPL_STOREDKEYCACHE_P_H
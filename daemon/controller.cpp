@@ -8,15 +8,20 @@
 #include "controller_p.h"
 #include "discoveryobject_p.h"
 #include "logging_p.h"
+#include "statistics_p.h"
+#include "plugin_p.h"
 
 #include "CryptoImpl/crypto_p.h"
 #include "SecretsImpl/secrets_p.h"
+#include "SecretsImpl/applicationpermissions_p.h"
 #include "SecretsImpl/metadatadb_p.h"
 #include "SecretsImpl/pluginfunctionwrappers_p.h"
 
 #include <QtCore/QString>
 #include <QtCore/QDir>
 #include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
+#include <QtCore/QElapsedTimer>
 
 #include <QtConcurrent>
 
@@ -47,23 +52,41 @@ Sailfish::Secrets::Daemon::Controller::Controller(bool autotestMode, QObject *pa
     , m_autotestMode(autotestMode)
     , m_isValid(false)
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     qRegisterMetaType<Sailfish::Secrets::Daemon::ApiImpl::CollectionMetadata>();
     qRegisterMetaType<Sailfish::Secrets::Daemon::ApiImpl::SecretMetadata>();
 
+    // Both request queues use the application permissions
+    // to determine the scheduling priority of client requests.
+    m_appPermissions = new Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions(this);
+
     // Initialize the various API implementation objects.
     // These objects provide Peer-To-Peer DBus API.
     m_secrets = new Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue(this, autotestMode);
     m_crypto = new Sailfish::Crypto::Daemon::ApiImpl::CryptoRequestQueue(this, m_secrets, autotestMode);
 
+    // Each crypto plugin gets its own thread pool, so that a slow
+    // operation in one plugin doesn't block operations in the others.
+    initializePluginThreadPools();
+
     // We may need to do this again once we know the real lock code.
     // see the comment below for more details.
     // Unless the user has not provided a master-lock code, we don't expect
     // that we have the "correct" bookkeeping database lock key here,
     // but that's ok - we can unlock the database at some later point in
     // time after performing a UI flow asking the user to unlock.
+    QElapsedTimer phaseTimer;
+    phaseTimer.start();
     if (m_secrets->initialize(
                 QByteArray(),
                 Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue::UnlockMode)) {
+        Sailfish::Secrets::Daemon::ApiImpl::Statistics::instance()->recordStartupPhase(
+                QStringLiteral("keyDerivation"), phaseTimer.nsecsElapsed() / 1000);
+        // The plugin metadata databases are unlocked asynchronously,
+        // so that we can start accepting client connections immediately.
+        // Requests are held back until the plugin they target is initialized.
         m_secrets->initializePlugins();
     }
 
@@ -100,6 +123,11 @@ Sailfish::Secrets::Daemon::Controller::Controller(bool autotestMode, QObject *pa
     connect(m_dbusServer, &QDBusServer::newConnection,
             this, &Sailfish::Secrets::Daemon::Controller::handleClientConnection);
 
+    const qint64 startupTime = startupTimer.nsecsElapsed() / 1000;
+    Sailfish::Secrets::Daemon::ApiImpl::Statistics::instance()->recordStartupPhase(
+            QStringLiteral("serverStartup"), startupTime);
+    qCDebug(lcSailfishSecretsDaemon) << "Accepting client connections after" << startupTime << "usecs";
+
     m_isValid = true;
 }
 
@@ -119,17 +147,88 @@ Sailfish::Secrets::Daemon::Controller::crypto() const
     return m_crypto;
 }
 
+Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions*
+Sailfish::Secrets::Daemon::Controller::applicationPermissions() const
+{
+    return m_appPermissions;
+}
+
+void Sailfish::Secrets::Daemon::Controller::initializePluginThreadPools()
+{
+    // Plugins which support concurrent operations may be given more than
+    // one thread.  The number of threads may be specified via environment
+    // variable, otherwise the ideal thread count of the device is used.
+    bool ok = false;
+    int concurrentThreadCount = QString::fromUtf8(qgetenv(ENV_PLUGIN_THREADPOOL_SIZE)).toInt(&ok);
+    if (!ok || concurrentThreadCount <= 0) {
+        concurrentThreadCount = qMax(1, QThread::idealThreadCount());
+    }
+
+    const QMap<QString, QObject*> cryptoStoragePlugins = m_secrets->potentialCryptoStoragePlugins();
+    const QMap<QString, Sailfish::Crypto::CryptoPlugin*> cryptoPlugins = m_crypto->plugins();
+    for (QMap<QString, Sailfish::Crypto::CryptoPlugin*>::const_iterator it = cryptoPlugins.constBegin();
+            it != cryptoPlugins.constEnd(); ++it) {
+        if (cryptoStoragePlugins.contains(it.key())) {
+            // Crypto-storage plugins must share the secrets thread pool,
+            // as their storage operations are performed from that pool
+            // by the secrets request processor.
+            continue;
+        }
+
+        QSharedPointer<QThreadPool> threadPool = QSharedPointer<QThreadPool>::create();
+        threadPool->setMaxThreadCount(it.value()->supportsConcurrentOperations() ? concurrentThreadCount : 1);
+        threadPool->setExpiryTimeout(-1);
+        m_pluginThreadPools.insert(it.key(), threadPool);
+        qCDebug(lcSailfishSecretsDaemon) << "Using" << threadPool->maxThreadCount()
+                                         << "thread(s) for plugin:" << it.key();
+    }
+}
+
 QWeakPointer<QThreadPool> Sailfish::Secrets::Daemon::Controller::threadPoolForPlugin(const QString &pluginName) const
 {
     if (m_secrets->potentialCryptoStoragePlugins().contains(pluginName)) {
         return m_secrets->secretsThreadPool();
-    } else if (m_crypto->plugins().contains(pluginName)) {
-        return m_crypto->cryptoThreadPool();
+    } else if (m_pluginThreadPools.contains(pluginName)) {
+        return m_pluginThreadPools.value(pluginName).toWeakRef();
     } else {
         return m_secrets->secretsThreadPool();
     }
 }
 
+QVariantMap Sailfish::Secrets::Daemon::Controller::daemonStatistics() const
+{
+    QVariantMap threadPools;
+    for (QMap<QString, QSharedPointer<QThreadPool> >::const_iterator it = m_pluginThreadPools.constBegin();
+            it != m_pluginThreadPools.constEnd(); ++it) {
+        QVariantMap pool;
+        pool.insert(QStringLiteral("maxThreadCount"), it.value()->maxThreadCount());
+        pool.insert(QStringLiteral("activeThreadCount"), it.value()->activeThreadCount());
+        threadPools.insert(it.key(), pool);
+    }
+    if (QSharedPointer<QThreadPool> secretsThreadPool = m_secrets->secretsThreadPool().toStrongRef()) {
+        QVariantMap pool;
+        pool.insert(QStringLiteral("maxThreadCount"), secretsThreadPool->maxThreadCount());
+        pool.insert(QStringLiteral("activeThreadCount"), secretsThreadPool->activeThreadCount());
+        threadPools.insert(QStringLiteral("secrets"), pool);
+    }
+    if (QSharedPointer<QThreadPool> kdfThreadPool = m_secrets->kdfThreadPool().toStrongRef()) {
+        QVariantMap pool;
+        pool.insert(QStringLiteral("maxThreadCount"), kdfThreadPool->maxThreadCount());
+        pool.insert(QStringLiteral("activeThreadCount"), kdfThreadPool->activeThreadCount());
+        threadPools.insert(QStringLiteral("kdf"), pool);
+    }
+
+    QVariantMap retn;
+    retn.insert(QStringLiteral("uptimeMs"), Sailfish::Secrets::Daemon::ApiImpl::Statistics::instance()->uptime());
+    retn.insert(QStringLiteral("secrets"), m_secrets->statistics());
+    retn.insert(QStringLiteral("crypto"), m_crypto->statistics());
+    retn.insert(QStringLiteral("plugins"), Sailfish::Secrets::Daemon::ApiImpl::Statistics::instance()->pluginStatistics());
+    retn.insert(QStringLiteral("threadPools"), threadPools);
+    retn.insert(QStringLiteral("startup"), Sailfish::Secrets::Daemon::ApiImpl::Statistics::instance()->startupStatistics());
+    retn.insert(QStringLiteral("metadataDatabases"), m_secrets->metadataStatistics());
+    return retn;
+}
+
 QString Sailfish::Secrets::Daemon::Controller::displayNameForPlugin(const QString &pluginName) const
 {
     if (m_crypto->plugins().contains(pluginName)) {
@@ -246,7 +345,8 @@ Sailfish::Secrets::Daemon::Controller::pluginInfoForPlugins(
                         plugin);
         future.waitForFinished();
         Sailfish::Secrets::Daemon::ApiImpl::PluginState ps = future.result();
-        if (ps.available) {
+        if (ps.available
+                && Sailfish::Secrets::Daemon::ApiImpl::PluginManager::instance()->isPluginAvailable(plugin->name())) {
             flags |= Sailfish::Secrets::PluginInfo::Available;
         }
         if (!ps.locked) {
@@ -263,6 +363,14 @@ Sailfish::Secrets::Daemon::Controller::pluginInfoForPlugins(
     return infos;
 }
 
+void Sailfish::Secrets::Daemon::Controller::handlePluginInitialized()
+{
+    // requests which were held back while the plugin
+    // was being initialized may now be handled.
+    m_secrets->handleRequests();
+    m_crypto->handleRequests();
+}
+
 void Sailfish::Secrets::Daemon::Controller::handleClientConnection(const QDBusConnection &connection)
 {
     qCDebug(lcSailfishSecretsDaemon) << "New client p2p connection received!" << connection.name();
@@ -16,8 +16,10 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
+#include <QtCore/QMap>
 #include <QtCore/QThreadPool>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVariantMap>
 
 #include <Secrets/Plugins/extensionplugins.h>
 #include <Secrets/plugininfo.h>
@@ -34,6 +36,31 @@
 #define ENV_DEFAULT_AUTHENTICATION_PLUGIN "SAILFISH_SECRETSD_DEFAULT_AUTHENTICATION_PLUGIN"
 #define ENV_INAPP_AUTHENTICATION_PLUGIN "SAILFISH_SECRETSD_INAPP_AUTHENTICATION_PLUGIN"
 
+// The environment variable which can be used to specify the maximum
+// number of threads used for plugins which support concurrent operations.
+// See Controller::initializePluginThreadPools() for more information.
+#define ENV_PLUGIN_THREADPOOL_SIZE "SAILFISH_SECRETSD_PLUGIN_THREADPOOL_SIZE"
+
+// The environment variable which can be used to specify the maximum
+// number of cipher session streams which are processed at the same time.
+// See Crypto::Daemon::ApiImpl::RequestProcessor::RequestProcessor() for more information.
+#define ENV_STREAM_THREADPOOL_SIZE "SAILFISH_SECRETSD_STREAM_THREADPOOL_SIZE"
+
+// The environment variables which can be used to specify how long (in
+// milliseconds) and for how many accesses a collection which is relocked
+// after every access may be kept open, to avoid reopening it on each access.
+// A value of zero disables this.
+// See RequestProcessor::RequestProcessor() for more information.
+#define ENV_RELOCK_CACHE_TIMEOUT "SAILFISH_SECRETSD_RELOCK_CACHE_TIMEOUT"
+#define ENV_RELOCK_CACHE_OPERATIONS "SAILFISH_SECRETSD_RELOCK_CACHE_OPERATIONS"
+
+// The environment variable which can be used to specify the duration (in
+// milliseconds) against which the key derivation parameters used for new
+// collections are calibrated.  Changing it causes the parameters to be
+// recalibrated.
+// See RequestProcessor::calibrateKeyDerivation() for more information.
+#define ENV_KDF_TARGET_DURATION "SAILFISH_SECRETSD_KDF_TARGET_DURATION"
+
 namespace Sailfish {
 
 namespace Crypto {
@@ -52,6 +79,7 @@ namespace Daemon {
 class DiscoveryObject;
 namespace ApiImpl {
     class SecretsRequestQueue;
+    class ApplicationPermissions;
 }
 
 class Controller : public QObject
@@ -66,22 +94,29 @@ public:
 
     Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue *secrets() const;
     Sailfish::Crypto::Daemon::ApiImpl::CryptoRequestQueue *crypto() const;
+    Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions *applicationPermissions() const;
     QString mappedPluginName(const QString &pluginName) const;
     QWeakPointer<QThreadPool> threadPoolForPlugin(const QString &pluginName) const;
     QString displayNameForPlugin(const QString &pluginName) const;
     QMap<QString, Sailfish::Secrets::PluginInfo> pluginInfoForPlugins(
             QList<Sailfish::Secrets::PluginBase*> plugins,
             bool masterLocked);
+    QVariantMap daemonStatistics() const;
 
 public Q_SLOTS:
     void handleClientConnection(const QDBusConnection &connection);
+    void handlePluginInitialized();
 
 private:
+    void initializePluginThreadPools();
+
     QDBusServer *m_dbusServer;
     Sailfish::Secrets::Daemon::DiscoveryObject *m_secretsDiscoveryObject;
     Sailfish::Crypto::Daemon::DiscoveryObject *m_cryptoDiscoveryObject;
     Sailfish::Secrets::Daemon::ApiImpl::SecretsRequestQueue *m_secrets;
     Sailfish::Crypto::Daemon::ApiImpl::CryptoRequestQueue *m_crypto;
+    Sailfish::Secrets::Daemon::ApiImpl::ApplicationPermissions *m_appPermissions;
+    QMap<QString, QSharedPointer<QThreadPool> > m_pluginThreadPools;
     bool m_autotestMode;
     bool m_isValid;
 };
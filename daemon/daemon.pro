@@ -29,12 +29,16 @@ HEADERS += \
     $$PWD/discoveryobject_p.h \
     $$PWD/logging_p.h \
     $$PWD/plugin_p.h \
-    $$PWD/requestqueue_p.h
+    $$PWD/requestqueue_p.h \
+    $$PWD/statistics_p.h \
+    $$PWD/util_p.h
 
 SOURCES += \
     $$PWD/controller.cpp \
     $$PWD/plugin_p.cpp \
     $$PWD/requestqueue.cpp \
+    $$PWD/statistics.cpp \
+    $$PWD/util.cpp \
     $$PWD/main.cpp
 
 include($$PWD/SecretsImpl/SecretsImpl.pri)
@@ -9,14 +9,18 @@
 #include <QtCore/QLoggingCategory>
 #include <QtCore/QDir>
 #include <QtCore/QTranslator>
+#include <QtCore/QElapsedTimer>
 
 #include "controller_p.h"
 #include "logging_p.h"
 #include "plugin_p.h"
+#include "statistics_p.h"
 
 #include "Crypto/Plugins/extensionplugins.h"
 #include "Secrets/Plugins/extensionplugins.h"
 
+#include <signal.h>
+
 Q_LOGGING_CATEGORY(lcSailfishSecretsDaemon, "org.sailfishos.secrets.daemon", QtWarningMsg)
 Q_LOGGING_CATEGORY(lcSailfishSecretsDaemonDBus, "org.sailfishos.secrets.daemon.dbus", QtWarningMsg)
 
@@ -31,6 +35,10 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     QCoreApplication::addLibraryPath(cryptoPluginDir);
     QCoreApplication app(argc, argv);
 
+    // Writing to a cipher session stream whose client has gone away must
+    // fail with EPIPE rather than terminating the daemon.
+    signal(SIGPIPE, SIG_IGN);
+
     bool autotestMode = false;
     QStringList args = app.arguments();
     if (args.size() > 1 &&
@@ -48,11 +56,15 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     app.installTranslator(engineeringEnglish.data());
     app.installTranslator(translator.data());
 
+    QElapsedTimer pluginLoadingTimer;
+    pluginLoadingTimer.start();
     Sailfish::Secrets::Daemon::ApiImpl::PluginManager::instance()->loadPlugins<Sailfish::Secrets::AuthenticationPlugin,
                                                                                Sailfish::Secrets::EncryptedStoragePlugin,
                                                                                Sailfish::Secrets::StoragePlugin,
                                                                                Sailfish::Secrets::EncryptionPlugin,
                                                                                Sailfish::Crypto::CryptoPlugin>();
+    Sailfish::Secrets::Daemon::ApiImpl::Statistics::instance()->recordStartupPhase(
+            QStringLiteral("pluginLoading"), pluginLoadingTimer.nsecsElapsed() / 1000);
 
     Sailfish::Secrets::Daemon::Controller controller(autotestMode);
     if (controller.isValid()) {
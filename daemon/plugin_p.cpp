@@ -110,3 +110,53 @@ bool Daemon::ApiImpl::PluginManager::addPlugin(QPluginLoader *loader, const Plug
     delete loader;
     return use;
 }
+
+// Plugins which are initialized asynchronously after startup (e.g. whose
+// metadata database is opened in the background) are marked as initializing
+// until they are ready to be used.  The request queues hold back requests
+// which target such a plugin, and calls into it block until it is ready.
+// A plugin which could not be master-unlocked is reported as unavailable
+// until it is successfully master-unlocked.
+void Daemon::ApiImpl::PluginManager::setPluginInitializing(const QString &pluginName)
+{
+    QMutexLocker locker(&m_initializationMutex);
+    m_initializingPlugins.insert(pluginName);
+}
+
+void Daemon::ApiImpl::PluginManager::setPluginInitialized(const QString &pluginName)
+{
+    QMutexLocker locker(&m_initializationMutex);
+    m_initializingPlugins.remove(pluginName);
+    m_initializationCondition.wakeAll();
+}
+
+void Daemon::ApiImpl::PluginManager::setPluginAvailable(const QString &pluginName, bool available)
+{
+    QMutexLocker locker(&m_initializationMutex);
+    if (available) {
+        m_unavailablePlugins.remove(pluginName);
+    } else {
+        m_unavailablePlugins.insert(pluginName);
+    }
+}
+
+bool Daemon::ApiImpl::PluginManager::isPluginInitializing(const QString &pluginName) const
+{
+    QMutexLocker locker(&m_initializationMutex);
+    return m_initializingPlugins.contains(pluginName);
+}
+
+bool Daemon::ApiImpl::PluginManager::isPluginAvailable(const QString &pluginName) const
+{
+    QMutexLocker locker(&m_initializationMutex);
+    return !m_unavailablePlugins.contains(pluginName);
+}
+
+bool Daemon::ApiImpl::PluginManager::waitForPluginInitialized(const QString &pluginName) const
+{
+    QMutexLocker locker(&m_initializationMutex);
+    while (m_initializingPlugins.contains(pluginName)) {
+        m_initializationCondition.wait(&m_initializationMutex);
+    }
+    return !m_unavailablePlugins.contains(pluginName);
+}
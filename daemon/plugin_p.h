@@ -11,6 +11,9 @@
 #include <QtCore/QPluginLoader>
 #include <QtCore/QString>
 #include <QtCore/QMap>
+#include <QtCore/QSet>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
 #include <QtCore/QLoggingCategory>
 
 #include "Secrets/Plugins/extensionplugins.h"
@@ -89,6 +92,11 @@ private:
     QMap<QString, QObject*> m_plugins;
     bool m_autotestMode;
 
+    mutable QMutex m_initializationMutex;
+    mutable QWaitCondition m_initializationCondition;
+    QSet<QString> m_initializingPlugins;
+    QSet<QString> m_unavailablePlugins;
+
     explicit PluginManager();
     QVector<QPluginLoader *> loadPluginFiles();
     bool addPlugin(QPluginLoader *loader, const PluginHelpers::PluginInfo &info, QObject *obj);
@@ -96,6 +104,13 @@ private:
 public:
     static PluginManager *instance();
 
+    void setPluginInitializing(const QString &pluginName);
+    void setPluginInitialized(const QString &pluginName);
+    void setPluginAvailable(const QString &pluginName, bool available);
+    bool isPluginInitializing(const QString &pluginName) const;
+    bool isPluginAvailable(const QString &pluginName) const;
+    bool waitForPluginInitialized(const QString &pluginName) const;
+
     template<typename ... TPlugins>
     void loadPlugins() {
         auto loaders = loadPluginFiles();
@@ -7,13 +7,32 @@
 
 #include "requestqueue_p.h"
 #include "logging_p.h"
+#include "plugin_p.h"
+
+#include "SecretsImpl/applicationpermissions_p.h"
 
 #include "Secrets/secretsdaemonconnection_p.h"
+#include "Secrets/secret.h"
+#include "Crypto/key.h"
 
 #include <QtCore/QElapsedTimer>
 
 #include <dbus/dbus.h>
 
+namespace {
+    // The default maximum number of requests from a single client
+    // which may be in progress at any time.
+    const int DefaultClientInProgressLimit = 16;
+
+    // The latency (in msecs, from enqueuing to completion) which requests
+    // of each priority are expected not to exceed.
+    const qint64 LatencyTargets[] = {
+        250,    // PlatformPriority
+        500,    // InteractivePriority
+        5000    // BulkPriority
+    };
+}
+
 using namespace Sailfish::Secrets;
 
 Daemon::ApiImpl::RequestQueue::RequestQueue(
@@ -25,8 +44,15 @@ Daemon::ApiImpl::RequestQueue::RequestQueue(
     , m_controller(parent)
     , m_dbusObjectPath(dbusObjectPath)
     , m_dbusInterfaceName(dbusInterfaceName)
+    , m_clientInProgressLimit(DefaultClientInProgressLimit)
     , m_autotestMode(autotestMode)
 {
+    bool ok = false;
+    const int clientInProgressLimit = QString::fromUtf8(qgetenv(ENV_CLIENT_INPROGRESS_LIMIT)).toInt(&ok);
+    if (ok && clientInProgressLimit >= 0) {
+        m_clientInProgressLimit = clientInProgressLimit; // zero means unlimited.
+    }
+
     qCDebug(lcSailfishSecretsDaemon) << "New API implementation request queue constructed:" << m_dbusObjectPath << "," << m_dbusInterfaceName;
 }
 
@@ -44,6 +70,8 @@ void Daemon::ApiImpl::DBusObject::onDisconnection()
 
 Daemon::ApiImpl::RequestQueue::~RequestQueue()
 {
+    qDeleteAll(m_requests);
+    qDeleteAll(m_enqueuingRequests);
 }
 
 void Daemon::ApiImpl::RequestQueue::handleClientConnection(const QDBusConnection &connection)
@@ -65,31 +93,65 @@ void Daemon::ApiImpl::RequestQueue::handleClientConnection(const QDBusConnection
                              QLatin1String("org.freedesktop.DBus.Local"),
                              QLatin1String("Disconnected"),
                              m_dbusObject, SLOT(onDisconnection()));
+
+    // The credentials of a p2p connection cannot change, so look up the
+    // caller once here rather than for every request it makes.
+    DBusConnection *internalConnection = static_cast<DBusConnection*>(clientConnection.internalPointer());
+    unsigned long dbusRemotePid = 0;
+    if (internalConnection && dbus_connection_get_unix_process_id(internalConnection, &dbusRemotePid)) {
+        m_controller->applicationPermissions()->addConnection(clientConnection.name(), (pid_t)dbusRemotePid);
+        ConnectionIdentity identity;
+        identity.remotePid = (pid_t)dbusRemotePid;
+        identity.isPlatformApplication = m_controller->applicationPermissions()->applicationIsPlatformApplication(identity.remotePid);
+        m_connectionIdentities.insert(clientConnection.name(), identity);
+    } else {
+        qCWarning(lcSailfishSecretsDaemon) << "Could not determine PID of client connection:" << clientConnection.name();
+    }
+}
+
+bool Daemon::ApiImpl::RequestQueue::connectionPid(const QDBusConnection &connection, pid_t *pid) const
+{
+    QHash<QString, ConnectionIdentity>::const_iterator it = m_connectionIdentities.constFind(connection.name());
+    if (it != m_connectionIdentities.constEnd()) {
+        *pid = it->remotePid;
+        return true;
+    }
+
+    DBusConnection *internalConnection = static_cast<DBusConnection*>(connection.internalPointer());
+    unsigned long dbusRemotePid = 0;
+    if (!dbus_connection_get_unix_process_id(internalConnection, &dbusRemotePid)) {
+        return false;
+    }
+    *pid = (pid_t)dbusRemotePid;
+    return true;
 }
 
 void Daemon::ApiImpl::RequestQueue::handleClientDisconnection(const QDBusConnection &connection)
 {
-    QList<RequestData*>::Iterator it = m_requests.begin();
-    while (it != m_requests.end()) {
-        Daemon::ApiImpl::RequestQueue::RequestData *request = *it;
-        if (request->connection.name() != connection.name()) {
-            ++it;
+    const QSet<quint64> requestIds = m_connectionRequests.value(connection.name());
+    for (quint64 requestId : requestIds) {
+        Daemon::ApiImpl::RequestQueue::RequestData *request = m_requests.value(requestId);
+        if (!request) {
             continue;
         }
         switch (request->status) {
         case RequestInProgress:
             handleCancelation(request); // Fallthrough
         case RequestPending:
+            // if the request is pending, its stale id will be skipped by handleRequests().
             qCDebug(lcSailfishSecretsDaemon) << "Deleting request" << request->requestId << request->remotePid;
-            it = m_requests.erase(it);
-            delete request;
+            removeRequest(request);
             break;
         case RequestFinished:
             qCDebug(lcSailfishSecretsDaemon) << "Ignoring finished request" << request->requestId << request->remotePid;
-            ++it;
             break;
         }
     }
+
+    // the client will be dropped from the round-robin order by takeNextPendingRequest().
+    m_clientQueues.remove(connection.name());
+    m_connectionIdentities.remove(connection.name());
+    m_controller->applicationPermissions()->removeConnection(connection.name());
 }
 
 void Daemon::ApiImpl::RequestQueue::handleRequest(
@@ -100,17 +162,15 @@ void Daemon::ApiImpl::RequestQueue::handleRequest(
         Sailfish::Crypto::Result &returnResult)
 {
     // queue up a Sailfish Crypto API request
-    DBusConnection *internalConnection = static_cast<DBusConnection*>(connection.internalPointer());
-    unsigned long dbusRemotePid = 0;
-    dbus_bool_t gotPid = dbus_connection_get_unix_process_id(internalConnection, &dbusRemotePid);
-    if (!gotPid) {
+    pid_t remotePid = 0;
+    if (!connectionPid(connection, &remotePid)) {
         connection.send(message.createErrorReply(
                             QDBusError::Other,
                             QString::fromUtf8("Could not determine PID of caller to enforce access controls")));
     } else {
         Daemon::ApiImpl::RequestQueue::RequestData *data = new Daemon::ApiImpl::RequestQueue::RequestData;
         data->connection = connection;
-        data->remotePid = (pid_t)dbusRemotePid;
+        data->remotePid = remotePid;
         data->status = Daemon::ApiImpl::RequestQueue::RequestPending;
         data->type = requestType;
         data->inParams = inParams;
@@ -137,17 +197,15 @@ void Daemon::ApiImpl::RequestQueue::handleRequest(
         Result &returnResult)
 {
     // queue up a Sailfish Secrets API request
-    DBusConnection *internalConnection = static_cast<DBusConnection*>(connection.internalPointer());
-    unsigned long dbusRemotePid = 0;
-    dbus_bool_t gotPid = dbus_connection_get_unix_process_id(internalConnection, &dbusRemotePid);
-    if (!gotPid) {
+    pid_t remotePid = 0;
+    if (!connectionPid(connection, &remotePid)) {
         connection.send(message.createErrorReply(
                             QDBusError::Other,
                             QString::fromUtf8("Could not determine PID of caller to enforce access controls")));
     } else {
         Daemon::ApiImpl::RequestQueue::RequestData *data = new Daemon::ApiImpl::RequestQueue::RequestData;
         data->connection = connection;
-        data->remotePid = (pid_t)dbusRemotePid;
+        data->remotePid = remotePid;
         data->status = Daemon::ApiImpl::RequestQueue::RequestPending;
         data->type = requestType;
         data->inParams = inParams;
@@ -189,37 +247,14 @@ Result Daemon::ApiImpl::RequestQueue::enqueueRequest(Daemon::ApiImpl::RequestQue
 {
     static quint64 requestId = 0;
 
-    // If no free request ids (i.e. queue is full) then return an error to the client.
-    quint64 prevId = requestId;
+    // Request ids are allocated monotonically, so an id can only be in use
+    // by another request after the counter wraps around.  Skip over any
+    // such ids (and zero, which is never a valid request id).
     quint64 nextFreeId = ++requestId;
-    bool found = false;
-    for ( ; nextFreeId != prevId; ++nextFreeId) {
-        found = false;
-        if (m_enqueuingRequests.contains(nextFreeId)) {
-            // another enqueuing request is using this id.
-            found = true;
-        } else {
-            QList<Daemon::ApiImpl::RequestQueue::RequestData*>::const_iterator it = m_requests.constBegin();
-            while (it != m_requests.constEnd()) {
-                if ((*it)->requestId == nextFreeId) {
-                    // another current request is using this id.
-                    found = true;
-                    break;
-                }
-                it++;
-            }
-        }
-        if (!found) {
-            // no requests in the queue are using this id.  it is free to use.
-            break;
-        }
-    }
-
-    if (found) {
-        // all request ids are taken.  we cannot enqueue this request.
-        qCWarning(lcSailfishSecretsDaemon) << "Cannot enqueue request:" << requestTypeToString(request->type) << ": queue is full!";
-        return Result(Result::SecretsDaemonRequestQueueFullError,
-                                         QString::fromUtf8("Request queue is full, try again later"));
+    while (nextFreeId == 0
+            || m_enqueuingRequests.contains(nextFreeId)
+            || m_requests.contains(nextFreeId)) {
+        nextFreeId = ++requestId;
     }
 
     if (request->isSecretsCryptoRequest) {
@@ -232,6 +267,7 @@ Result Daemon::ApiImpl::RequestQueue::enqueueRequest(Daemon::ApiImpl::RequestQue
     }
 
     request->requestId = nextFreeId;
+    request->enqueuedTimer.start();
     m_enqueuingRequests.insert(nextFreeId, request);
     // asynchronously append the request to the queue,
     // to avoid invalidating any iterators operating on it.
@@ -250,24 +286,324 @@ void Daemon::ApiImpl::RequestQueue::finishEnqueueRequest(quint64 requestId)
     }
 
     Daemon::ApiImpl::RequestQueue::RequestData *request = m_enqueuingRequests.take(requestId);
-    m_requests.append(request);
+    request->priority = requestPriority(request);
+    m_requests.insert(requestId, request);
+    m_connectionRequests[request->connection.name()].insert(requestId);
+
+    const QString name = clientName(request);
+    ClientQueue &client(m_clientQueues[name]);
+    client.remotePid = request->remotePid;
+    client.pendingRequests.append(requestId);
+    if (client.pendingRequests.size() == 1) {
+        scheduleClient(name, &client);
+    }
     QMetaObject::invokeMethod(this, "handleRequests", Qt::QueuedConnection);
 }
 
+// Returns the name of the client queue of the request.  Internal requests
+// (i.e. Secrets requests made as part of a Crypto request) have no client
+// connection of their own, so they are queued per calling process instead,
+// in order that the internal requests made on behalf of one Crypto client
+// cannot hold up those made on behalf of another.
+QString Daemon::ApiImpl::RequestQueue::clientName(const Daemon::ApiImpl::RequestQueue::RequestData *request) const
+{
+    if (request->isSecretsCryptoRequest) {
+        return QStringLiteral("%1.%2").arg(request->connection.name()).arg(request->remotePid);
+    }
+    return request->connection.name();
+}
+
+Daemon::ApiImpl::RequestQueue::RequestPriority
+Daemon::ApiImpl::RequestQueue::requestPriority(const Daemon::ApiImpl::RequestQueue::RequestData *request) const
+{
+    if (request->isSecretsCryptoRequest) {
+        // the Crypto request this is part of has already been scheduled.
+        return PlatformPriority;
+    }
+
+    // use the identity which was resolved when the client connected.
+    QHash<QString, ConnectionIdentity>::const_iterator identity = m_connectionIdentities.constFind(request->connection.name());
+    const bool isPlatformApplication = identity != m_connectionIdentities.constEnd()
+            ? identity->isPlatformApplication
+            : m_controller->applicationPermissions()->applicationIsPlatformApplication(request->remotePid);
+    if (isPlatformApplication) {
+        return PlatformPriority;
+    }
+    return isBulkRequest(request->type) ? BulkPriority : InteractivePriority;
+}
+
+// Returns the oldest pending request of the client, skipping the stale ids
+// of canceled requests, or null if the client has no pending requests.
+Daemon::ApiImpl::RequestQueue::RequestData *
+Daemon::ApiImpl::RequestQueue::nextClientRequest(Daemon::ApiImpl::RequestQueue::ClientQueue *client)
+{
+    while (!client->pendingRequests.isEmpty()) {
+        Daemon::ApiImpl::RequestQueue::RequestData *request = m_requests.value(client->pendingRequests.first());
+        if (request) {
+            return request;
+        }
+        client->pendingRequests.removeFirst();
+    }
+    return Q_NULLPTR;
+}
+
+// Schedules the client according to the priority of its oldest pending request.
+void Daemon::ApiImpl::RequestQueue::scheduleClient(const QString &clientName, Daemon::ApiImpl::RequestQueue::ClientQueue *client)
+{
+    Daemon::ApiImpl::RequestQueue::RequestData *request = nextClientRequest(client);
+    if (request) {
+        m_scheduledClients[request->priority].append(clientName);
+    }
+}
+
+Daemon::ApiImpl::RequestQueue::RequestData *Daemon::ApiImpl::RequestQueue::takeNextPendingRequest()
+{
+    // The requests of each client are handled in the order that the client
+    // made them, as a later request may depend upon an earlier one (e.g.
+    // storing a secret into a collection which is still being created).
+    // Priority and fairness apply between clients: each client is scheduled
+    // according to the priority of its oldest pending request, and clients
+    // of the same priority are served round-robin so that a client which
+    // floods the queue cannot starve other clients.  Clients which already
+    // have too many requests in progress are skipped until some of those
+    // requests finish.
+    for (int priority = PlatformPriority; priority < PriorityCount; ++priority) {
+        QList<QString> &scheduledClients(m_scheduledClients[priority]);
+        for (int i = scheduledClients.size(); i > 0; --i) {
+            const QString clientName = scheduledClients.takeFirst();
+            QHash<QString, ClientQueue>::iterator client = m_clientQueues.find(clientName);
+            if (client == m_clientQueues.end()) {
+                // the client has disconnected.
+                continue;
+            }
+
+            Daemon::ApiImpl::RequestQueue::RequestData *request = nextClientRequest(&(*client));
+            if (!request) {
+                continue;
+            } else if (request->priority != priority) {
+                // the request the client was scheduled for has been canceled,
+                // so reschedule it according to its next request.
+                m_scheduledClients[request->priority].append(clientName);
+                if (request->priority < priority) {
+                    priority = request->priority - 1; // rescan from that priority.
+                    break;
+                }
+                continue;
+            }
+
+            if (targetsInitializingPlugin(request)) {
+                // the plugin is still being initialized after startup.
+                // Rather than blocking a plugin thread (and so any requests
+                // queued behind it) the client waits until it is ready.
+                scheduledClients.append(clientName);
+                continue;
+            }
+
+            if (priority != PlatformPriority
+                    && m_clientInProgressLimit > 0
+                    && client->inProgressCount >= m_clientInProgressLimit) {
+                // this client must wait for some of its requests to finish.
+                scheduledClients.append(clientName);
+                continue;
+            }
+
+            client->pendingRequests.removeFirst();
+            scheduleClient(clientName, &(*client));
+            return request;
+        }
+    }
+
+    return Q_NULLPTR;
+}
+
+bool Daemon::ApiImpl::RequestQueue::targetsInitializingPlugin(const Daemon::ApiImpl::RequestQueue::RequestData *request) const
+{
+    // The plugin targeted by a request is one of its parameters,
+    // either by name or as part of a secret or key identifier.
+    Daemon::ApiImpl::PluginManager *pluginManager = Daemon::ApiImpl::PluginManager::instance();
+    for (const QVariant &param : request->inParams) {
+        const int type = param.userType();
+        QString pluginName;
+        if (type == QMetaType::QString) {
+            pluginName = param.toString();
+        } else if (type == qMetaTypeId<Sailfish::Secrets::Secret::Identifier>()) {
+            pluginName = param.value<Sailfish::Secrets::Secret::Identifier>().storagePluginName();
+        } else if (type == qMetaTypeId<Sailfish::Secrets::Secret>()) {
+            pluginName = param.value<Sailfish::Secrets::Secret>().storagePluginName();
+        } else if (type == qMetaTypeId<Sailfish::Crypto::Key::Identifier>()) {
+            pluginName = param.value<Sailfish::Crypto::Key::Identifier>().storagePluginName();
+        } else if (type == qMetaTypeId<Sailfish::Crypto::Key>()) {
+            pluginName = param.value<Sailfish::Crypto::Key>().storagePluginName();
+        }
+        if (!pluginName.isEmpty() && pluginManager->isPluginInitializing(pluginName)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Daemon::ApiImpl::RequestQueue::setRequestInProgress(Daemon::ApiImpl::RequestQueue::RequestData *request, bool inProgress)
+{
+    if ((request->status == RequestInProgress) == inProgress) {
+        return;
+    }
+
+    QHash<QString, ClientQueue>::iterator client = m_clientQueues.find(clientName(request));
+    if (client != m_clientQueues.end()) {
+        client->inProgressCount += inProgress ? 1 : -1;
+        if (request->isSecretsCryptoRequest
+                && client->inProgressCount == 0
+                && client->pendingRequests.isEmpty()) {
+            // there is no disconnection to clean up the queue of
+            // internal requests, so drop it once it is idle.
+            m_clientQueues.erase(client);
+        }
+    }
+    if (inProgress) {
+        request->status = RequestInProgress;
+    }
+}
+
+void Daemon::ApiImpl::RequestQueue::removeRequest(Daemon::ApiImpl::RequestQueue::RequestData *request)
+{
+    // Any stale id left in the pending or finished lists is skipped
+    // by handleRequests(), so we don't need to search those lists here.
+    setRequestInProgress(request, false);
+    m_requests.remove(request->requestId);
+    QHash<QString, QSet<quint64> >::iterator it = m_connectionRequests.find(request->connection.name());
+    if (it != m_connectionRequests.end()) {
+        it->remove(request->requestId);
+        if (it->isEmpty()) {
+            m_connectionRequests.erase(it);
+        }
+    }
+    delete request;
+}
+
 void Daemon::ApiImpl::RequestQueue::requestFinished(quint64 requestId, const QList<QVariant> &outParams)
 {
-    QList<Daemon::ApiImpl::RequestQueue::RequestData*>::iterator it = m_requests.begin();
-    while (it != m_requests.end()) {
-        if ((*it)->requestId == requestId) {
-            (*it)->status = Daemon::ApiImpl::RequestQueue::RequestFinished;
-            (*it)->outParams = outParams;
-            QMetaObject::invokeMethod(this, "handleRequests", Qt::QueuedConnection);
-            return;
+    Daemon::ApiImpl::RequestQueue::RequestData *request = m_requests.value(requestId);
+    if (!request) {
+        qCWarning(lcSailfishSecretsDaemon) << "Unable to finish unknown request:" << requestId;
+        return;
+    }
+
+    setRequestInProgress(request, false);
+    request->status = Daemon::ApiImpl::RequestQueue::RequestFinished;
+    request->outParams = outParams;
+    m_finishedRequests.append(requestId);
+    QMetaObject::invokeMethod(this, "handleRequests", Qt::QueuedConnection);
+}
+
+QVector<Daemon::ApiImpl::RequestQueue::PriorityStatistics>
+Daemon::ApiImpl::RequestQueue::priorityStatistics() const
+{
+    QVector<Daemon::ApiImpl::RequestQueue::PriorityStatistics> retn;
+    for (int priority = PlatformPriority; priority < PriorityCount; ++priority) {
+        retn.append(m_priorityStatistics[priority]);
+    }
+    return retn;
+}
+
+QMap<QString, Daemon::ApiImpl::RequestQueue::ClientStatistics>
+Daemon::ApiImpl::RequestQueue::clientStatistics() const
+{
+    QMap<QString, Daemon::ApiImpl::RequestQueue::ClientStatistics> retn;
+    for (QHash<QString, ClientQueue>::const_iterator it = m_clientQueues.constBegin(); it != m_clientQueues.constEnd(); ++it) {
+        Daemon::ApiImpl::RequestQueue::ClientStatistics stats;
+        stats.remotePid = it->remotePid;
+        stats.inProgressCount = it->inProgressCount;
+        stats.pendingCount = it->pendingRequests.size();
+        retn.insert(it.key(), stats);
+    }
+    return retn;
+}
+
+QMap<int, Daemon::ApiImpl::RequestQueue::RequestTypeStatistics>
+Daemon::ApiImpl::RequestQueue::requestTypeStatistics() const
+{
+    return m_requestTypeStatistics;
+}
+
+void Daemon::ApiImpl::RequestQueue::addInteractionTime(quint64 requestId, qint64 usecs)
+{
+    // called by the request processor once the authentication or
+    // user input flow for the request has completed.
+    if (RequestData *request = m_requests.value(requestId)) {
+        request->interactionTime += usecs;
+    }
+}
+
+void Daemon::ApiImpl::RequestQueue::recordStatistics(const RequestData *request)
+{
+    if (request->queueWait < 0) {
+        // the request was completed without ever being handled.
+        return;
+    }
+
+    const qint64 interactionTime = request->interactionTime;
+    const qint64 executionTime = qMax(Q_INT64_C(0), request->executionTimer.nsecsElapsed() / 1000 - interactionTime);
+    RequestTypeStatistics &stats(m_requestTypeStatistics[request->type]);
+    stats.completedCount += 1;
+    stats.totalQueueWait += request->queueWait;
+    stats.maxQueueWait = qMax(stats.maxQueueWait, request->queueWait);
+    stats.totalExecutionTime += executionTime;
+    stats.maxExecutionTime = qMax(stats.maxExecutionTime, executionTime);
+    stats.totalInteractionTime += interactionTime;
+    stats.maxInteractionTime = qMax(stats.maxInteractionTime, interactionTime);
+}
+
+QVariantMap Daemon::ApiImpl::RequestQueue::statistics() const
+{
+    QVariantMap requestTypes;
+    for (QMap<int, RequestTypeStatistics>::const_iterator it = m_requestTypeStatistics.constBegin();
+            it != m_requestTypeStatistics.constEnd(); ++it) {
+        const qint64 count = qMax(Q_INT64_C(1), qint64(it->completedCount));
+        QVariantMap type;
+        type.insert(QStringLiteral("completed"), it->completedCount);
+        type.insert(QStringLiteral("averageQueueWaitUs"), it->totalQueueWait / count);
+        type.insert(QStringLiteral("maxQueueWaitUs"), it->maxQueueWait);
+        type.insert(QStringLiteral("averageExecutionTimeUs"), it->totalExecutionTime / count);
+        type.insert(QStringLiteral("maxExecutionTimeUs"), it->maxExecutionTime);
+        type.insert(QStringLiteral("averageInteractionTimeUs"), it->totalInteractionTime / count);
+        type.insert(QStringLiteral("maxInteractionTimeUs"), it->maxInteractionTime);
+        requestTypes.insert(requestTypeToString(it.key()), type);
+    }
+
+    static const char *priorityNames[] = { "platform", "interactive", "bulk" };
+    QVariantMap priorities;
+    for (int priority = PlatformPriority; priority < PriorityCount; ++priority) {
+        const PriorityStatistics &stats(m_priorityStatistics[priority]);
+        QVariantMap p;
+        p.insert(QStringLiteral("completed"), stats.completedCount);
+        p.insert(QStringLiteral("latencyTargetViolations"), stats.sloViolationCount);
+        p.insert(QStringLiteral("averageLatencyMs"),
+                 stats.completedCount ? stats.totalLatency / qint64(stats.completedCount) : 0);
+        p.insert(QStringLiteral("maxLatencyMs"), stats.maxLatency);
+        priorities.insert(QLatin1String(priorityNames[priority]), p);
+    }
+
+    int pendingCount = 0;
+    int inProgressCount = 0;
+    for (QHash<quint64, RequestData*>::const_iterator it = m_requests.constBegin(); it != m_requests.constEnd(); ++it) {
+        if ((*it)->status == RequestPending) {
+            pendingCount++;
+        } else if ((*it)->status == RequestInProgress) {
+            inProgressCount++;
         }
-        it++;
     }
 
-    qCWarning(lcSailfishSecretsDaemon) << "Unable to finish unknown request:" << requestId;
+    QVariantMap queue;
+    queue.insert(QStringLiteral("pending"), pendingCount);
+    queue.insert(QStringLiteral("inProgress"), inProgressCount);
+    queue.insert(QStringLiteral("finished"), m_finishedRequests.size());
+    queue.insert(QStringLiteral("clients"), m_clientQueues.size());
+
+    QVariantMap retn;
+    retn.insert(QStringLiteral("requestTypes"), requestTypes);
+    retn.insert(QStringLiteral("priorities"), priorities);
+    retn.insert(QStringLiteral("queue"), queue);
+    return retn;
 }
 
 void Daemon::ApiImpl::RequestQueue::handleRequests()
@@ -276,37 +612,8 @@ void Daemon::ApiImpl::RequestQueue::handleRequests()
     QElapsedTimer yieldTimer;
     yieldTimer.start();
     bool completed = false;
-    QList<Daemon::ApiImpl::RequestQueue::RequestData*>::iterator it = m_requests.begin();
-    while (it != m_requests.end()) {
-        Daemon::ApiImpl::RequestQueue::RequestData *request = *it;
-        completed = false;
-        if (request->status == RequestPending) {
-            // This is a new request we haven't seen before.
-            // Track the peer connection (if we haven't already), and then handle the request.
-            //trackPeerConnection(request); // TODO: is this needed?
-            request->status = RequestInProgress;
-            handlePendingRequest(request, &completed);
-            if (completed) {
-                it = m_requests.erase(it);
-                delete request;
-            } else {
-                it++;
-            }
-        } else if (request->status == RequestFinished) {
-            // This (asynchronous) request is in Finished state.  We need to send the response.
-            handleFinishedRequest(request, &completed);
-            if (completed) {
-                it = m_requests.erase(it);
-                delete request;
-            } else {
-                it++;
-            }
-        } else if (request->status == RequestInProgress) {
-            // this request is already in progress.
-            it++;
-        }
-
-        if (m_requests.size() && yieldTimer.elapsed() > 100) {
+    forever {
+        if (yieldTimer.elapsed() > 100) {
             // If we've taken more than 100 msec to handle requests, then we should
             // yield to the event loop after queuing up another handleRequests event.
             // This ensures that we stay responsive to DBus requests even if we have
@@ -314,6 +621,42 @@ void Daemon::ApiImpl::RequestQueue::handleRequests()
             QMetaObject::invokeMethod(this, "handleRequests", Qt::QueuedConnection);
             break;
         }
+
+        completed = false;
+        Daemon::ApiImpl::RequestQueue::RequestData *request = Q_NULLPTR;
+        if (!m_finishedRequests.isEmpty()) {
+            // This (asynchronous) request is in Finished state.  We need to send the response.
+            request = m_requests.value(m_finishedRequests.takeFirst());
+            if (!request || request->status != RequestFinished) {
+                // the request was canceled, nothing to do.
+                continue;
+            }
+            handleFinishedRequest(request, &completed);
+        } else if ((request = takeNextPendingRequest()) != Q_NULLPTR) {
+            // This is a new request we haven't seen before.
+            if (request->queueWait < 0) {
+                request->queueWait = request->enqueuedTimer.nsecsElapsed() / 1000;
+                request->executionTimer.start();
+            }
+            setRequestInProgress(request, true);
+            handlePendingRequest(request, &completed);
+        } else {
+            // nothing left which can be handled right now.
+            break;
+        }
+
+        if (completed) {
+            const qint64 latency = request->enqueuedTimer.elapsed();
+            Daemon::ApiImpl::RequestQueue::PriorityStatistics &stats(m_priorityStatistics[request->priority]);
+            stats.completedCount += 1;
+            stats.totalLatency += latency;
+            stats.maxLatency = qMax(stats.maxLatency, latency);
+            if (latency > LatencyTargets[request->priority]) {
+                stats.sloViolationCount += 1;
+            }
+            recordStatistics(request);
+            removeRequest(request);
+        }
     }
 
     // no more pending requests to handle, or yielding to event loop.
@@ -13,6 +13,11 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <QtCore/QVariantMap>
+#include <QtCore/QElapsedTimer>
 
 #include "controller_p.h"
 
@@ -22,6 +27,11 @@
 // forward declare the QDBusConnection::internalPointer() return type.
 class DBusConnection;
 
+// The environment variable which can be used to specify the maximum number
+// of requests from a single client which may be in progress at any time.
+// See RequestQueue::takeNextPendingRequest() for more information.
+#define ENV_CLIENT_INPROGRESS_LIMIT "SAILFISH_SECRETSD_CLIENT_INPROGRESS_LIMIT"
+
 namespace Sailfish {
 
 namespace Secrets {
@@ -59,19 +69,31 @@ public:
         RequestFinished
     };
 
+    enum RequestPriority {
+        PlatformPriority = 0,   // requests from platform applications, and internal requests
+        InteractivePriority,    // requests which are expected to complete quickly
+        BulkPriority,           // requests which may be expensive, e.g. key generation
+        PriorityCount
+    };
+
     struct RequestData {
         RequestData()
             : requestId(0)
             , remotePid(0)
             , type(0) // InvalidRequest
             , status(RequestPending)
+            , priority(InteractivePriority)
             , connection(QString::fromUtf8("org.sailfishos.secrets.daemon.invalidConnection"))
             , cryptoRequestId(0)
-            , isSecretsCryptoRequest(false) {}
+            , isSecretsCryptoRequest(false)
+            , queueWait(-1)
+            , interactionTime(0) {}
         quint64 requestId;
         pid_t remotePid;
         int type;
         RequestStatus status;
+        RequestPriority priority;
+        QElapsedTimer enqueuedTimer;
         QList<QVariant> inParams;
         QList<QVariant> outParams;
         QDBusMessage message;
@@ -81,6 +103,51 @@ public:
         // which is being performed as part of a Sailfish::Crypto request.
         quint64 cryptoRequestId;
         bool isSecretsCryptoRequest;
+
+        // Timing information used for the daemon statistics.
+        qint64 queueWait;               // usecs between enqueuing and first being handled
+        qint64 interactionTime;         // usecs spent waiting for authentication or user input
+        QElapsedTimer executionTimer;   // started when the request is first handled
+    };
+
+    struct PriorityStatistics {
+        PriorityStatistics()
+            : completedCount(0)
+            , sloViolationCount(0)
+            , totalLatency(0)
+            , maxLatency(0) {}
+        quint64 completedCount;     // requests which have been completed
+        quint64 sloViolationCount;  // completed requests which exceeded the latency target
+        qint64 totalLatency;        // msecs between enqueuing and completion, summed
+        qint64 maxLatency;          // msecs between enqueuing and completion, maximum
+    };
+
+    struct RequestTypeStatistics {
+        RequestTypeStatistics()
+            : completedCount(0)
+            , totalQueueWait(0)
+            , maxQueueWait(0)
+            , totalExecutionTime(0)
+            , maxExecutionTime(0)
+            , totalInteractionTime(0)
+            , maxInteractionTime(0) {}
+        quint64 completedCount;     // requests of this type which have been completed
+        qint64 totalQueueWait;      // usecs between enqueuing and first being handled, summed
+        qint64 maxQueueWait;
+        qint64 totalExecutionTime;  // usecs between first being handled and completion, excluding interaction, summed
+        qint64 maxExecutionTime;
+        qint64 totalInteractionTime;// usecs spent waiting for authentication or user input, summed
+        qint64 maxInteractionTime;
+    };
+
+    struct ClientStatistics {
+        ClientStatistics()
+            : remotePid(0)
+            , pendingCount(0)
+            , inProgressCount(0) {}
+        pid_t remotePid;
+        int pendingCount;
+        int inProgressCount;
     };
 
 public:
@@ -112,10 +179,17 @@ public:
     Sailfish::Secrets::Result enqueueRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request);
     void requestFinished(quint64 requestId, const QList<QVariant> &outParams);
 
+    QVector<PriorityStatistics> priorityStatistics() const;
+    QMap<QString, ClientStatistics> clientStatistics() const;
+    QMap<int, RequestTypeStatistics> requestTypeStatistics() const;
+    QVariantMap statistics() const;
+    void addInteractionTime(quint64 requestId, qint64 usecs);
+
     virtual void handleCancelation(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request) = 0;
     virtual void handlePendingRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool *completed) = 0;
     virtual void handleFinishedRequest(Sailfish::Secrets::Daemon::ApiImpl::RequestQueue::RequestData *request, bool *completed) = 0;
     virtual QString requestTypeToString(int type) const = 0;
+    virtual bool isBulkRequest(int type) const = 0;
 
 public Q_SLOTS:
     void handleRequests();
@@ -125,12 +199,53 @@ public Q_SLOTS:
 private Q_SLOTS:
     void finishEnqueueRequest(quint64 requestId);
 
+private:
+    struct ClientQueue {
+        ClientQueue()
+            : remotePid(0)
+            , inProgressCount(0) {}
+        pid_t remotePid;
+        int inProgressCount;
+        QList<quint64> pendingRequests; // in the order they were made
+    };
+
+    struct ConnectionIdentity {
+        ConnectionIdentity()
+            : remotePid(0)
+            , isPlatformApplication(false) {}
+        pid_t remotePid;
+        bool isPlatformApplication;
+    };
+
+    bool connectionPid(const QDBusConnection &connection, pid_t *pid) const;
+    QString clientName(const RequestData *request) const;
+    RequestPriority requestPriority(const RequestData *request) const;
+    RequestData *nextClientRequest(ClientQueue *client);
+    bool targetsInitializingPlugin(const RequestData *request) const;
+    void scheduleClient(const QString &clientName, ClientQueue *client);
+    RequestData *takeNextPendingRequest();
+    void removeRequest(RequestData *request);
+    void recordStatistics(const RequestData *request);
+
 protected:
+    // a finished request which continues with another asynchronous
+    // operation (e.g. the next operation of a batch) must be marked
+    // as in progress again, via this method.
+    void setRequestInProgress(RequestData *request, bool inProgress);
+
     Controller *m_controller;
     DBusObject *m_dbusObject;
     QString m_dbusObjectPath;
     QString m_dbusInterfaceName;
-    QList<RequestData*> m_requests;
+    QHash<quint64, RequestData*> m_requests;                // request id to request, for every request in the queue
+    QList<quint64> m_finishedRequests;                      // ids of requests awaiting their reply, in completion order
+    QHash<QString, QSet<quint64> > m_connectionRequests;    // client connection name to ids of its requests
+    QHash<QString, ClientQueue> m_clientQueues;             // client name (see clientName()) to its pending requests
+    QHash<QString, ConnectionIdentity> m_connectionIdentities; // client connection name to the identity of the client
+    QList<QString> m_scheduledClients[PriorityCount];       // round-robin order of clients, by the priority of their oldest pending request
+    PriorityStatistics m_priorityStatistics[PriorityCount];
+    QMap<int, RequestTypeStatistics> m_requestTypeStatistics;
+    int m_clientInProgressLimit;
     QMap<quint64, RequestData*> m_enqueuingRequests;
 
     bool m_autotestMode;
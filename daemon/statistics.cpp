@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "statistics_p.h"
+
+#include <QtCore/QGlobalStatic>
+#include <QtCore/QVariantList>
+
+using namespace Sailfish::Secrets;
+
+Q_GLOBAL_STATIC(Daemon::ApiImpl::Statistics, statisticsInstance)
+
+Daemon::ApiImpl::Statistics::Statistics()
+{
+    m_uptimeTimer.start();
+}
+
+Daemon::ApiImpl::Statistics *Daemon::ApiImpl::Statistics::instance()
+{
+    return statisticsInstance();
+}
+
+Daemon::ApiImpl::Statistics::LatencyBucket
+Daemon::ApiImpl::Statistics::bucketForLatency(qint64 usecs)
+{
+    if (usecs < 100) {
+        return LatencyUnder100Microseconds;
+    } else if (usecs < 1000) {
+        return LatencyUnder1Millisecond;
+    } else if (usecs < 10 * 1000) {
+        return LatencyUnder10Milliseconds;
+    } else if (usecs < 100 * 1000) {
+        return LatencyUnder100Milliseconds;
+    } else if (usecs < 1000 * 1000) {
+        return LatencyUnder1Second;
+    }
+    return LatencyOver1Second;
+}
+
+void Daemon::ApiImpl::Statistics::recordPluginCall(
+        const QString &pluginName,
+        qint64 usecs)
+{
+    QMutexLocker locker(&m_mutex);
+    PluginStatistics &stats(m_pluginStatistics[pluginName]);
+    stats.callCount++;
+    stats.totalTime += usecs;
+    stats.maxTime = qMax(stats.maxTime, usecs);
+    stats.histogram[bucketForLatency(usecs)]++;
+}
+
+QVariantMap Daemon::ApiImpl::Statistics::pluginStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap retn;
+    for (QMap<QString, PluginStatistics>::const_iterator it = m_pluginStatistics.constBegin();
+            it != m_pluginStatistics.constEnd(); ++it) {
+        const PluginStatistics &stats(it.value());
+        QVariantList histogram;
+        for (int i = 0; i < LatencyBucketCount; ++i) {
+            histogram.append(stats.histogram[i]);
+        }
+
+        QVariantMap plugin;
+        plugin.insert(QStringLiteral("calls"), stats.callCount);
+        plugin.insert(QStringLiteral("totalTimeUs"), stats.totalTime);
+        plugin.insert(QStringLiteral("maxTimeUs"), stats.maxTime);
+        plugin.insert(QStringLiteral("averageTimeUs"),
+                      stats.callCount ? stats.totalTime / qint64(stats.callCount) : 0);
+        // buckets: <100us, <1ms, <10ms, <100ms, <1s, >=1s
+        plugin.insert(QStringLiteral("latencyHistogram"), histogram);
+        retn.insert(it.key(), plugin);
+    }
+    return retn;
+}
+
+void Daemon::ApiImpl::Statistics::recordStartupPhase(
+        const QString &phase,
+        qint64 usecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_startupPhases.insert(phase, usecs);
+}
+
+void Daemon::ApiImpl::Statistics::recordPluginStartup(
+        const QString &pluginName,
+        qint64 usecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pluginStartupTimes.insert(pluginName, usecs);
+}
+
+QVariantMap Daemon::ApiImpl::Statistics::startupStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap phases;
+    for (QMap<QString, qint64>::const_iterator it = m_startupPhases.constBegin();
+            it != m_startupPhases.constEnd(); ++it) {
+        phases.insert(it.key(), it.value());
+    }
+    QVariantMap plugins;
+    for (QMap<QString, qint64>::const_iterator it = m_pluginStartupTimes.constBegin();
+            it != m_pluginStartupTimes.constEnd(); ++it) {
+        plugins.insert(it.key(), it.value());
+    }
+
+    // all times are in microseconds.  Phases which have
+    // not yet completed are not included.
+    QVariantMap retn;
+    retn.insert(QStringLiteral("phasesUs"), phases);
+    retn.insert(QStringLiteral("pluginInitializationUs"), plugins);
+    return retn;
+}
+
+qint64 Daemon::ApiImpl::Statistics::uptime() const
+{
+    return m_uptimeTimer.elapsed();
+}
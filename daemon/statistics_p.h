@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_DAEMON_STATISTICS_P_H
+#define SAILFISHSECRETS_DAEMON_STATISTICS_P_H
+
+#include <QtCore/QString>
+#include <QtCore/QMap>
+#include <QtCore/QVariantMap>
+#include <QtCore/QMutex>
+#include <QtCore/QElapsedTimer>
+
+#include "plugin_p.h"
+
+namespace Sailfish {
+
+namespace Secrets {
+
+namespace Daemon {
+
+namespace ApiImpl {
+
+// Collects timing information about calls into the loaded plugins.
+// Calls are made from the plugin thread pools, so all access is
+// serialized by the internal mutex.
+class Statistics
+{
+public:
+    enum LatencyBucket {
+        LatencyUnder100Microseconds = 0,
+        LatencyUnder1Millisecond,
+        LatencyUnder10Milliseconds,
+        LatencyUnder100Milliseconds,
+        LatencyUnder1Second,
+        LatencyOver1Second,
+        LatencyBucketCount
+    };
+
+    static Statistics *instance();
+
+    void recordPluginCall(const QString &pluginName, qint64 usecs);
+    QVariantMap pluginStatistics() const;
+
+    void recordStartupPhase(const QString &phase, qint64 usecs);
+    void recordPluginStartup(const QString &pluginName, qint64 usecs);
+    QVariantMap startupStatistics() const;
+    qint64 uptime() const;
+
+private:
+    struct PluginStatistics {
+        PluginStatistics() : callCount(0), totalTime(0), maxTime(0)
+        {
+            for (int i = 0; i < LatencyBucketCount; ++i) {
+                histogram[i] = 0;
+            }
+        }
+
+        quint64 callCount;
+        qint64 totalTime;
+        qint64 maxTime;
+        quint64 histogram[LatencyBucketCount];
+    };
+
+    Statistics();
+    static LatencyBucket bucketForLatency(qint64 usecs);
+
+    mutable QMutex m_mutex;
+    QMap<QString, PluginStatistics> m_pluginStatistics;
+    QMap<QString, qint64> m_startupPhases;
+    QMap<QString, qint64> m_pluginStartupTimes;
+    QElapsedTimer m_uptimeTimer;
+};
+
+// Records the time spent in a single plugin call into the
+// daemon statistics when it goes out of scope.
+// Requests for a plugin which is still being initialized after daemon
+// startup are held back by the request queues, but calls made on behalf
+// of requests which don't name the plugin (e.g. master-locking every
+// plugin) wait here until it is ready before the call is timed.
+class PluginCallTimer
+{
+public:
+    explicit PluginCallTimer(const QString &pluginName)
+        : m_pluginName(pluginName)
+    {
+        if (!m_pluginName.isEmpty()) {
+            PluginManager::instance()->waitForPluginInitialized(m_pluginName);
+        }
+        m_timer.start();
+    }
+
+    ~PluginCallTimer()
+    {
+        if (!m_pluginName.isEmpty()) {
+            Statistics::instance()->recordPluginCall(m_pluginName, m_timer.nsecsElapsed() / 1000);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(PluginCallTimer)
+    QString m_pluginName;
+    QElapsedTimer m_timer;
+};
+
+} // namespace ApiImpl
+
+} // namespace Daemon
+
+} // namespace Secrets
+
+} // namespace Sailfish
+
+#endif // SAILFISHSECRETS_DAEMON_STATISTICS_P_H
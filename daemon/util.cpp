@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "util_p.h"
+#include "logging_p.h"
+
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <string.h>
+
+char *Sailfish::Secrets::Daemon::ApiImpl::lockedKeyCopy(const QByteArray &key)
+{
+    char *data = static_cast<char*>(malloc(key.size()));
+    if (data) {
+        if (mlock(data, key.size()) < 0) {
+            qCWarning(lcSailfishSecretsDaemon) << "Warning: unable to mlock cached key memory!";
+        }
+        memcpy(data, key.constData(), key.size());
+    }
+    return data;
+}
+
+void Sailfish::Secrets::Daemon::ApiImpl::wipeKey(char *data, int length)
+{
+    if (data) {
+        volatile char *p = data;
+        for (int i = 0; i < length; ++i) {
+            p[i] = 0;
+        }
+        munlock(data, length);
+        free(data);
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_DAEMON_UTIL_P_H
+#define SAILFISHSECRETS_DAEMON_UTIL_P_H
+
+#include <QtCore/QByteArray>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+namespace Daemon {
+
+namespace ApiImpl {
+
+// Returns a copy of the key in mlock()ed memory, which must
+// be released with wipeKey().  Returns null if out of memory.
+char *lockedKeyCopy(const QByteArray &key);
+
+// Overwrites the key copy with zeros before unlocking and freeing it.
+void wipeKey(char *data, int length);
+
+} // namespace ApiImpl
+
+} // namespace Daemon
+
+} // namespace Secrets
+
+} // namespace Sailfish
+
+#endif // SAILFISHSECRETS_DAEMON_UTIL_P_H
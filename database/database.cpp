@@ -64,6 +64,26 @@ static bool finalizeTransaction(QSqlDatabase &database, bool success)
     return false;
 }
 
+static int statementCacheSize()
+{
+    // The prepared statement cache is bounded, as some statements are
+    // constructed per-call (e.g. searches with a variable number of terms).
+    bool ok = false;
+    const int size = qgetenv("SAILFISHSECRETSD_STATEMENT_CACHE_SIZE").toInt(&ok);
+    return ok && size > 0 ? size : 64;
+}
+
+static bool isCacheableStatement(const QString &statement)
+{
+    // PRAGMA statements are never cached: they are executed rarely,
+    // and some of them (e.g. PRAGMA key and PRAGMA rekey) embed key material.
+    int i = 0;
+    while (i < statement.size() && statement.at(i).isSpace()) {
+        ++i;
+    }
+    return statement.midRef(i, 6).compare(QLatin1String("PRAGMA"), Qt::CaseInsensitive) != 0;
+}
+
 static int lengthOf(const char *createStatements[])
 {
     int count = 0;
@@ -108,18 +128,25 @@ static bool executeUpgradeStatements(QSqlDatabase &database,
     int schemaVersion = versionQuery.value(0).toInt();
     versionQuery.finish();
 
+    if (schemaVersion < 1) {
+        qCWarning(lcSailfishSecretsDaemonSqlite) << "Invalid secrets database schema version:" << schemaVersion;
+        return false;
+    }
+
     while (schemaVersion < currentSchemaVersion) {
         qCWarning(lcSailfishSecretsDaemonSqlite) << "Upgrading secrets database from schema version" << schemaVersion;
 
-        if (upgradeVersions[schemaVersion].fn) {
-            if (!(*upgradeVersions[schemaVersion].fn)(database)) {
+        // the first schema version is 1, which is upgraded by the first operation.
+        const UpgradeOperation &upgrade(upgradeVersions[schemaVersion - 1]);
+        if (upgrade.fn) {
+            if (!(*upgrade.fn)(database)) {
                 qCWarning(lcSailfishSecretsDaemonSqlite) << "Unable to update data for schema version" << schemaVersion;
                 return false;
             }
         }
-        if (upgradeVersions[schemaVersion].statements) {
-            for (unsigned i = 0; upgradeVersions[schemaVersion].statements[i]; i++) {
-                if (!execute(database, QLatin1String(upgradeVersions[schemaVersion].statements[i])))
+        if (upgrade.statements) {
+            for (unsigned i = 0; upgrade.statements[i]; i++) {
+                if (!execute(database, QLatin1String(upgrade.statements[i])))
                     return false;
             }
         }
@@ -259,6 +286,9 @@ void Database::Query::reportError(const char *text) const
 Database::Database()
     : m_mutex(QMutex::Recursive)
     , m_localeName(QLocale().name())
+    , m_preparedQueries(statementCacheSize())
+    , m_durability(FullDurability)
+    , m_idleCheckpoints(false)
 {
 }
 
@@ -353,6 +383,12 @@ bool Database::open(
         }
     }
 
+    // the setup statements specify full durability, which may be relaxed.
+    m_durability = FullDurability;
+    if (defaultDurability() != FullDurability && !applyDurability(defaultDurability())) {
+        qCWarning(lcSailfishSecretsDaemonSqlite) << "Failed to apply durability mode to database:" << databaseFile;
+    }
+
     qCDebug(lcSailfishSecretsDaemonSqlite) << "Opened secrets database:" << databaseFile << "Locale:" << m_localeName;
     return true;
 }
@@ -411,7 +447,18 @@ bool Database::commitTransaction()
 {
     int oldSemaphoreValue = m_transactionSemaphore.fetchAndAddAcquire(-1);
     if (oldSemaphoreValue == 1) {
-        return ::commitTransaction(m_database);
+        if (!::commitTransaction(m_database)) {
+            // a failed COMMIT may leave the transaction open, holding its
+            // locks and absorbing the next transaction, so roll it back.
+            if (!::rollbackTransaction(m_database)) {
+                qCWarning(lcSailfishSecretsDaemonSqlite) << "Failed to roll back transaction after failed commit";
+            }
+            return false;
+        }
+        if (m_idleCheckpoints && m_durability != FullDurability) {
+            m_checkpointPending.storeRelease(1);
+        }
+        return true;
     } else if (oldSemaphoreValue == 0) {
         // this is always an error in sailfishsecretsd code.
         qCWarning(lcSailfishSecretsDaemonSqlite) << "Invalid semaphore value - commitTransaction called without beginTransaction!";
@@ -446,21 +493,114 @@ Database::Query Database::prepare(const QString &statement, QString *errorText)
 {
     QMutexLocker locker(accessMutex());
 
-    QHash<QString, QSqlQuery>::const_iterator it = m_preparedQueries.constFind(statement);
-    if (it == m_preparedQueries.constEnd()) {
-        QSqlQuery query(m_database);
-        query.setForwardOnly(true);
-        if (!query.prepare(statement)) {
-            qCWarning(lcSailfishSecretsDaemonSqlite) << QString::fromLatin1("Failed to prepare query: %1\n%2")
-                    .arg(query.lastError().text())
-                    .arg(statement);
-            *errorText = query.lastError().text();
-            return Query(QSqlQuery());
+    QElapsedTimer lookupTimer;
+    lookupTimer.start();
+
+    const bool cacheable = isCacheableStatement(statement);
+    if (cacheable) {
+        if (QSqlQuery *cached = m_preparedQueries.object(statement)) {
+            m_statementCacheStatistics.hits++;
+            m_statementCacheStatistics.lookupTime += lookupTimer.nsecsElapsed();
+            return Query(*cached);
         }
-        it = m_preparedQueries.insert(statement, query);
+        m_statementCacheStatistics.misses++;
+    } else {
+        m_statementCacheStatistics.uncached++;
+    }
+    m_statementCacheStatistics.lookupTime += lookupTimer.nsecsElapsed();
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.prepare(statement)) {
+        qCWarning(lcSailfishSecretsDaemonSqlite) << QString::fromLatin1("Failed to prepare query: %1\n%2")
+                .arg(query.lastError().text())
+                .arg(cacheable ? statement : QStringLiteral("PRAGMA"));
+        *errorText = query.lastError().text();
+        return Query(QSqlQuery());
+    }
+
+    if (cacheable) {
+        if (m_preparedQueries.size() >= m_preparedQueries.maxCost()) {
+            m_statementCacheStatistics.evictions++;
+        }
+        m_preparedQueries.insert(statement, new QSqlQuery(query));
+    }
+
+    return Query(query);
+}
+
+Database::Durability Database::defaultDurability()
+{
+    static const Durability durability = qgetenv("SAILFISHSECRETSD_DURABILITY").toLower() == "normal"
+            ? NormalDurability
+            : FullDurability;
+    return durability;
+}
+
+bool Database::applyDurability(Durability durability)
+{
+    static const char *synchronousModes[] = { "FULL", "NORMAL" };
+
+    // SQLite checkpoints the WAL automatically, inline with the commit
+    // which makes it grow too large, unless the owner of the database
+    // checkpoints it when idle.
+    const bool automaticCheckpoints = durability == FullDurability
+            || (durability == NormalDurability && !m_idleCheckpoints);
+    if (!::execute(m_database, QString::fromLatin1("PRAGMA synchronous = %1")
+                   .arg(QLatin1String(synchronousModes[durability])))
+            || !::execute(m_database, QString::fromLatin1("PRAGMA wal_autocheckpoint = %1")
+                          .arg(automaticCheckpoints ? 1000 : 0))) {
+        return false;
+    }
+
+    m_durability = durability;
+    return true;
+}
+
+void Database::enableIdleCheckpoints()
+{
+    QMutexLocker locker(accessMutex());
+
+    m_idleCheckpoints = true;
+    if (m_database.isOpen() && !withinTransaction()) {
+        applyDurability(m_durability);
+    }
+}
+
+bool Database::checkpointPending() const
+{
+    return m_checkpointPending.loadAcquire() != 0;
+}
+
+bool Database::checkpoint()
+{
+    QMutexLocker locker(accessMutex());
+
+    if (!m_database.isOpen() || withinTransaction()) {
+        return false;
     }
 
-    return Query(*it);
+    m_checkpointPending.storeRelease(0);
+    return ::execute(m_database, QString::fromLatin1("PRAGMA wal_checkpoint(PASSIVE)"));
+}
+
+QVariantMap Database::statementCacheStatistics() const
+{
+    QMutexLocker locker(accessMutex());
+
+    const quint64 lookups = m_statementCacheStatistics.hits
+                          + m_statementCacheStatistics.misses
+                          + m_statementCacheStatistics.uncached;
+    QVariantMap retn;
+    retn.insert(QStringLiteral("cachedStatements"), m_preparedQueries.size());
+    retn.insert(QStringLiteral("capacity"), m_preparedQueries.maxCost());
+    retn.insert(QStringLiteral("hits"), m_statementCacheStatistics.hits);
+    retn.insert(QStringLiteral("misses"), m_statementCacheStatistics.misses);
+    retn.insert(QStringLiteral("evictions"), m_statementCacheStatistics.evictions);
+    retn.insert(QStringLiteral("uncached"), m_statementCacheStatistics.uncached);
+    retn.insert(QStringLiteral("averageLookupNs"),
+                lookups ? m_statementCacheStatistics.lookupTime / qint64(lookups) : 0);
+    return retn;
 }
 
 bool Database::execute(QSqlQuery &query, QString *errorText)
@@ -586,3 +726,43 @@ DatabaseLocker::~DatabaseLocker()
         }
     }
 }
+
+QString Sailfish::Secrets::Daemon::Sqlite::filterMatchKey(const QString &value)
+{
+    return value.isNull() ? QString(QLatin1String("")) : value.toCaseFolded();
+}
+
+bool Sailfish::Secrets::Daemon::Sqlite::upgradeFilterDataMatchKeys(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (!query.exec(QStringLiteral("ALTER TABLE SecretsFilterData ADD COLUMN FieldKey TEXT NOT NULL DEFAULT ''"))
+            || !query.exec(QStringLiteral("ALTER TABLE SecretsFilterData ADD COLUMN ValueKey TEXT NOT NULL DEFAULT ''"))
+            || !query.exec(QStringLiteral("SELECT rowid, Field, Value FROM SecretsFilterData"))) {
+        qCWarning(lcSailfishSecretsDaemonSqlite) << "Unable to add filter data match keys:" << query.lastError();
+        return false;
+    }
+
+    QList<QVariantList> rows;
+    while (query.next()) {
+        rows.append(QVariantList() << query.value(0) << query.value(1) << query.value(2));
+    }
+    query.finish();
+
+    QSqlQuery updateQuery(database);
+    if (!updateQuery.prepare(QStringLiteral("UPDATE SecretsFilterData"
+                                            " SET FieldKey = ?, ValueKey = ?"
+                                            " WHERE rowid = ?"))) {
+        qCWarning(lcSailfishSecretsDaemonSqlite) << "Unable to prepare filter data match key update:" << updateQuery.lastError();
+        return false;
+    }
+    for (const QVariantList &row : rows) {
+        updateQuery.bindValue(0, filterMatchKey(row.at(1).toString()));
+        updateQuery.bindValue(1, filterMatchKey(row.at(2).toString()));
+        updateQuery.bindValue(2, row.at(0));
+        if (!updateQuery.exec()) {
+            qCWarning(lcSailfishSecretsDaemonSqlite) << "Unable to update filter data match keys:" << updateQuery.lastError();
+            return false;
+        }
+    }
+    return true;
+}
@@ -17,6 +17,7 @@
 #include <QtCore/QVariant>
 #include <QtCore/QString>
 #include <QtCore/QHash>
+#include <QtCore/QCache>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QAtomicInt>
@@ -33,6 +34,8 @@ namespace Daemon {
 
 namespace Sqlite {
 
+// upgradeVersions[n] upgrades a database from schema version n + 1
+// (the first schema version), and the array is terminated by { 0, 0 }.
 typedef bool (*UpgradeFunction)(QSqlDatabase &database);
 struct UpgradeOperation {
     UpgradeFunction fn;
@@ -82,6 +85,14 @@ public:
         QString executedQuery() const { return m_query.executedQuery(); }
     };
 
+    // The durability of committed transactions.  With FullDurability
+    // every commit is synced to disk, with NormalDurability only
+    // checkpoints are synced.
+    enum Durability {
+        FullDurability = 0,
+        NormalDurability
+    };
+
     Database();
     ~Database();
 
@@ -120,12 +131,34 @@ public:
     static QString expandQuery(const QString &queryString, const QMap<QString, QVariant> &bindings);
     static QString expandQuery(const QSqlQuery &query);
 
+    QVariantMap statementCacheStatistics() const;
+
+    static Durability defaultDurability();
+    void enableIdleCheckpoints();
+    bool checkpointPending() const;
+    bool checkpoint();
+
 private:
+    bool applyDurability(Durability durability);
+
+    struct StatementCacheStatistics {
+        StatementCacheStatistics() : hits(0), misses(0), evictions(0), uncached(0), lookupTime(0) {}
+        quint64 hits;
+        quint64 misses;
+        quint64 evictions;
+        quint64 uncached;
+        qint64 lookupTime;
+    };
+
     QSqlDatabase m_database;
     QMutex m_mutex;
     QString m_localeName;
-    mutable QHash<QString, QSqlQuery> m_preparedQueries;
+    mutable QCache<QString, QSqlQuery> m_preparedQueries;
+    mutable StatementCacheStatistics m_statementCacheStatistics;
     QAtomicInt m_transactionSemaphore;
+    QAtomicInt m_checkpointPending;
+    Durability m_durability;
+    bool m_idleCheckpoints;
 };
 
 class DatabaseLocker : public QMutexLocker
@@ -139,6 +172,15 @@ private:
     Sailfish::Secrets::Daemon::Sqlite::Database *m_db;
 };
 
+// Filter data is matched case-insensitively.  The case-folded field and
+// value are stored alongside the original, so that the match can be
+// performed (and indexed) by the database rather than in memory.
+QString filterMatchKey(const QString &value);
+
+// Adds the case-folded FieldKey and ValueKey columns to the SecretsFilterData
+// table of a database created before they existed, and fills them in.
+bool upgradeFilterDataMatchKeys(QSqlDatabase &database);
+
 } // namespace Sqlite
 
 } // namespace Daemon
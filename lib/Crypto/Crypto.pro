@@ -12,6 +12,7 @@ INCLUDEPATH += $$PWD/../
 DEPENDPATH += $$INCLUDEPATH $$PWD
 
 PUBLIC_HEADERS += \
+    $$PWD/batchrequest.h \
     $$PWD/calculatedigestrequest.h \
     $$PWD/cipherrequest.h \
     $$PWD/cryptoglobal.h \
@@ -42,9 +43,11 @@ PUBLIC_HEADERS += \
 
 INTERNAL_PUBLIC_HEADERS += \
     $$PWD/cryptodaemonconnection_p.h \
+    $$PWD/payloadtransfer_p.h \
     $$PWD/serialization_p.h
 
 PRIVATE_HEADERS += \
+    $$PWD/batchrequest_p.h \
     $$PWD/calculatedigestrequest_p.h \
     $$PWD/cipherrequest_p.h \
     $$PWD/cryptodaemonconnection_p_p.h \
@@ -78,6 +81,7 @@ HEADERS += \
     $$PRIVATE_HEADERS
 
 SOURCES += \
+    $$PWD/batchrequest.cpp \
     $$PWD/calculatedigestrequest.cpp \
     $$PWD/cipherrequest.cpp \
     $$PWD/cryptodaemonconnection.cpp \
@@ -96,6 +100,7 @@ SOURCES += \
     $$PWD/keyderivationparameters.cpp \
     $$PWD/keypairgenerationparameters.cpp \
     $$PWD/lockcoderequest.cpp \
+    $$PWD/payloadtransfer.cpp \
     $$PWD/plugininfo.cpp \
     $$PWD/plugininforequest.cpp \
     $$PWD/request.cpp \
@@ -26,7 +26,9 @@
 #include <QtCore/QSharedDataPointer>
 #include <QtCore/QLoggingCategory>
 
-#define Sailfish_Crypto_CryptoPlugin_IID "org.sailfishos.crypto.CryptoPlugin/1.0"
+// Version 2.0 follows the Secrets plugin interfaces, as CryptoPlugin
+// shares their PluginBase virtual base.
+#define Sailfish_Crypto_CryptoPlugin_IID "org.sailfishos.crypto.CryptoPlugin/2.0"
 
 SAILFISH_CRYPTO_API Q_DECLARE_LOGGING_CATEGORY(lcSailfishCryptoPlugin)
 
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "Crypto/batchrequest.h"
+#include "Crypto/batchrequest_p.h"
+
+#include "Crypto/cryptomanager.h"
+#include "Crypto/cryptomanager_p.h"
+#include "Crypto/serialization_p.h"
+
+#include <QtDBus/QDBusPendingReply>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+using namespace Sailfish::Crypto;
+
+BatchRequestPrivate::BatchRequestPrivate()
+    : m_padding(CryptoManager::SignaturePaddingUnknown)
+    , m_digestFunction(CryptoManager::DigestUnknown)
+    , m_status(Request::Inactive)
+{
+}
+
+/*!
+  \class BatchRequest
+  \brief Allows a client request the system crypto service to perform many sign, verify or digest operations in a single request
+  \inmodule SailfishCrypto
+
+  Each operation added to the batch is equivalent to a separate
+  \l{SignRequest}, \l{VerifyRequest} or \l{CalculateDigestRequest}
+  which uses the key(), padding(), digestFunction() and cryptoPluginName()
+  of the batch.  The whole batch is sent to the crypto service in a
+  single round trip and is performed by the service as a single request,
+  which avoids the per-request overhead when an application needs to
+  sign or verify a large number of blobs of data.
+
+  The operations are performed in the order in which they were added,
+  and the result of each operation is reported in the corresponding
+  element of results().  The output of each sign or digest operation
+  is reported in the corresponding element of outputs(), and the
+  status of each verify operation in the corresponding element of
+  verificationStatuses().  The result() of the batch itself will only
+  be \c Failed if the batch as a whole could not be performed.
+ */
+
+/*!
+  \brief Constructs a new BatchRequest object with the given \a parent.
+ */
+BatchRequest::BatchRequest(QObject *parent)
+    : Request(parent)
+    , d_ptr(new BatchRequestPrivate)
+{
+}
+
+/*!
+  \brief Destroys the BatchRequest
+ */
+BatchRequest::~BatchRequest()
+{
+}
+
+void BatchRequest::addOperation(BatchRequest::OperationType type, const QByteArray &data, const QByteArray &signature)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active) {
+        d->m_operations.append(static_cast<int>(type));
+        d->m_data.append(data);
+        d->m_signatures.append(signature);
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit operationsChanged();
+    }
+}
+
+/*!
+  \brief Adds an operation to the batch which will sign the given \a data with the key()
+ */
+void BatchRequest::addSignOperation(const QByteArray &data)
+{
+    addOperation(SignOperation, data, QByteArray());
+}
+
+/*!
+  \brief Adds an operation to the batch which will verify that the given \a signature was generated for the given \a data with the key()
+ */
+void BatchRequest::addVerifyOperation(const QByteArray &signature, const QByteArray &data)
+{
+    addOperation(VerifyOperation, data, signature);
+}
+
+/*!
+  \brief Adds an operation to the batch which will calculate the digest of the given \a data
+ */
+void BatchRequest::addCalculateDigestOperation(const QByteArray &data)
+{
+    addOperation(CalculateDigestOperation, data, QByteArray());
+}
+
+/*!
+  \brief Removes all of the operations from the batch
+ */
+void BatchRequest::clearOperations()
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && !d->m_operations.isEmpty()) {
+        d->m_operations.clear();
+        d->m_data.clear();
+        d->m_signatures.clear();
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit operationsChanged();
+    }
+}
+
+/*!
+  \brief Returns the number of operations in the batch
+ */
+int BatchRequest::operationCount() const
+{
+    Q_D(const BatchRequest);
+    return d->m_operations.size();
+}
+
+/*!
+  \brief Returns the type of the operation at the given \a index in the batch
+ */
+BatchRequest::OperationType BatchRequest::operationType(int index) const
+{
+    Q_D(const BatchRequest);
+    return static_cast<BatchRequest::OperationType>(d->m_operations.value(index));
+}
+
+/*!
+  \brief Returns the key which the client wishes the system service to use for the sign and verify operations
+ */
+Key BatchRequest::key() const
+{
+    Q_D(const BatchRequest);
+    return d->m_key;
+}
+
+/*!
+  \brief Sets the key which the client wishes the system service to use for the sign and verify operations to \a key
+ */
+void BatchRequest::setKey(const Key &key)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && d->m_key != key) {
+        d->m_key = key;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit keyChanged();
+    }
+}
+
+/*!
+  \brief Returns the signature padding mode which should be used by the operations
+ */
+Sailfish::Crypto::CryptoManager::SignaturePadding BatchRequest::padding() const
+{
+    Q_D(const BatchRequest);
+    return d->m_padding;
+}
+
+/*!
+  \brief Sets the signature padding mode which should be used by the operations to \a padding
+ */
+void BatchRequest::setPadding(Sailfish::Crypto::CryptoManager::SignaturePadding padding)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && d->m_padding != padding) {
+        d->m_padding = padding;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit paddingChanged();
+    }
+}
+
+/*!
+  \brief Returns the digest which should be used by the operations
+ */
+Sailfish::Crypto::CryptoManager::DigestFunction BatchRequest::digestFunction() const
+{
+    Q_D(const BatchRequest);
+    return d->m_digestFunction;
+}
+
+/*!
+  \brief Sets the digest which should be used by the operations to \a digestFn
+ */
+void BatchRequest::setDigestFunction(Sailfish::Crypto::CryptoManager::DigestFunction digestFn)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && d->m_digestFunction != digestFn) {
+        d->m_digestFunction = digestFn;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit digestFunctionChanged();
+    }
+}
+
+/*!
+  \brief Returns the name of the crypto plugin which the client wishes to perform the operations
+ */
+QString BatchRequest::cryptoPluginName() const
+{
+    Q_D(const BatchRequest);
+    return d->m_cryptoPluginName;
+}
+
+/*!
+  \brief Sets the name of the crypto plugin which the client wishes to perform the operations to \a pluginName
+ */
+void BatchRequest::setCryptoPluginName(const QString &pluginName)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && d->m_cryptoPluginName != pluginName) {
+        d->m_cryptoPluginName = pluginName;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit cryptoPluginNameChanged();
+    }
+}
+
+/*!
+  \brief Returns the results of the operations in the batch, in the order in which they were added
+
+  Note: this value is only valid if the status of the request is Request::Finished.
+ */
+QVector<Result> BatchRequest::results() const
+{
+    Q_D(const BatchRequest);
+    return d->m_results;
+}
+
+/*!
+  \brief Returns the signatures and digests generated by the operations in the batch, in the order in which they were added
+
+  The elements which correspond to a \c VerifyOperation will be empty.
+
+  Note: this value is only valid if the status of the request is Request::Finished.
+ */
+QVector<QByteArray> BatchRequest::outputs() const
+{
+    Q_D(const BatchRequest);
+    return d->m_outputs;
+}
+
+/*!
+  \brief Returns the verification statuses of the operations in the batch, in the order in which they were added
+
+  The elements which do not correspond to a \c VerifyOperation will be
+  \c VerificationStatusUnknown.
+
+  Note: this value is only valid if the status of the request is Request::Finished.
+ */
+QVector<CryptoManager::VerificationStatus> BatchRequest::verificationStatuses() const
+{
+    Q_D(const BatchRequest);
+    return d->m_verificationStatuses;
+}
+
+Request::Status BatchRequest::status() const
+{
+    Q_D(const BatchRequest);
+    return d->m_status;
+}
+
+Result BatchRequest::result() const
+{
+    Q_D(const BatchRequest);
+    return d->m_result;
+}
+
+QVariantMap BatchRequest::customParameters() const
+{
+    Q_D(const BatchRequest);
+    return d->m_customParameters;
+}
+
+void BatchRequest::setCustomParameters(const QVariantMap &params)
+{
+    Q_D(BatchRequest);
+    if (d->m_customParameters != params) {
+        d->m_customParameters = params;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit customParametersChanged();
+    }
+}
+
+CryptoManager *BatchRequest::manager() const
+{
+    Q_D(const BatchRequest);
+    return d->m_manager.data();
+}
+
+void BatchRequest::setManager(CryptoManager *manager)
+{
+    Q_D(BatchRequest);
+    if (d->m_manager.data() != manager) {
+        d->m_manager = manager;
+        emit managerChanged();
+    }
+}
+
+static QVector<CryptoManager::VerificationStatus> toVerificationStatuses(const QVector<int> &statuses)
+{
+    QVector<CryptoManager::VerificationStatus> retn;
+    retn.reserve(statuses.size());
+    for (int status : statuses) {
+        retn.append(static_cast<CryptoManager::VerificationStatus>(status));
+    }
+    return retn;
+}
+
+void BatchRequest::startRequest()
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && !d->m_manager.isNull()) {
+        d->m_status = Request::Active;
+        emit statusChanged();
+        if (d->m_result.code() != Result::Pending) {
+            d->m_result = Result(Result::Pending);
+            emit resultChanged();
+        }
+
+        QDBusPendingReply<Result, QVector<Result>, QVector<QByteArray>, QVector<int> > reply =
+                d->m_manager->d_ptr->batch(d->m_operations,
+                                           d->m_data,
+                                           d->m_signatures,
+                                           d->m_key,
+                                           d->m_padding,
+                                           d->m_digestFunction,
+                                           d->m_customParameters,
+                                           d->m_cryptoPluginName);
+        if (!reply.isValid() && !reply.error().message().isEmpty()) {
+            d->m_status = Request::Finished;
+            d->m_result = Result(Result::CryptoManagerNotInitializedError,
+                                 reply.error().message());
+            d->m_results.clear();
+            d->m_outputs.clear();
+            d->m_verificationStatuses.clear();
+            emit statusChanged();
+            emit resultChanged();
+            emit resultsChanged();
+        } else if (reply.isFinished()
+                // work around a bug in QDBusAbstractInterface / QDBusConnection...
+                && reply.argumentAt<0>().code() != Sailfish::Crypto::Result::Succeeded) {
+            d->m_status = Request::Finished;
+            d->m_result = reply.argumentAt<0>();
+            d->m_results = reply.argumentAt<1>();
+            d->m_outputs = reply.argumentAt<2>();
+            d->m_verificationStatuses = toVerificationStatuses(reply.argumentAt<3>());
+            emit statusChanged();
+            emit resultChanged();
+            emit resultsChanged();
+        } else {
+            d->m_watcher.reset(new QDBusPendingCallWatcher(reply));
+            connect(d->m_watcher.data(), &QDBusPendingCallWatcher::finished,
+                    [this] {
+                QDBusPendingCallWatcher *watcher = this->d_ptr->m_watcher.take();
+                QDBusPendingReply<Result, QVector<Result>, QVector<QByteArray>, QVector<int> > reply = *watcher;
+                this->d_ptr->m_status = Request::Finished;
+                if (reply.isError()) {
+                    this->d_ptr->m_result = Result(Result::DaemonError,
+                                                   reply.error().message());
+                    this->d_ptr->m_results.clear();
+                    this->d_ptr->m_outputs.clear();
+                    this->d_ptr->m_verificationStatuses.clear();
+                } else {
+                    this->d_ptr->m_result = reply.argumentAt<0>();
+                    this->d_ptr->m_results = reply.argumentAt<1>();
+                    this->d_ptr->m_outputs = reply.argumentAt<2>();
+                    this->d_ptr->m_verificationStatuses = toVerificationStatuses(reply.argumentAt<3>());
+                }
+                watcher->deleteLater();
+                emit this->statusChanged();
+                emit this->resultChanged();
+                emit this->resultsChanged();
+            });
+        }
+    }
+}
+
+void BatchRequest::waitForFinished()
+{
+    Q_D(BatchRequest);
+    if (d->m_status == Request::Active && !d->m_watcher.isNull()) {
+        d->m_watcher->waitForFinished();
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHCRYPTO_BATCHREQUEST_H
+#define LIBSAILFISHCRYPTO_BATCHREQUEST_H
+
+#include "Crypto/cryptoglobal.h"
+#include "Crypto/request.h"
+#include "Crypto/key.h"
+#include "Crypto/cryptomanager.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+namespace Sailfish {
+
+namespace Crypto {
+
+class BatchRequestPrivate;
+class SAILFISH_CRYPTO_API BatchRequest : public Sailfish::Crypto::Request
+{
+    Q_OBJECT
+    Q_PROPERTY(int operationCount READ operationCount NOTIFY operationsChanged)
+    Q_PROPERTY(Sailfish::Crypto::Key key READ key WRITE setKey NOTIFY keyChanged)
+    Q_PROPERTY(Sailfish::Crypto::CryptoManager::SignaturePadding padding READ padding WRITE setPadding NOTIFY paddingChanged)
+    Q_PROPERTY(Sailfish::Crypto::CryptoManager::DigestFunction digestFunction READ digestFunction WRITE setDigestFunction NOTIFY digestFunctionChanged)
+    Q_PROPERTY(QString cryptoPluginName READ cryptoPluginName WRITE setCryptoPluginName NOTIFY cryptoPluginNameChanged)
+
+public:
+    enum OperationType {
+        SignOperation = 0,
+        VerifyOperation,
+        CalculateDigestOperation
+    };
+    Q_ENUM(OperationType)
+
+    BatchRequest(QObject *parent = Q_NULLPTR);
+    ~BatchRequest();
+
+    void addSignOperation(const QByteArray &data);
+    void addVerifyOperation(const QByteArray &signature, const QByteArray &data);
+    void addCalculateDigestOperation(const QByteArray &data);
+    void clearOperations();
+
+    int operationCount() const;
+    Sailfish::Crypto::BatchRequest::OperationType operationType(int index) const;
+
+    Sailfish::Crypto::Key key() const;
+    void setKey(const Sailfish::Crypto::Key &key);
+
+    Sailfish::Crypto::CryptoManager::SignaturePadding padding() const;
+    void setPadding(Sailfish::Crypto::CryptoManager::SignaturePadding padding);
+
+    Sailfish::Crypto::CryptoManager::DigestFunction digestFunction() const;
+    void setDigestFunction(Sailfish::Crypto::CryptoManager::DigestFunction digest);
+
+    QString cryptoPluginName() const;
+    void setCryptoPluginName(const QString &pluginName);
+
+    QVector<Sailfish::Crypto::Result> results() const;
+    QVector<QByteArray> outputs() const;
+    QVector<Sailfish::Crypto::CryptoManager::VerificationStatus> verificationStatuses() const;
+
+    Sailfish::Crypto::Request::Status status() const Q_DECL_OVERRIDE;
+    Sailfish::Crypto::Result result() const Q_DECL_OVERRIDE;
+
+    QVariantMap customParameters() const Q_DECL_OVERRIDE;
+    void setCustomParameters(const QVariantMap &params) Q_DECL_OVERRIDE;
+
+    Sailfish::Crypto::CryptoManager *manager() const Q_DECL_OVERRIDE;
+    void setManager(Sailfish::Crypto::CryptoManager *manager) Q_DECL_OVERRIDE;
+
+    void startRequest() Q_DECL_OVERRIDE;
+    void waitForFinished() Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void operationsChanged();
+    void keyChanged();
+    void paddingChanged();
+    void digestFunctionChanged();
+    void cryptoPluginNameChanged();
+    void resultsChanged();
+
+private:
+    void addOperation(Sailfish::Crypto::BatchRequest::OperationType type, const QByteArray &data, const QByteArray &signature);
+
+    QScopedPointer<BatchRequestPrivate> const d_ptr;
+    Q_DECLARE_PRIVATE(BatchRequest)
+};
+
+} // namespace Crypto
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHCRYPTO_BATCHREQUEST_H
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHCRYPTO_BATCHREQUEST_P_H
+#define LIBSAILFISHCRYPTO_BATCHREQUEST_P_H
+
+#include "Crypto/cryptoglobal.h"
+#include "Crypto/batchrequest.h"
+#include "Crypto/cryptomanager.h"
+
+#include <QtCore/QPointer>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <QtDBus/QDBusPendingCallWatcher>
+
+namespace Sailfish {
+
+namespace Crypto {
+
+class BatchRequestPrivate
+{
+    Q_DISABLE_COPY(BatchRequestPrivate)
+
+public:
+    explicit BatchRequestPrivate();
+
+    QPointer<Sailfish::Crypto::CryptoManager> m_manager;
+    QVariantMap m_customParameters;
+    QVector<int> m_operations;
+    QVector<QByteArray> m_data;
+    QVector<QByteArray> m_signatures;
+    Sailfish::Crypto::Key m_key;
+    Sailfish::Crypto::CryptoManager::SignaturePadding m_padding;
+    Sailfish::Crypto::CryptoManager::DigestFunction m_digestFunction;
+    QString m_cryptoPluginName;
+    QVector<Sailfish::Crypto::Result> m_results;
+    QVector<QByteArray> m_outputs;
+    QVector<Sailfish::Crypto::CryptoManager::VerificationStatus> m_verificationStatuses;
+
+    QScopedPointer<QDBusPendingCallWatcher> m_watcher;
+    Sailfish::Crypto::Request::Status m_status;
+    Sailfish::Crypto::Result m_result;
+};
+
+} // namespace Crypto
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHCRYPTO_BATCHREQUEST_P_H
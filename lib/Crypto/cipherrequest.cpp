@@ -14,6 +14,7 @@
 
 #include <QtDBus/QDBusPendingReply>
 #include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 using namespace Sailfish::Crypto;
 
@@ -23,6 +24,8 @@ CipherRequestPrivate::CipherRequestPrivate()
     , m_encryptionPadding(CryptoManager::EncryptionPaddingNone)
     , m_signaturePadding(CryptoManager::SignaturePaddingNone)
     , m_digestFunction(CryptoManager::DigestSha256)
+    , m_inputFileDescriptor(-1)
+    , m_outputFileDescriptor(-1)
     , m_cipherSessionToken(0)
     , m_verificationStatus(Sailfish::Crypto::CryptoManager::VerificationStatusUnknown)
     , m_status(Request::Inactive)
@@ -177,6 +180,62 @@ CipherRequest::CipherMode CipherRequest::cipherMode() const
   operation() was CryptoManager::OperationEncrypt, CryptoManager::OperationDecrypt,
   CryptoManager::Sign, or CryptoManager::Verify or CryptoManager::OperationDecrypt
   with BlockModeGcm respectively.
+
+  If \a mode is CipherRequest::StreamCipher then the system crypto service
+  will read data from the inputFileDescriptor() and update the cipher
+  session with it until the end of the input is reached (for example,
+  when the client closes the write end of a pipe), writing the data
+  generated by each update to the outputFileDescriptor() as it becomes
+  available, and will then finalize the cipher session.  The data() is
+  used as the finalization input (for example, the authentication tag
+  when decrypting using BlockModeGcm), and when the request is finished
+  the generatedData() and verificationStatus() will contain the
+  finalization output.  This avoids the overhead of a separate request
+  for each chunk of data, and so should be preferred when operating on
+  large amounts of data:
+
+  \code
+  // Initialize the cipher as above, then stream the input file through it.
+  QFile input(plaintextFilePath), output(ciphertextFilePath);
+  input.open(QIODevice::ReadOnly);
+  output.open(QIODevice::WriteOnly);
+  cr.setCipherMode(CipherRequest::StreamCipher);
+  cr.setInputFileDescriptor(input.handle());
+  cr.setOutputFileDescriptor(output.handle());
+  cr.startRequest();
+  cr.waitForFinished();
+  output.write(cr.generatedData());
+  \endcode
+
+  Note that if a pipe or socket is used for either stream, the client must
+  write the input and read the output concurrently (rather than waiting for
+  the request to finish), otherwise the stream may stall once its buffers
+  are full.
+
+  A cipher session may also calculate a digest (with
+  CryptoManager::OperationCalculateDigest, for which no key is required)
+  or an HMAC (with CryptoManager::OperationCalculateMac and a key whose
+  secretKey() is the HMAC key) of data which is supplied incrementally,
+  using the digestFunction().  Updates produce no data, and the digest or
+  HMAC is the generatedData() of the finalization.  Streaming a large file
+  through such a session calculates its digest in constant memory; the
+  output stream is not written to, but must still be valid (for example,
+  opened on /dev/null):
+
+  \code
+  cr.setCipherMode(CipherRequest::InitializeCipher);
+  cr.setOperation(Sailfish::Crypto::CryptoManager::OperationCalculateDigest);
+  cr.setDigestFunction(Sailfish::Crypto::CryptoManager::DigestSha2_256);
+  cr.startRequest();
+  cr.waitForFinished();
+
+  cr.setCipherMode(CipherRequest::StreamCipher);
+  cr.setInputFileDescriptor(input.handle());
+  cr.setOutputFileDescriptor(devNull.handle());
+  cr.startRequest();
+  cr.waitForFinished();
+  QByteArray digest = cr.generatedData();
+  \endcode
  */
 void CipherRequest::setCipherMode(CipherRequest::CipherMode mode)
 {
@@ -432,6 +491,64 @@ void CipherRequest::setCryptoPluginName(const QString &pluginName)
     }
 }
 
+/*!
+  \brief Returns the file descriptor from which data is read when streaming the cipher session
+ */
+int CipherRequest::inputFileDescriptor() const
+{
+    Q_D(const CipherRequest);
+    return d->m_inputFileDescriptor;
+}
+
+/*!
+  \brief Sets the file descriptor from which data is read when streaming the cipher session to \a fd
+
+  This file descriptor is only used if the cipher mode is
+  \l{CipherRequest::StreamCipher}.  The file descriptor remains owned by
+  the client, and must remain open until the request is finished.
+ */
+void CipherRequest::setInputFileDescriptor(int fd)
+{
+    Q_D(CipherRequest);
+    if (d->m_status != Request::Active && d->m_inputFileDescriptor != fd) {
+        d->m_inputFileDescriptor = fd;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit inputFileDescriptorChanged();
+    }
+}
+
+/*!
+  \brief Returns the file descriptor to which generated data is written when streaming the cipher session
+ */
+int CipherRequest::outputFileDescriptor() const
+{
+    Q_D(const CipherRequest);
+    return d->m_outputFileDescriptor;
+}
+
+/*!
+  \brief Sets the file descriptor to which generated data is written when streaming the cipher session to \a fd
+
+  This file descriptor is only used if the cipher mode is
+  \l{CipherRequest::StreamCipher}.  The file descriptor remains owned by
+  the client, and must remain open until the request is finished.
+ */
+void CipherRequest::setOutputFileDescriptor(int fd)
+{
+    Q_D(CipherRequest);
+    if (d->m_status != Request::Active && d->m_outputFileDescriptor != fd) {
+        d->m_outputFileDescriptor = fd;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit outputFileDescriptorChanged();
+    }
+}
+
 /*!
   \brief Returns the generated data result of the cipher operation.
 
@@ -680,7 +797,7 @@ void CipherRequest::startRequest()
                     });
                 }
             }
-        } else {
+        } else if (d->m_cipherMode == CipherRequest::FinalizeCipher) {
             if (d->m_cipherSessionToken == 0) {
                 qWarning() << "Ignoring attempt to finalize uninitialized cipher session!";
             } else {
@@ -758,6 +875,77 @@ void CipherRequest::startRequest()
                     });
                 }
             }
+        } else {
+            if (d->m_cipherSessionToken == 0) {
+                qWarning() << "Ignoring attempt to stream uninitialized cipher session!";
+            } else if (d->m_inputFileDescriptor < 0 || d->m_outputFileDescriptor < 0) {
+                d->m_status = Request::Finished;
+                d->m_result = Result(Result::CryptoPluginCipherSessionError,
+                                     QStringLiteral("Invalid input or output file descriptor for cipher stream"));
+                emit statusChanged();
+                emit resultChanged();
+            } else {
+                QDBusPendingReply<Result, QByteArray, CryptoManager::VerificationStatus> reply =
+                        d->m_manager->d_ptr->streamCipherSession(
+                                QDBusUnixFileDescriptor(d->m_inputFileDescriptor),
+                                QDBusUnixFileDescriptor(d->m_outputFileDescriptor),
+                                d->m_data,
+                                d->m_customParameters,
+                                d->m_cryptoPluginName,
+                                d->m_cipherSessionToken);
+                if (!reply.isValid() && !reply.error().message().isEmpty()) {
+                    d->m_status = Request::Finished;
+                    d->m_result = Result(Result::CryptoManagerNotInitializedError,
+                                         reply.error().message());
+                    emit statusChanged();
+                    emit resultChanged();
+                } else if (reply.isFinished()
+                        // work around a bug in QDBusAbstractInterface / QDBusConnection...
+                        && reply.argumentAt<0>().code() != Sailfish::Crypto::Result::Succeeded) {
+                    d->m_status = Request::Finished;
+                    d->m_result = reply.argumentAt<0>();
+                    emit statusChanged();
+                    emit resultChanged();
+                } else {
+                    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply);
+                    d->m_watcherQueue.enqueue(watcher);
+                    connect(watcher, &QDBusPendingCallWatcher::finished,
+                            [this] {
+                        QDBusPendingCallWatcher *watcher = this->d_ptr->m_watcherQueue.dequeue();
+                        QDBusPendingReply<Result, QByteArray, CryptoManager::VerificationStatus> reply = *watcher;
+                        bool needsStEmit = false;
+                        if (this->d_ptr->m_watcherQueue.isEmpty() && this->d_ptr->m_status != Request::Finished) {
+                            needsStEmit = true;
+                            this->d_ptr->m_status = Request::Finished;
+                        }
+                        bool needsVfEmit = false;
+                        if (reply.isError()) {
+                            this->d_ptr->m_result = Result(Result::DaemonError,
+                                                           reply.error().message());
+                        } else {
+                            this->d_ptr->m_result = reply.argumentAt<0>();
+                            if (this->d_ptr->m_result.code() == Result::Succeeded) {
+                                // the session was finalized once the stream ended.
+                                this->d_ptr->m_cipherSessionToken = 0;
+                            }
+                            this->d_ptr->m_generatedData = reply.argumentAt<1>();
+                            if (this->d_ptr->m_verificationStatus != reply.argumentAt<2>()) {
+                                needsVfEmit = true;
+                                this->d_ptr->m_verificationStatus = reply.argumentAt<2>();
+                            }
+                        }
+                        watcher->deleteLater();
+                        if (needsStEmit) {
+                            emit this->statusChanged();
+                        }
+                        emit this->resultChanged();
+                        emit this->generatedDataChanged();
+                        if (needsVfEmit) {
+                            emit verificationStatusChanged();
+                        }
+                    });
+                }
+            }
         }
     }
 }
@@ -36,6 +36,8 @@ class SAILFISH_CRYPTO_API CipherRequest : public Sailfish::Crypto::Request
     Q_PROPERTY(Sailfish::Crypto::CryptoManager::SignaturePadding signaturePadding READ signaturePadding WRITE setSignaturePadding NOTIFY signaturePaddingChanged)
     Q_PROPERTY(Sailfish::Crypto::CryptoManager::DigestFunction digestFunction READ digestFunction WRITE setDigestFunction NOTIFY digestFunctionChanged)
     Q_PROPERTY(QString cryptoPluginName READ cryptoPluginName WRITE setCryptoPluginName NOTIFY cryptoPluginNameChanged)
+    Q_PROPERTY(int inputFileDescriptor READ inputFileDescriptor WRITE setInputFileDescriptor NOTIFY inputFileDescriptorChanged)
+    Q_PROPERTY(int outputFileDescriptor READ outputFileDescriptor WRITE setOutputFileDescriptor NOTIFY outputFileDescriptorChanged)
     Q_PROPERTY(QByteArray generatedData READ generatedData NOTIFY generatedDataChanged)
     Q_PROPERTY(Sailfish::Crypto::CryptoManager::VerificationStatus verificationStatus READ verificationStatus NOTIFY verificationStatusChanged)
 
@@ -45,6 +47,7 @@ public:
         UpdateCipherAuthentication,
         UpdateCipher,
         FinalizeCipher,
+        StreamCipher,
     };
     Q_ENUM(CipherMode)
 
@@ -81,6 +84,12 @@ public:
     QString cryptoPluginName() const;
     void setCryptoPluginName(const QString &pluginName);
 
+    int inputFileDescriptor() const;
+    void setInputFileDescriptor(int fd);
+
+    int outputFileDescriptor() const;
+    void setOutputFileDescriptor(int fd);
+
     QByteArray generatedData() const;
     Sailfish::Crypto::CryptoManager::VerificationStatus verificationStatus() const;
 
@@ -107,6 +116,8 @@ Q_SIGNALS:
     void signaturePaddingChanged();
     void digestFunctionChanged();
     void cryptoPluginNameChanged();
+    void inputFileDescriptorChanged();
+    void outputFileDescriptorChanged();
     void generatedDataChanged();
     void verificationStatusChanged();
 
@@ -42,6 +42,8 @@ public:
     Sailfish::Crypto::CryptoManager::SignaturePadding m_signaturePadding;
     Sailfish::Crypto::CryptoManager::DigestFunction m_digestFunction;
     QString m_cryptoPluginName;
+    int m_inputFileDescriptor;
+    int m_outputFileDescriptor;
     quint32 m_cipherSessionToken;
     QByteArray m_generatedData;
     Sailfish::Crypto::CryptoManager::VerificationStatus m_verificationStatus;
@@ -177,6 +177,7 @@ void Sailfish::Crypto::CryptoDaemonConnection::registerDBusTypes()
     qRegisterMetaType<Sailfish::Crypto::Key::FilterData>("Sailfish::Crypto::Key::FilterData");
     qRegisterMetaType<Sailfish::Crypto::Key>("Sailfish::Crypto::Key");
     qRegisterMetaType<Sailfish::Crypto::Result>("Sailfish::Crypto::Result");
+    qRegisterMetaType<QVector<Sailfish::Crypto::Result> >("QVector<Sailfish::Crypto::Result>");
     qRegisterMetaType<Sailfish::Crypto::Key::Component>("Sailfish::Crypto::Key::Component");
     qRegisterMetaType<Sailfish::Crypto::Key::Components>("Sailfish::Crypto::Key::Components");
     qRegisterMetaType<Sailfish::Crypto::CipherRequest::CipherMode>("Sailfish::Crypto::CipherRequest::CipherMode");
@@ -208,6 +209,7 @@ void Sailfish::Crypto::CryptoDaemonConnection::registerDBusTypes()
     qDBusRegisterMetaType<QVector<Sailfish::Crypto::Key::Identifier> >();
     qDBusRegisterMetaType<Sailfish::Crypto::Key>();
     qDBusRegisterMetaType<Sailfish::Crypto::Result>();
+    qDBusRegisterMetaType<QVector<Sailfish::Crypto::Result> >();
     qDBusRegisterMetaType<Sailfish::Crypto::Key::Component>();
     qDBusRegisterMetaType<Sailfish::Crypto::Key::Components>();
     qDBusRegisterMetaType<Sailfish::Crypto::CipherRequest::CipherMode>();
@@ -220,4 +222,6 @@ void Sailfish::Crypto::CryptoDaemonConnection::registerDBusTypes()
     qDBusRegisterMetaType<Sailfish::Crypto::LockCodeRequest::LockStatus>();
     qDBusRegisterMetaType<Sailfish::Crypto::PluginInfo>();
     qDBusRegisterMetaType<QVector<Sailfish::Crypto::PluginInfo> >();
+    qDBusRegisterMetaType<QVector<QByteArray> >();
+    qDBusRegisterMetaType<QVector<int> >();
 }
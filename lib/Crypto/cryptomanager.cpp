@@ -8,6 +8,7 @@
 #include "Crypto/cryptomanager.h"
 #include "Crypto/cryptomanager_p.h"
 #include "Crypto/serialization_p.h"
+#include "Crypto/payloadtransfer_p.h"
 #include "Crypto/key.h"
 #include "Crypto/keypairgenerationparameters.h"
 #include "Crypto/keyderivationparameters.h"
@@ -28,6 +29,8 @@
 #include <QtCore/QStandardPaths>
 #include <QtCore/QDir>
 
+#include <climits>
+
 Q_LOGGING_CATEGORY(lcSailfishCrypto, "org.sailfishos.crypto", QtWarningMsg)
 
 using namespace Sailfish::Crypto;
@@ -316,6 +319,25 @@ CryptoManagerPrivate::storedKeyIdentifiers(
     return reply;
 }
 
+bool CryptoManagerPrivate::transferPayloadAsFileDescriptor(
+        const QByteArray &data,
+        QVariant *argument) const
+{
+    // Large payloads are passed via a memory file rather than being
+    // copied into (and back out of) the D-Bus message.
+    if (!PayloadTransfer::useFileDescriptor(m_interface->connection(), data)) {
+        return false;
+    }
+
+    const QDBusUnixFileDescriptor fd = PayloadTransfer::createFileDescriptor(data);
+    if (!fd.isValid()) {
+        return false;
+    }
+
+    *argument = QVariant::fromValue<QDBusUnixFileDescriptor>(fd);
+    return true;
+}
+
 QDBusPendingReply<Result, QByteArray>
 CryptoManagerPrivate::calculateDigest(
         const QByteArray &data,
@@ -330,14 +352,18 @@ CryptoManagerPrivate::calculateDigest(
                                               QStringLiteral("Not connected to daemon")));
     }
 
+    QVariantList args;
+    args << QVariant::fromValue<QByteArray>(data)
+         << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
+         << QVariant::fromValue<CryptoManager::DigestFunction>(digestFunction)
+         << QVariant::fromValue<QVariantMap>(customParameters)
+         << QVariant::fromValue<QString>(cryptosystemProviderName);
+    const bool useFd = transferPayloadAsFileDescriptor(data, &args[0]);
+
     QDBusPendingReply<Result, QByteArray> reply
             = m_interface->asyncCallWithArgumentList(
-                QStringLiteral("calculateDigest"),
-                QVariantList() << QVariant::fromValue<QByteArray>(data)
-                               << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
-                               << QVariant::fromValue<CryptoManager::DigestFunction>(digestFunction)
-                               << QVariant::fromValue<QVariantMap>(customParameters)
-                               << QVariant::fromValue<QString>(cryptosystemProviderName));
+                useFd ? QStringLiteral("calculateDigestFd") : QStringLiteral("calculateDigest"),
+                args);
     return reply;
 }
 
@@ -356,10 +382,45 @@ CryptoManagerPrivate::sign(
                                               QStringLiteral("Not connected to daemon")));
     }
 
+    QVariantList args;
+    args << QVariant::fromValue<QByteArray>(data)
+         << QVariant::fromValue<Key>(key)
+         << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
+         << QVariant::fromValue<CryptoManager::DigestFunction>(digestFunction)
+         << QVariant::fromValue<QVariantMap>(customParameters)
+         << QVariant::fromValue<QString>(cryptosystemProviderName);
+    const bool useFd = transferPayloadAsFileDescriptor(data, &args[0]);
+
     QDBusPendingReply<Result, QByteArray> reply
             = m_interface->asyncCallWithArgumentList(
-                QStringLiteral("sign"),
-                QVariantList() << QVariant::fromValue<QByteArray>(data)
+                useFd ? QStringLiteral("signFd") : QStringLiteral("sign"),
+                args);
+    return reply;
+}
+
+QDBusPendingReply<Result, QVector<Result>, QVector<QByteArray>, QVector<int> >
+CryptoManagerPrivate::batch(
+        const QVector<int> &operations,
+        const QVector<QByteArray> &data,
+        const QVector<QByteArray> &signatures,
+        const Key &key,
+        CryptoManager::SignaturePadding padding,
+        CryptoManager::DigestFunction digestFunction,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName)
+{
+    if (!m_interface) {
+        return QDBusPendingReply<Result, QVector<Result>, QVector<QByteArray>, QVector<int> >(
+                    QDBusMessage::createError(QDBusError::Other,
+                                              QStringLiteral("Not connected to daemon")));
+    }
+
+    QDBusPendingReply<Result, QVector<Result>, QVector<QByteArray>, QVector<int> > reply
+            = m_interface->asyncCallWithArgumentList(
+                QStringLiteral("batch"),
+                QVariantList() << QVariant::fromValue<QVector<int> >(operations)
+                               << QVariant::fromValue<QVector<QByteArray> >(data)
+                               << QVariant::fromValue<QVector<QByteArray> >(signatures)
                                << QVariant::fromValue<Key>(key)
                                << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
                                << QVariant::fromValue<CryptoManager::DigestFunction>(digestFunction)
@@ -383,16 +444,20 @@ QDBusPendingReply<Result, CryptoManager::VerificationStatus> CryptoManagerPrivat
                                               QStringLiteral("Not connected to daemon")));
     }
 
+    QVariantList args;
+    args << QVariant::fromValue<QByteArray>(signature)
+         << QVariant::fromValue<QByteArray>(data)
+         << QVariant::fromValue<Key>(key)
+         << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
+         << QVariant::fromValue<CryptoManager::DigestFunction>(digestFunction)
+         << QVariant::fromValue<QVariantMap>(customParameters)
+         << QVariant::fromValue<QString>(cryptosystemProviderName);
+    const bool useFd = transferPayloadAsFileDescriptor(data, &args[1]);
+
     QDBusPendingReply<Result, Sailfish::Crypto::CryptoManager::VerificationStatus> reply
             = m_interface->asyncCallWithArgumentList(
-                QStringLiteral("verify"),
-                QVariantList() << QVariant::fromValue<QByteArray>(signature)
-                               << QVariant::fromValue<QByteArray>(data)
-                               << QVariant::fromValue<Key>(key)
-                               << QVariant::fromValue<CryptoManager::SignaturePadding>(padding)
-                               << QVariant::fromValue<CryptoManager::DigestFunction>(digestFunction)
-                               << QVariant::fromValue<QVariantMap>(customParameters)
-                               << QVariant::fromValue<QString>(cryptosystemProviderName));
+                useFd ? QStringLiteral("verifyFd") : QStringLiteral("verify"),
+                args);
     return reply;
 }
 
@@ -405,7 +470,8 @@ CryptoManagerPrivate::encrypt(
         CryptoManager::EncryptionPadding padding,
         const QByteArray &authenticationData,
         const QVariantMap &customParameters,
-        const QString &cryptosystemProviderName)
+        const QString &cryptosystemProviderName,
+        QDBusUnixFileDescriptor *output)
 {
     if (!m_interface) {
         return QDBusPendingReply<Result, QByteArray, QByteArray>(
@@ -413,17 +479,30 @@ CryptoManagerPrivate::encrypt(
                                               QStringLiteral("Not connected to daemon")));
     }
 
+    QVariantList args;
+    args << QVariant::fromValue<QByteArray>(data)
+         << QVariant::fromValue<QByteArray>(iv)
+         << QVariant::fromValue<Key>(key)
+         << QVariant::fromValue<CryptoManager::BlockMode>(blockMode)
+         << QVariant::fromValue<CryptoManager::EncryptionPadding>(padding)
+         << QVariant::fromValue<QByteArray>(authenticationData)
+         << QVariant::fromValue<QVariantMap>(customParameters)
+         << QVariant::fromValue<QString>(cryptosystemProviderName);
+    // if the data is passed via file descriptor, the daemon will
+    // write the ciphertext to the output file rather than the reply.
+    const QDBusUnixFileDescriptor outputFd = PayloadTransfer::useFileDescriptor(m_interface->connection(), data)
+            ? PayloadTransfer::createFileDescriptor(QByteArray())
+            : QDBusUnixFileDescriptor();
+    const bool useFd = outputFd.isValid() && transferPayloadAsFileDescriptor(data, &args[0]);
+    *output = useFd ? outputFd : QDBusUnixFileDescriptor();
+    if (useFd) {
+        args.insert(1, QVariant::fromValue<QDBusUnixFileDescriptor>(outputFd));
+    }
+
     QDBusPendingReply<Result, QByteArray, QByteArray> reply
             = m_interface->asyncCallWithArgumentList(
-                QStringLiteral("encrypt"),
-                QVariantList() << QVariant::fromValue<QByteArray>(data)
-                               << QVariant::fromValue<QByteArray>(iv)
-                               << QVariant::fromValue<Key>(key)
-                               << QVariant::fromValue<CryptoManager::BlockMode>(blockMode)
-                               << QVariant::fromValue<CryptoManager::EncryptionPadding>(padding)
-                               << QVariant::fromValue<QByteArray>(authenticationData)
-                               << QVariant::fromValue<QVariantMap>(customParameters)
-                               << QVariant::fromValue<QString>(cryptosystemProviderName));
+                useFd ? QStringLiteral("encryptFd") : QStringLiteral("encrypt"),
+                args);
     return reply;
 }
 
@@ -436,7 +515,8 @@ QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::Verificat
         const QByteArray &authenticationData,
         const QByteArray &authenticationTag,
         const QVariantMap &customParameters,
-        const QString &cryptosystemProviderName)
+        const QString &cryptosystemProviderName,
+        QDBusUnixFileDescriptor *output)
 {
     if (!m_interface) {
         return QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::VerificationStatus>(
@@ -444,18 +524,31 @@ QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::Verificat
                                               QStringLiteral("Not connected to daemon")));
     }
 
+    QVariantList args;
+    args << QVariant::fromValue<QByteArray>(data)
+         << QVariant::fromValue<QByteArray>(iv)
+         << QVariant::fromValue<Key>(key)
+         << QVariant::fromValue<CryptoManager::BlockMode>(blockMode)
+         << QVariant::fromValue<CryptoManager::EncryptionPadding>(padding)
+         << QVariant::fromValue<QByteArray>(authenticationData)
+         << QVariant::fromValue<QByteArray>(authenticationTag)
+         << QVariant::fromValue<QVariantMap>(customParameters)
+         << QVariant::fromValue<QString>(cryptosystemProviderName);
+    // if the data is passed via file descriptor, the daemon will
+    // write the plaintext to the output file rather than the reply.
+    const QDBusUnixFileDescriptor outputFd = PayloadTransfer::useFileDescriptor(m_interface->connection(), data)
+            ? PayloadTransfer::createFileDescriptor(QByteArray())
+            : QDBusUnixFileDescriptor();
+    const bool useFd = outputFd.isValid() && transferPayloadAsFileDescriptor(data, &args[0]);
+    *output = useFd ? outputFd : QDBusUnixFileDescriptor();
+    if (useFd) {
+        args.insert(1, QVariant::fromValue<QDBusUnixFileDescriptor>(outputFd));
+    }
+
     QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::VerificationStatus> reply
             = m_interface->asyncCallWithArgumentList(
-                QStringLiteral("decrypt"),
-                QVariantList() << QVariant::fromValue<QByteArray>(data)
-                               << QVariant::fromValue<QByteArray>(iv)
-                               << QVariant::fromValue<Key>(key)
-                               << QVariant::fromValue<CryptoManager::BlockMode>(blockMode)
-                               << QVariant::fromValue<CryptoManager::EncryptionPadding>(padding)
-                               << QVariant::fromValue<QByteArray>(authenticationData)
-                               << QVariant::fromValue<QByteArray>(authenticationTag)
-                               << QVariant::fromValue<QVariantMap>(customParameters)
-                               << QVariant::fromValue<QString>(cryptosystemProviderName));
+                useFd ? QStringLiteral("decryptFd") : QStringLiteral("decrypt"),
+                args);
     return reply;
 }
 
@@ -561,6 +654,44 @@ CryptoManagerPrivate::finalizeCipherSession(
     return reply;
 }
 
+QDBusPendingReply<Result, QByteArray, CryptoManager::VerificationStatus>
+CryptoManagerPrivate::streamCipherSession(
+        const QDBusUnixFileDescriptor &input,
+        const QDBusUnixFileDescriptor &output,
+        const QByteArray &data,
+        const QVariantMap &customParameters,
+        const QString &cryptosystemProviderName,
+        quint32 cipherSessionToken)
+{
+    if (!m_interface) {
+        return QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::VerificationStatus>(
+                    QDBusMessage::createError(QDBusError::Other,
+                                              QStringLiteral("Not connected to daemon")));
+    }
+
+    if (!(m_interface->connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        return QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::VerificationStatus>(
+                    QDBusMessage::createError(QDBusError::NotSupported,
+                                              QStringLiteral("File descriptor passing is not supported by the connection")));
+    }
+
+    // the reply is only sent once the whole stream has been processed,
+    // which the daemon aborts if it takes longer than the maximum duration.
+    QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::VerificationStatus> reply
+            = m_interface->connection().asyncCall(
+                QDBusMessage::createMethodCall(
+                    m_interface->service(), m_interface->path(), m_interface->interface(),
+                    QStringLiteral("streamCipherSession"))
+                << QVariant::fromValue<QDBusUnixFileDescriptor>(input)
+                << QVariant::fromValue<QDBusUnixFileDescriptor>(output)
+                << QVariant::fromValue<QByteArray>(data)
+                << QVariant::fromValue<QVariantMap>(customParameters)
+                << QVariant::fromValue<QString>(cryptosystemProviderName)
+                << QVariant::fromValue<quint32>(cipherSessionToken),
+                PayloadTransfer::MaximumStreamDuration + PayloadTransfer::StreamInactivityTimeout);
+    return reply;
+}
+
 QDBusPendingReply<Result, LockCodeRequest::LockStatus>
 CryptoManagerPrivate::queryLockStatus(
         LockCodeRequest::LockCodeTargetType lockCodeTargetType,
@@ -677,6 +808,7 @@ CryptoManagerPrivate *CryptoManager::pimpl() const
   \li \l{CalculateDigestRequest} to calculate a digest (non-keyed hash) of some data
   \li \l{SignRequest} to generate a signature for some data with a given \l{Key}
   \li \l{VerifyRequest} to verify if a signature was generated with a given \l{Key}
+  \li \l{BatchRequest} to sign, verify or digest many blobs of data in a single request
   \li \l{CipherRequest} to start a cipher session with which to encrypt, decrypt, sign or verify a stream of data
   \endlist
  */
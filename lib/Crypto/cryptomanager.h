@@ -340,6 +340,7 @@ protected:
 private:
     QScopedPointer<CryptoManagerPrivate> const d_ptr;
     Q_DECLARE_PRIVATE(CryptoManager)
+    friend class BatchRequest;
     friend class CalculateDigestRequest;
     friend class CipherRequest;
     friend class DecryptRequest;
@@ -24,6 +24,7 @@
 #include <QtDBus/QDBusPendingReply>
 #include <QtDBus/QDBusMetaType>
 #include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 #include <QtCore/QByteArray>
 #include <QtCore/QObject>
@@ -128,6 +129,19 @@ public:
             const QVariantMap &customParameters,
             const QString &cryptosystemProviderName);
 
+    QDBusPendingReply<Sailfish::Crypto::Result,
+                      QVector<Sailfish::Crypto::Result>,
+                      QVector<QByteArray>,
+                      QVector<int> > batch(
+            const QVector<int> &operations,
+            const QVector<QByteArray> &data,
+            const QVector<QByteArray> &signatures,
+            const Sailfish::Crypto::Key &key, // or keyreference, i.e. Key(keyName)
+            Sailfish::Crypto::CryptoManager::SignaturePadding padding,
+            Sailfish::Crypto::CryptoManager::DigestFunction digestFunction,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName);
+
     QDBusPendingReply<Sailfish::Crypto::Result, Sailfish::Crypto::CryptoManager::VerificationStatus> verify(
             const QByteArray &signature,
             const QByteArray &data,
@@ -145,7 +159,8 @@ public:
             Sailfish::Crypto::CryptoManager::EncryptionPadding padding,
             const QByteArray &authenticationData,
             const QVariantMap &customParameters,
-            const QString &cryptosystemProviderName);
+            const QString &cryptosystemProviderName,
+            QDBusUnixFileDescriptor *output);
 
     QDBusPendingReply<Result, QByteArray, Sailfish::Crypto::CryptoManager::VerificationStatus> decrypt(
             const QByteArray &data,
@@ -156,7 +171,8 @@ public:
             const QByteArray &authenticationData,
             const QByteArray &authenticationTag,
             const QVariantMap &customParameters,
-            const QString &cryptosystemProviderName);
+            const QString &cryptosystemProviderName,
+            QDBusUnixFileDescriptor *output);
 
     QDBusPendingReply<Result, quint32> initializeCipherSession(
             const QByteArray &initializationVector,
@@ -187,6 +203,14 @@ public:
             const QString &cryptosystemProviderName,
             quint32 cipherSessionToken);
 
+    QDBusPendingReply<Result, QByteArray, CryptoManager::VerificationStatus> streamCipherSession(
+            const QDBusUnixFileDescriptor &input,
+            const QDBusUnixFileDescriptor &output,
+            const QByteArray &data,
+            const QVariantMap &customParameters,
+            const QString &cryptosystemProviderName,
+            quint32 cipherSessionToken);
+
     QDBusPendingReply<Sailfish::Crypto::Result, Sailfish::Crypto::LockCodeRequest::LockStatus> queryLockStatus(
             Sailfish::Crypto::LockCodeRequest::LockCodeTargetType lockCodeTargetType,
             const QString &lockCodeTarget);
@@ -207,6 +231,8 @@ public:
             const Sailfish::Crypto::InteractionParameters &interactionParameters);
 
 private:
+    bool transferPayloadAsFileDescriptor(const QByteArray &data, QVariant *argument) const;
+
     friend class CryptoManager;
     QPointer<Sailfish::Crypto::CryptoDaemonConnection> m_crypto;
     QDBusInterface *m_interface;
@@ -11,6 +11,7 @@
 #include "Crypto/cryptomanager.h"
 #include "Crypto/cryptomanager_p.h"
 #include "Crypto/serialization_p.h"
+#include "Crypto/payloadtransfer_p.h"
 
 #include <QtDBus/QDBusPendingReply>
 #include <QtDBus/QDBusPendingCallWatcher>
@@ -353,7 +354,8 @@ void DecryptRequest::startRequest()
                     d->m_authenticationData,
                     d->m_authenticationTag,
                     d->m_customParameters,
-                    d->m_cryptoPluginName);
+                    d->m_cryptoPluginName,
+                    &d->m_output);
         if (!reply.isValid() && !reply.error().message().isEmpty()) {
             d->m_status = Request::Finished;
             d->m_result = Result(Result::CryptoManagerNotInitializedError,
@@ -384,6 +386,12 @@ void DecryptRequest::startRequest()
                 } else {
                     this->d_ptr->m_result = reply.argumentAt<0>();
                     this->d_ptr->m_plaintext = reply.argumentAt<1>();
+                    if (this->d_ptr->m_output.isValid()
+                            && this->d_ptr->m_result.code() == Result::Succeeded
+                            && !PayloadTransfer::readFileDescriptor(this->d_ptr->m_output, &this->d_ptr->m_plaintext)) {
+                        this->d_ptr->m_result = Result(Result::DaemonError,
+                                                       QLatin1String("Unable to read the output from the daemon"));
+                    }
                     this->d_ptr->m_verificationStatus = reply.argumentAt<2>();
                 }
                 watcher->deleteLater();
@@ -17,6 +17,7 @@
 #include <QtCore/QString>
 
 #include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 namespace Sailfish {
 
@@ -42,6 +43,7 @@ public:
     QByteArray m_plaintext;
     Sailfish::Crypto::CryptoManager::VerificationStatus m_verificationStatus;
 
+    QDBusUnixFileDescriptor m_output; // large outputs are written here by the daemon
     QScopedPointer<QDBusPendingCallWatcher> m_watcher;
     Sailfish::Crypto::Request::Status m_status;
     Sailfish::Crypto::Result m_result;
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "Crypto/payloadtransfer_p.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QElapsedTimer>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace {
+    int createMemoryFile()
+    {
+#ifdef SYS_memfd_create
+        int fd = syscall(SYS_memfd_create, "sailfish-crypto-payload", MFD_CLOEXEC);
+        if (fd >= 0) {
+            return fd;
+        }
+#endif
+#ifdef O_TMPFILE
+        // fall back to an unnamed temporary file if memfd is not supported.
+        return open(QFile::encodeName(QDir::tempPath()).constData(),
+                    O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR);
+#else
+        return -1;
+#endif
+    }
+
+    bool waitForFileDescriptor(int fd, short events, int timeout, int cancelFd)
+    {
+        struct pollfd pfds[2];
+        pfds[0].fd = fd;
+        pfds[0].events = events;
+        pfds[0].revents = 0;
+        pfds[1].fd = cancelFd; // ignored by poll() if negative
+        pfds[1].events = POLLIN;
+        pfds[1].revents = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        int remaining = timeout;
+        int r = 0;
+        while ((r = poll(pfds, 2, remaining)) < 0 && errno == EINTR) {
+            if (timeout >= 0) {
+                remaining = static_cast<int>(qMax<qint64>(0, timeout - timer.elapsed()));
+            }
+        }
+
+        if (r == 0) {
+            errno = ETIMEDOUT;
+            return false;
+        } else if (r > 0 && pfds[1].revents) {
+            errno = ECANCELED;
+            return false;
+        }
+        return r > 0 && !(pfds[0].revents & POLLNVAL);
+    }
+}
+
+bool Sailfish::Crypto::PayloadTransfer::useFileDescriptor(
+        const QDBusConnection &connection,
+        const QByteArray &data)
+{
+    return data.size() >= FileDescriptorThreshold
+            && (connection.connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing);
+}
+
+QDBusUnixFileDescriptor Sailfish::Crypto::PayloadTransfer::createFileDescriptor(
+        const QByteArray &data)
+{
+    const int fd = createMemoryFile();
+    if (fd < 0) {
+        return QDBusUnixFileDescriptor();
+    }
+
+    QDBusUnixFileDescriptor retn;
+    if (data.isEmpty() || writeFileDescriptor(QDBusUnixFileDescriptor(fd), data)) {
+        retn.giveFileDescriptor(fd);
+    } else {
+        close(fd);
+    }
+    return retn;
+}
+
+bool Sailfish::Crypto::PayloadTransfer::readFileDescriptor(
+        const QDBusUnixFileDescriptor &fd,
+        QByteArray *data)
+{
+    // Only regular (e.g. memory) files are supported, as the payload is read
+    // in a single pass without blocking, using its size to allocate once.
+    // The size is checked before allocating, as the client controls it.
+    struct stat sb;
+    if (!fd.isValid() || fstat(fd.fileDescriptor(), &sb) != 0 || !S_ISREG(sb.st_mode)
+            || sb.st_size < 0 || sb.st_size > MaximumPayloadSize) {
+        return false;
+    }
+
+    QByteArray payload(static_cast<int>(sb.st_size), Qt::Uninitialized);
+    qint64 offset = 0;
+    while (offset < payload.size()) {
+        const ssize_t r = pread(fd.fileDescriptor(),
+                                payload.data() + offset,
+                                payload.size() - offset,
+                                offset);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        } else if (r <= 0) {
+            return false;
+        }
+        offset += r;
+    }
+
+    *data = payload;
+    return true;
+}
+
+bool Sailfish::Crypto::PayloadTransfer::writeFileDescriptor(
+        const QDBusUnixFileDescriptor &fd,
+        const QByteArray &data)
+{
+    if (!fd.isValid() || ftruncate(fd.fileDescriptor(), 0) != 0) {
+        return false;
+    }
+
+    qint64 offset = 0;
+    while (offset < data.size()) {
+        const ssize_t w = pwrite(fd.fileDescriptor(),
+                                 data.constData() + offset,
+                                 data.size() - offset,
+                                 offset);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        } else if (w <= 0) {
+            return false;
+        }
+        offset += w;
+    }
+
+    return true;
+}
+
+qint64 Sailfish::Crypto::PayloadTransfer::readStream(
+        const QDBusUnixFileDescriptor &fd,
+        char *buffer,
+        qint64 maxSize,
+        int timeout,
+        int cancelFd)
+{
+    if (!fd.isValid()) {
+        return -1;
+    }
+
+    // Wait before reading, rather than only once the read would block,
+    // so that the timeout also applies to blocking descriptors.
+    while (waitForFileDescriptor(fd.fileDescriptor(), POLLIN, timeout, cancelFd)) {
+        const ssize_t r = read(fd.fileDescriptor(), buffer, maxSize);
+        if (r >= 0) {
+            return r;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            break;
+        }
+    }
+    return -1;
+}
+
+bool Sailfish::Crypto::PayloadTransfer::writeStream(
+        const QDBusUnixFileDescriptor &fd,
+        const QByteArray &data,
+        int timeout,
+        int cancelFd)
+{
+    if (!fd.isValid()) {
+        return false;
+    }
+
+    qint64 offset = 0;
+    while (offset < data.size()) {
+        if (!waitForFileDescriptor(fd.fileDescriptor(), POLLOUT, timeout, cancelFd)) {
+            return false;
+        }
+        const ssize_t w = write(fd.fileDescriptor(),
+                                data.constData() + offset,
+                                data.size() - offset);
+        if (w > 0) {
+            offset += w;
+        } else if (w < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
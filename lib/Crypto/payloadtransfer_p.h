@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHCRYPTO_PAYLOADTRANSFER_P_H
+#define LIBSAILFISHCRYPTO_PAYLOADTRANSFER_P_H
+
+// WARNING!
+//
+// This is private API, used for internal implementation only!
+// No BC/SC guarantees are made for the methods in this file!
+
+#include "Crypto/cryptoglobal.h"
+
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusUnixFileDescriptor>
+
+#include <QtCore/QByteArray>
+
+namespace Sailfish {
+
+namespace Crypto {
+
+// Large payloads are passed between the client and the daemon in memory
+// file descriptors, rather than being marshalled into the D-Bus messages.
+namespace PayloadTransfer {
+
+// Payloads of at least this many bytes are passed via file descriptors.
+const int FileDescriptorThreshold = 64 * 1024;
+
+// Larger payloads are rejected without being read, so that a client
+// cannot force the daemon to allocate an arbitrary amount of memory.
+// This matches the maximum size of a D-Bus message.
+const int MaximumPayloadSize = 128 * 1024 * 1024;
+
+bool useFileDescriptor(const QDBusConnection &connection, const QByteArray &data) SAILFISH_CRYPTO_API;
+
+QDBusUnixFileDescriptor createFileDescriptor(const QByteArray &data) SAILFISH_CRYPTO_API;
+bool readFileDescriptor(const QDBusUnixFileDescriptor &fd, QByteArray *data) SAILFISH_CRYPTO_API;
+bool writeFileDescriptor(const QDBusUnixFileDescriptor &fd, const QByteArray &data) SAILFISH_CRYPTO_API;
+
+// Streamed cipher sessions read their input in chunks of at most this size.
+const int StreamChunkSize = 256 * 1024;
+
+// Streamed cipher sessions are aborted if no data can be transferred for
+// this many milliseconds, or if they have not completed after this many
+// milliseconds, so that a stalled client cannot occupy the daemon.
+const int StreamInactivityTimeout = 30 * 1000;
+const int MaximumStreamDuration = 60 * 60 * 1000;
+
+// Unlike the functions above, these support pipes and sockets.  They wait
+// until data can be transferred, for at most timeout milliseconds (or
+// indefinitely if negative), and give up if cancelFd becomes readable.
+// On failure, errno is ETIMEDOUT or ECANCELED if the wait was aborted.
+// Writing may still block if the descriptor is blocking.
+qint64 readStream(const QDBusUnixFileDescriptor &fd, char *buffer, qint64 maxSize,
+                  int timeout = -1, int cancelFd = -1) SAILFISH_CRYPTO_API;
+bool writeStream(const QDBusUnixFileDescriptor &fd, const QByteArray &data,
+                 int timeout = -1, int cancelFd = -1) SAILFISH_CRYPTO_API;
+
+} // namespace PayloadTransfer
+
+} // namespace Crypto
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHCRYPTO_PAYLOADTRANSFER_P_H
@@ -50,11 +50,16 @@ using namespace Sailfish::Secrets;
   they are implementing a Crypto-Storage plugin).
 
   Plugin implementers must be aware that the information reporting methods (name(), version(),
-  supportsLocking(), and supportsSetLockCode()) will be invoked from the main thread of the
-  secrets daemon, while the various locking operation methods (isLocked(), lock(), unlock(),
+  supportsLocking(), supportsSetLockCode(), and supportsConcurrentOperations()) will be invoked
+  from the main thread of the secrets daemon, while the various locking operation methods (isLocked(), lock(), unlock(),
   and setLockCode()) and availability reporting method (isAvailable()) will be invoked from a
   separate thread.  Plugins are loaded and plugin instances are constructed in the main thread.
 
+  Version 2.0 of the plugin interfaces added supportsConcurrentOperations() to
+  PluginBase.  As PluginBase is a virtual base of every plugin type, this changes
+  the binary layout of all of them, and plugins built against version 1.0 of the
+  interfaces must be rebuilt; the daemon will not load them.
+
   In order to implement a Secrets extension plugin, plugin implementers should
   specify the following in their .pro file:
   \code
@@ -235,6 +240,21 @@ bool PluginBase::setLockCode(const QByteArray &oldLockCode,
     return false;
 }
 
+/*!
+  \brief Returns true if the plugin supports having its operation methods invoked concurrently.
+
+  The default implementation returns false, in which case the daemon
+  will serialize all calls to the plugin's operation methods onto a
+  single thread.  This method should be overridden by a specific plugin
+  implementation to return true if every operation method may safely be
+  invoked from multiple threads at the same time, in which case the
+  daemon may dispatch independent operations to the plugin in parallel.
+ */
+bool PluginBase::supportsConcurrentOperations() const
+{
+    return false;
+}
+
 /*!
   \class EncryptionPlugin
   \brief Specifies an interface to derive an encryption key from
@@ -309,12 +329,66 @@ EncryptionPlugin::~EncryptionPlugin()
          operations offered by this plugin from the given \a authenticationCode
          and \a salt, and write it to the out-parameter \a key.
 
+  The derived key must depend only on the \a authenticationCode and \a salt.
+  This function may be invoked from a dedicated key derivation thread,
+  concurrently with other operations of the plugin, and so must not modify
+  the state of the plugin.  The secrets service may cache the derived key
+  for a short time, and reuse it rather than calling this function again.
+
   If the plugin itself is locked, this function should return a
   Sailfish::Secrets::Result with the result code set to
   Sailfish::Secrets::Result::Failed and the error code set to
   Sailfish::Secrets::Result::SecretsPluginIsLockedError.
  */
 
+/*!
+  \brief Derive an encryption key from the given \a authenticationCode and
+         \a salt using the key derivation \a parameters, and write it to
+         the out-parameter \a key.
+
+  The \a parameters are an opaque, plugin-defined description of the key
+  derivation function and its cost (e.g. as returned from a previous call
+  to calibrateKeyDerivation()), which the secrets service stores alongside
+  each collection.  Empty \a parameters denote the plugin's original key
+  derivation, so that keys derived for existing collections do not change.
+
+  The same threading and caching considerations apply as for
+  deriveKeyFromCode().
+
+  The default implementation calls deriveKeyFromCode() if the
+  \a parameters are empty, and otherwise returns a
+  Sailfish::Secrets::Result with the error code set to
+  Sailfish::Secrets::Result::OperationNotSupportedError.
+ */
+Result EncryptionPlugin::deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key)
+{
+    if (parameters.isEmpty()) {
+        return deriveKeyFromCode(authenticationCode, salt, key);
+    }
+    return Result(Result::OperationNotSupportedError,
+                  QLatin1String("This plugin does not support key derivation parameters"));
+}
+
+/*!
+  \brief Determine the strongest key derivation parameters supported by this
+         plugin whose cost on this device is approximately \a targetDuration
+         milliseconds, and write them to the out-parameter \a parameters.
+
+  The secrets service calls this function once per device, and uses the
+  resulting \a parameters for newly created collections, and to upgrade
+  existing collections when they are next unlocked.  The plugin should
+  never return parameters which are weaker than its original key derivation.
+
+  The default implementation writes empty \a parameters, which causes the
+  plugin's original key derivation to be used.
+ */
+Result EncryptionPlugin::calibrateKeyDerivation(int targetDuration, QByteArray *parameters)
+{
+    Q_UNUSED(targetDuration);
+    *parameters = QByteArray();
+    return Result(Result::Succeeded);
+}
+
 /*!
   \fn EncryptionPlugin::encryptSecret(const QByteArray &plaintext, const QByteArray &key, QByteArray *encrypted)
   \brief Encrypt the given \a plaintext with the given \a key and write
@@ -525,6 +599,38 @@ StoragePlugin::~StoragePlugin()
   Sailfish::Secrets::Result::DatabaseError.
  */
 
+/*!
+  \brief Store each of the given \a secrets into the collection identified
+         by the given \a collectionName.
+
+  The name, data and filter data of each secret in \a secrets are used;
+  its collection and storage plugin names are ignored.  The errors which
+  may be returned are the same as for \l setSecret().
+
+  Either every secret should be stored, or (if any of them cannot be
+  stored) none of them should be, so that a failed bulk write (e.g. of an
+  imported collection archive) does not leave a partial set of secrets.
+
+  The default implementation calls setSecret() for each secret in turn,
+  and removes any which were already stored if a later one fails.  Plugins
+  should override this method to store the secrets within a single storage
+  transaction instead.
+ */
+Result StoragePlugin::setSecrets(const QString &collectionName, const QVector<Secret> &secrets)
+{
+    for (int i = 0; i < secrets.size(); ++i) {
+        const Secret &secret = secrets.at(i);
+        Result result = setSecret(collectionName, secret.name(), secret.data(), secret.filterData());
+        if (result.code() != Result::Succeeded) {
+            for (int j = 0; j < i; ++j) {
+                removeSecret(collectionName, secrets.at(j).name());
+            }
+            return result;
+        }
+    }
+    return Result(Result::Succeeded);
+}
+
 /*!
   \fn StoragePlugin::getSecret(const QString &collectionName, const QString &secretName, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData)
   \brief Write the secret data and filter data associated with the secret
@@ -883,12 +989,66 @@ EncryptedStoragePlugin::~EncryptedStoragePlugin()
          operations offered by this plugin from the given \a authenticationCode
          and \a salt, and write it to the out-parameter \a key.
 
+  The derived key must depend only on the \a authenticationCode and \a salt.
+  This function may be invoked from a dedicated key derivation thread,
+  concurrently with other operations of the plugin, and so must not modify
+  the state of the plugin.  The secrets service may cache the derived key
+  for a short time, and reuse it rather than calling this function again.
+
   If the plugin itself is locked, this function should return a
   Sailfish::Secrets::Result with the result code set to
   Sailfish::Secrets::Result::Failed and the error code set to
   Sailfish::Secrets::Result::SecretsPluginIsLockedError.
  */
 
+/*!
+  \brief Derive an encryption key from the given \a authenticationCode and
+         \a salt using the key derivation \a parameters, and write it to
+         the out-parameter \a key.
+
+  The \a parameters are an opaque, plugin-defined description of the key
+  derivation function and its cost (e.g. as returned from a previous call
+  to calibrateKeyDerivation()), which the secrets service stores alongside
+  each collection.  Empty \a parameters denote the plugin's original key
+  derivation, so that keys derived for existing collections do not change.
+
+  The same threading and caching considerations apply as for
+  deriveKeyFromCode().
+
+  The default implementation calls deriveKeyFromCode() if the
+  \a parameters are empty, and otherwise returns a
+  Sailfish::Secrets::Result with the error code set to
+  Sailfish::Secrets::Result::OperationNotSupportedError.
+ */
+Result EncryptedStoragePlugin::deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key)
+{
+    if (parameters.isEmpty()) {
+        return deriveKeyFromCode(authenticationCode, salt, key);
+    }
+    return Result(Result::OperationNotSupportedError,
+                  QLatin1String("This plugin does not support key derivation parameters"));
+}
+
+/*!
+  \brief Determine the strongest key derivation parameters supported by this
+         plugin whose cost on this device is approximately \a targetDuration
+         milliseconds, and write them to the out-parameter \a parameters.
+
+  The secrets service calls this function once per device, and uses the
+  resulting \a parameters for newly created collections, and to upgrade
+  existing collections when they are next unlocked.  The plugin should
+  never return parameters which are weaker than its original key derivation.
+
+  The default implementation writes empty \a parameters, which causes the
+  plugin's original key derivation to be used.
+ */
+Result EncryptedStoragePlugin::calibrateKeyDerivation(int targetDuration, QByteArray *parameters)
+{
+    Q_UNUSED(targetDuration);
+    *parameters = QByteArray();
+    return Result(Result::Succeeded);
+}
+
 /*!
   \fn EncryptedStoragePlugin::setEncryptionKey(const QString &collectionName, const QByteArray &key)
   \brief Unlock the collection identified by the given \a collectionName
@@ -997,6 +1157,39 @@ EncryptedStoragePlugin::~EncryptedStoragePlugin()
   Sailfish::Secrets::Result::DatabaseError.
  */
 
+/*!
+  \brief Store each of the given \a secrets into the collection identified
+         by the given \a collectionName.
+
+  The name, data and filter data of each secret in \a secrets are used;
+  its collection and storage plugin names are ignored.  The errors which
+  may be returned are the same as for \l setSecret(), including
+  Sailfish::Secrets::Result::CollectionIsLockedError if the collection is locked.
+
+  Either every secret should be stored, or (if any of them cannot be
+  stored) none of them should be, so that a failed bulk write (e.g. of an
+  imported collection archive) does not leave a partial set of secrets.
+
+  The default implementation calls setSecret() for each secret in turn,
+  and removes any which were already stored if a later one fails.  Plugins
+  should override this method to store the secrets within a single storage
+  transaction instead.
+ */
+Result EncryptedStoragePlugin::setSecrets(const QString &collectionName, const QVector<Secret> &secrets)
+{
+    for (int i = 0; i < secrets.size(); ++i) {
+        const Secret &secret = secrets.at(i);
+        Result result = setSecret(collectionName, secret.name(), secret.data(), secret.filterData());
+        if (result.code() != Result::Succeeded) {
+            for (int j = 0; j < i; ++j) {
+                removeSecret(collectionName, secrets.at(j).name());
+            }
+            return result;
+        }
+    }
+    return Result(Result::Succeeded);
+}
+
 /*!
   \fn EncryptedStoragePlugin::getSecret(const QString &collectionName, const QString &secretName, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData)
   \brief Retrieve the secret data and filter data for the secret identified
@@ -21,10 +21,13 @@
 #include <QtCore/QVector>
 #include <QtCore/QLoggingCategory>
 
-#define Sailfish_Secrets_StoragePlugin_IID "org.sailfishos.secrets.StoragePlugin/1.0"
-#define Sailfish_Secrets_EncryptionPlugin_IID "org.sailfishos.secrets.EncryptionPlugin/1.0"
-#define Sailfish_Secrets_EncryptedStoragePlugin_IID "org.sailfishos.secrets.EncryptedStoragePlugin/1.0"
-#define Sailfish_Secrets_AuthenticationPlugin_IID "org.sailfishos.secrets.AuthenticationPlugin/1.0"
+// PluginBase is a virtual base of every plugin interface, so adding a virtual
+// method to it changes the layout of all of them: version 2.0 of the plugin
+// interfaces is not binary compatible with plugins built against version 1.0.
+#define Sailfish_Secrets_StoragePlugin_IID "org.sailfishos.secrets.StoragePlugin/2.0"
+#define Sailfish_Secrets_EncryptionPlugin_IID "org.sailfishos.secrets.EncryptionPlugin/2.0"
+#define Sailfish_Secrets_EncryptedStoragePlugin_IID "org.sailfishos.secrets.EncryptedStoragePlugin/2.0"
+#define Sailfish_Secrets_AuthenticationPlugin_IID "org.sailfishos.secrets.AuthenticationPlugin/2.0"
 
 SAILFISH_SECRETS_API Q_DECLARE_LOGGING_CATEGORY(lcSailfishSecretsPlugin)
 
@@ -51,6 +54,9 @@ public:
     virtual bool lock();
     virtual bool unlock(const QByteArray &lockCode);
     virtual bool setLockCode(const QByteArray &oldLockCode, const QByteArray &newLockCode);
+
+    // added in version 2.0 of the plugin interfaces.
+    virtual bool supportsConcurrentOperations() const;
 };
 
 class SAILFISH_SECRETS_API EncryptionPlugin : public virtual Sailfish::Secrets::PluginBase
@@ -78,6 +84,10 @@ public:
     virtual Sailfish::Secrets::Result deriveKeyFromCode(const QByteArray &authenticationCode, const QByteArray &salt, QByteArray *key) = 0;
     virtual Sailfish::Secrets::Result encryptSecret(const QByteArray &plaintext, const QByteArray &key, QByteArray *encrypted) = 0;
     virtual Sailfish::Secrets::Result decryptSecret(const QByteArray &encrypted, const QByteArray &key, QByteArray *plaintext) = 0;
+
+    // added in version 2.0 of the plugin interfaces.
+    virtual Sailfish::Secrets::Result deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key);
+    virtual Sailfish::Secrets::Result calibrateKeyDerivation(int targetDuration, QByteArray *parameters);
 };
 
 class SAILFISH_SECRETS_API StoragePlugin : public virtual Sailfish::Secrets::PluginBase
@@ -116,6 +126,9 @@ public:
             const QByteArray &oldkey,
             const QByteArray &newkey,
             Sailfish::Secrets::EncryptionPlugin *plugin) = 0;
+
+    // added in version 2.0 of the plugin interfaces.
+    virtual Sailfish::Secrets::Result setSecrets(const QString &collectionName, const QVector<Sailfish::Secrets::Secret> &secrets);
 };
 
 class SAILFISH_SECRETS_API EncryptedStoragePlugin : public virtual Sailfish::Secrets::PluginBase
@@ -148,6 +161,11 @@ public:
     virtual Sailfish::Secrets::Result accessSecret(const QString &secretName, const QByteArray &key, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData) = 0;
     virtual Sailfish::Secrets::Result removeSecret(const QString &secretName) = 0;
     virtual Sailfish::Secrets::Result reencryptSecret(const QString &secretName, const QByteArray &oldkey, const QByteArray &newkey) = 0;
+
+    // added in version 2.0 of the plugin interfaces.
+    virtual Sailfish::Secrets::Result setSecrets(const QString &collectionName, const QVector<Sailfish::Secrets::Secret> &secrets);
+    virtual Sailfish::Secrets::Result deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key);
+    virtual Sailfish::Secrets::Result calibrateKeyDerivation(int targetDuration, QByteArray *parameters);
 };
 
 class SAILFISH_SECRETS_API AuthenticationPlugin : public QObject, public virtual PluginBase
@@ -12,8 +12,11 @@ INCLUDEPATH += $$PWD/../
 DEPENDPATH += $$INCLUDEPATH $$PWD
 
 PUBLIC_HEADERS += \
+    $$PWD/batchrequest.h \
+    $$PWD/collectionarchiverequest.h \
     $$PWD/collectionnamesrequest.h \
     $$PWD/createcollectionrequest.h \
+    $$PWD/daemonstatisticsrequest.h \
     $$PWD/deletecollectionrequest.h \
     $$PWD/deletesecretrequest.h \
     $$PWD/findsecretsrequest.h \
@@ -39,8 +42,11 @@ INTERNAL_PUBLIC_HEADERS += \
     $$PWD/serialization_p.h
 
 PRIVATE_HEADERS += \
+    $$PWD/batchrequest_p.h \
+    $$PWD/collectionarchiverequest_p.h \
     $$PWD/collectionnamesrequest_p.h \
     $$PWD/createcollectionrequest_p.h \
+    $$PWD/daemonstatisticsrequest_p.h \
     $$PWD/deletecollectionrequest_p.h \
     $$PWD/deletesecretrequest_p.h \
     $$PWD/findsecretsrequest_p.h \
@@ -65,8 +71,11 @@ HEADERS += \
     $$PRIVATE_HEADERS
 
 SOURCES += \
+    $$PWD/batchrequest.cpp \
+    $$PWD/collectionarchiverequest.cpp \
     $$PWD/collectionnamesrequest.cpp \
     $$PWD/createcollectionrequest.cpp \
+    $$PWD/daemonstatisticsrequest.cpp \
     $$PWD/deletecollectionrequest.cpp \
     $$PWD/deletesecretrequest.cpp \
     $$PWD/findsecretsrequest.cpp \
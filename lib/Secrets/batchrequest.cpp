@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "Secrets/batchrequest.h"
+#include "Secrets/batchrequest_p.h"
+
+#include "Secrets/secretmanager.h"
+#include "Secrets/secretmanager_p.h"
+#include "Secrets/serialization_p.h"
+
+#include <QtDBus/QDBusPendingReply>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+using namespace Sailfish::Secrets;
+
+BatchRequestPrivate::BatchRequestPrivate()
+    : m_userInteractionMode(SecretManager::PreventInteraction)
+    , m_status(Request::Inactive)
+{
+}
+
+/*!
+  \class BatchRequest
+  \brief Allows a client to perform many secret operations in a single request to the system's secure secret storage service
+  \inmodule SailfishSecrets
+
+  Each operation added to the batch is equivalent to a separate
+  \l{StoreSecretRequest}, \l{StoredSecretRequest} or \l{DeleteSecretRequest},
+  however the whole batch is sent to the Secrets service in a single
+  round trip and is performed by the service as a single request.
+  This avoids the per-request overhead when an application needs to
+  store or retrieve a large number of secrets (e.g. during provisioning).
+
+  The operations are performed in the order in which they were added,
+  and the result of each operation is reported in the corresponding
+  element of results().  The result() of the batch itself will only be
+  \c Failed if the batch as a whole could not be performed (for example,
+  if the secrets service is locked); a batch whose individual operations
+  failed will still succeed, so clients must check the results() vector.
+
+  Note that only secrets which are stored in collections may be stored
+  via a batch.  Standalone secrets may be retrieved or deleted, however.
+
+  An example of storing several secrets in a batch follows:
+
+  \code
+  Sailfish::Secrets::SecretManager sm;
+  Sailfish::Secrets::BatchRequest br;
+  br.setManager(&sm);
+  br.setUserInteractionMode(Sailfish::Secrets::SecretManager::PreventInteraction);
+  for (const Sailfish::Secrets::Secret &secret : provisionedSecrets) {
+      br.addStoreSecretOperation(secret);
+  }
+  br.startRequest(); // status() will change to Finished when complete
+  \endcode
+ */
+
+/*!
+  \brief Constructs a new BatchRequest object with the given \a parent.
+ */
+BatchRequest::BatchRequest(QObject *parent)
+    : Request(parent)
+    , d_ptr(new BatchRequestPrivate)
+{
+}
+
+/*!
+  \brief Destroys the BatchRequest
+ */
+BatchRequest::~BatchRequest()
+{
+}
+
+void BatchRequest::addOperation(BatchRequest::OperationType type, const Secret &secret)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active) {
+        d->m_operations.append(static_cast<int>(type));
+        d->m_operationSecrets.append(secret);
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit operationsChanged();
+    }
+}
+
+/*!
+  \brief Adds an operation to the batch which will store the given \a secret into its collection
+
+  The identifier of the \a secret must identify a collection-stored secret.
+ */
+void BatchRequest::addStoreSecretOperation(const Secret &secret)
+{
+    addOperation(StoreSecretOperation, secret);
+}
+
+/*!
+  \brief Adds an operation to the batch which will retrieve the secret identified by \a ident
+
+  The retrieved secret will be reported in the corresponding element of secrets().
+ */
+void BatchRequest::addStoredSecretOperation(const Secret::Identifier &ident)
+{
+    addOperation(StoredSecretOperation, Secret(ident));
+}
+
+/*!
+  \brief Adds an operation to the batch which will delete the secret identified by \a ident
+ */
+void BatchRequest::addDeleteSecretOperation(const Secret::Identifier &ident)
+{
+    addOperation(DeleteSecretOperation, Secret(ident));
+}
+
+/*!
+  \brief Removes all of the operations from the batch
+ */
+void BatchRequest::clearOperations()
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && !d->m_operations.isEmpty()) {
+        d->m_operations.clear();
+        d->m_operationSecrets.clear();
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit operationsChanged();
+    }
+}
+
+/*!
+  \brief Returns the number of operations in the batch
+ */
+int BatchRequest::operationCount() const
+{
+    Q_D(const BatchRequest);
+    return d->m_operations.size();
+}
+
+/*!
+  \brief Returns the type of the operation at the given \a index in the batch
+ */
+BatchRequest::OperationType BatchRequest::operationType(int index) const
+{
+    Q_D(const BatchRequest);
+    return static_cast<BatchRequest::OperationType>(d->m_operations.value(index));
+}
+
+/*!
+  \brief Returns the user interaction mode required when performing the operations (e.g. if a custom lock code must be requested from the user)
+ */
+SecretManager::UserInteractionMode BatchRequest::userInteractionMode() const
+{
+    Q_D(const BatchRequest);
+    return d->m_userInteractionMode;
+}
+
+/*!
+  \brief Sets the user interaction mode required when performing the operations (e.g. if a custom lock code must be requested from the user) to \a mode
+ */
+void BatchRequest::setUserInteractionMode(SecretManager::UserInteractionMode mode)
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && d->m_userInteractionMode != mode) {
+        d->m_userInteractionMode = mode;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit userInteractionModeChanged();
+    }
+}
+
+/*!
+  \brief Returns the results of the operations in the batch, in the order in which they were added
+
+  Note: this value is only valid if the status of the request is Request::Finished.
+ */
+QVector<Result> BatchRequest::results() const
+{
+    Q_D(const BatchRequest);
+    return d->m_results;
+}
+
+/*!
+  \brief Returns the secrets retrieved by the operations in the batch, in the order in which they were added
+
+  Only the elements which correspond to a \c StoredSecretOperation will
+  contain secret data; the other elements will contain only the identifier
+  of the secret which the operation affected.
+
+  Note: this value is only valid if the status of the request is Request::Finished.
+ */
+QVector<Secret> BatchRequest::secrets() const
+{
+    Q_D(const BatchRequest);
+    return d->m_secrets;
+}
+
+Request::Status BatchRequest::status() const
+{
+    Q_D(const BatchRequest);
+    return d->m_status;
+}
+
+Result BatchRequest::result() const
+{
+    Q_D(const BatchRequest);
+    return d->m_result;
+}
+
+SecretManager *BatchRequest::manager() const
+{
+    Q_D(const BatchRequest);
+    return d->m_manager.data();
+}
+
+void BatchRequest::setManager(SecretManager *manager)
+{
+    Q_D(BatchRequest);
+    if (d->m_manager.data() != manager) {
+        d->m_manager = manager;
+        emit managerChanged();
+    }
+}
+
+void BatchRequest::startRequest()
+{
+    Q_D(BatchRequest);
+    if (d->m_status != Request::Active && !d->m_manager.isNull()) {
+        d->m_status = Request::Active;
+        emit statusChanged();
+        if (d->m_result.code() != Result::Pending) {
+            d->m_result = Result(Result::Pending);
+            emit resultChanged();
+        }
+
+        QDBusPendingReply<Result, QVector<Result>, QVector<Secret> > reply
+                = d->m_manager->d_ptr->batch(d->m_operations,
+                                             d->m_operationSecrets,
+                                             d->m_userInteractionMode);
+        if (reply.isFinished()
+                // work around a bug in QDBusAbstractInterface / QDBusConnection...
+                && reply.argumentAt<0>().code() != Sailfish::Secrets::Result::Succeeded) {
+            d->m_status = Request::Finished;
+            d->m_result = reply.argumentAt<0>();
+            d->m_results.clear();
+            d->m_secrets.clear();
+            emit statusChanged();
+            emit resultChanged();
+            emit resultsChanged();
+        } else {
+            d->m_watcher.reset(new QDBusPendingCallWatcher(reply));
+            connect(d->m_watcher.data(), &QDBusPendingCallWatcher::finished,
+                    [this] {
+                QDBusPendingCallWatcher *watcher = this->d_ptr->m_watcher.take();
+                QDBusPendingReply<Result, QVector<Result>, QVector<Secret> > reply = *watcher;
+                this->d_ptr->m_status = Request::Finished;
+                if (reply.isError()) {
+                    this->d_ptr->m_result = Result(Result::DaemonError,
+                                                   reply.error().message());
+                    this->d_ptr->m_results.clear();
+                    this->d_ptr->m_secrets.clear();
+                } else {
+                    this->d_ptr->m_result = reply.argumentAt<0>();
+                    this->d_ptr->m_results = reply.argumentAt<1>();
+                    this->d_ptr->m_secrets = reply.argumentAt<2>();
+                }
+                watcher->deleteLater();
+                emit this->statusChanged();
+                emit this->resultChanged();
+                emit this->resultsChanged();
+            });
+        }
+    }
+}
+
+void BatchRequest::waitForFinished()
+{
+    Q_D(BatchRequest);
+    if (d->m_status == Request::Active && !d->m_watcher.isNull()) {
+        d->m_watcher->waitForFinished();
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHSECRETS_BATCHREQUEST_H
+#define LIBSAILFISHSECRETS_BATCHREQUEST_H
+
+#include "Secrets/secretsglobal.h"
+#include "Secrets/request.h"
+#include "Secrets/secret.h"
+#include "Secrets/secretmanager.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+class BatchRequestPrivate;
+class SAILFISH_SECRETS_API BatchRequest : public Sailfish::Secrets::Request
+{
+    Q_OBJECT
+    Q_PROPERTY(int operationCount READ operationCount NOTIFY operationsChanged)
+    Q_PROPERTY(Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode READ userInteractionMode WRITE setUserInteractionMode NOTIFY userInteractionModeChanged)
+
+public:
+    enum OperationType {
+        StoreSecretOperation = 0,
+        StoredSecretOperation,
+        DeleteSecretOperation
+    };
+    Q_ENUM(OperationType)
+
+    BatchRequest(QObject *parent = Q_NULLPTR);
+    ~BatchRequest();
+
+    void addStoreSecretOperation(const Sailfish::Secrets::Secret &secret);
+    void addStoredSecretOperation(const Sailfish::Secrets::Secret::Identifier &ident);
+    void addDeleteSecretOperation(const Sailfish::Secrets::Secret::Identifier &ident);
+    void clearOperations();
+
+    int operationCount() const;
+    Sailfish::Secrets::BatchRequest::OperationType operationType(int index) const;
+
+    Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode() const;
+    void setUserInteractionMode(Sailfish::Secrets::SecretManager::UserInteractionMode mode);
+
+    QVector<Sailfish::Secrets::Result> results() const;
+    QVector<Sailfish::Secrets::Secret> secrets() const;
+
+    Sailfish::Secrets::Request::Status status() const Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result result() const Q_DECL_OVERRIDE;
+
+    Sailfish::Secrets::SecretManager *manager() const Q_DECL_OVERRIDE;
+    void setManager(Sailfish::Secrets::SecretManager *manager) Q_DECL_OVERRIDE;
+
+    void startRequest() Q_DECL_OVERRIDE;
+    void waitForFinished() Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void operationsChanged();
+    void userInteractionModeChanged();
+    void resultsChanged();
+
+private:
+    void addOperation(Sailfish::Secrets::BatchRequest::OperationType type, const Sailfish::Secrets::Secret &secret);
+
+    QScopedPointer<BatchRequestPrivate> const d_ptr;
+    Q_DECLARE_PRIVATE(BatchRequest)
+};
+
+} // namespace Secrets
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHSECRETS_BATCHREQUEST_H
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "Secrets/collectionarchiverequest.h"
+#include "Secrets/collectionarchiverequest_p.h"
+
+#include "Secrets/secretmanager.h"
+#include "Secrets/secretmanager_p.h"
+#include "Secrets/serialization_p.h"
+
+#include <QtDBus/QDBusPendingReply>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+using namespace Sailfish::Secrets;
+
+CollectionArchiveRequestPrivate::CollectionArchiveRequestPrivate()
+    : m_operation(CollectionArchiveRequest::ExportCollection)
+    , m_fileDescriptor(-1)
+    , m_userInteractionMode(SecretManager::PreventInteraction)
+    , m_status(Request::Inactive)
+{
+}
+
+/*!
+  \class CollectionArchiveRequest
+  \brief Allows a client request that the system secrets service export a collection to, or import a collection from, an archive file
+  \inmodule SailfishSecrets
+
+  This class allows clients to request the Secrets service to write all of the
+  secrets stored in the collection with the particular collectionName() in the
+  storage plugin with the specified storagePluginName() to an archive file
+  (if the operation() is \c ExportCollection), or to store all of the secrets
+  contained in an archive file into that collection (if the operation() is
+  \c ImportCollection).  The collection must already exist when importing,
+  and must not already contain a secret with the name of any archived secret.
+
+  The archive is read from or written to the regular file referred to by the
+  specified fileDescriptor(), which is passed to the Secrets service and is
+  processed in a sequence of bounded frames, so that even very large
+  collections are never held in memory (or sent over the bus) all at once.
+  The contents of the archive are encrypted and authenticated with keys which
+  are derived from the given passphrase(); the same passphrase must be
+  supplied in order to import the archive.  An archive which was truncated,
+  modified or protected with a different passphrase is rejected before any of
+  its secrets are stored.
+
+  If the calling application is not the owner of the collection, the user's
+  permission may be required, and if the collection is locked the user may be
+  asked for its lock code (unless the given \a userInteractionMode is
+  \a PreventInteraction in which case the request will fail).
+
+  An example of exporting a collection is as follows:
+
+  \code
+  QFile archive(QStringLiteral("/home/nemo/ExampleCollection.archive"));
+  archive.open(QIODevice::ReadWrite | QIODevice::Truncate);
+
+  Sailfish::Secrets::SecretManager sm;
+  Sailfish::Secrets::CollectionArchiveRequest car;
+  car.setManager(&sm);
+  car.setOperation(Sailfish::Secrets::CollectionArchiveRequest::ExportCollection);
+  car.setStoragePluginName(Sailfish::Secrets::SecretManager::DefaultEncryptedStoragePluginName);
+  car.setCollectionName(QLatin1String("ExampleCollection"));
+  car.setFileDescriptor(archive.handle());
+  car.setPassphrase(QByteArray("example archive passphrase"));
+  car.setUserInteractionMode(Sailfish::Secrets::SecretManager::SystemInteraction);
+  car.startRequest(); // status() will change to Finished when complete
+  \endcode
+ */
+
+/*!
+  \brief Constructs a new CollectionArchiveRequest object with the given \a parent.
+ */
+CollectionArchiveRequest::CollectionArchiveRequest(QObject *parent)
+    : Request(parent)
+    , d_ptr(new CollectionArchiveRequestPrivate)
+{
+}
+
+/*!
+  \brief Destroys the CollectionArchiveRequest
+ */
+CollectionArchiveRequest::~CollectionArchiveRequest()
+{
+}
+
+/*!
+  \brief Returns the operation which the client wishes to perform
+ */
+CollectionArchiveRequest::Operation CollectionArchiveRequest::operation() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_operation;
+}
+
+/*!
+  \brief Sets the operation which the client wishes to perform to \a operation
+ */
+void CollectionArchiveRequest::setOperation(CollectionArchiveRequest::Operation operation)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && d->m_operation != operation) {
+        d->m_operation = operation;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit operationChanged();
+    }
+}
+
+/*!
+  \brief Returns the name of the collection which the client wishes to export or import
+ */
+QString CollectionArchiveRequest::collectionName() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_collectionName;
+}
+
+/*!
+  \brief Sets the name of the collection which the client wishes to export or import to \a name
+ */
+void CollectionArchiveRequest::setCollectionName(const QString &name)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && d->m_collectionName != name) {
+        d->m_collectionName = name;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit collectionNameChanged();
+    }
+}
+
+/*!
+  \brief Returns the name of the storage plugin which stores the collection
+ */
+QString CollectionArchiveRequest::storagePluginName() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_storagePluginName;
+}
+
+/*!
+  \brief Sets the name of the storage plugin which stores the collection to \a pluginName
+ */
+void CollectionArchiveRequest::setStoragePluginName(const QString &pluginName)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && d->m_storagePluginName != pluginName) {
+        d->m_storagePluginName = pluginName;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit storagePluginNameChanged();
+    }
+}
+
+/*!
+  \brief Returns the file descriptor of the archive file
+ */
+int CollectionArchiveRequest::fileDescriptor() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_fileDescriptor;
+}
+
+/*!
+  \brief Sets the file descriptor of the archive file to \a fd
+
+  The file descriptor must refer to a regular file, which must be readable
+  when importing and writable when exporting.  It remains owned by the client.
+ */
+void CollectionArchiveRequest::setFileDescriptor(int fd)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && d->m_fileDescriptor != fd) {
+        d->m_fileDescriptor = fd;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit fileDescriptorChanged();
+    }
+}
+
+/*!
+  \brief Returns the passphrase from which the archive keys are derived
+ */
+QByteArray CollectionArchiveRequest::passphrase() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_passphrase;
+}
+
+/*!
+  \brief Sets the passphrase from which the archive keys are derived to \a passphrase
+ */
+void CollectionArchiveRequest::setPassphrase(const QByteArray &passphrase)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && d->m_passphrase != passphrase) {
+        d->m_passphrase = passphrase;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit passphraseChanged();
+    }
+}
+
+/*!
+  \brief Returns the user interaction mode required when exporting or importing the collection (e.g. if a custom lock code must be requested from the user)
+ */
+SecretManager::UserInteractionMode CollectionArchiveRequest::userInteractionMode() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_userInteractionMode;
+}
+
+/*!
+  \brief Sets the user interaction mode required when exporting or importing the collection (e.g. if a custom lock code must be requested from the user) to \a mode
+ */
+void CollectionArchiveRequest::setUserInteractionMode(SecretManager::UserInteractionMode mode)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && d->m_userInteractionMode != mode) {
+        d->m_userInteractionMode = mode;
+        if (d->m_status == Request::Finished) {
+            d->m_status = Request::Inactive;
+            emit statusChanged();
+        }
+        emit userInteractionModeChanged();
+    }
+}
+
+Request::Status CollectionArchiveRequest::status() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_status;
+}
+
+Result CollectionArchiveRequest::result() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_result;
+}
+
+SecretManager *CollectionArchiveRequest::manager() const
+{
+    Q_D(const CollectionArchiveRequest);
+    return d->m_manager.data();
+}
+
+void CollectionArchiveRequest::setManager(SecretManager *manager)
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_manager.data() != manager) {
+        d->m_manager = manager;
+        emit managerChanged();
+    }
+}
+
+void CollectionArchiveRequest::startRequest()
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status != Request::Active && !d->m_manager.isNull()) {
+        d->m_status = Request::Active;
+        emit statusChanged();
+        if (d->m_result.code() != Result::Pending) {
+            d->m_result = Result(Result::Pending);
+            emit resultChanged();
+        }
+
+        QDBusPendingReply<Result> reply = d->m_operation == CollectionArchiveRequest::ImportCollection
+                ? d->m_manager->d_ptr->importCollection(
+                                                    d->m_collectionName,
+                                                    d->m_storagePluginName,
+                                                    d->m_fileDescriptor,
+                                                    d->m_passphrase,
+                                                    d->m_userInteractionMode)
+                : d->m_manager->d_ptr->exportCollection(
+                                                    d->m_collectionName,
+                                                    d->m_storagePluginName,
+                                                    d->m_fileDescriptor,
+                                                    d->m_passphrase,
+                                                    d->m_userInteractionMode);
+        if (!reply.isValid() && !reply.error().message().isEmpty()) {
+            d->m_status = Request::Finished;
+            d->m_result = Result(Result::SecretManagerNotInitializedError,
+                                 reply.error().message());
+            emit statusChanged();
+            emit resultChanged();
+        } else if (reply.isFinished()
+                // work around a bug in QDBusAbstractInterface / QDBusConnection...
+                && reply.argumentAt<0>().code() != Sailfish::Secrets::Result::Succeeded) {
+            d->m_status = Request::Finished;
+            d->m_result = reply.argumentAt<0>();
+            emit statusChanged();
+            emit resultChanged();
+        } else {
+            d->m_watcher.reset(new QDBusPendingCallWatcher(reply));
+            connect(d->m_watcher.data(), &QDBusPendingCallWatcher::finished,
+                    [this] {
+                QDBusPendingCallWatcher *watcher = this->d_ptr->m_watcher.take();
+                QDBusPendingReply<Result> reply = *watcher;
+                this->d_ptr->m_status = Request::Finished;
+                if (reply.isError()) {
+                    this->d_ptr->m_result = Result(Result::DaemonError,
+                                                   reply.error().message());
+                } else {
+                    this->d_ptr->m_result = reply.argumentAt<0>();
+                }
+                watcher->deleteLater();
+                emit this->statusChanged();
+                emit this->resultChanged();
+            });
+        }
+    }
+}
+
+void CollectionArchiveRequest::waitForFinished()
+{
+    Q_D(CollectionArchiveRequest);
+    if (d->m_status == Request::Active && !d->m_watcher.isNull()) {
+        d->m_watcher->waitForFinished();
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHSECRETS_COLLECTIONARCHIVEREQUEST_H
+#define LIBSAILFISHSECRETS_COLLECTIONARCHIVEREQUEST_H
+
+#include "Secrets/secretsglobal.h"
+#include "Secrets/request.h"
+#include "Secrets/secretmanager.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+class CollectionArchiveRequestPrivate;
+class SAILFISH_SECRETS_API CollectionArchiveRequest : public Sailfish::Secrets::Request
+{
+    Q_OBJECT
+    Q_PROPERTY(Operation operation READ operation WRITE setOperation NOTIFY operationChanged)
+    Q_PROPERTY(QString collectionName READ collectionName WRITE setCollectionName NOTIFY collectionNameChanged)
+    Q_PROPERTY(QString storagePluginName READ storagePluginName WRITE setStoragePluginName NOTIFY storagePluginNameChanged)
+    Q_PROPERTY(int fileDescriptor READ fileDescriptor WRITE setFileDescriptor NOTIFY fileDescriptorChanged)
+    Q_PROPERTY(QByteArray passphrase READ passphrase WRITE setPassphrase NOTIFY passphraseChanged)
+    Q_PROPERTY(Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode READ userInteractionMode WRITE setUserInteractionMode NOTIFY userInteractionModeChanged)
+
+public:
+    enum Operation {
+        ExportCollection = 0,
+        ImportCollection
+    };
+    Q_ENUM(Operation)
+
+    CollectionArchiveRequest(QObject *parent = Q_NULLPTR);
+    ~CollectionArchiveRequest();
+
+    Operation operation() const;
+    void setOperation(Operation operation);
+
+    QString collectionName() const;
+    void setCollectionName(const QString &collectionName);
+
+    QString storagePluginName() const;
+    void setStoragePluginName(const QString &pluginName);
+
+    int fileDescriptor() const;
+    void setFileDescriptor(int fd);
+
+    QByteArray passphrase() const;
+    void setPassphrase(const QByteArray &passphrase);
+
+    Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode() const;
+    void setUserInteractionMode(Sailfish::Secrets::SecretManager::UserInteractionMode mode);
+
+    Sailfish::Secrets::Request::Status status() const Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result result() const Q_DECL_OVERRIDE;
+
+    Sailfish::Secrets::SecretManager *manager() const Q_DECL_OVERRIDE;
+    void setManager(Sailfish::Secrets::SecretManager *manager) Q_DECL_OVERRIDE;
+
+    void startRequest() Q_DECL_OVERRIDE;
+    void waitForFinished() Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void operationChanged();
+    void collectionNameChanged();
+    void storagePluginNameChanged();
+    void fileDescriptorChanged();
+    void passphraseChanged();
+    void userInteractionModeChanged();
+
+private:
+    QScopedPointer<CollectionArchiveRequestPrivate> const d_ptr;
+    Q_DECLARE_PRIVATE(CollectionArchiveRequest)
+};
+
+} // namespace Secrets
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHSECRETS_COLLECTIONARCHIVEREQUEST_H
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHSECRETS_COLLECTIONARCHIVEREQUEST_P_H
+#define LIBSAILFISHSECRETS_COLLECTIONARCHIVEREQUEST_P_H
+
+#include "Secrets/secretsglobal.h"
+#include "Secrets/collectionarchiverequest.h"
+#include "Secrets/secretmanager.h"
+
+#include <QtCore/QPointer>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+
+#include <QtDBus/QDBusPendingCallWatcher>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+class CollectionArchiveRequestPrivate
+{
+    Q_DISABLE_COPY(CollectionArchiveRequestPrivate)
+
+public:
+    explicit CollectionArchiveRequestPrivate();
+
+    QPointer<Sailfish::Secrets::SecretManager> m_manager;
+    Sailfish::Secrets::CollectionArchiveRequest::Operation m_operation;
+    QString m_collectionName;
+    QString m_storagePluginName;
+    int m_fileDescriptor;
+    QByteArray m_passphrase;
+    Sailfish::Secrets::SecretManager::UserInteractionMode m_userInteractionMode;
+
+    QScopedPointer<QDBusPendingCallWatcher> m_watcher;
+    Sailfish::Secrets::Request::Status m_status;
+    Sailfish::Secrets::Result m_result;
+};
+
+} // namespace Secrets
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHSECRETS_COLLECTIONARCHIVEREQUEST_P_H
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "Secrets/daemonstatisticsrequest.h"
+#include "Secrets/daemonstatisticsrequest_p.h"
+
+#include "Secrets/secretmanager.h"
+#include "Secrets/secretmanager_p.h"
+#include "Secrets/serialization_p.h"
+
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusPendingReply>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+using namespace Sailfish::Secrets;
+
+namespace {
+    // Nested maps and lists within the statistics are received as
+    // QDBusArgument values, so convert them into plain variants.
+    QVariant demarshallValue(const QVariant &value)
+    {
+        if (value.userType() == qMetaTypeId<QDBusArgument>()) {
+            const QDBusArgument argument = value.value<QDBusArgument>();
+            if (argument.currentType() == QDBusArgument::MapType) {
+                QVariantMap map;
+                argument.beginMap();
+                while (!argument.atEnd()) {
+                    QString key;
+                    QVariant entry;
+                    argument.beginMapEntry();
+                    argument >> key >> entry;
+                    argument.endMapEntry();
+                    map.insert(key, demarshallValue(entry));
+                }
+                argument.endMap();
+                return map;
+            } else if (argument.currentType() == QDBusArgument::ArrayType) {
+                QVariantList list;
+                argument.beginArray();
+                while (!argument.atEnd()) {
+                    QVariant entry;
+                    argument >> entry;
+                    list.append(demarshallValue(entry));
+                }
+                argument.endArray();
+                return list;
+            }
+        } else if (value.type() == QVariant::Map) {
+            QVariantMap map = value.toMap();
+            for (QVariantMap::iterator it = map.begin(); it != map.end(); ++it) {
+                it.value() = demarshallValue(it.value());
+            }
+            return map;
+        }
+        return value;
+    }
+}
+
+DaemonStatisticsRequestPrivate::DaemonStatisticsRequestPrivate()
+    : m_status(Request::Inactive)
+{
+}
+
+/*!
+  \class DaemonStatisticsRequest
+  \brief Allows a client to request runtime statistics from the secrets daemon.
+  \inmodule SailfishSecrets
+
+  The statistics describe the latency of requests of each type (time spent
+  queued, executing, and waiting for authentication or user input), the
+  latency of calls into each plugin, the utilisation of the plugin thread
+  pools, and the current depth of the request queues.  They are intended
+  to help diagnose performance problems, and only platform applications
+  may read them.
+
+  \code
+  Sailfish::Secrets::SecretManager man;
+  Sailfish::Secrets::DaemonStatisticsRequest req;
+  req.setManager(&man);
+  req.startRequest(); // status() will change to Finished when complete
+
+  // real clients should not use waitForFinished() because it blocks
+  req.waitForFinished();
+  qDebug() << "plugin statistics:" << req.statistics().value("plugins");
+  \endcode
+ */
+
+/*!
+  \brief Constructs a new DaemonStatisticsRequest object with the given \a parent.
+ */
+DaemonStatisticsRequest::DaemonStatisticsRequest(QObject *parent)
+    : Request(parent)
+    , d_ptr(new DaemonStatisticsRequestPrivate)
+{
+}
+
+/*!
+  \brief Destroys the DaemonStatisticsRequest
+ */
+DaemonStatisticsRequest::~DaemonStatisticsRequest()
+{
+}
+
+/*!
+  \brief Returns the statistics reported by the daemon.
+
+  The map contains the following entries: \c uptimeMs, \c secrets and
+  \c crypto (per-request-type latencies, per-priority latencies and queue
+  depth of each API), \c plugins (call counts and latency histograms of
+  each plugin), \c threadPools (utilisation of each plugin thread pool),
+  \c startup (the cost of each daemon startup phase, and of the
+  initialization of each storage plugin) and \c metadataDatabases (the
+  prepared statement cache usage of each plugin metadata database).
+  All durations whose key ends with \c Us are in microseconds.
+ */
+QVariantMap DaemonStatisticsRequest::statistics() const
+{
+    Q_D(const DaemonStatisticsRequest);
+    return d->m_statistics;
+}
+
+Request::Status DaemonStatisticsRequest::status() const
+{
+    Q_D(const DaemonStatisticsRequest);
+    return d->m_status;
+}
+
+Result DaemonStatisticsRequest::result() const
+{
+    Q_D(const DaemonStatisticsRequest);
+    return d->m_result;
+}
+
+SecretManager *DaemonStatisticsRequest::manager() const
+{
+    Q_D(const DaemonStatisticsRequest);
+    return d->m_manager.data();
+}
+
+void DaemonStatisticsRequest::setManager(SecretManager *manager)
+{
+    Q_D(DaemonStatisticsRequest);
+    if (d->m_manager.data() != manager) {
+        d->m_manager = manager;
+        emit managerChanged();
+    }
+}
+
+void DaemonStatisticsRequest::startRequest()
+{
+    Q_D(DaemonStatisticsRequest);
+    if (d->m_status != Request::Active && !d->m_manager.isNull()) {
+        d->m_status = Request::Active;
+        emit statusChanged();
+        if (d->m_result.code() != Result::Pending) {
+            d->m_result = Result(Result::Pending);
+            emit resultChanged();
+        }
+
+        QDBusPendingReply<Result, QVariantMap> reply
+                = d->m_manager->d_ptr->getDaemonStatistics();
+        if (!reply.isValid() && !reply.error().message().isEmpty()) {
+            d->m_status = Request::Finished;
+            d->m_result = Result(Result::SecretManagerNotInitializedError,
+                                 reply.error().message());
+            emit statusChanged();
+            emit resultChanged();
+        } else if (reply.isFinished()
+                // work around a bug in QDBusAbstractInterface / QDBusConnection...
+                && reply.argumentAt<0>().code() != Sailfish::Secrets::Result::Succeeded) {
+            d->m_status = Request::Finished;
+            d->m_result = reply.argumentAt<0>();
+            emit statusChanged();
+            emit resultChanged();
+        } else {
+            d->m_watcher.reset(new QDBusPendingCallWatcher(reply));
+            connect(d->m_watcher.data(), &QDBusPendingCallWatcher::finished, [this] {
+                QDBusPendingCallWatcher *watcher = this->d_ptr->m_watcher.take();
+                QDBusPendingReply<Result, QVariantMap> reply = *watcher;
+                this->d_ptr->m_status = Request::Finished;
+                if (reply.isError()) {
+                    this->d_ptr->m_result = Result(Result::DaemonError,
+                                                   reply.error().message());
+                } else {
+                    this->d_ptr->m_result = reply.argumentAt<0>();
+                    this->d_ptr->m_statistics = demarshallValue(reply.argumentAt<1>()).toMap();
+                }
+                watcher->deleteLater();
+                emit this->statisticsChanged();
+                emit this->statusChanged();
+                emit this->resultChanged();
+            });
+        }
+    }
+}
+
+void DaemonStatisticsRequest::waitForFinished()
+{
+    Q_D(DaemonStatisticsRequest);
+    if (d->m_status == Request::Active && !d->m_watcher.isNull()) {
+        d->m_watcher->waitForFinished();
+    }
+}
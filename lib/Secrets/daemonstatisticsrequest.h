@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef LIBSAILFISHSECRETS_DAEMONSTATISTICSREQUEST_H
+#define LIBSAILFISHSECRETS_DAEMONSTATISTICSREQUEST_H
+
+#include "Secrets/secretsglobal.h"
+#include "Secrets/request.h"
+#include "Secrets/secretmanager.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QVariantMap>
+
+namespace Sailfish {
+
+namespace Secrets {
+
+class DaemonStatisticsRequestPrivate;
+class SAILFISH_SECRETS_API DaemonStatisticsRequest : public Sailfish::Secrets::Request
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantMap statistics READ statistics NOTIFY statisticsChanged)
+
+public:
+    DaemonStatisticsRequest(QObject *parent = Q_NULLPTR);
+    ~DaemonStatisticsRequest() Q_DECL_OVERRIDE;
+
+    QVariantMap statistics() const;
+
+    Sailfish::Secrets::Request::Status status() const Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result result() const Q_DECL_OVERRIDE;
+
+    Sailfish::Secrets::SecretManager *manager() const Q_DECL_OVERRIDE;
+    void setManager(Sailfish::Secrets::SecretManager *manager) Q_DECL_OVERRIDE;
+
+    void startRequest() Q_DECL_OVERRIDE;
+    void waitForFinished() Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void statisticsChanged();
+
+private:
+    QScopedPointer<DaemonStatisticsRequestPrivate> const d_ptr;
+    Q_DECLARE_PRIVATE(DaemonStatisticsRequest)
+};
+
+} // namespace Secrets
+
+} // namespace Sailfish
+
+#endif // LIBSAILFISHSECRETS_DAEMONSTATISTICSREQUEST_H
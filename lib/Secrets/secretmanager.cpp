@@ -18,12 +18,15 @@
 #include <QtDBus/QDBusMessage>
 #include <QtDBus/QDBusArgument>
 #include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 #include <QtCore/QPointer>
 #include <QtCore/QLoggingCategory>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QDir>
 
+#include <climits>
+
 Q_LOGGING_CATEGORY(lcSailfishSecrets, "org.sailfishos.secrets", QtWarningMsg)
 
 using namespace Sailfish::Secrets;
@@ -136,6 +139,20 @@ SecretManagerPrivate::getHealthInfo()
     return reply;
 }
 
+QDBusPendingReply<Result, QVariantMap>
+SecretManagerPrivate::getDaemonStatistics()
+{
+    if (!m_interface) {
+        return QDBusPendingReply<Result, QVariantMap>(
+                    QDBusMessage::createError(QDBusError::Other,
+                                              QStringLiteral("Not connected to daemon")));
+    }
+
+    QDBusPendingReply<Result, QVariantMap> reply
+            = m_interface->asyncCall(QStringLiteral("getDaemonStatistics"));
+    return reply;
+}
+
 QDBusPendingReply<Result, QByteArray>
 SecretManagerPrivate::userInput(
         const InteractionParameters &uiParams)
@@ -264,6 +281,85 @@ SecretManagerPrivate::deleteCollection(
     return reply;
 }
 
+QDBusPendingReply<Result>
+SecretManagerPrivate::exportCollection(
+        const QString &collectionName,
+        const QString &storagePluginName,
+        int fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode)
+{
+    return transferCollection(QStringLiteral("exportCollection"),
+                              collectionName,
+                              storagePluginName,
+                              fileDescriptor,
+                              passphrase,
+                              userInteractionMode);
+}
+
+QDBusPendingReply<Result>
+SecretManagerPrivate::importCollection(
+        const QString &collectionName,
+        const QString &storagePluginName,
+        int fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode)
+{
+    return transferCollection(QStringLiteral("importCollection"),
+                              collectionName,
+                              storagePluginName,
+                              fileDescriptor,
+                              passphrase,
+                              userInteractionMode);
+}
+
+QDBusPendingReply<Result>
+SecretManagerPrivate::transferCollection(
+        const QString &methodName,
+        const QString &collectionName,
+        const QString &storagePluginName,
+        int fileDescriptor,
+        const QByteArray &passphrase,
+        SecretManager::UserInteractionMode userInteractionMode)
+{
+    if (!m_interface) {
+        return QDBusPendingReply<Result>(
+                    QDBusMessage::createError(QDBusError::Other,
+                                              QStringLiteral("Not connected to daemon")));
+    }
+
+    if (!(m_interface->connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        return QDBusPendingReply<Result>(
+                QDBusMessage().createReply(
+                        QVariantList() << QVariant::fromValue<Result>(
+                                Result(Result::OperationNotSupportedError,
+                                       QStringLiteral("File descriptor passing is not supported by the connection")))));
+    }
+
+    QString interactionServiceAddress;
+    Result uiServiceResult = registerInteractionService(userInteractionMode, &interactionServiceAddress);
+    if (uiServiceResult.code() == Result::Failed) {
+        return QDBusPendingReply<Result>(
+                QDBusMessage().createReply(
+                        QVariantList() << QVariant::fromValue<Result>(uiServiceResult)));
+    }
+
+    // no timeout: the reply is only sent once the whole archive has been processed.
+    QDBusPendingReply<Result> reply
+            = m_interface->connection().asyncCall(
+                QDBusMessage::createMethodCall(
+                    m_interface->service(), m_interface->path(), m_interface->interface(),
+                    methodName)
+                << QVariant::fromValue<QString>(collectionName)
+                << QVariant::fromValue<QString>(storagePluginName)
+                << QVariant::fromValue<QDBusUnixFileDescriptor>(QDBusUnixFileDescriptor(fileDescriptor))
+                << QVariant::fromValue<QByteArray>(passphrase)
+                << QVariant::fromValue<SecretManager::UserInteractionMode>(userInteractionMode)
+                << QVariant::fromValue<QString>(interactionServiceAddress),
+                INT_MAX);
+    return reply;
+}
+
 QDBusPendingReply<Result>
 SecretManagerPrivate::setSecret(
         const Secret &secret,
@@ -541,6 +637,48 @@ SecretManagerPrivate::deleteSecret(
     return reply;
 }
 
+QDBusPendingReply<Result, QVector<Result>, QVector<Secret> >
+SecretManagerPrivate::batch(
+        const QVector<int> &operations,
+        const QVector<Secret> &secrets,
+        SecretManager::UserInteractionMode userInteractionMode)
+{
+    if (!m_interface) {
+        return QDBusPendingReply<Result, QVector<Result>, QVector<Secret> >(
+                    QDBusMessage::createError(QDBusError::Other,
+                                              QStringLiteral("Not connected to daemon")));
+    }
+
+    if (operations.size() != secrets.size()) {
+        Result batchError(Result::InvalidSecretError,
+                          QLatin1String("Each operation in the batch must have exactly one secret"));
+        return QDBusPendingReply<Result, QVector<Result>, QVector<Secret> >(
+                QDBusMessage().createReply(
+                        QVariantList() << QVariant::fromValue<Result>(batchError)
+                                       << QVariant::fromValue<QVector<Result> >(QVector<Result>())
+                                       << QVariant::fromValue<QVector<Secret> >(QVector<Secret>())));
+    }
+
+    QString interactionServiceAddress;
+    Result uiServiceResult = registerInteractionService(userInteractionMode, &interactionServiceAddress);
+    if (uiServiceResult.code() == Result::Failed) {
+        return QDBusPendingReply<Result, QVector<Result>, QVector<Secret> >(
+                QDBusMessage().createReply(
+                        QVariantList() << QVariant::fromValue<Result>(uiServiceResult)
+                                       << QVariant::fromValue<QVector<Result> >(QVector<Result>())
+                                       << QVariant::fromValue<QVector<Secret> >(QVector<Secret>())));
+    }
+
+    QDBusPendingReply<Result, QVector<Result>, QVector<Secret> > reply
+            = m_interface->asyncCallWithArgumentList(
+                QStringLiteral("batch"),
+                QVariantList() << QVariant::fromValue<QVector<int> >(operations)
+                               << QVariant::fromValue<QVector<Secret> >(secrets)
+                               << QVariant::fromValue<SecretManager::UserInteractionMode>(userInteractionMode)
+                               << QVariant::fromValue<QString>(interactionServiceAddress));
+    return reply;
+}
+
 QDBusPendingReply<Result, LockCodeRequest::LockStatus>
 SecretManagerPrivate::queryLockStatus(
         LockCodeRequest::LockCodeTargetType lockCodeTargetType,
@@ -684,6 +822,7 @@ SecretManagerPrivate *SecretManager::pimpl() const
   \li \l{Sailfish::Secrets::StoredSecretRequest} to retrieve a secret
   \li \l{Sailfish::Secrets::FindSecretsRequest} to search a collection for secrets matching a filter
   \li \l{Sailfish::Secrets::DeleteSecretRequest} to delete a secret
+  \li \l{Sailfish::Secrets::BatchRequest} to store, retrieve or delete many secrets in a single request
   \li \l{Sailfish::Secrets::InteractionRequest} to request the system mediate a user-interaction flow on behalf of the application
   \endlist
  */
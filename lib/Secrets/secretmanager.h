@@ -23,6 +23,7 @@ namespace Sailfish {
 
 namespace Secrets {
 
+class BatchRequest;
 class CreateCollectionRequest;
 class DeleteCollectionRequest;
 class DeleteSecretRequest;
@@ -96,8 +97,11 @@ protected:
 private:
     QScopedPointer<SecretManagerPrivate> const d_ptr;
     Q_DECLARE_PRIVATE(SecretManager)
+    friend class BatchRequest;
+    friend class CollectionArchiveRequest;
     friend class CollectionNamesRequest;
     friend class CreateCollectionRequest;
+    friend class DaemonStatisticsRequest;
     friend class DeleteCollectionRequest;
     friend class DeleteSecretRequest;
     friend class FindSecretsRequest;
@@ -60,6 +60,9 @@ public:
                       HealthCheckRequest::Health,
                       HealthCheckRequest::Health> getHealthInfo();
 
+    // retrieve request, plugin and queue statistics of the daemon
+    QDBusPendingReply<Sailfish::Secrets::Result, QVariantMap> getDaemonStatistics();
+
     // retrieve user input data
     QDBusPendingReply<Sailfish::Secrets::Result, QByteArray> userInput(
             const Sailfish::Secrets::InteractionParameters &uiParams);
@@ -92,6 +95,22 @@ public:
             const QString &storagePluginName,
             Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
 
+    // export the secrets of a collection to an archive file
+    QDBusPendingReply<Sailfish::Secrets::Result> exportCollection(
+            const QString &collectionName,
+            const QString &storagePluginName,
+            int fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
+
+    // import the secrets of an archive file into a collection
+    QDBusPendingReply<Sailfish::Secrets::Result> importCollection(
+            const QString &collectionName,
+            const QString &storagePluginName,
+            int fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
+
     // set a secret in a collection.  Will immediately fail if the secret's identifier is standalone.
     QDBusPendingReply<Sailfish::Secrets::Result> setSecret(
             const Sailfish::Secrets::Secret &secret,
@@ -142,6 +161,14 @@ public:
             const Sailfish::Secrets::Secret::Identifier &identifier,
             Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
 
+    // perform a batch of store, get and delete operations on secrets
+    QDBusPendingReply<Sailfish::Secrets::Result,
+                      QVector<Sailfish::Secrets::Result>,
+                      QVector<Sailfish::Secrets::Secret> > batch(
+            const QVector<int> &operations,
+            const QVector<Sailfish::Secrets::Secret> &secrets,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
+
     // query the lock status of a plugin or the metadata db
     QDBusPendingReply<Sailfish::Secrets::Result, Sailfish::Secrets::LockCodeRequest::LockStatus> queryLockStatus(
             Sailfish::Secrets::LockCodeRequest::LockCodeTargetType lockCodeTargetType,
@@ -169,6 +196,14 @@ public:
             Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
 
 private:
+    QDBusPendingReply<Sailfish::Secrets::Result> transferCollection(
+            const QString &methodName,
+            const QString &collectionName,
+            const QString &storagePluginName,
+            int fileDescriptor,
+            const QByteArray &passphrase,
+            Sailfish::Secrets::SecretManager::UserInteractionMode userInteractionMode);
+
     friend class SecretManager;
     friend class InteractionService;
     InteractionService *m_uiService;
@@ -167,7 +167,9 @@ void Sailfish::Secrets::SecretsDaemonConnection::registerDBusTypes()
     qRegisterMetaType<Sailfish::Secrets::PluginInfo>("Sailfish::Secrets::PluginInfo");
     qRegisterMetaType<QVector<Sailfish::Secrets::PluginInfo> >("QVector<Sailfish::Secrets::PluginInfo>");
     qRegisterMetaType<Sailfish::Secrets::Result>("Sailfish::Secrets::Result");
+    qRegisterMetaType<QVector<Sailfish::Secrets::Result> >("QVector<Sailfish::Secrets::Result>");
     qRegisterMetaType<Sailfish::Secrets::Secret>("Sailfish::Secrets::Secret");
+    qRegisterMetaType<QVector<Sailfish::Secrets::Secret> >("QVector<Sailfish::Secrets::Secret>");
     qRegisterMetaType<Sailfish::Secrets::Secret::Identifier>("Sailfish::Secrets::Secret::Identifier");
     qRegisterMetaType<Sailfish::Secrets::Secret::FilterData>("Sailfish::Secrets::Secret::FilterData");
     qRegisterMetaType<Sailfish::Secrets::InteractionParameters>("Sailfish::Secrets::InteractionParameters");
@@ -188,7 +190,9 @@ void Sailfish::Secrets::SecretsDaemonConnection::registerDBusTypes()
     qDBusRegisterMetaType<Sailfish::Secrets::PluginInfo>();
     qDBusRegisterMetaType<QVector<Sailfish::Secrets::PluginInfo> >();
     qDBusRegisterMetaType<Sailfish::Secrets::Result>();
+    qDBusRegisterMetaType<QVector<Sailfish::Secrets::Result> >();
     qDBusRegisterMetaType<Sailfish::Secrets::Secret>();
+    qDBusRegisterMetaType<QVector<Sailfish::Secrets::Secret> >();
     qDBusRegisterMetaType<Sailfish::Secrets::Secret::Identifier>();
     qDBusRegisterMetaType<QVector<Sailfish::Secrets::Secret::Identifier> >();
     qDBusRegisterMetaType<Sailfish::Secrets::Secret::FilterData>();
@@ -203,4 +207,5 @@ void Sailfish::Secrets::SecretsDaemonConnection::registerDBusTypes()
     qDBusRegisterMetaType<Sailfish::Secrets::LockCodeRequest::LockStatus>();
     qDBusRegisterMetaType<Sailfish::Secrets::HealthCheckRequest::Health>();
     qDBusRegisterMetaType<QMap<QString, bool> >();
+    qDBusRegisterMetaType<QVector<int> >();
 }
@@ -59,6 +59,7 @@ bool ExampleUsbTokenPlugin::setLockCode(const QByteArray &oldLockCode, const QBy
 bool ExampleUsbTokenPlugin::lock()
 {
     m_usbTokenKey = Sailfish::Crypto::Key();
+    m_usbInterface.clearKeyCache();
     return true;
 }
 
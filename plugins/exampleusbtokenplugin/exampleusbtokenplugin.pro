@@ -14,12 +14,16 @@ DEPENDPATH += . $$PWD/../opensslcryptoplugin $$PWD/../opensslcryptoplugin/evp/
 
 HEADERS += \
     $$PWD/../opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../opensslcryptoplugin/evp/keycache_p.h \
+    $$PWD/../opensslcryptoplugin/evp/randomgenerator_p.h \
     $$PWD/../opensslcryptoplugin/evp/evp_helpers_p.h \
     $$PWD/../opensslcryptoplugin/opensslcryptoplugin.h \
     $$PWD/exampleusbtokenplugin.h
 
 SOURCES += \
     $$PWD/../opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../opensslcryptoplugin/evp/keycache.cpp \
+    $$PWD/../opensslcryptoplugin/evp/randomgenerator.cpp \
     $$PWD/../opensslcryptoplugin/opensslcryptoplugin.cpp \
     $$PWD/exampleusbtokenplugin.cpp \
     $$PWD/encryptedstorageplugin.cpp \
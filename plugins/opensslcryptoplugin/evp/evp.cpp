@@ -15,6 +15,7 @@
 #include <QtCore/QVector>
 #include <QtCore/QThread>
 #include <QtCore/QHash>
+#include <QtCore/QThreadStorage>
 
 #define OSSLEVP_PRINT_ERR(message) \
     fprintf(stderr, "%s#%d, %s: %s\n", __FILE__, __LINE__, __FUNCTION__, message);
@@ -87,6 +88,63 @@ static unsigned long qthreads_thread_id()
 
 #endif // OPENSSL_VERSION_NUMBER < 0x10100000L
 
+// Setting up a cipher context for each operation dominates the cost of
+// encrypting small records, so each thread keeps one context which the
+// AES functions reuse.  The context is reset (which wipes the key
+// schedule) when it is released.  A context which is requested while
+// the thread's context is in use is simply allocated and freed.
+namespace {
+
+struct ThreadCipherContext
+{
+    ThreadCipherContext()
+        : context(EVP_CIPHER_CTX_new())
+        , inUse(false)
+    {
+    }
+    ~ThreadCipherContext()
+    {
+        EVP_CIPHER_CTX_free(context);
+    }
+    EVP_CIPHER_CTX *context;
+    bool inUse;
+};
+QThreadStorage<ThreadCipherContext*> s_cipherContexts;
+
+EVP_CIPHER_CTX *acquire_cipher_context()
+{
+    if (!s_cipherContexts.hasLocalData()) {
+        s_cipherContexts.setLocalData(new ThreadCipherContext);
+    }
+    ThreadCipherContext *threadContext = s_cipherContexts.localData();
+    if (threadContext->inUse || threadContext->context == NULL) {
+        return EVP_CIPHER_CTX_new();
+    }
+    threadContext->inUse = true;
+    return threadContext->context;
+}
+
+void release_cipher_context(EVP_CIPHER_CTX *context)
+{
+    ThreadCipherContext *threadContext = s_cipherContexts.hasLocalData()
+            ? s_cipherContexts.localData()
+            : NULL;
+    if (threadContext == NULL || context != threadContext->context) {
+        EVP_CIPHER_CTX_free(context);
+        return;
+    }
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    EVP_CIPHER_CTX_cleanup(context);
+    EVP_CIPHER_CTX_init(context);
+#else
+    EVP_CIPHER_CTX_reset(context);
+#endif
+    threadContext->inUse = false;
+}
+
+} // namespace
+
 /*
     int OpenSslEvp::init()
 
@@ -163,6 +221,45 @@ int OpenSslEvp::pkcs5_pbkdf2_hmac(const char *pass, int passlen,
                              iter, md, keylen, out);
 }
 
+/*
+    int OpenSslEvp::pbe_scrypt(const char *pass,
+                               size_t passlen,
+                               const unsigned char *salt,
+                               size_t saltlen,
+                               uint64_t N,
+                               uint64_t r,
+                               uint64_t p,
+                               size_t keylen,
+                               unsigned char *out)
+
+    Derive a key from input data via the scrypt key derivation function,
+    with the CPU/memory cost \a N (which must be a power of two), the
+    block size \a r and the parallelization parameter \a p.
+
+    The memory limit passed to OpenSSL is exactly the amount required
+    by the given parameters, and so callers must bound those parameters.
+
+    Returns 1 on success, 0 on failure (including if scrypt is not
+    supported by the version of OpenSSL in use).
+ */
+int OpenSslEvp::pbe_scrypt(const char *pass, size_t passlen,
+                           const unsigned char *salt, size_t saltlen,
+                           uint64_t N, uint64_t r, uint64_t p,
+                           size_t keylen, unsigned char *out)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(OPENSSL_NO_SCRYPT)
+    // see EVP_PBE_scrypt(3): V requires 128*r*(N+2) bytes and B requires 128*r*p bytes.
+    const uint64_t maxmem = 128 * r * (N + 2) + 128 * r * p;
+    return EVP_PBE_scrypt(pass, passlen, salt, saltlen,
+                          N, r, p, maxmem, out, keylen);
+#else
+    (void)pass; (void)passlen; (void)salt; (void)saltlen;
+    (void)N; (void)r; (void)p; (void)keylen; (void)out;
+    OSSLEVP_PRINT_ERR("scrypt is not supported by this version of OpenSSL");
+    return 0;
+#endif
+}
+
 /*
     int OpenSslEvp::aes_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
                                           const unsigned char *init_vector,
@@ -210,12 +307,12 @@ int OpenSslEvp::aes_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     ciphertext = (unsigned char *)malloc(ciphertext_length);
     memset(ciphertext, 0, ciphertext_length);
 
-    /* Create the encryption context */
-    EVP_CIPHER_CTX *encryption_context = EVP_CIPHER_CTX_new();
+    /* Take this thread's encryption context */
+    EVP_CIPHER_CTX *encryption_context = acquire_cipher_context();
 
     if (!EVP_EncryptInit_ex(encryption_context, evp_cipher, NULL, key, init_vector)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         fprintf(stderr, "%s\n", "failed to initialize encryption context");
         return -1;
@@ -224,7 +321,7 @@ int OpenSslEvp::aes_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     /* Encrypt the plaintext into the encrypted output buffer */
     if (!EVP_EncryptUpdate(encryption_context, ciphertext, &update_length, plaintext, plaintext_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         fprintf(stderr, "%s\n", "failed to update ciphertext buffer with encrypted content");
         return -1;
@@ -232,7 +329,7 @@ int OpenSslEvp::aes_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
 
     if (!EVP_EncryptFinal_ex(encryption_context, ciphertext+update_length, &final_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         fprintf(stderr, "%s\n", "failed to encrypt final block");
         return -1;
@@ -241,8 +338,8 @@ int OpenSslEvp::aes_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     /* Update the out parameter */
     *encrypted = ciphertext;
 
-    /* Clean up the encryption context */
-    EVP_CIPHER_CTX_free(encryption_context);
+    /* Return the encryption context */
+    release_cipher_context(encryption_context);
     ciphertext_length = update_length + final_length;
     return ciphertext_length;
 }
@@ -294,12 +391,12 @@ int OpenSslEvp::aes_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     plaintext = (unsigned char *)malloc(ciphertext_length + AES_BLOCK_SIZE);
     memset(plaintext, 0, ciphertext_length + AES_BLOCK_SIZE);
 
-    /* Create the decryption context */
-    EVP_CIPHER_CTX *decryption_context = EVP_CIPHER_CTX_new();
+    /* Take this thread's decryption context */
+    EVP_CIPHER_CTX *decryption_context = acquire_cipher_context();
 
     if (!EVP_DecryptInit_ex(decryption_context, evp_cipher, NULL, key, init_vector)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -311,7 +408,7 @@ int OpenSslEvp::aes_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     /* Decrypt the ciphertext into the decrypted output buffer */
     if (!EVP_DecryptUpdate(decryption_context, plaintext, &update_length, ciphertext, ciphertext_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -322,7 +419,7 @@ int OpenSslEvp::aes_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
 
     if (!EVP_DecryptFinal_ex(decryption_context, plaintext+update_length, &final_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -334,8 +431,8 @@ int OpenSslEvp::aes_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     /* Update the out parameter */
     *decrypted = plaintext;
 
-    /* Clean up the decryption context */
-    EVP_CIPHER_CTX_free(decryption_context);
+    /* Return the decryption context */
+    release_cipher_context(decryption_context);
     plaintext_length = update_length + final_length;
     return plaintext_length;
 }
@@ -396,13 +493,13 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     tag_output = (unsigned char *)malloc(tag_length);
     memset(tag_output, 0, tag_length);
 
-    /* Create the encryption context */
-    EVP_CIPHER_CTX *encryption_context = EVP_CIPHER_CTX_new();
+    /* Take this thread's encryption context */
+    EVP_CIPHER_CTX *encryption_context = acquire_cipher_context();
 
     /* Initialize the encryption operation. */
     if (!EVP_EncryptInit_ex(encryption_context, evp_cipher, NULL, NULL, NULL)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to initialize encryption context");
@@ -415,7 +512,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
          || (cipher_mode == EVP_CIPH_CCM_MODE
              && !EVP_CIPHER_CTX_ctrl(encryption_context, EVP_CTRL_CCM_SET_IVLEN, init_vector_length, NULL)) ) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to set IV length");
@@ -426,7 +523,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     if (cipher_mode == EVP_CIPH_CCM_MODE
             && !EVP_CIPHER_CTX_ctrl(encryption_context, EVP_CTRL_CCM_SET_TAG, tag_length, NULL)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to set authentication tag length");
@@ -436,7 +533,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     /* Initialize key and IV */
     if (!EVP_EncryptInit_ex(encryption_context, NULL, NULL, key, init_vector)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to initialize encryption context");
@@ -447,7 +544,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     if (cipher_mode == EVP_CIPH_CCM_MODE
             && !EVP_EncryptUpdate(encryption_context, NULL, &update_length, NULL, plaintext_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to set plaintext length");
@@ -457,7 +554,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     /* Provide auth data */
     if (!EVP_EncryptUpdate(encryption_context, NULL, &update_length, auth, auth_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to set authentication data");
@@ -469,7 +566,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
      */
     if (!EVP_EncryptUpdate(encryption_context, ciphertext, &update_length, plaintext, plaintext_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to update ciphertext buffer with encrypted content");
@@ -481,7 +578,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
      */
     if (!EVP_EncryptFinal_ex(encryption_context, ciphertext+update_length, &final_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to encrypt final block");
@@ -494,7 +591,7 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
           || (cipher_mode == EVP_CIPH_CCM_MODE
               && !EVP_CIPHER_CTX_ctrl(encryption_context, EVP_CTRL_CCM_GET_TAG, tag_length, tag_output)) ) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(encryption_context);
+        release_cipher_context(encryption_context);
         free(ciphertext);
         free(tag_output);
         fprintf(stderr, "%s\n", "failed to get tag");
@@ -505,8 +602,8 @@ int OpenSslEvp::aes_auth_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
     *encrypted = ciphertext;
     *tag = tag_output;
 
-    /* Clean up the encryption context */
-    EVP_CIPHER_CTX_free(encryption_context);
+    /* Return the encryption context */
+    release_cipher_context(encryption_context);
     ciphertext_length = update_length + final_length;
 
     return ciphertext_length;
@@ -570,13 +667,13 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     plaintext = (unsigned char *)malloc(ciphertext_length + AES_BLOCK_SIZE);
     memset(plaintext, 0, ciphertext_length + AES_BLOCK_SIZE);
 
-    /* Create the decryption context */
-    EVP_CIPHER_CTX *decryption_context = EVP_CIPHER_CTX_new();
+    /* Take this thread's decryption context */
+    EVP_CIPHER_CTX *decryption_context = acquire_cipher_context();
 
     /* Initialise the decryption operation. */
     if (!EVP_DecryptInit_ex(decryption_context, evp_cipher, NULL, NULL, NULL)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -591,7 +688,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
          || (cipher_mode == EVP_CIPH_CCM_MODE
              && !EVP_CIPHER_CTX_ctrl(decryption_context, EVP_CTRL_CCM_SET_IVLEN, init_vector_length, NULL)) ) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -604,7 +701,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     if (cipher_mode == EVP_CIPH_CCM_MODE
             && !EVP_CIPHER_CTX_ctrl(decryption_context, EVP_CTRL_CCM_SET_TAG, tag_length, tag)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -616,7 +713,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     /* Initialize key and IV */
     if (!EVP_DecryptInit_ex(decryption_context, NULL, NULL, key, init_vector)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -629,7 +726,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     if (cipher_mode == EVP_CIPH_CCM_MODE
             && !EVP_DecryptUpdate(decryption_context, NULL, &update_length, NULL, ciphertext_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -641,7 +738,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     /* Provide auth data */
     if (!EVP_DecryptUpdate(decryption_context, NULL, &update_length, auth, auth_length)) {
         ERR_print_errors_fp(stderr);
-        EVP_CIPHER_CTX_free(decryption_context);
+        release_cipher_context(decryption_context);
         free(plaintext);
         fprintf(stderr,
                 "%s: %s\n",
@@ -655,7 +752,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     if (cipher_mode == EVP_CIPH_GCM_MODE) {
         if (!last_update_result) {
             ERR_print_errors_fp(stderr);
-            EVP_CIPHER_CTX_free(decryption_context);
+            release_cipher_context(decryption_context);
             free(plaintext);
             fprintf(stderr,
                     "%s: %s\n",
@@ -666,7 +763,7 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
         /* Set expected tag value. */
         if (!EVP_CIPHER_CTX_ctrl(decryption_context, EVP_CTRL_GCM_SET_TAG, tag_length, tag)) {
             ERR_print_errors_fp(stderr);
-            EVP_CIPHER_CTX_free(decryption_context);
+            release_cipher_context(decryption_context);
             free(plaintext);
             fprintf(stderr,
                     "%s: %s\n",
@@ -688,8 +785,8 @@ int OpenSslEvp::aes_auth_decrypt_ciphertext(const EVP_CIPHER *evp_cipher,
     /* Update the out parameter */
     *decrypted = plaintext;
 
-    /* Clean up the decryption context */
-    EVP_CIPHER_CTX_free(decryption_context);
+    /* Return the decryption context */
+    release_cipher_context(decryption_context);
     plaintext_length = update_length + final_length;
     return plaintext_length;
 }
@@ -1178,6 +1275,156 @@ int OpenSslEvp::verify_session_finalize(EVP_MD_CTX *mdctx,
     return r;
 }
 
+/*
+    int digest_session_init(EVP_MD_CTX **ctx,
+                            const EVP_MD *digestFunc);
+
+    Initializes a digest session, which allows a digest to be calculated
+    incrementally rather than over a single buffer.
+
+    Arguments:
+    * ctx: output parameter, context of the digest operation, should be freed with EVP_MD_CTX_destroy
+    * digestFunc: should be the result of an EVP function, eg. EVP_sha256()
+
+    Return value:
+    * 1 when the operation was successful.
+    * less than 0 when there was an error.
+*/
+int OpenSslEvp::digest_session_init(EVP_MD_CTX **ctx,
+                                    const EVP_MD *digestFunc)
+{
+    if (ctx == nullptr) {
+        return -2;
+    }
+
+    *ctx = nullptr;
+
+    int r = -1;
+    EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
+    OSSLEVP_HANDLE_ERR(mdctx == nullptr, r = -1, "failed to allocate memory for MD context", err_dontfree);
+
+    r = EVP_DigestInit_ex(mdctx, digestFunc, nullptr);
+    OSSLEVP_HANDLE_ERR(r != 1, r = -1, "failed to initialize Digest", err_free_mdctx);
+
+    *ctx = mdctx;
+    return 1;
+
+    err_free_mdctx:
+    EVP_MD_CTX_destroy(mdctx);
+    err_dontfree:
+    return r;
+}
+
+/*
+    int digest_session_update(EVP_MD_CTX *ctx,
+                              const void *bytes,
+                              size_t bytesCount);
+
+    Updates a digest or HMAC session with more data.  Unlike
+    sign_session_update(), the context is not destroyed on error.
+
+    Return value:
+    * 1 when the operation was successful.
+    * less than 0 when there was an error.
+*/
+int OpenSslEvp::digest_session_update(EVP_MD_CTX *mdctx,
+                                      const void *bytes,
+                                      size_t bytesCount)
+{
+    if (mdctx == nullptr) {
+        return -2;
+    }
+
+    int r = EVP_DigestUpdate(mdctx, bytes, bytesCount);
+    OSSLEVP_HANDLE_ERR(r != 1, r = -1, "failed to update Digest", err_dontfree);
+
+    err_dontfree:
+    return r;
+}
+
+/*
+    int digest_session_finalize(EVP_MD_CTX *ctx,
+                                uint8_t **digest,
+                                size_t *digestLength);
+
+    Finalizes the digest session, producing the digest.  The context
+    is destroyed.
+
+    Arguments:
+    * ctx: the digest context to use
+    * digest: where the generated digest will be stored, which will have to be freed using OPENSSL_free
+    * digestLength: where the length of the generated digest will be stored
+
+    Return value:
+    * 1 when the operation was successful.
+    * less than 0 when there was an error.
+*/
+int OpenSslEvp::digest_session_finalize(EVP_MD_CTX *mdctx,
+                                        uint8_t **digest,
+                                        size_t *digestLength)
+{
+    if (mdctx == nullptr) {
+        return -2;
+    }
+
+    int r = -1;
+    unsigned int actualDigestLength = 0;
+    *digest = (uint8_t *) OPENSSL_malloc(EVP_MAX_MD_SIZE);
+    OSSLEVP_HANDLE_ERR(*digest == nullptr, r = -1, "failed to allocate memory for digest", err_free_mdctx);
+
+    r = EVP_DigestFinal_ex(mdctx, *digest, &actualDigestLength);
+    OSSLEVP_HANDLE_ERR(r != 1, r = -1; OPENSSL_free(*digest), "failed to finalize Digest", err_free_mdctx);
+
+    *digestLength = actualDigestLength;
+
+    err_free_mdctx:
+    EVP_MD_CTX_destroy(mdctx);
+    return r;
+}
+
+/*
+    int hmac_session_init(EVP_MD_CTX **ctx,
+                          const EVP_MD *digestFunc,
+                          const unsigned char *key,
+                          size_t keyLength);
+
+    Initializes an HMAC session with the given key.  The session is
+    updated with digest_session_update() (as EVP_DigestSignUpdate() is
+    EVP_DigestUpdate()) and finalized with sign_session_finalize().
+
+    Arguments:
+    * ctx: output parameter, context of the HMAC operation, should be freed with EVP_MD_CTX_destroy
+    * digestFunc: should be the result of an EVP function, eg. EVP_sha256()
+    * key: the HMAC key
+    * keyLength: the number of bytes in 'key'
+
+    Return value:
+    * 1 when the operation was successful.
+    * less than 0 when there was an error.
+*/
+int OpenSslEvp::hmac_session_init(EVP_MD_CTX **ctx,
+                                  const EVP_MD *digestFunc,
+                                  const unsigned char *key,
+                                  size_t keyLength)
+{
+    if (ctx == nullptr || key == nullptr || keyLength == 0) {
+        return -2;
+    }
+
+    *ctx = nullptr;
+
+    int r = -1;
+    EVP_PKEY *pkey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, nullptr, key, keyLength);
+    OSSLEVP_HANDLE_ERR(pkey == nullptr, r = -1, "failed to create HMAC key", err_dontfree);
+
+    // The context holds its own reference to the key.
+    r = sign_session_init(ctx, digestFunc, pkey);
+    EVP_PKEY_free(pkey);
+
+    err_dontfree:
+    return r;
+}
+
 /*
     int OpenSslEvp::generate_ec_key(int curveNid,
                                     uint8_t **publicKeyBytes,
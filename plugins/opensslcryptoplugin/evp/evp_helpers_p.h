@@ -50,7 +50,8 @@ public:
     quint32 cipherSessionToken = 0;
     EVP_MD_CTX *evp_md_ctx = nullptr;
     EVP_CIPHER_CTX *evp_cipher_ctx = nullptr;
-    QTimer *timeout;
+    QTimer *timeout = nullptr;
+    bool inUse = false; // an update is in progress on some thread.
 };
 
 struct CipherSessionDataDeleter
@@ -163,12 +164,38 @@ int authenticationTagSize(Sailfish::Crypto::CryptoManager::Algorithm algorithm,
 
 const EVP_MD *getEvpDigestFunction(Sailfish::Crypto::CryptoManager::DigestFunction digestFunction) {
     switch (digestFunction) {
-    case Sailfish::Crypto::CryptoManager::DigestSha256:
-        return EVP_sha256();
-    case Sailfish::Crypto::CryptoManager::DigestSha512:
-        return EVP_sha512();
     case Sailfish::Crypto::CryptoManager::DigestMd5:
         return EVP_md5();
+    case Sailfish::Crypto::CryptoManager::DigestSha1:
+        return EVP_sha1();
+    case Sailfish::Crypto::CryptoManager::DigestSha2_224:
+        return EVP_sha224();
+    case Sailfish::Crypto::CryptoManager::DigestSha2_256:
+        return EVP_sha256();
+    case Sailfish::Crypto::CryptoManager::DigestSha2_384:
+        return EVP_sha384();
+    case Sailfish::Crypto::CryptoManager::DigestSha2_512:
+        return EVP_sha512();
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    case Sailfish::Crypto::CryptoManager::DigestSha2_512_224:
+        return EVP_sha512_224();
+    case Sailfish::Crypto::CryptoManager::DigestSha2_512_256:
+        return EVP_sha512_256();
+    case Sailfish::Crypto::CryptoManager::DigestSha3_224:
+        return EVP_sha3_224();
+    case Sailfish::Crypto::CryptoManager::DigestSha3_256:
+        return EVP_sha3_256();
+    case Sailfish::Crypto::CryptoManager::DigestSha3_384:
+        return EVP_sha3_384();
+    case Sailfish::Crypto::CryptoManager::DigestSha3_512:
+        return EVP_sha3_512();
+#endif
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(OPENSSL_NO_BLAKE2)
+    case Sailfish::Crypto::CryptoManager::DigestBlake2b:
+        return EVP_blake2b512();
+    case Sailfish::Crypto::CryptoManager::DigestBlake2s:
+        return EVP_blake2s256();
+#endif
     default:
         return Q_NULLPTR;
     }
@@ -411,32 +438,3 @@ int getEllipticCurveKeySize(Sailfish::Crypto::CryptoManager::EllipticCurve curve
     }
 }
 
-typedef EVP_PKEY *(*evpKeyReadFunc)(BIO *, EVP_PKEY **, pem_password_cb *, void *);
-
-EVP_PKEY *readEvpKey(const QByteArray &key, evpKeyReadFunc read)
-{
-    QScopedPointer<BIO, LibCrypto_BIO_Deleter> bio(BIO_new(BIO_s_mem()));
-
-    // Use BIO to write public key data
-    int r = BIO_write(bio.data(), key.data(), key.length());
-    if (r != key.length()) {
-        return Q_NULLPTR;
-    }
-
-    // Read the public key data into an EVP_PKEY
-    EVP_PKEY *pkeyPtr = Q_NULLPTR;
-    read(bio.data(), &pkeyPtr, Q_NULLPTR, Q_NULLPTR);
-
-    return pkeyPtr;
-}
-
-EVP_PKEY *readEvpPrivKey(const QByteArray &privKey)
-{
-    return readEvpKey(privKey, PEM_read_bio_PrivateKey);
-}
-
-EVP_PKEY *readEvpPubKey(const QByteArray &pubKey)
-{
-    return readEvpKey(pubKey, PEM_read_bio_PUBKEY);
-}
-
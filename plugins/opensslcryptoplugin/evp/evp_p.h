@@ -29,6 +29,11 @@ int pkcs5_pbkdf2_hmac(const char *pass, int passlen,
                       int iter, int digestFunction,
                       int keylen, unsigned char *out);
 
+int pbe_scrypt(const char *pass, size_t passlen,
+               const unsigned char *salt, size_t saltlen,
+               uint64_t N, uint64_t r, uint64_t p,
+               size_t keylen, unsigned char *out);
+
 int aes_encrypt_plaintext(const EVP_CIPHER *evp_cipher,
                           const unsigned char *init_vector,
                           const unsigned char *key,
@@ -131,6 +136,22 @@ int verify_session_finalize(EVP_MD_CTX *ctx,
                             const uint8_t *signature,
                             size_t signatureLength);
 
+int digest_session_init(EVP_MD_CTX **ctx,
+                        const EVP_MD *digestFunc);
+
+int digest_session_update(EVP_MD_CTX *ctx,
+                          const void *bytes,
+                          size_t bytesCount);
+
+int digest_session_finalize(EVP_MD_CTX *ctx,
+                            uint8_t **digest,
+                            size_t *digestLength);
+
+int hmac_session_init(EVP_MD_CTX **ctx,
+                      const EVP_MD *digestFunc,
+                      const unsigned char *key,
+                      size_t keyLength);
+
 int generate_ec_key(int curveNid,
                     uint8_t **publicKeyBytes,
                     size_t *publicKeySize,
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "keycache_p.h"
+
+#include <QtCore/QMessageAuthenticationCode>
+#include <QtCore/QMutexLocker>
+
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+
+namespace {
+    const int IdentifierKeySize = 32;
+
+    EVP_PKEY *parseKey(OpenSslKeyCache::KeyType type, const QByteArray &pemData)
+    {
+        BIO *bio = BIO_new_mem_buf(const_cast<char*>(pemData.constData()), pemData.size());
+        if (!bio) {
+            return NULL;
+        }
+
+        EVP_PKEY *pkey = type == OpenSslKeyCache::PrivateKey
+                ? PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL)
+                : PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+        BIO_free(bio);
+        if (!pkey) {
+            return NULL;
+        }
+
+        // Precompute the blinding factors now rather than on first use,
+        // so that the cost is paid once per cached key.
+        if (type == OpenSslKeyCache::PrivateKey && EVP_PKEY_base_id(pkey) == EVP_PKEY_RSA) {
+            RSA *rsa = EVP_PKEY_get1_RSA(pkey);
+            if (rsa) {
+                RSA_blinding_on(rsa, NULL);
+                RSA_free(rsa);
+            }
+        }
+
+        return pkey;
+    }
+
+    EVP_PKEY *newReference(EVP_PKEY *pkey)
+    {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+        CRYPTO_add(&pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+#else
+        EVP_PKEY_up_ref(pkey);
+#endif
+        return pkey;
+    }
+}
+
+OpenSslKeyCache::OpenSslKeyCache()
+    : m_identifierKey(IdentifierKeySize, Qt::Uninitialized)
+    , m_useCounter(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(m_identifierKey.data()), IdentifierKeySize) != 1) {
+        // the identifiers are still unique, they are just not keyed.
+        m_identifierKey.fill('\0');
+    }
+}
+
+OpenSslKeyCache::~OpenSslKeyCache()
+{
+    clear();
+}
+
+QByteArray OpenSslKeyCache::entryIdentifier(KeyType type, const QByteArray &pemData) const
+{
+    QMessageAuthenticationCode code(QCryptographicHash::Sha256, m_identifierKey);
+    code.addData(QByteArray(1, static_cast<char>(type)));
+    code.addData(pemData);
+    return code.result();
+}
+
+EVP_PKEY *OpenSslKeyCache::key(KeyType type, const QByteArray &pemData)
+{
+    if (pemData.isEmpty()) {
+        return NULL;
+    }
+
+    const QByteArray identifier = entryIdentifier(type, pemData);
+
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Entry>::iterator it = m_entries.find(identifier);
+    if (it != m_entries.end()) {
+        ++m_hits;
+        it->lastUsed = ++m_useCounter;
+        return newReference(it->pkey);
+    }
+    ++m_misses;
+    locker.unlock();
+
+    // Parse outside of the lock, so that other keys may be used meanwhile.
+    EVP_PKEY *pkey = parseKey(type, pemData);
+    if (!pkey) {
+        return NULL;
+    }
+
+    locker.relock();
+    it = m_entries.find(identifier);
+    if (it != m_entries.end()) {
+        // another thread parsed the same key; use its copy.
+        EVP_PKEY_free(pkey);
+        it->lastUsed = ++m_useCounter;
+        return newReference(it->pkey);
+    }
+
+    if (m_entries.size() >= MaximumEntries) {
+        // evict the least recently used entry.
+        QHash<QByteArray, Entry>::iterator oldest = m_entries.begin();
+        for (QHash<QByteArray, Entry>::iterator eit = m_entries.begin(); eit != m_entries.end(); ++eit) {
+            if (eit->lastUsed < oldest->lastUsed) {
+                oldest = eit;
+            }
+        }
+        EVP_PKEY_free(oldest->pkey);
+        m_entries.erase(oldest);
+    }
+
+    Entry entry;
+    entry.pkey = pkey;
+    entry.lastUsed = ++m_useCounter;
+    m_entries.insert(identifier, entry);
+    return newReference(pkey);
+}
+
+/*
+    void OpenSslKeyCache::clear()
+
+    Releases every cached key.  Keys which are still in use by an
+    operation in progress are freed when that operation releases them.
+ */
+void OpenSslKeyCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    for (const Entry &entry : m_entries) {
+        EVP_PKEY_free(entry.pkey);
+    }
+    m_entries.clear();
+}
+
+quint64 OpenSslKeyCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+quint64 OpenSslKeyCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_KEYCACHE_P_H
+#define SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_KEYCACHE_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+
+#include <openssl/evp.h>
+
+// Caches the EVP_PKEY objects parsed from PEM encoded asymmetric keys,
+// so that repeated operations with the same key do not each pay for
+// the PEM/ASN.1 decoding and (for RSA private keys) the blinding setup.
+// Entries are identified by a keyed hash of the key data, so that the
+// cache does not itself retain a copy of the PEM.  The cache is bounded
+// to MaximumEntries, evicting the least recently used key, and is safe
+// to use from multiple threads.
+class OpenSslKeyCache
+{
+public:
+    enum KeyType {
+        PrivateKey = 0,
+        PublicKey
+    };
+
+    enum {
+        MaximumEntries = 16
+    };
+
+    OpenSslKeyCache();
+    ~OpenSslKeyCache();
+
+    // Returns a new reference to the parsed key, which the caller
+    // must release with EVP_PKEY_free(), or null if the data could
+    // not be parsed as a key of the given type.
+    EVP_PKEY *key(KeyType type, const QByteArray &pemData);
+    void clear();
+
+    quint64 hits() const;
+    quint64 misses() const;
+
+private:
+    Q_DISABLE_COPY(OpenSslKeyCache)
+
+    struct Entry {
+        EVP_PKEY *pkey;
+        quint64 lastUsed;
+    };
+
+    QByteArray entryIdentifier(KeyType type, const QByteArray &pemData) const;
+
+    mutable QMutex m_mutex;
+    QHash<QByteArray, Entry> m_entries;
+    QByteArray m_identifierKey;
+    quint64 m_useCounter;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif // SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_KEYCACHE_P_H
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "keyderivation_p.h"
+#include "evp_p.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
+
+#ifdef SAILFISH_SECRETS_HAVE_ARGON2
+#include <argon2.h>
+#endif
+
+namespace {
+    const quint8 ParametersVersion = 1;
+
+    enum {
+        KeySize = 32,                           // 256 bit
+        LegacyIterations = 10000,
+        MaximumIterations = 10000000,
+        MinimumArgon2TimeCost = 2,
+        MaximumTimeCost = 64,                   // Argon2 passes, or scrypt p
+        MinimumMemoryCost = 16 * 1024,          // KiB
+        CalibrationMemoryCost = 64 * 1024,      // KiB, the most we will choose on a mobile device
+        MaximumMemoryCost = 256 * 1024,         // KiB, the most we will accept
+        MaximumParallelism = 16
+    };
+
+    bool isPowerOfTwo(quint32 value)
+    {
+        return value && !(value & (value - 1));
+    }
+
+    bool validParameters(const OpenSslKeyDerivation::Parameters &parameters)
+    {
+        switch (parameters.function) {
+            case OpenSslKeyDerivation::Pbkdf2:
+                return parameters.timeCost >= LegacyIterations
+                        && parameters.timeCost <= MaximumIterations;
+            case OpenSslKeyDerivation::Scrypt:
+                // with r = 8, each unit of N requires 1 KiB, and p is applied sequentially.
+                return isPowerOfTwo(parameters.memoryCost)
+                        && parameters.memoryCost >= 1024
+                        && parameters.memoryCost <= MaximumMemoryCost
+                        && parameters.parallelism >= 1
+                        && parameters.parallelism <= MaximumTimeCost;
+            case OpenSslKeyDerivation::Argon2id:
+                return parameters.timeCost >= 1
+                        && parameters.timeCost <= MaximumTimeCost
+                        && parameters.parallelism >= 1
+                        && parameters.parallelism <= MaximumParallelism
+                        && parameters.memoryCost >= 8 * parameters.parallelism
+                        && parameters.memoryCost <= MaximumMemoryCost;
+            default:
+                return false;
+        }
+    }
+
+    qint64 measure(const OpenSslKeyDerivation::Parameters &parameters)
+    {
+        const QByteArray code("calibration");
+        const QByteArray salt(32, 's');
+        QByteArray key;
+        QElapsedTimer timer;
+        timer.start();
+        if (!OpenSslKeyDerivation::deriveKey(code, salt, OpenSslKeyDerivation::encodeParameters(parameters), &key)) {
+            return -1;
+        }
+        return qMax<qint64>(timer.nsecsElapsed() / 1000, 1); // usec
+    }
+
+    quint32 scaled(quint32 value, qint64 elapsed, qint64 target, quint32 maximum)
+    {
+        if (elapsed >= target) {
+            return value;
+        }
+        return static_cast<quint32>(qMin<qint64>(value * target / elapsed, maximum));
+    }
+
+    bool calibrateFunction(OpenSslKeyDerivation::Function function,
+                           qint64 target,
+                           OpenSslKeyDerivation::Parameters *parameters)
+    {
+        OpenSslKeyDerivation::Parameters candidate;
+        switch (function) {
+            case OpenSslKeyDerivation::Argon2id:
+                candidate = OpenSslKeyDerivation::Parameters(function, MinimumArgon2TimeCost, MinimumMemoryCost, 1);
+                break;
+            case OpenSslKeyDerivation::Scrypt:
+                candidate = OpenSslKeyDerivation::Parameters(function, 0, MinimumMemoryCost, 1);
+                break;
+            default:
+                candidate = OpenSslKeyDerivation::Parameters(function, LegacyIterations, 0, 0);
+                break;
+        }
+
+        qint64 elapsed = measure(candidate);
+        if (elapsed < 0) {
+            return false;
+        }
+
+        // Spend the time budget on memory first, for the memory-hard functions,
+        // and then scale the number of passes to reach the target duration.
+        if (function != OpenSslKeyDerivation::Pbkdf2) {
+            while (elapsed * 2 <= target && candidate.memoryCost * 2 <= CalibrationMemoryCost) {
+                candidate.memoryCost *= 2;
+                elapsed = measure(candidate);
+                if (elapsed < 0) {
+                    return false;
+                }
+            }
+        }
+
+        switch (function) {
+            case OpenSslKeyDerivation::Argon2id:
+                candidate.timeCost = scaled(candidate.timeCost, elapsed, target, MaximumTimeCost);
+                break;
+            case OpenSslKeyDerivation::Scrypt:
+                candidate.parallelism = scaled(candidate.parallelism, elapsed, target, MaximumTimeCost);
+                break;
+            default:
+                candidate.timeCost = scaled(candidate.timeCost, elapsed, target, MaximumIterations);
+                break;
+        }
+
+        *parameters = candidate;
+        return true;
+    }
+}
+
+bool OpenSslKeyDerivation::supportsFunction(Function function)
+{
+    switch (function) {
+        case LegacyPbkdf2:
+        case Pbkdf2:
+            return true;
+        case Scrypt:
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(OPENSSL_NO_SCRYPT)
+            return true;
+#else
+            return false;
+#endif
+        case Argon2id:
+#ifdef SAILFISH_SECRETS_HAVE_ARGON2
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+QByteArray OpenSslKeyDerivation::encodeParameters(const Parameters &parameters)
+{
+    if (parameters.function == LegacyPbkdf2) {
+        return QByteArray();
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << ParametersVersion
+        << static_cast<quint8>(parameters.function)
+        << parameters.timeCost
+        << parameters.memoryCost
+        << parameters.parallelism;
+    return data;
+}
+
+bool OpenSslKeyDerivation::decodeParameters(const QByteArray &data, Parameters *parameters)
+{
+    if (data.isEmpty()) {
+        *parameters = Parameters(LegacyPbkdf2, LegacyIterations);
+        return true;
+    }
+
+    quint8 version = 0;
+    quint8 function = 0;
+    Parameters decoded;
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+    in >> version >> function >> decoded.timeCost >> decoded.memoryCost >> decoded.parallelism;
+    decoded.function = static_cast<Function>(function);
+    if (in.status() != QDataStream::Ok || !in.atEnd()
+            || version != ParametersVersion
+            || !validParameters(decoded)) {
+        return false;
+    }
+
+    *parameters = decoded;
+    return true;
+}
+
+/*
+    bool OpenSslKeyDerivation::deriveKey(const QByteArray &authenticationCode,
+                                         const QByteArray &salt,
+                                         const QByteArray &parameters,
+                                         QByteArray *key)
+
+    Derive a 256 bit key from the given authentication code and salt,
+    with the function and cost described by the given parameters.
+
+    Returns true on success, false if the parameters are invalid or
+    not supported, or if the derivation otherwise fails.
+ */
+bool OpenSslKeyDerivation::deriveKey(
+        const QByteArray &authenticationCode,
+        const QByteArray &salt,
+        const QByteArray &parameters,
+        QByteArray *key)
+{
+    Parameters params;
+    if (!decodeParameters(parameters, &params)) {
+        return false;
+    }
+
+    const QByteArray inputData = authenticationCode.isEmpty()
+                         ? QByteArray(1, '\0')
+                         : authenticationCode;
+    const unsigned char *saltData = salt.isEmpty()
+                         ? NULL
+                         : reinterpret_cast<const unsigned char*>(salt.constData());
+    QByteArray derived(KeySize, Qt::Uninitialized);
+    unsigned char *out = reinterpret_cast<unsigned char*>(derived.data());
+    int ok = 0;
+
+    switch (params.function) {
+        case LegacyPbkdf2:
+        case Pbkdf2:
+            ok = OpenSslEvp::pkcs5_pbkdf2_hmac(
+                    inputData.constData(), inputData.size(),
+                    saltData, salt.size(),
+                    params.timeCost,
+                    21, // CryptoManager::DigestSha256
+                    KeySize, out);
+            break;
+        case Scrypt:
+            ok = OpenSslEvp::pbe_scrypt(
+                    inputData.constData(), inputData.size(),
+                    saltData, salt.size(),
+                    params.memoryCost, 8, params.parallelism,
+                    KeySize, out);
+            break;
+        case Argon2id:
+#ifdef SAILFISH_SECRETS_HAVE_ARGON2
+            ok = argon2id_hash_raw(
+                    params.timeCost, params.memoryCost, params.parallelism,
+                    inputData.constData(), inputData.size(),
+                    salt.constData(), salt.size(),
+                    out, KeySize) == ARGON2_OK;
+#endif
+            break;
+    }
+
+    if (ok != 1) {
+        return false;
+    }
+
+    *key = derived;
+    return true;
+}
+
+/*
+    QByteArray OpenSslKeyDerivation::calibrate(int targetDuration)
+
+    Returns the parameters for the strongest supported key derivation
+    function (Argon2id, then scrypt, then PBKDF2) with a cost which takes
+    approximately targetDuration milliseconds on this device, bounded so
+    as to be no weaker than the minimum costs and to require no more than
+    64 MiB of memory.
+
+    Returns empty (legacy) parameters if no function could be calibrated.
+ */
+QByteArray OpenSslKeyDerivation::calibrate(int targetDuration)
+{
+    const qint64 target = qMax(targetDuration, 1) * Q_INT64_C(1000); // usec
+    const Function functions[] = { Argon2id, Scrypt, Pbkdf2 };
+    for (Function function : functions) {
+        Parameters parameters;
+        if (supportsFunction(function) && calibrateFunction(function, target, &parameters)) {
+            return encodeParameters(parameters);
+        }
+    }
+    return QByteArray();
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_KEYDERIVATION_P_H
+#define SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_KEYDERIVATION_P_H
+
+#include <QtCore/QByteArray>
+
+// Key derivation for the secrets plugins which are based on OpenSSL.
+// The key derivation parameters which are stored by the secrets service
+// for each collection are an opaque blob, which is produced and consumed
+// only by these functions.  Empty parameters denote the original
+// PBKDF2-HMAC-SHA256 derivation with a fixed number of iterations.
+namespace OpenSslKeyDerivation {
+
+enum Function {
+    LegacyPbkdf2 = 0,
+    Pbkdf2 = 10,    // CryptoManager::KdfPkcs5Pbkdf2
+    Scrypt = 40,    // CryptoManager::KdfScrypt
+    Argon2id = 52   // CryptoManager::KdfArgon2id
+};
+
+struct Parameters {
+    Parameters(Function f = LegacyPbkdf2, quint32 t = 0, quint32 m = 0, quint32 p = 0)
+        : function(f), timeCost(t), memoryCost(m), parallelism(p) {}
+    Function function;
+    quint32 timeCost;       // PBKDF2 iterations, or Argon2 passes
+    quint32 memoryCost;     // in KiB, for scrypt (with r = 8, this is N) or Argon2
+    quint32 parallelism;    // scrypt p, or Argon2 lanes
+};
+
+bool supportsFunction(Function function);
+
+QByteArray encodeParameters(const Parameters &parameters);
+bool decodeParameters(const QByteArray &data, Parameters *parameters);
+
+bool deriveKey(const QByteArray &authenticationCode,
+               const QByteArray &salt,
+               const QByteArray &parameters,
+               QByteArray *key);
+
+QByteArray calibrate(int targetDuration);
+
+} // OpenSslKeyDerivation
+
+#endif // SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_KEYDERIVATION_P_H
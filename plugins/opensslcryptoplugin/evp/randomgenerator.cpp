@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "randomgenerator_p.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QThreadStorage>
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+    struct ThreadRandomBuffer
+    {
+        ThreadRandomBuffer()
+            : available(0)
+            , generation(-1)
+        {
+        }
+        ~ThreadRandomBuffer()
+        {
+            OPENSSL_cleanse(data, sizeof(data));
+        }
+        unsigned char data[OpenSslRandomGenerator::BufferSize];
+        int available;
+        int generation;
+    };
+    QThreadStorage<ThreadRandomBuffer*> s_randomBuffers;
+    QAtomicInt s_seedGeneration;
+
+    bool drbgBytes(unsigned char *data, quint64 length)
+    {
+        while (length > 0) {
+            const int chunk = static_cast<int>(qMin<quint64>(length, OpenSslRandomGenerator::ChunkSize));
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            if (RAND_priv_bytes(data, chunk) != 1) {
+#else
+            if (RAND_bytes(data, chunk) != 1) {
+#endif
+                return false;
+            }
+            data += chunk;
+            length -= chunk;
+        }
+        return true;
+    }
+
+    int urandomDescriptor()
+    {
+        // opened once, and intentionally never closed.
+        static const int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        return fd;
+    }
+
+    bool kernelBytes(unsigned char *data, quint64 length)
+    {
+#if defined(SYS_getrandom)
+        while (length > 0) {
+            const long r = syscall(SYS_getrandom, data, static_cast<size_t>(length), 0);
+            if (r < 0) {
+                if (errno == EINTR) {
+                    continue;
+                } else if (errno == ENOSYS) {
+                    break; // older kernel, fall back to /dev/urandom.
+                }
+                return false;
+            }
+            data += r;
+            length -= r;
+        }
+        if (length == 0) {
+            return true;
+        }
+#endif
+
+        const int fd = urandomDescriptor();
+        if (fd < 0) {
+            return false;
+        }
+        while (length > 0) {
+            const ssize_t r = read(fd, data, static_cast<size_t>(qMin<quint64>(length, OpenSslRandomGenerator::ChunkSize)));
+            if (r < 0 && errno == EINTR) {
+                continue;
+            } else if (r <= 0) {
+                return false;
+            }
+            data += r;
+            length -= r;
+        }
+        return true;
+    }
+
+    bool bufferedDrbgBytes(unsigned char *data, int length)
+    {
+        if (!s_randomBuffers.hasLocalData()) {
+            s_randomBuffers.setLocalData(new ThreadRandomBuffer);
+        }
+        ThreadRandomBuffer *buffer = s_randomBuffers.localData();
+
+        // discard any data which was generated before the last seed.
+        const int generation = s_seedGeneration.loadAcquire();
+        if (buffer->generation != generation) {
+            OPENSSL_cleanse(buffer->data, sizeof(buffer->data));
+            buffer->available = 0;
+            buffer->generation = generation;
+        }
+
+        if (buffer->available < length) {
+            if (!drbgBytes(buffer->data, sizeof(buffer->data))) {
+                buffer->available = 0;
+                return false;
+            }
+            buffer->available = sizeof(buffer->data);
+        }
+
+        // hand out each byte once, wiping it from the buffer.
+        unsigned char *start = buffer->data + sizeof(buffer->data) - buffer->available;
+        memcpy(data, start, length);
+        OPENSSL_cleanse(start, length);
+        buffer->available -= length;
+        return true;
+    }
+}
+
+/*
+    bool OpenSslRandomGenerator::generate(Engine engine, char *data, quint64 length)
+
+    Writes length bytes of random data from the given engine into data.
+    Returns false if the length exceeds MaximumRequestSize, or if the
+    engine failed to generate the data.
+ */
+bool OpenSslRandomGenerator::generate(Engine engine, char *data, quint64 length)
+{
+    if (length > quint64(MaximumRequestSize)) {
+        return false;
+    }
+
+    unsigned char *bytes = reinterpret_cast<unsigned char*>(data);
+    if (engine == DevURandomEngine) {
+        return kernelBytes(bytes, length);
+    } else if (length <= quint64(MaximumBufferedRequestSize)) {
+        return bufferedDrbgBytes(bytes, static_cast<int>(length));
+    }
+    return drbgBytes(bytes, length);
+}
+
+/*
+    void OpenSslRandomGenerator::seed(const void *seedData, int length, double entropyEstimate)
+
+    Mixes the given seed data into the OpenSSL DRBG, and discards any
+    random data which was buffered before the seed was added.
+ */
+void OpenSslRandomGenerator::seed(const void *seedData, int length, double entropyEstimate)
+{
+    RAND_add(seedData, length, entropyEstimate);
+    s_seedGeneration.fetchAndAddOrdered(1);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_RANDOMGENERATOR_P_H
+#define SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_RANDOMGENERATOR_P_H
+
+#include <QtCore/QtGlobal>
+
+// Generates random data for the OpenSSL crypto plugin.
+// The default engine uses the OpenSSL DRBG (the private DRBG where it is
+// available).  Small requests are served from a per-thread buffer which
+// is refilled in a single DRBG call, while large requests are generated
+// directly into the caller's buffer in chunks.  The buffered data is
+// discarded whenever the generator is seeded, so that data generated
+// after seeding always reflects the seed.
+// The /dev/urandom engine reads from the kernel via getrandom(), falling
+// back to a single /dev/urandom descriptor which stays open for the
+// lifetime of the process.
+// All functions are safe to call from multiple threads.
+class OpenSslRandomGenerator
+{
+public:
+    enum Engine {
+        DefaultEngine = 0,
+        DevURandomEngine
+    };
+
+    enum {
+        MaximumRequestSize = 16 * 1024 * 1024,
+        MaximumBufferedRequestSize = 256,
+        BufferSize = 4096,
+        ChunkSize = 1024 * 1024
+    };
+
+    // Writes length bytes of random data into data.
+    // Returns false if the data could not be generated, in which
+    // case the contents of data are undefined.
+    static bool generate(Engine engine, char *data, quint64 length);
+    static void seed(const void *seedData, int length, double entropyEstimate);
+
+private:
+    OpenSslRandomGenerator();
+};
+
+#endif // SAILFISHCRYPTO_PLUGIN_CRYPTO_OPENSSL_RANDOMGENERATOR_P_H
@@ -8,6 +8,7 @@
 #include "opensslcryptoplugin.h"
 #include "evp_p.h"
 #include "evp_helpers_p.h"
+#include "randomgenerator_p.h"
 
 #include "Crypto/key.h"
 #include "Crypto/generaterandomdatarequest.h"
@@ -19,8 +20,8 @@
 #include <QtCore/QString>
 #include <QtCore/QUuid>
 #include <QtCore/QCryptographicHash>
+#include <QtCore/QMutexLocker>
 
-#include <fstream>
 #include <cstdlib>
 
 #include <openssl/rand.h>
@@ -32,6 +33,22 @@ Q_PLUGIN_METADATA(IID Sailfish_Crypto_CryptoPlugin_IID)
 
 using namespace Sailfish::Crypto;
 
+namespace {
+    // Marks a cipher session as no longer in use when it goes out of scope.
+    struct CipherSessionInUse
+    {
+        CipherSessionInUse(QMutex *mutex, CipherSessionData *csd)
+            : m_mutex(mutex), m_csd(csd) {}
+        ~CipherSessionInUse()
+        {
+            QMutexLocker locker(m_mutex);
+            m_csd->inUse = false;
+        }
+        QMutex *m_mutex;
+        CipherSessionData *m_csd;
+    };
+}
+
 Daemon::Plugins::OpenSslCryptoPlugin::OpenSslCryptoPlugin(QObject *parent)
     : QObject(parent)
 {
@@ -40,17 +57,43 @@ Daemon::Plugins::OpenSslCryptoPlugin::OpenSslCryptoPlugin(QObject *parent)
 
     // seed the RNG
     char seed[1024] = {0};
-    std::ifstream rand("/dev/urandom");
-    rand.read(seed, 1024);
-    rand.close();
-    RAND_add(seed, 1024, 1.0);
+    if (OpenSslRandomGenerator::generate(OpenSslRandomGenerator::DevURandomEngine, seed, sizeof(seed))) {
+        OpenSslRandomGenerator::seed(seed, sizeof(seed), 1.0);
+        OPENSSL_cleanse(seed, sizeof(seed));
+    }
 }
 
 Daemon::Plugins::OpenSslCryptoPlugin::~OpenSslCryptoPlugin()
 {
+    m_keyCache.clear();
     OpenSslEvp::cleanup();
 }
 
+bool
+Daemon::Plugins::OpenSslCryptoPlugin::lock()
+{
+    clearKeyCache();
+    return PluginBase::lock();
+}
+
+void
+Daemon::Plugins::OpenSslCryptoPlugin::clearKeyCache()
+{
+    m_keyCache.clear();
+}
+
+quint64
+Daemon::Plugins::OpenSslCryptoPlugin::keyCacheHits() const
+{
+    return m_keyCache.hits();
+}
+
+quint64
+Daemon::Plugins::OpenSslCryptoPlugin::keyCacheMisses() const
+{
+    return m_keyCache.misses();
+}
+
 Result
 Daemon::Plugins::OpenSslCryptoPlugin::seedRandomDataGenerator(
         quint64 callerIdent,
@@ -68,7 +111,7 @@ Daemon::Plugins::OpenSslCryptoPlugin::seedRandomDataGenerator(
 
     // Note: this will affect all clients, as we don't currently separate RNGs based on callerIdent.
     // TODO: initialize separate RNG engine instances for separate callers?
-    RAND_add(seedData.constData(), seedData.size(), entropyEstimate);
+    OpenSslRandomGenerator::seed(seedData.constData(), seedData.size(), entropyEstimate);
     return Result(Result::Succeeded);
 }
 
@@ -143,33 +186,28 @@ Daemon::Plugins::OpenSslCryptoPlugin::generateRandomData(
 {
     Q_UNUSED(callerIdent)
 
-    static const int maxBytes = 4096;
-    bool useDevURandom = false;
+    OpenSslRandomGenerator::Engine engine = OpenSslRandomGenerator::DefaultEngine;
 
     if (csprngEngineName == QStringLiteral("/dev/urandom")) {
-        useDevURandom = true;
+        engine = OpenSslRandomGenerator::DevURandomEngine;
     } else if (csprngEngineName != Sailfish::Crypto::GenerateRandomDataRequest::DefaultCsprngEngineName) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginRandomDataError,
                                         QLatin1String("This crypto plugin only supports default and /dev/urandom engines"));
     }
 
-    if (!numberBytes || numberBytes > maxBytes) {
+    if (!numberBytes || numberBytes > quint64(OpenSslRandomGenerator::MaximumRequestSize)) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginRandomDataError,
-                                        QLatin1String("This crypto plugin can only generate up to 4096 bytes of random data at a time"));
+                                        QLatin1String("This crypto plugin can only generate up to 16 MiB of random data at a time"));
     }
 
-    int nbytes = numberBytes;
-    QScopedArrayPointer<char> buf(new char[nbytes]);
-    if (useDevURandom) {
-        std::ifstream rand("/dev/urandom");
-        rand.read(buf.data(), nbytes);
-        rand.close();
-    } else if (RAND_bytes(reinterpret_cast<unsigned char*>(buf.data()), nbytes) != 1) {
+    // generate directly into the result, to avoid an intermediate copy.
+    QByteArray buf(static_cast<int>(numberBytes), Qt::Uninitialized);
+    if (!OpenSslRandomGenerator::generate(engine, buf.data(), numberBytes)) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginRandomDataError,
                                         QLatin1String("This crypto plugin failed to generate the random data"));
     }
 
-    *randomData = QByteArray(reinterpret_cast<const char *>(buf.data()), nbytes);
+    *randomData = buf;
     return Sailfish::Crypto::Result(Sailfish::Crypto::Result::Succeeded);
 }
 
@@ -655,7 +693,7 @@ Daemon::Plugins::OpenSslCryptoPlugin::sign(
     }
 
     // Read the private key data into an EVP_PKEY, which SHOULD handle different formats transparently.
-    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(readEvpPrivKey(key.privateKey()));
+    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(m_keyCache.key(OpenSslKeyCache::PrivateKey, key.privateKey()));
     if (pkey.data() == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginSigningError,
                                         QLatin1String("Failed to read private key from PEM format."));
@@ -723,7 +761,7 @@ Daemon::Plugins::OpenSslCryptoPlugin::verify(
     }
 
     // Read the public key data into an EVP_PKEY
-    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(readEvpPubKey(key.publicKey()));
+    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(m_keyCache.key(OpenSslKeyCache::PublicKey, key.publicKey()));
     if (pkey.data() == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginVerificationError,
                                         QLatin1String("Failed to read public key from PEM format."));
@@ -810,29 +848,17 @@ Daemon::Plugins::OpenSslCryptoPlugin::encryptAsymmetric(
                                         QLatin1String("The given padding type is not supported for the given algorithm."));
     }
 
-    QScopedPointer<BIO, LibCrypto_BIO_Deleter> bio(BIO_new(BIO_s_mem()));
-
-    // Use BIO to write public key data
-    int r = BIO_write(bio.data(), key.publicKey().data(), key.publicKey().length());
-    if (r == 0 || r != key.publicKey().length()) {
-        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginEncryptionError,
-                                        QLatin1String("Failed to read public key data."));
-    }
-
     // Read the public key data into an EVP_PKEY, which SHOULD handle different formats transparently.
-    EVP_PKEY *pkeyPtr = Q_NULLPTR;
-    PEM_read_bio_PUBKEY(bio.data(), &pkeyPtr, Q_NULLPTR, Q_NULLPTR);
-    if (pkeyPtr == Q_NULLPTR) {
+    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(m_keyCache.key(OpenSslKeyCache::PublicKey, key.publicKey()));
+    if (pkey.data() == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginEncryptionError,
                                         QLatin1String("Failed to read public key from PEM format."));
     }
 
-    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(pkeyPtr);
-
     uint8_t *encryptedBytes = Q_NULLPTR;
     size_t encryptedBytesLength = 0;
 
-    r = OpenSslEvp::pkey_encrypt_plaintext(pkeyPtr,
+    int r = OpenSslEvp::pkey_encrypt_plaintext(pkey.data(),
                                        opensslPadding,
                                        reinterpret_cast<const uint8_t*>(data.data()),
                                        data.length(),
@@ -998,29 +1024,17 @@ Daemon::Plugins::OpenSslCryptoPlugin::decryptAsymmetric(
                                         QLatin1String("The given padding type is not supported for the given algorithm."));
     }
 
-    QScopedPointer<BIO, LibCrypto_BIO_Deleter> bio(BIO_new(BIO_s_mem()));
-
-    // Use BIO to write private key data
-    int r = BIO_write(bio.data(), key.privateKey().data(), key.privateKey().length());
-    if (r == 0 || r != key.privateKey().length()) {
-        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginDecryptionError,
-                                        QLatin1String("Failed to read private key data."));
-    }
-
     // Read the private key data into an EVP_PKEY, which SHOULD handle different formats transparently.
-    EVP_PKEY *pkeyPtr = Q_NULLPTR;
-    PEM_read_bio_PrivateKey(bio.data(), &pkeyPtr, Q_NULLPTR, Q_NULLPTR);
-    if (pkeyPtr == Q_NULLPTR) {
+    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(m_keyCache.key(OpenSslKeyCache::PrivateKey, key.privateKey()));
+    if (pkey.data() == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginDecryptionError,
                                         QLatin1String("Failed to read private key from PEM format."));
     }
 
-    QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(pkeyPtr);
-
     uint8_t *decryptedBytes = Q_NULLPTR;
     size_t decryptedBytesLength = 0;
 
-    r = OpenSslEvp::pkey_decrypt_ciphertext(pkeyPtr,
+    int r = OpenSslEvp::pkey_decrypt_ciphertext(pkey.data(),
                                         opensslPadding,
                                         reinterpret_cast<const uint8_t*>(data.data()),
                                         data.length(),
@@ -1133,7 +1147,14 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
         const QVariantMap & /* customParameters */,
         quint32 *cipherSessionToken)
 {
-    if (key.algorithm() == Sailfish::Crypto::CryptoManager::AlgorithmAes) {
+    if (operation == Sailfish::Crypto::CryptoManager::OperationCalculateDigest) {
+        // no key is required.
+    } else if (operation == Sailfish::Crypto::CryptoManager::OperationCalculateMac) {
+        if (key.secretKey().isEmpty()) {
+            return Sailfish::Crypto::Result(Sailfish::Crypto::Result::EmptySecretKeyError,
+                                            QLatin1String("Cannot create a MAC cipher session with empty secret key"));
+        }
+    } else if (key.algorithm() == Sailfish::Crypto::CryptoManager::AlgorithmAes) {
         if (operation != Sailfish::Crypto::CryptoManager::OperationEncrypt
                 && operation != Sailfish::Crypto::CryptoManager::OperationDecrypt) {
             return Sailfish::Crypto::Result(Sailfish::Crypto::Result::OperationNotSupportedError,
@@ -1170,16 +1191,17 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
                                         QLatin1String("Plugin only supports signature padding None"));
     }
 
-    if (digestFunction != Sailfish::Crypto::CryptoManager::DigestSha256) {
+    if (getEvpDigestFunction(digestFunction) == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::DigestNotSupportedError,
-                                        QLatin1String("Plugin only supports digest function Sha256"));
+                                        QLatin1String("Unsupported digest function chosen."));
     }
 
-    quint32 sessionToken = getNextCipherSessionToken(&m_cipherSessions, clientId);
-    if (sessionToken == 0) {
+    QMutexLocker sessionsLocker(&m_cipherSessionsMutex);
+    if (getNextCipherSessionToken(&m_cipherSessions, clientId) == 0) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                         QLatin1String("Too many concurrent cipher sessions initiated by client"));
     }
+    sessionsLocker.unlock();
 
     if (operation == Sailfish::Crypto::CryptoManager::OperationEncrypt) {
         const int expectedIvSize = initializationVectorSize(key.algorithm(), blockMode, key.size());
@@ -1276,7 +1298,7 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
         }
 
         // Read the private key data into an EVP_PKEY
-        QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(readEvpPrivKey(key.privateKey()));
+        QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(m_keyCache.key(OpenSslKeyCache::PrivateKey, key.privateKey()));
         if (pkey.data() == Q_NULLPTR) {
             return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                             QLatin1String("Failed to read private key from PEM format."));
@@ -1296,7 +1318,7 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
         }
 
         // Read the public key data into an EVP_PKEY
-        QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(readEvpPubKey(key.publicKey()));
+        QScopedPointer<EVP_PKEY, LibCrypto_EVP_PKEY_Deleter> pkey(m_keyCache.key(OpenSslKeyCache::PublicKey, key.publicKey()));
         if (pkey.data() == Q_NULLPTR) {
             return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginVerificationError,
                                             QLatin1String("Failed to read public key from PEM format."));
@@ -1308,6 +1330,20 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
             return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                             QLatin1String("Failed to initialize cipher session context"));
         }
+    } else if (operation == Sailfish::Crypto::CryptoManager::OperationCalculateDigest) {
+        int r = OpenSslEvp::digest_session_init(&evp_md_ctx, getEvpDigestFunction(digestFunction));
+        if (r != 1) {
+            return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                            QLatin1String("Failed to initialize digest session context"));
+        }
+    } else if (operation == Sailfish::Crypto::CryptoManager::OperationCalculateMac) {
+        int r = OpenSslEvp::hmac_session_init(&evp_md_ctx, getEvpDigestFunction(digestFunction),
+                                              reinterpret_cast<const unsigned char *>(key.secretKey().constData()),
+                                              key.secretKey().size());
+        if (r != 1) {
+            return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                            QLatin1String("Failed to initialize HMAC session context"));
+        }
     } else {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::OperationNotSupportedError,
                                         QLatin1String("Unsupported operation for cipher request"));
@@ -1321,23 +1357,43 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
     csd->encryptionPadding = encryptionPadding;
     csd->signaturePadding = signaturePadding;
     csd->digestFunction = digestFunction;
-    csd->cipherSessionToken = sessionToken;
     csd->evp_cipher_ctx = evp_cipher_ctx;
     csd->evp_md_ctx = evp_md_ctx;
+
+    // The session is initialized outside the lock, so the token is only
+    // allocated now, as another thread may have taken the earlier one.
+    sessionsLocker.relock();
+    const quint32 sessionToken = getNextCipherSessionToken(&m_cipherSessions, clientId);
+    if (sessionToken == 0) {
+        sessionsLocker.unlock();
+        QScopedPointer<CipherSessionData,CipherSessionDataDeleter> csdd(csd);
+        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                        QLatin1String("Too many concurrent cipher sessions initiated by client"));
+    }
+    csd->cipherSessionToken = sessionToken;
+
+    // The timer lives in the plugin's thread, which runs an event loop,
+    // rather than in whichever worker thread initialized the session.
     QTimer *timeout = new QTimer;
     timeout->setSingleShot(true);
     timeout->setInterval(CIPHER_SESSION_INACTIVITY_TIMEOUT);
+    timeout->moveToThread(thread());
     QObject::connect(timeout, &QTimer::timeout,
                      [this, timeout] {
-        CipherSessionLookup lookup(this->m_cipherSessionTimeouts.take(timeout));
-        if (lookup.csd) {
+        QMutexLocker locker(&this->m_cipherSessionsMutex);
+        QMap<QTimer *, CipherSessionLookup>::iterator it = this->m_cipherSessionTimeouts.find(timeout);
+        if (it == this->m_cipherSessionTimeouts.end()) {
+            timeout->deleteLater();
+        } else if (it->csd->inUse) {
+            timeout->start(); // still active, check again later.
+        } else {
+            CipherSessionLookup lookup(*it);
+            this->m_cipherSessionTimeouts.erase(it);
             this->m_cipherSessions[lookup.clientId].remove(lookup.sessionToken);
+            locker.unlock();
             QScopedPointer<CipherSessionData,CipherSessionDataDeleter> csdd(lookup.csd);
-        } else {
-            timeout->deleteLater();
         }
     });
-    timeout->start();
     csd->timeout = timeout;
     m_cipherSessions[clientId].insert(sessionToken, csd);
 
@@ -1346,11 +1402,46 @@ Daemon::Plugins::OpenSslCryptoPlugin::initializeCipherSession(
     lookup.sessionToken = sessionToken;
     lookup.clientId = clientId;
     m_cipherSessionTimeouts.insert(timeout, lookup);
+    QMetaObject::invokeMethod(timeout, "start", Qt::QueuedConnection);
 
     *cipherSessionToken = sessionToken;
     return Sailfish::Crypto::Result(Sailfish::Crypto::Result::Succeeded);
 }
 
+// Looks up the given cipher session and marks it as in use, so that it
+// is neither expired nor used by another thread until it is released.
+// If finalize is true the session is instead removed, and ownership of
+// it is passed to the caller.
+Sailfish::Crypto::Result
+Daemon::Plugins::OpenSslCryptoPlugin::acquireCipherSession(
+        quint64 clientId,
+        quint32 cipherSessionToken,
+        bool finalize,
+        CipherSessionData **csd)
+{
+    QMutexLocker locker(&m_cipherSessionsMutex);
+    CipherSessionData *session = m_cipherSessions.value(clientId).value(cipherSessionToken);
+    if (!session) {
+        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                        QLatin1String("Unknown cipher session token provided"));
+    } else if (session->inUse) {
+        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                        QLatin1String("The cipher session is in use by another operation"));
+    }
+
+    if (finalize) {
+        m_cipherSessions[clientId].remove(cipherSessionToken);
+        m_cipherSessionTimeouts.remove(session->timeout);
+    } else {
+        session->inUse = true;
+        // restart the timeout due to activity.
+        QMetaObject::invokeMethod(session->timeout, "start", Qt::QueuedConnection);
+    }
+
+    *csd = session;
+    return Sailfish::Crypto::Result(Sailfish::Crypto::Result::Succeeded);
+}
+
 Sailfish::Crypto::Result
 Daemon::Plugins::OpenSslCryptoPlugin::updateCipherSessionAuthentication(
         quint64 clientId,
@@ -1358,13 +1449,12 @@ Daemon::Plugins::OpenSslCryptoPlugin::updateCipherSessionAuthentication(
         const QVariantMap & /* customParameters */,
         quint32 cipherSessionToken)
 {
-    if (!m_cipherSessions.contains(clientId)
-            || !m_cipherSessions[clientId].contains(cipherSessionToken)) {
-        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
-                                        QLatin1String("Unknown cipher session token provided"));
+    CipherSessionData *csd = Q_NULLPTR;
+    Sailfish::Crypto::Result sessionResult = acquireCipherSession(clientId, cipherSessionToken, false, &csd);
+    if (sessionResult.code() != Sailfish::Crypto::Result::Succeeded) {
+        return sessionResult;
     }
-
-    CipherSessionData *csd = m_cipherSessions[clientId].value(cipherSessionToken);
+    CipherSessionInUse sessionInUse(&m_cipherSessionsMutex, csd);
     if (csd->blockMode != Sailfish::Crypto::CryptoManager::BlockModeGcm) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                         QLatin1String("Block mode is not GCM, cannot update authentication data"));
@@ -1373,7 +1463,6 @@ Daemon::Plugins::OpenSslCryptoPlugin::updateCipherSessionAuthentication(
                                         QLatin1String("Cipher context has not been initialized"));
     }
 
-    csd->timeout->start(); // restart the timeout due to activity.
     int len = 0;
     if (csd->operation == Sailfish::Crypto::CryptoManager::OperationEncrypt) {
         if (EVP_EncryptUpdate(csd->evp_cipher_ctx, Q_NULLPTR, &len,
@@ -1405,19 +1494,17 @@ Daemon::Plugins::OpenSslCryptoPlugin::updateCipherSession(
         quint32 cipherSessionToken,
         QByteArray *generatedData)
 {
-    if (!m_cipherSessions.contains(clientId)
-            || !m_cipherSessions[clientId].contains(cipherSessionToken)) {
-        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
-                                        QLatin1String("Unknown cipher session token provided"));
+    CipherSessionData *csd = Q_NULLPTR;
+    Sailfish::Crypto::Result sessionResult = acquireCipherSession(clientId, cipherSessionToken, false, &csd);
+    if (sessionResult.code() != Sailfish::Crypto::Result::Succeeded) {
+        return sessionResult;
     }
-
-    CipherSessionData *csd = m_cipherSessions[clientId].value(cipherSessionToken);
+    CipherSessionInUse sessionInUse(&m_cipherSessionsMutex, csd);
     if (csd->evp_cipher_ctx == Q_NULLPTR && csd->evp_md_ctx == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                         QLatin1String("Cipher context has not been initialized"));
     }
 
-    csd->timeout->start(); // restart the timeout due to activity.
     if (csd->evp_cipher_ctx) {
         int blockSizeForCipher = 16; // TODO: lookup for different algorithms, but AES is 128 bit blocks = 16 bytes
         QScopedArrayPointer<unsigned char> generatedDataBuf(new unsigned char[data.size() + blockSizeForCipher]);
@@ -1456,6 +1543,13 @@ Daemon::Plugins::OpenSslCryptoPlugin::updateCipherSession(
                 return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                                 QLatin1String("Failed to update verify cipher data"));
             }
+        } else if (csd->operation == Sailfish::Crypto::CryptoManager::OperationCalculateDigest
+                   || csd->operation == Sailfish::Crypto::CryptoManager::OperationCalculateMac) {
+            int r = OpenSslEvp::digest_session_update(csd->evp_md_ctx, data.constData(), data.size());
+            if (r != 1) {
+                return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                                QLatin1String("Failed to update digest cipher data"));
+            }
         }
         *generatedData = QByteArray();
     }
@@ -1472,20 +1566,17 @@ Daemon::Plugins::OpenSslCryptoPlugin::finalizeCipherSession(
         QByteArray *generatedData,
         Sailfish::Crypto::CryptoManager::VerificationStatus *verificationStatus)
 {
-    if (!m_cipherSessions.contains(clientId)
-            || !m_cipherSessions[clientId].contains(cipherSessionToken)) {
-        return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
-                                        QLatin1String("Unknown cipher session token provided"));
+    CipherSessionData *csd = Q_NULLPTR;
+    Sailfish::Crypto::Result sessionResult = acquireCipherSession(clientId, cipherSessionToken, true, &csd);
+    if (sessionResult.code() != Sailfish::Crypto::Result::Succeeded) {
+        return sessionResult;
     }
-
-    CipherSessionData *csd = m_cipherSessions[clientId].value(cipherSessionToken);
+    QScopedPointer<CipherSessionData,CipherSessionDataDeleter> csdd(csd);
     if (csd->evp_cipher_ctx == Q_NULLPTR && csd->evp_md_ctx == Q_NULLPTR) {
         return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
                                         QLatin1String("Cipher context has not been initialized"));
     }
 
-    QScopedPointer<CipherSessionData,CipherSessionDataDeleter> csdd(m_cipherSessions[clientId].take(cipherSessionToken));
-    m_cipherSessionTimeouts.remove(csd->timeout);
     if (csd->evp_cipher_ctx) {
         int blockSizeForCipher = 16; // TODO: lookup for different algorithms, but AES is 128 bit blocks = 16 bytes
         QScopedArrayPointer<unsigned char> generatedDataBuf(new unsigned char[blockSizeForCipher*2]); // final 1 or 2 blocks.
@@ -1580,6 +1671,24 @@ Daemon::Plugins::OpenSslCryptoPlugin::finalizeCipherSession(
                                                 QLatin1String("Failed to finalize verify cipher with signature data"));
             }
             *generatedData = QByteArray();
+        } else if (csd->operation == Sailfish::Crypto::CryptoManager::OperationCalculateDigest
+                   || csd->operation == Sailfish::Crypto::CryptoManager::OperationCalculateMac) {
+            size_t digestLength = 0;
+            uint8_t *digestData;
+
+            int r = csd->operation == Sailfish::Crypto::CryptoManager::OperationCalculateDigest
+                    ? OpenSslEvp::digest_session_finalize(csd->evp_md_ctx, &digestData, &digestLength)
+                    : OpenSslEvp::sign_session_finalize(csd->evp_md_ctx, &digestData, &digestLength);
+            // Already destroyed, set to nullptr to prevent double free
+            csd->evp_md_ctx = nullptr;
+
+            if (r != 1) {
+                return Sailfish::Crypto::Result(Sailfish::Crypto::Result::CryptoPluginCipherSessionError,
+                                                QLatin1String("Failed to finalize digest cipher"));
+            }
+
+            *generatedData = QByteArray(reinterpret_cast<const char *>(digestData), digestLength);
+            OPENSSL_free(digestData);
         }
     }
 
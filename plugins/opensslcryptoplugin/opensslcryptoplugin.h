@@ -10,10 +10,13 @@
 
 #include "Crypto/Plugins/extensionplugins.h"
 
+#include "keycache_p.h"
+
 #include <QObject>
 #include <QByteArray>
 #include <QCryptographicHash>
 #include <QMap>
+#include <QMutex>
 
 // When building the actual plugin, export it.
 // When just compiling into another plugin, don't.
@@ -59,8 +62,19 @@ public:
     int version() const Q_DECL_OVERRIDE {
         return 1;
     }
+    bool supportsConcurrentOperations() const Q_DECL_OVERRIDE {
+        return true;
+    }
 
     bool canStoreKeys() const Q_DECL_OVERRIDE { return false; }
+    bool lock() Q_DECL_OVERRIDE;
+
+    // Parsed asymmetric keys are cached between operations.
+    // Plugins which embed this plugin should clear the cache
+    // whenever the keys they hold become inaccessible.
+    void clearKeyCache();
+    quint64 keyCacheHits() const;
+    quint64 keyCacheMisses() const;
     Sailfish::Crypto::CryptoPlugin::EncryptionType encryptionType() const Q_DECL_OVERRIDE { return Sailfish::Crypto::CryptoPlugin::SoftwareEncryption; }
 
     Sailfish::Crypto::Result generateRandomData(
@@ -256,6 +270,15 @@ private:
             Sailfish::Crypto::CryptoManager::EncryptionPadding padding,
             QByteArray *decrypted);
 
+    Sailfish::Crypto::Result acquireCipherSession(
+            quint64 clientId,
+            quint32 cipherSessionToken,
+            bool finalize,
+            CipherSessionData **csd);
+
+    // Guards the cipher session maps and the inUse flag of each session,
+    // as operations may be invoked from several threads at once.
+    mutable QMutex m_cipherSessionsMutex;
     QMap<quint64, QMap<quint32, CipherSessionData*> > m_cipherSessions; // clientId to token to data
     struct CipherSessionLookup {
         CipherSessionData *csd = 0;
@@ -263,6 +286,7 @@ private:
         quint64 clientId = 0;
     };
     QMap<QTimer *, CipherSessionLookup> m_cipherSessionTimeouts;
+    OpenSslKeyCache m_keyCache;
 };
 
 } // namespace Plugins
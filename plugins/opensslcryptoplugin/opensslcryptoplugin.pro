@@ -10,8 +10,8 @@ include($$PWD/../../lib/libsailfishcryptopluginapi.pri)
 
 INCLUDEPATH += $$PWD/evp/
 DEPENDPATH += $$PWD/evp/
-HEADERS += $$PWD/evp/evp_p.h $$PWD/evp/evp_helpers_p.h $$PWD/opensslcryptoplugin.h
-SOURCES += $$PWD/evp/evp.cpp $$PWD/opensslcryptoplugin.cpp
+HEADERS += $$PWD/evp/evp_p.h $$PWD/evp/evp_helpers_p.h $$PWD/evp/keycache_p.h $$PWD/evp/randomgenerator_p.h $$PWD/opensslcryptoplugin.h
+SOURCES += $$PWD/evp/evp.cpp $$PWD/evp/keycache.cpp $$PWD/evp/randomgenerator.cpp $$PWD/opensslcryptoplugin.cpp
 
 target.path=/usr/lib/Sailfish/Crypto/
 INSTALLS += target
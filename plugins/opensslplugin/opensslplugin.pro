@@ -4,6 +4,12 @@ TARGET = sailfishsecrets-openssl
 TARGET = $$qtLibraryTarget($$TARGET)
 PKGCONFIG += libcrypto
 
+# Argon2id key derivation is available if libargon2 is installed.
+packagesExist(libargon2) {
+    PKGCONFIG += libargon2
+    DEFINES += SAILFISH_SECRETS_HAVE_ARGON2
+}
+
 include($$PWD/../../common.pri)
 include($$PWD/../../lib/libsailfishsecretspluginapi.pri)
 
@@ -12,9 +18,11 @@ DEPENDPATH += $$PWD/../opensslcryptoplugin/evp/
 
 HEADERS += \
     $$PWD/../opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../opensslcryptoplugin/evp/keyderivation_p.h \
     $$PWD/plugin.h
 SOURCES += \
     $$PWD/../opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../opensslcryptoplugin/evp/keyderivation.cpp \
     $$PWD/plugin.cpp
 
 target.path=/usr/lib/Sailfish/Secrets/
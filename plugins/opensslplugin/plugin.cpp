@@ -7,6 +7,7 @@
 
 #include "plugin.h"
 #include "evp_p.h"
+#include "keyderivation_p.h"
 #include "evp_helpers_p.h"
 
 #include "Crypto/cryptomanager.h"
@@ -32,27 +33,30 @@ Daemon::Plugins::OpenSslPlugin::deriveKeyFromCode(
         const QByteArray &salt,
         QByteArray *key)
 {
-    const QByteArray inputData = authenticationCode.isEmpty()
-                         ? QByteArray(1, '\0')
-                         : authenticationCode;
-    const int nbytes = 32; // 256 bit
-    QScopedArrayPointer<char> buf(new char[nbytes]);
-    if (OpenSslEvp::pkcs5_pbkdf2_hmac(
-            inputData.constData(),
-            inputData.size(),
-            salt.isEmpty()
-                    ? NULL
-                    : reinterpret_cast<const unsigned char*>(salt.constData()),
-            salt.size(),
-            10000, // iterations
-            21, // CryptoManager::DigestSha256
-            nbytes,
-            reinterpret_cast<unsigned char*>(buf.data())) != 1) {
+    return deriveKeyFromCodeWithParameters(authenticationCode, salt, QByteArray(), key);
+}
+
+Result
+Daemon::Plugins::OpenSslPlugin::deriveKeyFromCodeWithParameters(
+        const QByteArray &authenticationCode,
+        const QByteArray &salt,
+        const QByteArray &parameters,
+        QByteArray *key)
+{
+    if (!OpenSslKeyDerivation::deriveKey(authenticationCode, salt, parameters, key)) {
         return Result(Result::SecretsPluginKeyDerivationError,
                       QLatin1String("The OpenSSL plugin failed to derive the key data"));
     }
 
-    *key = QByteArray(buf.data(), nbytes);
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::Plugins::OpenSslPlugin::calibrateKeyDerivation(
+        int targetDuration,
+        QByteArray *parameters)
+{
+    *parameters = OpenSslKeyDerivation::calibrate(targetDuration);
     return Result(Result::Succeeded);
 }
 
@@ -50,6 +50,8 @@ public:
     Sailfish::Secrets::EncryptionPlugin::EncryptionAlgorithm encryptionAlgorithm() const Q_DECL_OVERRIDE { return Sailfish::Secrets::EncryptionPlugin::AES_256_CBC; }
 
     Sailfish::Secrets::Result deriveKeyFromCode(const QByteArray &authenticationCode, const QByteArray &salt, QByteArray *key) Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key) Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result calibrateKeyDerivation(int targetDuration, QByteArray *parameters) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result encryptSecret(const QByteArray &plaintext, const QByteArray &key, QByteArray *encrypted) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result decryptSecret(const QByteArray &encrypted, const QByteArray &key, QByteArray *plaintext) Q_DECL_OVERRIDE;
 
@@ -6,11 +6,15 @@
  */
 
 #include "sqlcipherplugin.h"
+#include "sqlcipherdatabase_p.h"
 #include "evp_p.h"
+#include "keyderivation_p.h"
 
 #include <QDir>
 #include <QFile>
 #include <QCryptographicHash>
+#include <QPair>
+#include <QSet>
 
 using namespace Sailfish::Secrets;
 
@@ -22,49 +26,6 @@ static const char *setupEncryptionKey =
 static const char *setupReEncryptionKey =
         "\n PRAGMA rekey = \"x\'%1\'\";";
 
-static const char *setupEnforceForeignKeys =
-        "\n PRAGMA foreign_keys = ON;";
-
-static const char *setupEncoding =
-        "\n PRAGMA encoding = \"UTF-16\";";
-
-static const char *setupTempStore =
-        "\n PRAGMA temp_store = MEMORY;";
-
-static const char *setupJournal =
-        "\n PRAGMA journal_mode = WAL;";
-
-static const char *setupSynchronous =
-        "\n PRAGMA synchronous = FULL;";
-
-static const char *createSecretsTable =
-        "\n CREATE TABLE Secrets ("
-        "   SecretName TEXT NOT NULL,"
-        "   Secret BLOB,"
-        "   Timestamp DATE,"
-        "   PRIMARY KEY (SecretName));";
-
-static const char *createSecretsFilterDataTable =
-        "\n CREATE TABLE SecretsFilterData ("
-        "   SecretName TEXT NOT NULL,"
-        "   Field TEXT NOT NULL,"
-        "   Value TEXT,"
-        "   FOREIGN KEY (SecretName) REFERENCES Secrets (SecretName) ON DELETE CASCADE,"
-        "   PRIMARY KEY (SecretName, Field));";
-
-static const char *createStatements[] =
-{
-    createSecretsTable,
-    createSecretsFilterDataTable,
-    NULL
-};
-
-static Daemon::Sqlite::UpgradeOperation upgradeVersions[] = {
-    { 0, 0 },
-};
-
-static const int currentSchemaVersion = 1;
-
 Result
 Daemon::Plugins::SqlCipherPlugin::openCollectionDatabase(
         const QString &collectionName,
@@ -239,27 +200,30 @@ Daemon::Plugins::SqlCipherPlugin::deriveKeyFromCode(
         const QByteArray &salt,
         QByteArray *key)
 {
-    const QByteArray inputData = authenticationCode.isEmpty()
-                         ? QByteArray(1, '\0')
-                         : authenticationCode;
-    const int nbytes = 32; // 256 bit
-    QScopedArrayPointer<char> buf(new char[nbytes]);
-    if (OpenSslEvp::pkcs5_pbkdf2_hmac(
-            inputData.constData(),
-            inputData.size(),
-            salt.isEmpty()
-                    ? NULL
-                    : reinterpret_cast<const unsigned char*>(salt.constData()),
-            salt.size(),
-            10000, // iterations
-            21, // CryptoManager::DigestSha256
-            nbytes,
-            reinterpret_cast<unsigned char*>(buf.data())) != 1) {
+    return deriveKeyFromCodeWithParameters(authenticationCode, salt, QByteArray(), key);
+}
+
+Result
+Daemon::Plugins::SqlCipherPlugin::deriveKeyFromCodeWithParameters(
+        const QByteArray &authenticationCode,
+        const QByteArray &salt,
+        const QByteArray &parameters,
+        QByteArray *key)
+{
+    if (!OpenSslKeyDerivation::deriveKey(authenticationCode, salt, parameters, key)) {
         return Result(Result::SecretsPluginKeyDerivationError,
                       QLatin1String("The OpenSSL plugin failed to derive the key data"));
     }
 
-    *key = QByteArray(buf.data(), nbytes);
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::Plugins::SqlCipherPlugin::calibrateKeyDerivation(
+        int targetDuration,
+        QByteArray *parameters)
+{
+    *parameters = OpenSslKeyDerivation::calibrate(targetDuration);
     return Result(Result::Succeeded);
 }
 
@@ -278,7 +242,9 @@ Daemon::Plugins::SqlCipherPlugin::setEncryptionKey(
     }
 
     if (key.isEmpty()) {
-        // caller wants to lock the database.  succeeded.
+        // caller wants to lock the database.  Keys read from it
+        // may still be cached by the crypto plugin, so drop those.
+        m_opensslCryptoPlugin.clearKeyCache();
         return Result(Result::Succeeded);
     }
 
@@ -359,6 +325,85 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
 
     Daemon::Sqlite::DatabaseLocker locker(db);
 
+    if (!db->beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("SQLCipher plugin unable to begin transaction"));
+    }
+
+    Result result = writeSecret(db, secretName, secret, filterData);
+    if (result.code() != Result::Succeeded) {
+        db->rollbackTransaction();
+        return result;
+    }
+
+    if (!db->commitTransaction()) {
+        db->rollbackTransaction();
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("SQLCipher plugin unable to commit insert secret transaction"));
+    }
+
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::Plugins::SqlCipherPlugin::setSecrets(
+        const QString &collectionName,
+        const QVector<Secret> &secrets)
+{
+    if (collectionName.isEmpty()) {
+        return Result(Result::InvalidCollectionError,
+                      QString::fromUtf8("Empty collection name given"));
+    }
+    for (const Secret &secret : secrets) {
+        if (secret.name().isEmpty()) {
+            return Result(Result::InvalidSecretError,
+                          QString::fromUtf8("Empty secret name given"));
+        }
+    }
+
+    Daemon::Sqlite::Database *db = m_collectionDatabases.value(collectionName);
+    if (!db) {
+        const QString collectionPath = m_databaseDirPath + collectionName + QLatin1String(".db");
+        return QFile::exists(collectionPath)
+                ? Result(Result::CollectionIsLockedError,
+                         QLatin1String("That collection is locked"))
+                : Result(Result::InvalidCollectionError,
+                         QLatin1String("No collection with that name exists"));
+    }
+
+    Daemon::Sqlite::DatabaseLocker locker(db);
+
+    if (!db->beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("SQLCipher plugin unable to begin transaction"));
+    }
+
+    for (const Secret &secret : secrets) {
+        Result result = writeSecret(db, secret.name(), secret.data(), secret.filterData());
+        if (result.code() != Result::Succeeded) {
+            db->rollbackTransaction();
+            return result;
+        }
+    }
+
+    if (!db->commitTransaction()) {
+        db->rollbackTransaction();
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("SQLCipher plugin unable to commit insert secrets transaction"));
+    }
+
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::Plugins::SqlCipherPlugin::writeSecret(
+        Daemon::Sqlite::Database *db,
+        const QString &secretName,
+        const QByteArray &secret,
+        const Secret::FilterData &filterData)
+{
+    // Note: the caller must have begun a transaction, and rolls it back on failure.
+
     const QString selectSecretsCountQuery = QStringLiteral(
                  "SELECT"
                     " Count(*)"
@@ -377,13 +422,7 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
     values << QVariant::fromValue<QString>(secretName);
     sq.bindValues(values);
 
-    if (!db->beginTransaction()) {
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("SQLCipher plugin unable to begin transaction"));
-    }
-
     if (!db->execute(sq, &errorText)) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("SQLCipher plugin unable to execute select secrets query: %1").arg(errorText));
     }
@@ -411,7 +450,6 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
 
     Daemon::Sqlite::Database::Query iq = db->prepare(found ? updateSecretQuery : insertSecretQuery, &errorText);
     if (!errorText.isEmpty()) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("SQLCipher plugin unable to prepare insert secret query: %1").arg(errorText));
     }
@@ -427,7 +465,6 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
     iq.bindValues(ivalues);
 
     if (!db->execute(iq, &errorText)) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("SQLCipher plugin unable to execute insert secret query: %1").arg(errorText));
     }
@@ -439,7 +476,6 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
 
     Daemon::Sqlite::Database::Query dq = db->prepare(deleteSecretsFilterDataQuery, &errorText);
     if (!errorText.isEmpty()) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("SQLCipher plugin unable to prepare delete secrets filter data query: %1").arg(errorText));
     }
@@ -449,7 +485,6 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
     dq.bindValues(dvalues);
 
     if (!db->execute(dq, &errorText)) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("SQLCipher plugin unable to execute delete secrets filter data query: %1").arg(errorText));
     }
@@ -458,15 +493,16 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
                 "INSERT INTO SecretsFilterData ("
                   "SecretName,"
                   "Field,"
-                  "Value"
+                  "Value,"
+                  "FieldKey,"
+                  "ValueKey"
                 ")"
                 " VALUES ("
-                  "?,?,?"
+                  "?,?,?,?,?"
                 ");");
 
     Daemon::Sqlite::Database::Query ifdq = db->prepare(insertSecretsFilterDataQuery, &errorText);
     if (!errorText.isEmpty()) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("SQLCipher plugin unable to prepare insert secrets filter data query: %1").arg(errorText));
     }
@@ -476,20 +512,15 @@ Daemon::Plugins::SqlCipherPlugin::setSecret(
         ivalues << QVariant::fromValue<QString>(secretName);
         ivalues << QVariant::fromValue<QString>(it.key());
         ivalues << QVariant::fromValue<QString>(it.value());
+        ivalues << QVariant::fromValue<QString>(Daemon::Sqlite::filterMatchKey(it.key()));
+        ivalues << QVariant::fromValue<QString>(Daemon::Sqlite::filterMatchKey(it.value()));
         ifdq.bindValues(ivalues);
         if (!db->execute(ifdq, &errorText)) {
-            db->rollbackTransaction();
             return Result(Result::DatabaseQueryError,
                           QString::fromUtf8("SQLCipher plugin unable to execute insert secrets filter data query: %1").arg(errorText));
         }
     }
 
-    if (!db->commitTransaction()) {
-        db->rollbackTransaction();
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("SQLCipher plugin unable to commit insert secret transaction"));
-    }
-
     return Result(Result::Succeeded);
 }
 
@@ -679,86 +710,65 @@ Daemon::Plugins::SqlCipherPlugin::findSecrets(
 
     Daemon::Sqlite::DatabaseLocker locker(db);
 
-    // very naive implementation.
-    // first, select all of the field/value filter data for the secret
-    // second, filter in-memory.
+    // match each field/value pair of the filter against the indexed
+    // case-folded filter data.  For AND, a secret must match every field.
+    QList<QPair<QString, QString> > matchPairs;
+    QSet<QString> matchFields;
+    for (Secret::FilterData::const_iterator fit = filter.constBegin(); fit != filter.constEnd(); fit++) {
+        const QPair<QString, QString> matchPair(Daemon::Sqlite::filterMatchKey(fit.key()), Daemon::Sqlite::filterMatchKey(fit.value()));
+        if (!matchPairs.contains(matchPair)) {
+            matchPairs.append(matchPair);
+            matchFields.insert(matchPair.first);
+        }
+    }
 
-    const QString selectSecretsFilterDataQuery = QStringLiteral(
+    if (filterOperator == StoragePlugin::OperatorAnd && matchFields.size() != matchPairs.size()) {
+        // the filter requires different values for the same field, nothing can match.
+        identifiers->clear();
+        return Result(Result::Succeeded);
+    }
+
+    QStringList conditions;
+    QVariantList values;
+    for (const QPair<QString, QString> &matchPair : matchPairs) {
+        conditions.append(QStringLiteral("(FieldKey = ? AND ValueKey = ?)"));
+        values << QVariant::fromValue<QString>(matchPair.first);
+        values << QVariant::fromValue<QString>(matchPair.second);
+    }
+
+    const QString selectSecretNamesQuery = filterOperator == StoragePlugin::OperatorAnd
+            ? QStringLiteral(
                  "SELECT"
-                    " SecretName,"
-                    " Field,"
-                    " Value"
-                 " FROM SecretsFilterData;"
-             );
+                    " SecretName"
+                 " FROM SecretsFilterData"
+                 " WHERE %1"
+                 " GROUP BY SecretName"
+                 " HAVING COUNT(DISTINCT FieldKey) = %2;"
+              ).arg(conditions.join(QStringLiteral(" OR "))).arg(matchFields.size())
+            : QStringLiteral(
+                 "SELECT DISTINCT"
+                    " SecretName"
+                 " FROM SecretsFilterData"
+                 " WHERE %1;"
+              ).arg(conditions.join(QStringLiteral(" OR ")));
 
     QString errorText;
-    Daemon::Sqlite::Database::Query sq = db->prepare(selectSecretsFilterDataQuery, &errorText);
+    Daemon::Sqlite::Database::Query sq = db->prepare(selectSecretNamesQuery, &errorText);
     if (!errorText.isEmpty()) {
         return Result(Result::DatabaseQueryError,
-                      QString::fromUtf8("SQLCipher plugin unable to prepare select secrets filter data query: %1").arg(errorText));
+                      QString::fromUtf8("SQLCipher plugin unable to prepare find secrets query: %1").arg(errorText));
     }
 
-    if (!db->beginTransaction()) {
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("SQLCipher plugin unable to begin find secrets transaction"));
-    }
+    sq.bindValues(values);
 
     if (!db->execute(sq, &errorText)) {
-        db->rollbackTransaction();
         return Result(Result::DatabaseQueryError,
-                      QString::fromUtf8("SQLCipher plugin unable to execute select secrets filter data query: %1").arg(errorText));
-    }
-
-    QMap<QString, Secret::FilterData > secretNameToFilterData;
-    while (sq.next()) {
-        secretNameToFilterData[sq.value(0).value<QString>()].insert(sq.value(1).value<QString>(), sq.value(2).value<QString>());
-    }
-
-    // perform in-memory filtering.
-    QSet<QString> matchingSecretNames;
-    for (QMap<QString, Secret::FilterData >::const_iterator it = secretNameToFilterData.constBegin(); it != secretNameToFilterData.constEnd(); it++) {
-        const Secret::FilterData &currFilterData(it.value());
-        bool matches = filterOperator == StoragePlugin::OperatorOr ? false : true;
-        for (Secret::FilterData::const_iterator fit = filter.constBegin(); fit != filter.constEnd(); fit++) {
-            bool found = false;
-            for (Secret::FilterData::const_iterator mit = currFilterData.constBegin(); mit != currFilterData.constEnd(); mit++) {
-                if (fit.key().compare(mit.key(), Qt::CaseInsensitive) == 0) {
-                    found = true; // found a matching metadata field for this filter field
-                    if (fit.value().compare(mit.value(), Qt::CaseInsensitive) == 0) {
-                        // the metadata value matches the filter value
-                        if (filterOperator == StoragePlugin::OperatorOr) {
-                            // we have a match!
-                            matches = true;
-                        }
-                    } else {
-                        if (filterOperator == StoragePlugin::OperatorAnd) {
-                            // we know that this one doesn't match.
-                            matches = false;
-                        }
-                    }
-                    break; // mit
-                }
-            }
-            if (!found && filterOperator == StoragePlugin::OperatorAnd) {
-                // the metadata is missing a required filter field.
-                matches = false;
-                break; // fit
-            }
-        }
-        if (matches) {
-            matchingSecretNames.insert(it.key());
-        }
+                      QString::fromUtf8("SQLCipher plugin unable to execute find secrets query: %1").arg(errorText));
     }
 
     QVector<Secret::Identifier> retn;
-    for (const QString &secretName : matchingSecretNames) {
-        retn.append(Secret::Identifier(secretName, collectionName, name()));
-    }
-
-    if (!db->commitTransaction()) {
-        db->rollbackTransaction();
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("SQLCipher plugin unable to commit find secrets transaction"));
+    while (sq.next()) {
+        retn.append(Secret::Identifier(sq.value(0).value<QString>(), collectionName, name()));
     }
 
     *identifiers = retn;
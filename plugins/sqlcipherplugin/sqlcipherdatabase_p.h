@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#ifndef SAILFISHSECRETS_PLUGIN_STORAGE_SQLCIPHER_DATABASE_P_H
+#define SAILFISHSECRETS_PLUGIN_STORAGE_SQLCIPHER_DATABASE_P_H
+
+#include "database_p.h"
+
+static const char *setupEnforceForeignKeys =
+        "\n PRAGMA foreign_keys = ON;";
+
+static const char *setupEncoding =
+        "\n PRAGMA encoding = \"UTF-16\";";
+
+static const char *setupTempStore =
+        "\n PRAGMA temp_store = MEMORY;";
+
+static const char *setupJournal =
+        "\n PRAGMA journal_mode = WAL;";
+
+static const char *setupSynchronous =
+        "\n PRAGMA synchronous = FULL;";
+
+static const char *createSecretsTable =
+        "\n CREATE TABLE Secrets ("
+        "   SecretName TEXT NOT NULL,"
+        "   Secret BLOB,"
+        "   Timestamp DATE,"
+        "   PRIMARY KEY (SecretName));";
+
+static const char *createSecretsFilterDataTable =
+        "\n CREATE TABLE SecretsFilterData ("
+        "   SecretName TEXT NOT NULL,"
+        "   Field TEXT NOT NULL,"
+        "   Value TEXT,"
+        "   FieldKey TEXT NOT NULL DEFAULT '',"
+        "   ValueKey TEXT NOT NULL DEFAULT '',"
+        "   FOREIGN KEY (SecretName) REFERENCES Secrets (SecretName) ON DELETE CASCADE,"
+        "   PRIMARY KEY (SecretName, Field));";
+
+static const char *createSecretsFilterDataIndex =
+        "\n CREATE INDEX SecretsFilterDataMatchIndex"
+        "   ON SecretsFilterData (FieldKey, ValueKey);";
+
+static const char *createStatements[] =
+{
+    createSecretsTable,
+    createSecretsFilterDataTable,
+    createSecretsFilterDataIndex,
+    NULL
+};
+
+static const char *upgradeVersion1[] = {
+    createSecretsFilterDataIndex,
+    "PRAGMA user_version=2",
+    NULL
+};
+
+static Sailfish::Secrets::Daemon::Sqlite::UpgradeOperation upgradeVersions[] = {
+    { Sailfish::Secrets::Daemon::Sqlite::upgradeFilterDataMatchKeys, upgradeVersion1 },
+    { 0, 0 },
+};
+
+static const int currentSchemaVersion = 2;
+
+#endif // SAILFISHSECRETS_PLUGIN_STORAGE_SQLCIPHER_DATABASE_P_H
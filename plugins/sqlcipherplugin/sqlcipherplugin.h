@@ -95,10 +95,13 @@ public:
 
     Sailfish::Secrets::Result isCollectionLocked(const QString &collectionName, bool *locked) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result deriveKeyFromCode(const QByteArray &authenticationCode, const QByteArray &salt, QByteArray *key) Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result deriveKeyFromCodeWithParameters(const QByteArray &authenticationCode, const QByteArray &salt, const QByteArray &parameters, QByteArray *key) Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result calibrateKeyDerivation(int targetDuration, QByteArray *parameters) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result setEncryptionKey(const QString &collectionName, const QByteArray &key) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result reencrypt(const QString &collectionName, const QByteArray &oldkey, const QByteArray &newkey) Q_DECL_OVERRIDE;
 
     Sailfish::Secrets::Result setSecret(const QString &collectionName, const QString &secretName, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData) Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result setSecrets(const QString &collectionName, const QVector<Sailfish::Secrets::Secret> &secrets) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result getSecret(const QString &collectionName, const QString &secretName, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result secretNames(const QString &collectionName, QStringList *secretNames) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result findSecrets(const QString &collectionName, const Sailfish::Secrets::Secret::FilterData &filter, Sailfish::Secrets::StoragePlugin::FilterOperator filterOperator, QVector<Sailfish::Secrets::Secret::Identifier> *identifiers) Q_DECL_OVERRIDE;
@@ -255,6 +258,7 @@ public:
 private:
     static QString databaseDirPath(bool isTestPlugin, const QString &databaseSubdir);
     Sailfish::Secrets::Result openCollectionDatabase(const QString &collectionName, const QByteArray &key, bool createIfNotExists);
+    Sailfish::Secrets::Result writeSecret(Sailfish::Secrets::Daemon::Sqlite::Database *db, const QString &secretName, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData);
     QMap<QString, Sailfish::Secrets::Daemon::Sqlite::Database *> m_collectionDatabases;
 
     QString m_databaseSubdir;
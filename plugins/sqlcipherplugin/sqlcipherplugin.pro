@@ -4,6 +4,12 @@ TARGET = sailfishsecrets-sqlcipher
 TARGET = $$qtLibraryTarget($$TARGET)
 PKGCONFIG += libcrypto
 
+# Argon2id key derivation is available if libargon2 is installed.
+packagesExist(libargon2) {
+    PKGCONFIG += libargon2
+    DEFINES += SAILFISH_SECRETS_HAVE_ARGON2
+}
+
 include($$PWD/../../common.pri)
 include($$PWD/../../lib/libsailfishsecretspluginapi.pri)
 include($$PWD/../../lib/libsailfishcryptopluginapi.pri)
@@ -14,12 +20,19 @@ DEPENDPATH += . $$PWD/../opensslcryptoplugin $$PWD/../opensslcryptoplugin/evp/
 
 HEADERS += \
     $$PWD/../opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../opensslcryptoplugin/evp/keycache_p.h \
+    $$PWD/../opensslcryptoplugin/evp/randomgenerator_p.h \
+    $$PWD/../opensslcryptoplugin/evp/keyderivation_p.h \
     $$PWD/../opensslcryptoplugin/evp/evp_helpers_p.h \
     $$PWD/../opensslcryptoplugin/opensslcryptoplugin.h \
+    $$PWD/sqlcipherdatabase_p.h \
     $$PWD/sqlcipherplugin.h
 
 SOURCES += \
     $$PWD/../opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../opensslcryptoplugin/evp/keycache.cpp \
+    $$PWD/../opensslcryptoplugin/evp/randomgenerator.cpp \
+    $$PWD/../opensslcryptoplugin/evp/keyderivation.cpp \
     $$PWD/../opensslcryptoplugin/opensslcryptoplugin.cpp \
     $$PWD/sqlcipherplugin.cpp \
     $$PWD/encryptedstorageplugin.cpp \
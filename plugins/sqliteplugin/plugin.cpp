@@ -8,6 +8,9 @@
 #include "plugin.h"
 #include "sqlitedatabase_p.h"
 
+#include <QPair>
+#include <QSet>
+
 Q_PLUGIN_METADATA(IID Sailfish_Secrets_StoragePlugin_IID)
 
 Q_LOGGING_CATEGORY(lcSailfishSecretsPluginSqlite, "org.sailfishos.secrets.plugin.storage.sqlite", QtWarningMsg)
@@ -268,6 +271,76 @@ Daemon::Plugins::SqlitePlugin::setSecret(
                       QString::fromUtf8("Empty collection name given"));
     }
 
+    if (!m_db.beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("Sqlite plugin unable to begin transaction"));
+    }
+
+    Result result = writeSecret(collectionName, secretName, secret, filterData);
+    if (result.code() != Result::Succeeded) {
+        m_db.rollbackTransaction();
+        return result;
+    }
+
+    if (!m_db.commitTransaction()) {
+        m_db.rollbackTransaction();
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("Sqlite plugin unable to commit insert secret transaction"));
+    }
+
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::Plugins::SqlitePlugin::setSecrets(
+        const QString &collectionName,
+        const QVector<Secret> &secrets)
+{
+    openDatabaseIfNecessary();
+    Daemon::Sqlite::DatabaseLocker locker(&m_db);
+
+    if (collectionName.isEmpty()) {
+        return Result(Result::InvalidCollectionError,
+                      QString::fromUtf8("Empty collection name given"));
+    }
+    for (const Secret &secret : secrets) {
+        if (secret.name().isEmpty()) {
+            return Result(Result::InvalidSecretError,
+                          QString::fromUtf8("Empty secret name given"));
+        }
+    }
+
+    if (!m_db.beginTransaction()) {
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("Sqlite plugin unable to begin transaction"));
+    }
+
+    for (const Secret &secret : secrets) {
+        Result result = writeSecret(collectionName, secret.name(), secret.data(), secret.filterData());
+        if (result.code() != Result::Succeeded) {
+            m_db.rollbackTransaction();
+            return result;
+        }
+    }
+
+    if (!m_db.commitTransaction()) {
+        m_db.rollbackTransaction();
+        return Result(Result::DatabaseTransactionError,
+                      QString::fromUtf8("Sqlite plugin unable to commit insert secrets transaction"));
+    }
+
+    return Result(Result::Succeeded);
+}
+
+Result
+Daemon::Plugins::SqlitePlugin::writeSecret(
+        const QString &collectionName,
+        const QString &secretName,
+        const QByteArray &secret,
+        const Secret::FilterData &filterData)
+{
+    // Note: the caller must have begun a transaction, and rolls it back on failure.
+
     const QString selectSecretsCountQuery = QStringLiteral(
                  "SELECT"
                     " Count(*)"
@@ -288,13 +361,7 @@ Daemon::Plugins::SqlitePlugin::setSecret(
     values << QVariant::fromValue<QString>(secretName);
     sq.bindValues(values);
 
-    if (!m_db.beginTransaction()) {
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("Sqlite plugin unable to begin transaction"));
-    }
-
     if (!m_db.execute(sq, &errorText)) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("Sqlite plugin unable to execute select secrets query: %1").arg(errorText));
     }
@@ -324,7 +391,6 @@ Daemon::Plugins::SqlitePlugin::setSecret(
 
     Daemon::Sqlite::Database::Query iq = m_db.prepare(found ? updateSecretQuery : insertSecretQuery, &errorText);
     if (!errorText.isEmpty()) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("Sqlite plugin unable to prepare insert secret query: %1").arg(errorText));
     }
@@ -342,7 +408,6 @@ Daemon::Plugins::SqlitePlugin::setSecret(
     iq.bindValues(ivalues);
 
     if (!m_db.execute(iq, &errorText)) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("Sqlite plugin unable to execute insert secret query: %1").arg(errorText));
     }
@@ -355,7 +420,6 @@ Daemon::Plugins::SqlitePlugin::setSecret(
 
     Daemon::Sqlite::Database::Query dq = m_db.prepare(deleteSecretsFilterDataQuery, &errorText);
     if (!errorText.isEmpty()) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("Sqlite plugin unable to prepare delete secrets filter data query: %1").arg(errorText));
     }
@@ -366,7 +430,6 @@ Daemon::Plugins::SqlitePlugin::setSecret(
     dq.bindValues(dvalues);
 
     if (!m_db.execute(dq, &errorText)) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("Sqlite plugin unable to execute delete secrets filter data query: %1").arg(errorText));
     }
@@ -376,15 +439,16 @@ Daemon::Plugins::SqlitePlugin::setSecret(
                   "CollectionName,"
                   "SecretName,"
                   "Field,"
-                  "Value"
+                  "Value,"
+                  "FieldKey,"
+                  "ValueKey"
                 ")"
                 " VALUES ("
-                  "?,?,?,?"
+                  "?,?,?,?,?,?"
                 ");");
 
     Daemon::Sqlite::Database::Query ifdq = m_db.prepare(insertSecretsFilterDataQuery, &errorText);
     if (!errorText.isEmpty()) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
                       QString::fromUtf8("Sqlite plugin unable to prepare insert secrets filter data query: %1").arg(errorText));
     }
@@ -395,20 +459,15 @@ Daemon::Plugins::SqlitePlugin::setSecret(
         ivalues << QVariant::fromValue<QString>(secretName);
         ivalues << QVariant::fromValue<QString>(it.key());
         ivalues << QVariant::fromValue<QString>(it.value());
+        ivalues << QVariant::fromValue<QString>(Daemon::Sqlite::filterMatchKey(it.key()));
+        ivalues << QVariant::fromValue<QString>(Daemon::Sqlite::filterMatchKey(it.value()));
         ifdq.bindValues(ivalues);
         if (!m_db.execute(ifdq, &errorText)) {
-            m_db.rollbackTransaction();
             return Result(Result::DatabaseQueryError,
                           QString::fromUtf8("Sqlite plugin unable to execute insert secrets filter data query: %1").arg(errorText));
         }
     }
 
-    if (!m_db.commitTransaction()) {
-        m_db.rollbackTransaction();
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("Sqlite plugin unable to commit insert secret transaction"));
-    }
-
     return Result(Result::Succeeded);
 }
 
@@ -571,87 +630,66 @@ Daemon::Plugins::SqlitePlugin::findSecrets(
                       QString::fromUtf8("Empty filter given"));
     }
 
-    // very naive implementation.
-    // first, select all of the field/value filter data for the secret
-    // second, filter in-memory.
+    // match each field/value pair of the filter against the indexed
+    // case-folded filter data.  For AND, a secret must match every field.
+    QList<QPair<QString, QString> > matchPairs;
+    QSet<QString> matchFields;
+    for (Secret::FilterData::const_iterator fit = filter.constBegin(); fit != filter.constEnd(); fit++) {
+        const QPair<QString, QString> matchPair(Daemon::Sqlite::filterMatchKey(fit.key()), Daemon::Sqlite::filterMatchKey(fit.value()));
+        if (!matchPairs.contains(matchPair)) {
+            matchPairs.append(matchPair);
+            matchFields.insert(matchPair.first);
+        }
+    }
+
+    if (filterOperator == StoragePlugin::OperatorAnd && matchFields.size() != matchPairs.size()) {
+        // the filter requires different values for the same field, nothing can match.
+        return Result(Result::Succeeded);
+    }
 
-    const QString selectSecretsFilterDataQuery = QStringLiteral(
+    QStringList conditions;
+    QVariantList values;
+    values << QVariant::fromValue<QString>(collectionName);
+    for (const QPair<QString, QString> &matchPair : matchPairs) {
+        conditions.append(QStringLiteral("(FieldKey = ? AND ValueKey = ?)"));
+        values << QVariant::fromValue<QString>(matchPair.first);
+        values << QVariant::fromValue<QString>(matchPair.second);
+    }
+
+    const QString selectSecretNamesQuery = filterOperator == StoragePlugin::OperatorAnd
+            ? QStringLiteral(
                  "SELECT"
-                    " SecretName,"
-                    " Field,"
-                    " Value"
+                    " SecretName"
                  " FROM SecretsFilterData"
-                 " WHERE CollectionName = ?;"
-             );
+                 " WHERE CollectionName = ?"
+                 " AND (%1)"
+                 " GROUP BY SecretName"
+                 " HAVING COUNT(DISTINCT FieldKey) = %2;"
+              ).arg(conditions.join(QStringLiteral(" OR "))).arg(matchFields.size())
+            : QStringLiteral(
+                 "SELECT DISTINCT"
+                    " SecretName"
+                 " FROM SecretsFilterData"
+                 " WHERE CollectionName = ?"
+                 " AND (%1);"
+              ).arg(conditions.join(QStringLiteral(" OR ")));
 
     QString errorText;
-    Daemon::Sqlite::Database::Query sq = m_db.prepare(selectSecretsFilterDataQuery, &errorText);
+    Daemon::Sqlite::Database::Query sq = m_db.prepare(selectSecretNamesQuery, &errorText);
     if (!errorText.isEmpty()) {
         return Result(Result::DatabaseQueryError,
-                      QString::fromUtf8("Sqlite plugin unable to prepare select secrets filter data query: %1").arg(errorText));
+                      QString::fromUtf8("Sqlite plugin unable to prepare find secrets query: %1").arg(errorText));
     }
 
-    QVariantList values;
-    values << QVariant::fromValue<QString>(collectionName);
     sq.bindValues(values);
 
-    if (!m_db.beginTransaction()) {
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("Sqlite plugin unable to begin find secrets transaction"));
-    }
-
     if (!m_db.execute(sq, &errorText)) {
-        m_db.rollbackTransaction();
         return Result(Result::DatabaseQueryError,
-                      QString::fromUtf8("Sqlite plugin unable to execute select secrets filter data query: %1").arg(errorText));
+                      QString::fromUtf8("Sqlite plugin unable to execute find secrets query: %1").arg(errorText));
     }
 
-    QMap<QString, Secret::FilterData> secretNameToFilterData;
     while (sq.next()) {
-        secretNameToFilterData[sq.value(0).value<QString>()].insert(sq.value(1).value<QString>(), sq.value(2).value<QString>());
-    }
-
-    // perform in-memory filtering.
-    QSet<QString> matchingSecretNames;
-    for (QMap<QString, Secret::FilterData >::const_iterator it = secretNameToFilterData.constBegin(); it != secretNameToFilterData.constEnd(); it++) {
-        const Secret::FilterData &currFilterData(it.value());
-        bool matches = filterOperator == StoragePlugin::OperatorOr ? false : true;
-        for (Secret::FilterData::const_iterator fit = filter.constBegin(); fit != filter.constEnd(); fit++) {
-            bool found = false;
-            for (Secret::FilterData::const_iterator mit = currFilterData.constBegin(); mit != currFilterData.constEnd(); mit++) {
-                if (fit.key().compare(mit.key(), Qt::CaseInsensitive) == 0) {
-                    found = true; // found a matching metadata field for this filter field
-                    if (fit.value().compare(mit.value(), Qt::CaseInsensitive) == 0) {
-                        // the metadata value matches the filter value
-                        if (filterOperator == StoragePlugin::OperatorOr) {
-                            // we have a match!
-                            matches = true;
-                        }
-                    } else {
-                        if (filterOperator == StoragePlugin::OperatorAnd) {
-                            // we know that this one doesn't match.
-                            matches = false;
-                        }
-                    }
-                    break; // mit
-                }
-            }
-            if (!found && filterOperator == StoragePlugin::OperatorAnd) {
-                // the metadata is missing a required filter field.
-                matches = false;
-                break; // fit
-            }
-        }
-        if (matches && !matchingSecretNames.contains(it.key())) {
-            matchingSecretNames.insert(it.key());
-            secretNames->append(it.key());
-        }
-    }
-
-    if (!m_db.commitTransaction()) {
-        m_db.rollbackTransaction();
-        return Result(Result::DatabaseTransactionError,
-                      QString::fromUtf8("Sqlite plugin unable to commit find secrets transaction"));
+        secretNames->append(sq.value(0).value<QString>());
     }
 
     return Result(Result::Succeeded);
@@ -60,6 +60,7 @@ public:
     Sailfish::Secrets::Result createCollection(const QString &collectionName) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result removeCollection(const QString &collectionName) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result setSecret(const QString &collectionName, const QString &secretName, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData) Q_DECL_OVERRIDE;
+    Sailfish::Secrets::Result setSecrets(const QString &collectionName, const QVector<Sailfish::Secrets::Secret> &secrets) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result getSecret(const QString &collectionName, const QString &secretName, QByteArray *secret, Sailfish::Secrets::Secret::FilterData *filterData) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result secretNames(const QString &collectionName, QStringList *secretNames) Q_DECL_OVERRIDE;
     Sailfish::Secrets::Result findSecrets(const QString &collectionName, const Sailfish::Secrets::Secret::FilterData &filter, Sailfish::Secrets::StoragePlugin::FilterOperator filterOperator, QStringList *secretNames) Q_DECL_OVERRIDE;
@@ -74,6 +75,7 @@ public:
 
 private:
     void openDatabaseIfNecessary();
+    Sailfish::Secrets::Result writeSecret(const QString &collectionName, const QString &secretName, const QByteArray &secret, const Sailfish::Secrets::Secret::FilterData &filterData);
     Sailfish::Secrets::Daemon::Sqlite::Database m_db;
 };
 
@@ -45,9 +45,15 @@ static const char *createSecretsFilterDataTable =
         "   SecretName TEXT NOT NULL,"
         "   Field TEXT NOT NULL,"
         "   Value TEXT,"
+        "   FieldKey TEXT NOT NULL DEFAULT '',"
+        "   ValueKey TEXT NOT NULL DEFAULT '',"
         "   FOREIGN KEY (CollectionName, SecretName) REFERENCES Secrets (CollectionName, SecretName) ON DELETE CASCADE,"
         "   PRIMARY KEY (CollectionName, SecretName, Field));";
 
+static const char *createSecretsFilterDataIndex =
+        "\n CREATE INDEX SecretsFilterDataMatchIndex"
+        "   ON SecretsFilterData (CollectionName, FieldKey, ValueKey);";
+
 static const char *setupStatements[] =
 {
     setupEnforceForeignKeys,
@@ -63,13 +69,21 @@ static const char *createStatements[] =
     createCollectionsTable,
     createSecretsTable,
     createSecretsFilterDataTable,
+    createSecretsFilterDataIndex,
+    NULL
+};
+
+static const char *upgradeVersion1[] = {
+    createSecretsFilterDataIndex,
+    "PRAGMA user_version=2",
     NULL
 };
 
 static Sailfish::Secrets::Daemon::Sqlite::UpgradeOperation upgradeVersions[] = {
+    { Sailfish::Secrets::Daemon::Sqlite::upgradeFilterDataMatchKeys, upgradeVersion1 },
     { 0, 0 },
 };
 
-static const int currentSchemaVersion = 1;
+static const int currentSchemaVersion = 2;
 
 #endif // SAILFISHSECRETS_PLUGIN_STORAGE_SQLITE_DATABASE_P_H
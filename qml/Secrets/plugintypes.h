@@ -17,10 +17,12 @@
 
 #include "Secrets/plugininforequest.h"
 #include "Secrets/healthcheckrequest.h"
+#include "Secrets/daemonstatisticsrequest.h"
 #include "Secrets/interactionrequest.h"
 #include "Secrets/collectionnamesrequest.h"
 #include "Secrets/createcollectionrequest.h"
 #include "Secrets/deletecollectionrequest.h"
+#include "Secrets/collectionarchiverequest.h"
 #include "Secrets/storesecretrequest.h"
 #include "Secrets/storedsecretrequest.h"
 #include "Secrets/findsecretsrequest.h"
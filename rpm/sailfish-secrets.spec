@@ -229,6 +229,7 @@ BuildRequires:  pkgconfig(Qt5Core)
 BuildRequires:  pkgconfig(Qt5DBus)
 BuildRequires:  pkgconfig(dbus-1)
 BuildRequires:  pkgconfig(libcrypto)
+BuildRequires:  pkgconfig(libargon2)
 BuildRequires:  qt5-plugin-sqldriver-sqlite
 Requires:   qt5-plugin-sqldriver-sqlcipher
 Requires:   libsailfishsecretspluginapi = %{version}-%{release}
@@ -356,6 +357,7 @@ ln -s ../sailfish-secretsd.service %{buildroot}/%{user_unitdir}/user-session.tar
 /opt/tests/Sailfish/Secrets/authentication-client
 /opt/tests/Sailfish/Secrets/tst_secrets
 /opt/tests/Sailfish/Secrets/tst_dataprotection
+/opt/tests/Sailfish/Secrets/tst_schemaupgrade
 /opt/tests/Sailfish/Secrets/tst_secrets.qml
 /opt/tests/Sailfish/Secrets/tst_secretsrequests
 /opt/tests/Sailfish/Secrets/tst_secretsrequests.qml
@@ -413,6 +415,7 @@ ln -s ../sailfish-secretsd.service %{buildroot}/%{user_unitdir}/user-session.tar
 /opt/tests/Sailfish/Crypto/tst_gnupgplugin
 /opt/tests/Sailfish/Crypto/matrix/run-matrix-tests.sh
 /opt/tests/Sailfish/Crypto/matrix/0*sh
+/opt/tests/Sailfish/Benchmarks/tst_requestpipeline
 %{_libdir}/Sailfish/Crypto/libsailfishcrypto-testopenssl.so
 %{_libdir}/Sailfish/Crypto/libsailfishcrypto-testopenpgp.so
 
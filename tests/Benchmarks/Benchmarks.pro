@@ -0,0 +1,3 @@
+TEMPLATE = subdirs
+SUBDIRS = \
+    $$PWD/tst_requestpipeline
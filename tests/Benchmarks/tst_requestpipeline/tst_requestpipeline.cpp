@@ -0,0 +1,669 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include <QtTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QFile>
+#include <QTextStream>
+
+#include "Secrets/secretmanager.h"
+#include "Secrets/secret.h"
+#include "Secrets/createcollectionrequest.h"
+#include "Secrets/deletecollectionrequest.h"
+#include "Secrets/deletesecretrequest.h"
+#include "Secrets/findsecretsrequest.h"
+#include "Secrets/storedsecretrequest.h"
+#include "Secrets/storesecretrequest.h"
+
+#include "Crypto/cryptomanager.h"
+#include "Crypto/key.h"
+#include "Crypto/keypairgenerationparameters.h"
+#include "Crypto/generatestoredkeyrequest.h"
+#include "Crypto/encryptrequest.h"
+#include "Crypto/decryptrequest.h"
+#include "Crypto/signrequest.h"
+#include "Crypto/cipherrequest.h"
+
+#include <algorithm>
+
+// The daemon must be running in autotest mode (with --test option).
+// Results are written in CSV form to the file named by the environment variable
+// SAILFISH_SECRETS_BENCHMARK_RESULTS, and QTest's own output (e.g. -csv or -xml)
+// contains the wall time of each benchmark.
+// The number of operations performed by each client may be specified via the
+// environment variable SAILFISH_SECRETS_BENCHMARK_ITERATIONS.
+
+#define DEFAULT_TEST_STORAGE_PLUGIN Sailfish::Secrets::SecretManager::DefaultStoragePluginName + QLatin1String(".test")
+#define DEFAULT_TEST_ENCRYPTION_PLUGIN Sailfish::Secrets::SecretManager::DefaultEncryptionPluginName + QLatin1String(".test")
+#define DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME Sailfish::Secrets::SecretManager::DefaultEncryptedStoragePluginName + QLatin1String(".test")
+#define PASSWORD_AGENT_TEST_AUTH_PLUGIN Sailfish::Secrets::SecretManager::DefaultAuthenticationPluginName + QLatin1String(".test")
+
+#define WORKER_ARGUMENT "--benchmark-worker"
+
+namespace {
+    const QString DeviceLockCollectionName = QStringLiteral("benchdevicelock");
+    const QString CustomLockCollectionName = QStringLiteral("benchcustomlock");
+    const QString KeyCollectionName = QStringLiteral("benchkeys");
+    const QString AesKeyName = QStringLiteral("benchaeskey");
+    const QString RsaKeyName = QStringLiteral("benchrsakey");
+
+    const int DefaultIterations = 20;
+    const int PayloadSize = 1024;
+    const int CipherSessionPayloadSize = 4096;
+
+    int iterationCount()
+    {
+        bool ok = false;
+        const int iterations = qgetenv("SAILFISH_SECRETS_BENCHMARK_ITERATIONS").toInt(&ok);
+        return ok && iterations > 0 ? iterations : DefaultIterations;
+    }
+
+    QString resultsFilePath()
+    {
+        const QString path = QString::fromUtf8(qgetenv("SAILFISH_SECRETS_BENCHMARK_RESULTS"));
+        return path.isEmpty() ? QStringLiteral("tst_requestpipeline-results.csv") : path;
+    }
+
+    Sailfish::Crypto::Key keyReference(const QString &keyName)
+    {
+        return Sailfish::Crypto::Key(keyName, KeyCollectionName, DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME);
+    }
+
+    // The contents of the initialization vector don't matter for the benchmark.
+    const QByteArray InitializationVector(16, 'i');
+}
+
+// Performs one flow repeatedly within a separate client process,
+// and writes the latency of each operation (in usecs) to stdout.
+class BenchmarkWorker
+{
+public:
+    int run(const QStringList &args);
+
+private:
+    template <typename Operation>
+    bool measure(Operation operation)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        const bool succeeded = operation();
+        m_latencies.append(timer.nsecsElapsed() / 1000);
+        return succeeded;
+    }
+
+    Sailfish::Secrets::Secret testSecret(const QString &mode, int index) const;
+    bool storeSecret(const QString &mode, const Sailfish::Secrets::Secret &secret);
+    bool storedSecret(const Sailfish::Secrets::Secret::Identifier &identifier);
+    bool deleteSecret(const Sailfish::Secrets::Secret::Identifier &identifier);
+    bool findSecrets(const QString &mode, const Sailfish::Secrets::Secret::FilterData &filter);
+    bool encrypt(const QByteArray &data, QByteArray *ciphertext);
+    bool decrypt(const QByteArray &ciphertext);
+    bool sign(const QByteArray &data);
+    bool cipherSession(const QByteArray &data);
+
+    Sailfish::Secrets::SecretManager m_sm;
+    Sailfish::Crypto::CryptoManager m_cm;
+    QVector<qint64> m_latencies;
+};
+
+Sailfish::Secrets::Secret BenchmarkWorker::testSecret(const QString &mode, int index) const
+{
+    const QString collectionName = mode == QStringLiteral("devicelock") ? DeviceLockCollectionName
+                                 : mode == QStringLiteral("customlock") ? CustomLockCollectionName
+                                 : QString();
+    Sailfish::Secrets::Secret secret(Sailfish::Secrets::Secret::Identifier(
+            QStringLiteral("bench-%1-%2").arg(QCoreApplication::applicationPid()).arg(index),
+            collectionName,
+            DEFAULT_TEST_STORAGE_PLUGIN));
+    secret.setData(QByteArray(PayloadSize, 's'));
+    secret.setType(Sailfish::Secrets::Secret::TypeBlob);
+    secret.setFilterData(QLatin1String("client"), QString::number(QCoreApplication::applicationPid()));
+    secret.setFilterData(QLatin1String("test"), QLatin1String("true"));
+    return secret;
+}
+
+bool BenchmarkWorker::storeSecret(const QString &mode, const Sailfish::Secrets::Secret &secret)
+{
+    Sailfish::Secrets::StoreSecretRequest ssr;
+    ssr.setManager(&m_sm);
+    if (mode == QStringLiteral("standalone")) {
+        ssr.setSecretStorageType(Sailfish::Secrets::StoreSecretRequest::StandaloneDeviceLockSecret);
+        ssr.setDeviceLockUnlockSemantic(Sailfish::Secrets::SecretManager::DeviceLockKeepUnlocked);
+        ssr.setAccessControlMode(Sailfish::Secrets::SecretManager::OwnerOnlyMode);
+        ssr.setEncryptionPluginName(DEFAULT_TEST_ENCRYPTION_PLUGIN);
+    } else {
+        ssr.setSecretStorageType(Sailfish::Secrets::StoreSecretRequest::CollectionSecret);
+    }
+    ssr.setUserInteractionMode(Sailfish::Secrets::SecretManager::PreventInteraction);
+    ssr.setSecret(secret);
+    ssr.startRequest();
+    ssr.waitForFinished();
+    return ssr.result().code() == Sailfish::Secrets::Result::Succeeded;
+}
+
+bool BenchmarkWorker::storedSecret(const Sailfish::Secrets::Secret::Identifier &identifier)
+{
+    Sailfish::Secrets::StoredSecretRequest gsr;
+    gsr.setManager(&m_sm);
+    gsr.setIdentifier(identifier);
+    gsr.setUserInteractionMode(Sailfish::Secrets::SecretManager::PreventInteraction);
+    gsr.startRequest();
+    gsr.waitForFinished();
+    return gsr.result().code() == Sailfish::Secrets::Result::Succeeded;
+}
+
+bool BenchmarkWorker::deleteSecret(const Sailfish::Secrets::Secret::Identifier &identifier)
+{
+    Sailfish::Secrets::DeleteSecretRequest dsr;
+    dsr.setManager(&m_sm);
+    dsr.setIdentifier(identifier);
+    dsr.setUserInteractionMode(Sailfish::Secrets::SecretManager::PreventInteraction);
+    dsr.startRequest();
+    dsr.waitForFinished();
+    return dsr.result().code() == Sailfish::Secrets::Result::Succeeded;
+}
+
+bool BenchmarkWorker::findSecrets(const QString &mode, const Sailfish::Secrets::Secret::FilterData &filter)
+{
+    Sailfish::Secrets::FindSecretsRequest fsr;
+    fsr.setManager(&m_sm);
+    fsr.setCollectionName(testSecret(mode, 0).identifier().collectionName());
+    fsr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    fsr.setFilter(filter);
+    fsr.setFilterOperator(Sailfish::Secrets::SecretManager::OperatorAnd);
+    fsr.setUserInteractionMode(Sailfish::Secrets::SecretManager::PreventInteraction);
+    fsr.startRequest();
+    fsr.waitForFinished();
+    return fsr.result().code() == Sailfish::Secrets::Result::Succeeded
+            && fsr.identifiers().size() == 1;
+}
+
+bool BenchmarkWorker::encrypt(const QByteArray &data, QByteArray *ciphertext)
+{
+    Sailfish::Crypto::EncryptRequest er;
+    er.setManager(&m_cm);
+    er.setKey(keyReference(AesKeyName));
+    er.setBlockMode(Sailfish::Crypto::CryptoManager::BlockModeCbc);
+    er.setPadding(Sailfish::Crypto::CryptoManager::EncryptionPaddingNone);
+    er.setInitializationVector(InitializationVector);
+    er.setCryptoPluginName(DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME);
+    er.setData(data);
+    er.startRequest();
+    er.waitForFinished();
+    if (ciphertext) {
+        *ciphertext = er.ciphertext();
+    }
+    return er.result().code() == Sailfish::Crypto::Result::Succeeded;
+}
+
+bool BenchmarkWorker::decrypt(const QByteArray &ciphertext)
+{
+    Sailfish::Crypto::DecryptRequest dr;
+    dr.setManager(&m_cm);
+    dr.setKey(keyReference(AesKeyName));
+    dr.setBlockMode(Sailfish::Crypto::CryptoManager::BlockModeCbc);
+    dr.setPadding(Sailfish::Crypto::CryptoManager::EncryptionPaddingNone);
+    dr.setInitializationVector(InitializationVector);
+    dr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME);
+    dr.setData(ciphertext);
+    dr.startRequest();
+    dr.waitForFinished();
+    return dr.result().code() == Sailfish::Crypto::Result::Succeeded;
+}
+
+bool BenchmarkWorker::sign(const QByteArray &data)
+{
+    Sailfish::Crypto::SignRequest sr;
+    sr.setManager(&m_cm);
+    sr.setKey(keyReference(RsaKeyName));
+    sr.setPadding(Sailfish::Crypto::CryptoManager::SignaturePaddingRsaPkcs1);
+    sr.setDigestFunction(Sailfish::Crypto::CryptoManager::DigestSha256);
+    sr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME);
+    sr.setData(data);
+    sr.startRequest();
+    sr.waitForFinished();
+    return sr.result().code() == Sailfish::Crypto::Result::Succeeded;
+}
+
+bool BenchmarkWorker::cipherSession(const QByteArray &data)
+{
+    // A complete session: initialize, update with the whole payload, finalize.
+    Sailfish::Crypto::CipherRequest cr;
+    cr.setManager(&m_cm);
+    cr.setKey(keyReference(AesKeyName));
+    cr.setOperation(Sailfish::Crypto::CryptoManager::OperationEncrypt);
+    cr.setBlockMode(Sailfish::Crypto::CryptoManager::BlockModeCbc);
+    cr.setEncryptionPadding(Sailfish::Crypto::CryptoManager::EncryptionPaddingNone);
+    cr.setInitializationVector(InitializationVector);
+    cr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME);
+
+    const Sailfish::Crypto::CipherRequest::CipherMode modes[] = {
+        Sailfish::Crypto::CipherRequest::InitializeCipher,
+        Sailfish::Crypto::CipherRequest::UpdateCipher,
+        Sailfish::Crypto::CipherRequest::FinalizeCipher
+    };
+    for (Sailfish::Crypto::CipherRequest::CipherMode mode : modes) {
+        cr.setCipherMode(mode);
+        cr.setData(mode == Sailfish::Crypto::CipherRequest::UpdateCipher ? data : QByteArray());
+        cr.startRequest();
+        cr.waitForFinished();
+        if (cr.result().code() != Sailfish::Crypto::Result::Succeeded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int BenchmarkWorker::run(const QStringList &args)
+{
+    if (args.size() < 2) {
+        return 1;
+    }
+
+    const QString flow = args.at(0);
+    const QString mode = args.value(2);
+    const int iterations = args.at(1).toInt();
+    bool succeeded = true;
+
+    if (flow == QStringLiteral("store")) {
+        QVector<Sailfish::Secrets::Secret::Identifier> stored;
+        for (int i = 0; succeeded && i < iterations; ++i) {
+            const Sailfish::Secrets::Secret secret = testSecret(mode, i);
+            succeeded = measure([&] { return storeSecret(mode, secret); });
+            stored.append(secret.identifier());
+        }
+        if (mode == QStringLiteral("standalone")) {
+            for (const Sailfish::Secrets::Secret::Identifier &identifier : stored) {
+                deleteSecret(identifier);
+            }
+        }
+    } else if (flow == QStringLiteral("stored") || flow == QStringLiteral("find")) {
+        const Sailfish::Secrets::Secret secret = testSecret(mode, 0);
+        succeeded = storeSecret(mode, secret);
+        for (int i = 0; succeeded && i < iterations; ++i) {
+            succeeded = flow == QStringLiteral("stored")
+                    ? measure([&] { return storedSecret(secret.identifier()); })
+                    : measure([&] { return findSecrets(mode, secret.filterData()); });
+        }
+        deleteSecret(secret.identifier());
+    } else if (flow == QStringLiteral("encrypt")) {
+        const QByteArray data(PayloadSize, 'p');
+        for (int i = 0; succeeded && i < iterations; ++i) {
+            succeeded = measure([&] { return encrypt(data, Q_NULLPTR); });
+        }
+    } else if (flow == QStringLiteral("decrypt")) {
+        QByteArray ciphertext;
+        succeeded = encrypt(QByteArray(PayloadSize, 'p'), &ciphertext);
+        for (int i = 0; succeeded && i < iterations; ++i) {
+            succeeded = measure([&] { return decrypt(ciphertext); });
+        }
+    } else if (flow == QStringLiteral("sign")) {
+        const QByteArray data(PayloadSize, 'p');
+        for (int i = 0; succeeded && i < iterations; ++i) {
+            succeeded = measure([&] { return sign(data); });
+        }
+    } else if (flow == QStringLiteral("ciphersession")) {
+        const QByteArray data(CipherSessionPayloadSize, 'p');
+        for (int i = 0; succeeded && i < iterations; ++i) {
+            succeeded = measure([&] { return cipherSession(data); });
+        }
+    } else {
+        return 1;
+    }
+
+    if (!succeeded) {
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    for (qint64 latency : m_latencies) {
+        out << latency << '\n';
+    }
+    return 0;
+}
+
+class tst_requestpipeline : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void storeSecret_data();
+    void storeSecret();
+    void storedSecret_data();
+    void storedSecret();
+    void findSecrets_data();
+    void findSecrets();
+    void encrypt_data();
+    void encrypt();
+    void decrypt_data();
+    void decrypt();
+    void sign_data();
+    void sign();
+    void cipherSession_data();
+    void cipherSession();
+
+private:
+    void addClientRows(const QStringList &modes = QStringList() << QString());
+    bool createCollection(const QString &collectionName,
+                          const QString &storagePluginName,
+                          const QString &encryptionPluginName,
+                          Sailfish::Secrets::CreateCollectionRequest::CollectionLockType lockType);
+    bool generateStoredKey(const QString &keyName,
+                           Sailfish::Crypto::CryptoManager::Algorithm algorithm,
+                           int keySize,
+                           const Sailfish::Crypto::KeyPairGenerationParameters &kpgParams);
+    bool runWorkers(const QString &flow, const QString &mode, int clients, QVector<qint64> *latencies);
+    void runBenchmark(const QString &flow);
+
+    Sailfish::Secrets::SecretManager m_sm;
+    Sailfish::Crypto::CryptoManager m_cm;
+    QStringList m_createdCollections;
+    QStringList m_results;
+    bool m_customLockAvailable = false;
+};
+
+void tst_requestpipeline::initTestCase()
+{
+    QVERIFY(createCollection(DeviceLockCollectionName,
+                             DEFAULT_TEST_STORAGE_PLUGIN,
+                             DEFAULT_TEST_ENCRYPTION_PLUGIN,
+                             Sailfish::Secrets::CreateCollectionRequest::DeviceLock));
+
+    // a custom lock collection requires the user to enter the passphrase once,
+    // after which it is kept unlocked for the remainder of the benchmark.
+    m_customLockAvailable = createCollection(CustomLockCollectionName,
+                                             DEFAULT_TEST_STORAGE_PLUGIN,
+                                             DEFAULT_TEST_ENCRYPTION_PLUGIN,
+                                             Sailfish::Secrets::CreateCollectionRequest::CustomLock);
+
+    QVERIFY(createCollection(KeyCollectionName,
+                             DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME,
+                             DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME,
+                             Sailfish::Secrets::CreateCollectionRequest::DeviceLock));
+    QVERIFY(generateStoredKey(AesKeyName, Sailfish::Crypto::CryptoManager::AlgorithmAes, 256,
+                              Sailfish::Crypto::KeyPairGenerationParameters()));
+    Sailfish::Crypto::RsaKeyPairGenerationParameters rsakpg;
+    rsakpg.setModulusLength(2048);
+    QVERIFY(generateStoredKey(RsaKeyName, Sailfish::Crypto::CryptoManager::AlgorithmRsa, 2048, rsakpg));
+
+    m_results.append(QStringLiteral("flow,mode,clients,iterations,operations,wallTimeMs,throughputOpsPerSec,p50Us,p90Us,p99Us,maxUs"));
+}
+
+void tst_requestpipeline::cleanupTestCase()
+{
+    while (!m_createdCollections.isEmpty()) {
+        const QStringList collection = m_createdCollections.takeLast().split(QLatin1Char('/'));
+        Sailfish::Secrets::DeleteCollectionRequest dcr;
+        dcr.setManager(&m_sm);
+        dcr.setCollectionName(collection.at(0));
+        dcr.setStoragePluginName(collection.at(1));
+        dcr.setUserInteractionMode(Sailfish::Secrets::SecretManager::PreventInteraction);
+        dcr.startRequest();
+        dcr.waitForFinished();
+    }
+
+    QFile results(resultsFilePath());
+    if (results.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        results.write(m_results.join(QLatin1Char('\n')).toUtf8());
+        results.write("\n");
+        qInfo() << "Benchmark results written to" << results.fileName();
+    } else {
+        qWarning() << "Unable to write benchmark results to" << results.fileName();
+    }
+}
+
+bool tst_requestpipeline::createCollection(
+        const QString &collectionName,
+        const QString &storagePluginName,
+        const QString &encryptionPluginName,
+        Sailfish::Secrets::CreateCollectionRequest::CollectionLockType lockType)
+{
+    Sailfish::Secrets::CreateCollectionRequest ccr;
+    ccr.setManager(&m_sm);
+    ccr.setCollectionName(collectionName);
+    ccr.setCollectionLockType(lockType);
+    ccr.setStoragePluginName(storagePluginName);
+    ccr.setEncryptionPluginName(encryptionPluginName);
+    ccr.setAuthenticationPluginName(PASSWORD_AGENT_TEST_AUTH_PLUGIN);
+    ccr.setDeviceLockUnlockSemantic(Sailfish::Secrets::SecretManager::DeviceLockKeepUnlocked);
+    ccr.setCustomLockUnlockSemantic(Sailfish::Secrets::SecretManager::CustomLockKeepUnlocked);
+    ccr.setAccessControlMode(Sailfish::Secrets::SecretManager::OwnerOnlyMode);
+    ccr.setUserInteractionMode(lockType == Sailfish::Secrets::CreateCollectionRequest::CustomLock
+                               ? Sailfish::Secrets::SecretManager::SystemInteraction
+                               : Sailfish::Secrets::SecretManager::PreventInteraction);
+    ccr.startRequest();
+    // creating the custom lock collection may require the user to enter a passphrase.
+    QElapsedTimer timer;
+    timer.start();
+    while (ccr.status() != Sailfish::Secrets::Request::Finished && timer.elapsed() < 60 * 1000) {
+        QTest::qWait(100);
+    }
+    if (ccr.result().code() != Sailfish::Secrets::Result::Succeeded) {
+        qWarning() << "Unable to create collection" << collectionName << ":" << ccr.result().errorMessage();
+        return false;
+    }
+
+    m_createdCollections.append(collectionName + QLatin1Char('/') + storagePluginName);
+    return true;
+}
+
+bool tst_requestpipeline::generateStoredKey(
+        const QString &keyName,
+        Sailfish::Crypto::CryptoManager::Algorithm algorithm,
+        int keySize,
+        const Sailfish::Crypto::KeyPairGenerationParameters &kpgParams)
+{
+    Sailfish::Crypto::Key keyTemplate;
+    keyTemplate.setSize(keySize);
+    keyTemplate.setAlgorithm(algorithm);
+    keyTemplate.setOrigin(Sailfish::Crypto::Key::OriginDevice);
+    keyTemplate.setOperations(Sailfish::Crypto::CryptoManager::OperationEncrypt
+                              | Sailfish::Crypto::CryptoManager::OperationDecrypt
+                              | Sailfish::Crypto::CryptoManager::OperationSign
+                              | Sailfish::Crypto::CryptoManager::OperationVerify);
+    keyTemplate.setComponentConstraints(Sailfish::Crypto::Key::MetaData
+                                        | Sailfish::Crypto::Key::PublicKeyData
+                                        | Sailfish::Crypto::Key::PrivateKeyData);
+    keyTemplate.setFilterData(QLatin1String("test"), QLatin1String("true"));
+    keyTemplate.setIdentifier(keyReference(keyName).identifier());
+
+    Sailfish::Crypto::GenerateStoredKeyRequest gskr;
+    gskr.setManager(&m_cm);
+    gskr.setKeyTemplate(keyTemplate);
+    gskr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_STORAGE_PLUGIN_NAME);
+    if (algorithm != Sailfish::Crypto::CryptoManager::AlgorithmAes) {
+        gskr.setKeyPairGenerationParameters(kpgParams);
+    }
+    gskr.startRequest();
+    gskr.waitForFinished();
+    if (gskr.result().code() != Sailfish::Crypto::Result::Succeeded) {
+        qWarning() << "Unable to generate key" << keyName << ":" << gskr.result().errorMessage();
+        return false;
+    }
+    return true;
+}
+
+void tst_requestpipeline::addClientRows(const QStringList &modes)
+{
+    QTest::addColumn<QString>("mode");
+    QTest::addColumn<int>("clients");
+
+    const int clientCounts[] = { 1, 8, 64 };
+    for (const QString &mode : modes) {
+        for (int clients : clientCounts) {
+            const QString rowName = mode.isEmpty()
+                    ? QStringLiteral("%1 clients").arg(clients)
+                    : QStringLiteral("%1 %2 clients").arg(mode).arg(clients);
+            QTest::newRow(rowName.toLatin1().constData()) << mode << clients;
+        }
+    }
+}
+
+bool tst_requestpipeline::runWorkers(
+        const QString &flow,
+        const QString &mode,
+        int clients,
+        QVector<qint64> *latencies)
+{
+    const QStringList args = QStringList() << QStringLiteral(WORKER_ARGUMENT)
+                                           << flow
+                                           << QString::number(iterationCount())
+                                           << mode;
+
+    // each client is a separate process, with its own connection to the daemon.
+    QList<QProcess*> workers;
+    for (int i = 0; i < clients; ++i) {
+        QProcess *worker = new QProcess(this);
+        worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        worker->start(QCoreApplication::applicationFilePath(), args);
+        workers.append(worker);
+    }
+
+    bool succeeded = true;
+    for (QProcess *worker : workers) {
+        if (!worker->waitForFinished(10 * 60 * 1000)
+                || worker->exitStatus() != QProcess::NormalExit
+                || worker->exitCode() != 0) {
+            succeeded = false;
+        }
+        for (const QByteArray &line : worker->readAllStandardOutput().split('\n')) {
+            if (!line.isEmpty()) {
+                latencies->append(line.toLongLong());
+            }
+        }
+        delete worker;
+    }
+
+    return succeeded;
+}
+
+void tst_requestpipeline::runBenchmark(const QString &flow)
+{
+    QFETCH(QString, mode);
+    QFETCH(int, clients);
+
+    if (mode == QStringLiteral("customlock") && !m_customLockAvailable) {
+        QSKIP("The custom lock collection could not be created");
+    }
+
+    QVector<qint64> latencies;
+    QElapsedTimer wallTimer;
+    bool succeeded = false;
+    QBENCHMARK_ONCE {
+        wallTimer.start();
+        succeeded = runWorkers(flow, mode, clients, &latencies);
+    }
+    const qint64 wallTime = qMax(Q_INT64_C(1), wallTimer.elapsed());
+    QVERIFY(succeeded);
+    QCOMPARE(latencies.size(), clients * iterationCount());
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies] (int p) {
+        return latencies.at(qMin(latencies.size() - 1, latencies.size() * p / 100));
+    };
+    const double throughput = latencies.size() * 1000.0 / wallTime;
+
+    const QString result = QStringLiteral("%1,%2,%3,%4,%5,%6,%7,%8,%9,%10,%11")
+            .arg(flow).arg(mode).arg(clients).arg(iterationCount()).arg(latencies.size())
+            .arg(wallTime).arg(throughput, 0, 'f', 2)
+            .arg(percentile(50)).arg(percentile(90)).arg(percentile(99)).arg(latencies.last());
+    m_results.append(result);
+    qInfo().noquote() << result;
+}
+
+void tst_requestpipeline::storeSecret_data()
+{
+    addClientRows(QStringList() << QStringLiteral("devicelock")
+                                << QStringLiteral("customlock")
+                                << QStringLiteral("standalone"));
+}
+
+void tst_requestpipeline::storeSecret()
+{
+    runBenchmark(QStringLiteral("store"));
+}
+
+void tst_requestpipeline::storedSecret_data()
+{
+    addClientRows(QStringList() << QStringLiteral("devicelock")
+                                << QStringLiteral("customlock")
+                                << QStringLiteral("standalone"));
+}
+
+void tst_requestpipeline::storedSecret()
+{
+    runBenchmark(QStringLiteral("stored"));
+}
+
+void tst_requestpipeline::findSecrets_data()
+{
+    addClientRows(QStringList() << QStringLiteral("devicelock"));
+}
+
+void tst_requestpipeline::findSecrets()
+{
+    runBenchmark(QStringLiteral("find"));
+}
+
+void tst_requestpipeline::encrypt_data()
+{
+    addClientRows();
+}
+
+void tst_requestpipeline::encrypt()
+{
+    runBenchmark(QStringLiteral("encrypt"));
+}
+
+void tst_requestpipeline::decrypt_data()
+{
+    addClientRows();
+}
+
+void tst_requestpipeline::decrypt()
+{
+    runBenchmark(QStringLiteral("decrypt"));
+}
+
+void tst_requestpipeline::sign_data()
+{
+    addClientRows();
+}
+
+void tst_requestpipeline::sign()
+{
+    runBenchmark(QStringLiteral("sign"));
+}
+
+void tst_requestpipeline::cipherSession_data()
+{
+    addClientRows();
+}
+
+void tst_requestpipeline::cipherSession()
+{
+    runBenchmark(QStringLiteral("ciphersession"));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    if (argc > 1 && qstrcmp(argv[1], WORKER_ARGUMENT) == 0) {
+        BenchmarkWorker worker;
+        return worker.run(app.arguments().mid(2));
+    }
+
+    tst_requestpipeline tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_requestpipeline.moc"
@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = tst_requestpipeline
+target.path = /opt/tests/Sailfish/Benchmarks/
+include($$PWD/../../../lib/libsailfishsecrets.pri)
+include($$PWD/../../../lib/libsailfishcrypto.pri)
+QT += testlib dbus
+SOURCES += tst_requestpipeline.cpp
+INSTALLS += target
@@ -13,8 +13,13 @@
 #include <QElapsedTimer>
 #include <QFile>
 #include <QDateTime>
+#include <QTemporaryFile>
 #include <QtCore/QCryptographicHash>
+#include <QtCore/QMessageAuthenticationCode>
 
+#include <unistd.h>
+
+#include "Crypto/batchrequest.h"
 #include "Crypto/calculatedigestrequest.h"
 #include "Crypto/cipherrequest.h"
 #include "Crypto/decryptrequest.h"
@@ -33,6 +38,7 @@
 #include "Crypto/storedkeyidentifiersrequest.h"
 #include "Crypto/storedkeyrequest.h"
 #include "Crypto/verifyrequest.h"
+#include "Crypto/payloadtransfer_p.h"
 
 #include "Crypto/cryptomanager.h"
 #include "Crypto/key.h"
@@ -128,10 +134,12 @@ private slots:
     void generateInitializationVectorRequest();
     void generateKeyEncryptDecrypt_data();
     void generateKeyEncryptDecrypt();
+    void encryptDecryptLargePayload();
     void signVerify();
     void signVerify_data();
     void calculateDigest();
     void calculateDigest_data();
+    void batchSignVerify();
     void storedKeyRequests_data();
     void storedKeyRequests();
     void storedKeyIdentifiersRequests_data();
@@ -144,6 +152,9 @@ private slots:
     void cipherSignVerify();
     void cipherEncryptDecrypt_data();
     void cipherEncryptDecrypt();
+    void cipherStreamEncryptDecrypt();
+    void cipherStreamDigest_data();
+    void cipherStreamDigest();
     void cipherBenchmark_data();
     void cipherBenchmark();
     void cipherTimeout_data();
@@ -311,6 +322,12 @@ void tst_cryptorequests::randomData_data()
             << 2048
             << 0.5 << QByteArray("seed")
             << CryptoTest::TestRequests();
+
+    QTest::newRow("DefaultCryptoPluginLarge")
+            << plugins << GenerateRandomDataRequest::DefaultCsprngEngineName
+            << 4 * 1024 * 1024
+            << 0.5 << QByteArray("seed")
+            << CryptoTest::TestRequests();
 }
 
 void tst_cryptorequests::randomData()
@@ -560,6 +577,67 @@ void tst_cryptorequests::generateKeyEncryptDecrypt()
     }
 }
 
+void tst_cryptorequests::encryptDecryptLargePayload()
+{
+    // Payloads this large are passed to and from the daemon via file descriptors.
+    const QByteArray plaintext = createRandomTestData(4 * 1024 * 1024);
+    const QByteArray initVector = generateInitializationVector(CryptoManager::AlgorithmAes, CryptoManager::BlockModeCbc);
+
+    GenerateKeyRequest gkr;
+    gkr.setManager(&m_cm);
+    gkr.setKeyTemplate(createTestKey(256, CryptoManager::AlgorithmAes, Key::OriginDevice,
+                                     CryptoManager::OperationEncrypt | CryptoManager::OperationDecrypt));
+    gkr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    gkr.startRequest();
+    WAIT_FOR_REQUEST_SUCCEEDED(gkr);
+    Key fullKey = gkr.generatedKey();
+    QVERIFY(!fullKey.secretKey().isEmpty());
+
+    EncryptRequest er;
+    er.setManager(&m_cm);
+    QSignalSpy erss(&er, &EncryptRequest::statusChanged);
+    er.setData(plaintext);
+    er.setInitializationVector(initVector);
+    er.setKey(fullKey);
+    er.setBlockMode(CryptoManager::BlockModeCbc);
+    er.setPadding(CryptoManager::EncryptionPaddingNone);
+    er.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    START_AND_WAIT_FOR_REQUEST(er, erss, Result::Succeeded, Result::NoError, 10 * 1000);
+    const QByteArray ciphertext = er.ciphertext();
+    QCOMPARE(ciphertext.size(), plaintext.size());
+    QVERIFY(ciphertext != plaintext);
+
+    DecryptRequest dr;
+    dr.setManager(&m_cm);
+    QSignalSpy drss(&dr, &DecryptRequest::statusChanged);
+    dr.setData(ciphertext);
+    dr.setInitializationVector(initVector);
+    dr.setKey(fullKey);
+    dr.setBlockMode(CryptoManager::BlockModeCbc);
+    dr.setPadding(CryptoManager::EncryptionPaddingNone);
+    dr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    START_AND_WAIT_FOR_REQUEST(dr, drss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QCOMPARE(dr.plaintext(), plaintext);
+
+    CalculateDigestRequest cdr;
+    cdr.setManager(&m_cm);
+    QSignalSpy cdrss(&cdr, &CalculateDigestRequest::statusChanged);
+    cdr.setData(plaintext);
+    cdr.setPadding(CryptoManager::SignaturePaddingNone);
+    cdr.setDigestFunction(CryptoManager::DigestSha256);
+    cdr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    START_AND_WAIT_FOR_REQUEST(cdr, cdrss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QCOMPARE(cdr.digest(), QCryptographicHash::hash(plaintext, QCryptographicHash::Sha256));
+
+    // Payload descriptors larger than the maximum are rejected without being read.
+    QDBusUnixFileDescriptor oversized = PayloadTransfer::createFileDescriptor(QByteArray("payload"));
+    QVERIFY(oversized.isValid());
+    QCOMPARE(ftruncate(oversized.fileDescriptor(), qint64(PayloadTransfer::MaximumPayloadSize) + 1), 0);
+    QByteArray payload;
+    QVERIFY(!PayloadTransfer::readFileDescriptor(oversized, &payload));
+    QVERIFY(payload.isEmpty());
+}
+
 void tst_cryptorequests::signVerify_data()
 {
     QTest::addColumn<TestPluginMap>("plugins");
@@ -702,6 +780,67 @@ void tst_cryptorequests::signVerify()
     }
 }
 
+void tst_cryptorequests::batchSignVerify()
+{
+    // Generate key for signing
+    Key keyTemplate = createTestKey(0, CryptoManager::AlgorithmRsa, Key::OriginDevice, CryptoManager::OperationSign);
+    GenerateKeyRequest gkr;
+    gkr.setManager(&m_cm);
+    gkr.setKeyPairGenerationParameters(getKeyPairGenerationParameters(CryptoManager::AlgorithmRsa, 2048));
+    gkr.setKeyTemplate(keyTemplate);
+    gkr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    gkr.startRequest();
+    WAIT_FOR_REQUEST_SUCCEEDED(gkr);
+    Key fullKey = gkr.generatedKey();
+    QVERIFY(!fullKey.privateKey().isEmpty());
+
+    // Sign several blobs of data in a single batch
+    const QVector<QByteArray> plaintexts { "Test plaintext data 1",
+                                           "Test plaintext data 2",
+                                           "Test plaintext data 3" };
+    BatchRequest sbr;
+    sbr.setManager(&m_cm);
+    QSignalSpy sbrss(&sbr, &BatchRequest::statusChanged);
+    sbr.setKey(fullKey);
+    QCOMPARE(sbr.key(), fullKey);
+    sbr.setPadding(CryptoManager::SignaturePaddingNone);
+    sbr.setDigestFunction(CryptoManager::DigestSha256);
+    sbr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    for (const QByteArray &plaintext : plaintexts) {
+        sbr.addSignOperation(plaintext);
+    }
+    sbr.addCalculateDigestOperation(plaintexts.first());
+    QCOMPARE(sbr.operationCount(), plaintexts.size() + 1);
+    QCOMPARE(sbr.operationType(plaintexts.size()), BatchRequest::CalculateDigestOperation);
+    START_AND_WAIT_FOR_REQUEST(sbr, sbrss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QCOMPARE(sbr.results().size(), plaintexts.size() + 1);
+    QCOMPARE(sbr.outputs().size(), plaintexts.size() + 1);
+    for (const Result &result : sbr.results()) {
+        QCOMPARE(result.code(), Result::Succeeded);
+    }
+    QCOMPARE(sbr.outputs().last(), QCryptographicHash::hash(plaintexts.first(), QCryptographicHash::Sha256));
+
+    // Verify the signatures in another batch, one of them against the wrong data
+    BatchRequest vbr;
+    vbr.setManager(&m_cm);
+    QSignalSpy vbrss(&vbr, &BatchRequest::statusChanged);
+    vbr.setKey(fullKey);
+    vbr.setPadding(CryptoManager::SignaturePaddingNone);
+    vbr.setDigestFunction(CryptoManager::DigestSha256);
+    vbr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    for (int i = 0; i < plaintexts.size(); ++i) {
+        vbr.addVerifyOperation(sbr.outputs().at(i), plaintexts.at(i));
+    }
+    vbr.addVerifyOperation(sbr.outputs().first(), plaintexts.last());
+    START_AND_WAIT_FOR_REQUEST(vbr, vbrss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QCOMPARE(vbr.verificationStatuses().size(), plaintexts.size() + 1);
+    for (int i = 0; i < plaintexts.size(); ++i) {
+        QCOMPARE(vbr.results().at(i).code(), Result::Succeeded);
+        QCOMPARE(vbr.verificationStatuses().at(i), CryptoManager::VerificationSucceeded);
+    }
+    QVERIFY(vbr.verificationStatuses().last() != CryptoManager::VerificationSucceeded);
+}
+
 void tst_cryptorequests::calculateDigest_data()
 {
     QTest::addColumn<TestPluginMap>("plugins");
@@ -1148,6 +1287,19 @@ void tst_cryptorequests::storedKeyIdentifiersRequests()
         }
         QCOMPARE(keyFound, true);
     }
+
+    // a stored key request doesn't unlock the collection, so must fail once
+    // the collection has been relocked, even if it is still kept open.
+    if (testRequests.value("GenerateStoredKeyRequest").resultCode == Result::Succeeded
+            && unlockSemantic == Sailfish::Secrets::SecretManager::CustomLockAccessRelock) {
+        StoredKeyRequest skr;
+        skr.setManager(&m_cm);
+        skr.setIdentifier(keyReference.identifier());
+        skr.setKeyComponents(Key::MetaData | Key::PublicKeyData | Key::PrivateKeyData);
+        skr.startRequest();
+        WAIT_FOR_REQUEST_FAILED(skr, Result::StorageError);
+        QVERIFY(skr.storedKey().secretKey().isEmpty());
+    }
 }
 
 void tst_cryptorequests::storedDerivedKeyRequests_data()
@@ -1945,6 +2097,155 @@ void tst_cryptorequests::cipherEncryptDecrypt()
 #define BATCH_BENCHMARK_CHUNK_SIZE 32768
 #define BENCHMARK_TEST_FILE QLatin1String("/tmp/sailfish.crypto.testfile")
 
+void tst_cryptorequests::cipherStreamEncryptDecrypt()
+{
+    const QByteArray plaintext = createRandomTestData(4 * 1024 * 1024);
+    const QByteArray initVector = generateInitializationVector(CryptoManager::AlgorithmAes, CryptoManager::BlockModeCbc);
+
+    GenerateKeyRequest gkr;
+    gkr.setManager(&m_cm);
+    gkr.setKeyTemplate(createTestKey(256, CryptoManager::AlgorithmAes, Key::OriginDevice,
+                                     CryptoManager::OperationEncrypt | CryptoManager::OperationDecrypt));
+    gkr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    gkr.startRequest();
+    WAIT_FOR_REQUEST_SUCCEEDED(gkr);
+    Key fullKey = gkr.generatedKey();
+    QVERIFY(!fullKey.secretKey().isEmpty());
+
+    QTemporaryFile plaintextFile, ciphertextFile, decryptedFile;
+    QVERIFY(plaintextFile.open());
+    QVERIFY(ciphertextFile.open());
+    QVERIFY(decryptedFile.open());
+    QCOMPARE(plaintextFile.write(plaintext), qint64(plaintext.size()));
+    QVERIFY(plaintextFile.flush());
+    QVERIFY(plaintextFile.seek(0));
+
+    // stream the plaintext through an encryption cipher session.
+    CipherRequest er;
+    er.setManager(&m_cm);
+    QSignalSpy erss(&er, &CipherRequest::statusChanged);
+    er.setKey(fullKey);
+    er.setOperation(CryptoManager::OperationEncrypt);
+    er.setBlockMode(CryptoManager::BlockModeCbc);
+    er.setEncryptionPadding(CryptoManager::EncryptionPaddingNone);
+    er.setInitializationVector(initVector);
+    er.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    er.setCipherMode(CipherRequest::InitializeCipher);
+    START_AND_WAIT_FOR_REQUEST(er, erss, Result::Succeeded, Result::NoError, 10 * 1000);
+
+    er.setCipherMode(CipherRequest::StreamCipher);
+    er.setInputFileDescriptor(plaintextFile.handle());
+    er.setOutputFileDescriptor(ciphertextFile.handle());
+    QCOMPARE(er.inputFileDescriptor(), plaintextFile.handle());
+    QCOMPARE(er.outputFileDescriptor(), ciphertextFile.handle());
+    START_AND_WAIT_FOR_REQUEST(er, erss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QVERIFY(ciphertextFile.seek(0));
+    QByteArray ciphertext = ciphertextFile.readAll();
+    ciphertext.append(er.generatedData());
+    QVERIFY(ciphertext.size() >= plaintext.size());
+    QVERIFY(ciphertext.left(plaintext.size()) != plaintext);
+
+    QVERIFY(ciphertextFile.seek(0));
+    QVERIFY(ciphertextFile.resize(0));
+    QCOMPARE(ciphertextFile.write(ciphertext), qint64(ciphertext.size()));
+    QVERIFY(ciphertextFile.flush());
+    QVERIFY(ciphertextFile.seek(0));
+
+    // and stream the ciphertext back through a decryption cipher session.
+    CipherRequest dr;
+    dr.setManager(&m_cm);
+    QSignalSpy drss(&dr, &CipherRequest::statusChanged);
+    dr.setKey(fullKey);
+    dr.setOperation(CryptoManager::OperationDecrypt);
+    dr.setBlockMode(CryptoManager::BlockModeCbc);
+    dr.setEncryptionPadding(CryptoManager::EncryptionPaddingNone);
+    dr.setInitializationVector(initVector);
+    dr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    dr.setCipherMode(CipherRequest::InitializeCipher);
+    START_AND_WAIT_FOR_REQUEST(dr, drss, Result::Succeeded, Result::NoError, 10 * 1000);
+
+    dr.setCipherMode(CipherRequest::StreamCipher);
+    dr.setInputFileDescriptor(ciphertextFile.handle());
+    dr.setOutputFileDescriptor(decryptedFile.handle());
+    START_AND_WAIT_FOR_REQUEST(dr, drss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QVERIFY(decryptedFile.seek(0));
+    QByteArray decrypted = decryptedFile.readAll();
+    decrypted.append(dr.generatedData());
+    QCOMPARE(decrypted, plaintext);
+}
+
+void tst_cryptorequests::cipherStreamDigest_data()
+{
+    QTest::addColumn<CryptoManager::Operation>("operation");
+    QTest::addColumn<CryptoManager::DigestFunction>("digestFunction");
+    QTest::addColumn<QCryptographicHash::Algorithm>("cryptographicHashAlgorithm");
+
+    QTest::newRow("SHA1") << CryptoManager::OperationCalculateDigest
+                          << CryptoManager::DigestSha1 << QCryptographicHash::Sha1;
+    QTest::newRow("SHA2-384") << CryptoManager::OperationCalculateDigest
+                              << CryptoManager::DigestSha2_384 << QCryptographicHash::Sha384;
+    QTest::newRow("SHA2-512") << CryptoManager::OperationCalculateDigest
+                              << CryptoManager::DigestSha2_512 << QCryptographicHash::Sha512;
+    QTest::newRow("HMAC-SHA256") << CryptoManager::OperationCalculateMac
+                                 << CryptoManager::DigestSha2_256 << QCryptographicHash::Sha256;
+}
+
+void tst_cryptorequests::cipherStreamDigest()
+{
+    QFETCH(CryptoManager::Operation, operation);
+    QFETCH(CryptoManager::DigestFunction, digestFunction);
+    QFETCH(QCryptographicHash::Algorithm, cryptographicHashAlgorithm);
+
+    const QByteArray data = createRandomTestData(8 * 1024 * 1024);
+    Key macKey;
+    QByteArray expected;
+    if (operation == CryptoManager::OperationCalculateMac) {
+        macKey.setSecretKey(createRandomTestData(32));
+        expected = QMessageAuthenticationCode::hash(data, macKey.secretKey(), cryptographicHashAlgorithm);
+    } else {
+        expected = QCryptographicHash::hash(data, cryptographicHashAlgorithm);
+    }
+
+    QTemporaryFile dataFile, outputFile;
+    QVERIFY(dataFile.open());
+    QVERIFY(outputFile.open());
+    QCOMPARE(dataFile.write(data), qint64(data.size()));
+    QVERIFY(dataFile.flush());
+    QVERIFY(dataFile.seek(0));
+
+    // stream the data through a digest cipher session.
+    CipherRequest cr;
+    cr.setManager(&m_cm);
+    QSignalSpy crss(&cr, &CipherRequest::statusChanged);
+    cr.setKey(macKey);
+    cr.setOperation(operation);
+    cr.setDigestFunction(digestFunction);
+    cr.setCryptoPluginName(DEFAULT_TEST_CRYPTO_PLUGIN_NAME);
+    cr.setCipherMode(CipherRequest::InitializeCipher);
+    START_AND_WAIT_FOR_REQUEST(cr, crss, Result::Succeeded, Result::NoError, 10 * 1000);
+
+    cr.setCipherMode(CipherRequest::StreamCipher);
+    cr.setInputFileDescriptor(dataFile.handle());
+    cr.setOutputFileDescriptor(outputFile.handle());
+    START_AND_WAIT_FOR_REQUEST(cr, crss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QCOMPARE(cr.generatedData(), expected);
+    QCOMPARE(outputFile.size(), qint64(0));
+
+    // the same digest is calculated when the session is updated with each chunk.
+    cr.setCipherMode(CipherRequest::InitializeCipher);
+    START_AND_WAIT_FOR_REQUEST(cr, crss, Result::Succeeded, Result::NoError, 10 * 1000);
+    for (int offset = 0; offset < data.size(); offset += 1024 * 1024) {
+        cr.setCipherMode(CipherRequest::UpdateCipher);
+        cr.setData(data.mid(offset, 1024 * 1024));
+        START_AND_WAIT_FOR_REQUEST(cr, crss, Result::Succeeded, Result::NoError, 10 * 1000);
+        QVERIFY(cr.generatedData().isEmpty());
+    }
+    cr.setCipherMode(CipherRequest::FinalizeCipher);
+    cr.setData(QByteArray());
+    START_AND_WAIT_FOR_REQUEST(cr, crss, Result::Succeeded, Result::NoError, 10 * 1000);
+    QCOMPARE(cr.generatedData(), expected);
+}
+
 void tst_cryptorequests::cipherBenchmark_data()
 {
     TestPluginMap plugins;
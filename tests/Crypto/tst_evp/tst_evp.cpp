@@ -7,6 +7,8 @@
 
 #include "tst_evp.h"
 #include "evp_p.h"
+#include "keycache_p.h"
+#include "randomgenerator_p.h"
 
 #include <openssl/evp.h>
 #include <openssl/rand.h>
@@ -187,6 +189,100 @@ void tst_evp::testVerifyIncorrect()
     QCOMPARE(ok2, ok1);
 }
 
+/*!
+ * Tests the parsed key cache.
+ * Makes sure that a cached key produces the same signature as a freshly
+ * parsed one, and that hits, misses and clearing are accounted correctly.
+ */
+void tst_evp::testKeyCache()
+{
+    OpenSslKeyCache cache;
+    QByteArray testData = generateTestData(512);
+    const EVP_MD *digestFunc = EVP_sha256();
+
+    // The first use of each key parses it, later uses are served from the cache.
+    for (int i = 0; i < 3; ++i) {
+        EVP_PKEY *pkey = cache.key(OpenSslKeyCache::PrivateKey, privateKey);
+        QVERIFY(pkey);
+
+        uint8_t *signature;
+        size_t signatureLength;
+        int r = OpenSslEvp::sign(digestFunc, pkey, testData.data(), testData.length(), &signature, &signatureLength);
+        EVP_PKEY_free(pkey);
+        QCOMPARE(r, 1);
+        QByteArray result((const char*) signature, (int) signatureLength);
+        OPENSSL_free(signature);
+        QCOMPARE(result, signWithEvp(testData));
+
+        pkey = cache.key(OpenSslKeyCache::PublicKey, publicKey);
+        QVERIFY(pkey);
+        r = OpenSslEvp::verify(digestFunc, pkey, testData.data(), testData.length(),
+                               reinterpret_cast<const uint8_t*>(result.data()), result.length());
+        EVP_PKEY_free(pkey);
+        QCOMPARE(r, 1);
+    }
+    QCOMPARE(cache.misses(), Q_UINT64_C(2));
+    QCOMPARE(cache.hits(), Q_UINT64_C(4));
+
+    // A public key is not a private key, and invalid data is not cached.
+    QVERIFY(!cache.key(OpenSslKeyCache::PrivateKey, publicKey));
+    QVERIFY(!cache.key(OpenSslKeyCache::PublicKey, QByteArray("not a key")));
+    QCOMPARE(cache.misses(), Q_UINT64_C(4));
+
+    // Keys which are still referenced remain usable after the cache is cleared.
+    EVP_PKEY *pkey = cache.key(OpenSslKeyCache::PrivateKey, privateKey);
+    QCOMPARE(cache.hits(), Q_UINT64_C(5));
+    cache.clear();
+    QVERIFY(EVP_PKEY_size(pkey) > 0);
+    EVP_PKEY_free(pkey);
+
+    pkey = cache.key(OpenSslKeyCache::PrivateKey, privateKey);
+    QVERIFY(pkey);
+    EVP_PKEY_free(pkey);
+    QCOMPARE(cache.misses(), Q_UINT64_C(5));
+}
+
+/*!
+ * Tests batched AES encryption and decryption.
+ * Makes sure that each record of a batch is encrypted exactly as it would
+ * be on its own, and that a record with a bad tag fails only that record.
+ */
+void tst_evp::testRandomGenerator()
+{
+    const OpenSslRandomGenerator::Engine engines[] = {
+        OpenSslRandomGenerator::DefaultEngine,
+        OpenSslRandomGenerator::DevURandomEngine
+    };
+    const int sizes[] = { 1, 32, OpenSslRandomGenerator::MaximumBufferedRequestSize,
+                          OpenSslRandomGenerator::BufferSize + 1, 3 * 1024 * 1024 + 7 };
+
+    for (OpenSslRandomGenerator::Engine engine : engines) {
+        for (int size : sizes) {
+            QByteArray first(size, '\0');
+            QByteArray second(size, '\0');
+            QVERIFY(OpenSslRandomGenerator::generate(engine, first.data(), first.size()));
+            QVERIFY(OpenSslRandomGenerator::generate(engine, second.data(), second.size()));
+            if (size >= 32) {
+                QVERIFY(first != second);
+                QVERIFY(first.count('\0') < size / 2);
+            }
+        }
+    }
+
+    // Buffered data is not handed out twice, including across a seed.
+    QByteArray before(32, '\0');
+    QByteArray after(32, '\0');
+    QVERIFY(OpenSslRandomGenerator::generate(OpenSslRandomGenerator::DefaultEngine, before.data(), before.size()));
+    OpenSslRandomGenerator::seed("seed", 4, 0.5);
+    QVERIFY(OpenSslRandomGenerator::generate(OpenSslRandomGenerator::DefaultEngine, after.data(), after.size()));
+    QVERIFY(before != after);
+
+    // Requests larger than the maximum are rejected.
+    char byte = 0;
+    QVERIFY(!OpenSslRandomGenerator::generate(OpenSslRandomGenerator::DefaultEngine, &byte,
+                                              quint64(OpenSslRandomGenerator::MaximumRequestSize) + 1));
+}
+
 /*!
  * \brief Creates an SHA-256 signature using the OpenSSL command line.
  * \param data The data which needs to be signed.
@@ -14,6 +14,8 @@
 #include <QtCore/QDebug>
 
 #include "evp_p.h"
+#include "keycache_p.h"
+#include "randomgenerator_p.h"
 
 class tst_evp : public QObject
 {
@@ -32,6 +34,8 @@ private slots:
     void testSign();
     void testVerifyCorrect();
     void testVerifyIncorrect();
+    void testKeyCache();
+    void testRandomGenerator();
 
 private:
     QByteArray generateTestData(size_t size);
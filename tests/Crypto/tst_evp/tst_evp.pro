@@ -11,10 +11,14 @@ DEPENDPATH  += $$PWD/../../../plugins/opensslcryptoplugin/evp
 
 HEADERS += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator_p.h \
     tst_evp.h
 
 SOURCES += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator.cpp \
     tst_evp.cpp
 
 INSTALLS += target
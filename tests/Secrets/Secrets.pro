@@ -2,4 +2,5 @@ TEMPLATE = subdirs
 SUBDIRS = \
     $$PWD/tst_secrets \
     $$PWD/tst_secretsrequests \
-    $$PWD/tst_dataprotection
+    $$PWD/tst_dataprotection \
+    $$PWD/tst_schemaupgrade
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "tst_schemaupgrade.h"
+#include "metadatadbschema_p.h"
+
+bool openMetadataDatabase(Sailfish::Secrets::Daemon::Sqlite::Database *db,
+                          const QString &databaseSubdir,
+                          const QByteArray &hexKey,
+                          const QString &connectionName)
+{
+    const QByteArray setupKeyStatement = QStringLiteral("PRAGMA key = \"x'%1'\";").arg(QLatin1String(hexKey)).toLatin1();
+    const char *setupStatements[] = {
+        setupKeyStatement.constData(),
+        setupEnforceForeignKeys,
+        setupEncoding,
+        setupTempStore,
+        setupJournal,
+        setupSynchronous,
+        NULL
+    };
+
+    return db->open(QLatin1String("QSQLCIPHER"),
+                    databaseSubdir,
+                    QLatin1String("metadata.db"),
+                    setupStatements,
+                    createStatements,
+                    upgradeVersions,
+                    currentSchemaVersion,
+                    connectionName,
+                    true);
+}
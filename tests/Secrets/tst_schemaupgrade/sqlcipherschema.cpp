@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "tst_schemaupgrade.h"
+#include "sqlcipherdatabase_p.h"
+
+bool openSqlCipherPluginDatabase(Sailfish::Secrets::Daemon::Sqlite::Database *db,
+                                 const QString &databaseSubdir,
+                                 const QString &databaseFilename,
+                                 const QByteArray &hexKey,
+                                 const QString &connectionName)
+{
+    const QByteArray setupKeyStatement = QStringLiteral("PRAGMA key = \"x'%1'\";").arg(QLatin1String(hexKey)).toLatin1();
+    const char *setupStatements[] = {
+        setupKeyStatement.constData(),
+        setupEnforceForeignKeys,
+        setupEncoding,
+        setupTempStore,
+        setupJournal,
+        setupSynchronous,
+        NULL
+    };
+
+    return db->open(QLatin1String("QSQLCIPHER"),
+                    databaseSubdir,
+                    databaseFilename,
+                    setupStatements,
+                    createStatements,
+                    upgradeVersions,
+                    currentSchemaVersion,
+                    connectionName,
+                    true);
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "tst_schemaupgrade.h"
+#include "sqlitedatabase_p.h"
+
+bool openSqlitePluginDatabase(Sailfish::Secrets::Daemon::Sqlite::Database *db,
+                              const QString &databaseSubdir,
+                              const QString &connectionName)
+{
+    return db->open(QLatin1String("QSQLITE"),
+                    databaseSubdir,
+                    QLatin1String("secrets.db"),
+                    setupStatements,
+                    createStatements,
+                    upgradeVersions,
+                    currentSchemaVersion,
+                    connectionName,
+                    true);
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include "tst_schemaupgrade.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QStandardPaths>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+
+using namespace Sailfish::Secrets::Daemon;
+
+static const QString TestDatabaseSubdir = QStringLiteral("schemaupgrade-test");
+static const QByteArray TestHexKey = QByteArray(64, 'a');
+
+static int schemaVersion(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    return query.exec(QStringLiteral("PRAGMA user_version")) && query.next()
+            ? query.value(0).toInt()
+            : -1;
+}
+
+static bool indexExists(QSqlDatabase &database, const QString &indexName)
+{
+    QSqlQuery query(database);
+    query.prepare(QStringLiteral("SELECT name FROM sqlite_master WHERE type = 'index' AND name = ?"));
+    query.addBindValue(indexName);
+    return query.exec() && query.next();
+}
+
+static QStringList columnNames(QSqlDatabase &database, const QString &tableName)
+{
+    QStringList names;
+    QSqlQuery query(database);
+    if (query.exec(QStringLiteral("PRAGMA table_info(%1)").arg(tableName))) {
+        while (query.next()) {
+            names << query.value(1).toString();
+        }
+    }
+    return names;
+}
+
+static QStringList filterDataMatchKeys(QSqlDatabase &database)
+{
+    QStringList keys;
+    QSqlQuery query(database);
+    if (query.exec(QStringLiteral("SELECT FieldKey, ValueKey FROM SecretsFilterData ORDER BY Field"))) {
+        while (query.next()) {
+            keys << query.value(0).toString() << query.value(1).toString();
+        }
+    }
+    return keys;
+}
+
+void tst_schemaupgrade::init()
+{
+    // the databases are created beneath the test mode data location.
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(databaseDirPath(TestDatabaseSubdir)).removeRecursively();
+    QVERIFY(QDir().mkpath(databaseDirPath(TestDatabaseSubdir)));
+}
+
+void tst_schemaupgrade::cleanup()
+{
+    QDir(databaseDirPath(TestDatabaseSubdir)).removeRecursively();
+}
+
+QString tst_schemaupgrade::databaseDirPath(const QString &databaseSubdir) const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
+            + QStringLiteral("/system/privileged/Secrets/")
+            + databaseSubdir
+            + QLatin1Char('/');
+}
+
+bool tst_schemaupgrade::createDatabase(
+        const QString &driver,
+        const QString &filePath,
+        const QByteArray &hexKey,
+        const QStringList &statements)
+{
+    const QString connectionName = QStringLiteral("tst_schemaupgrade-create");
+    bool success = true;
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase(driver, connectionName);
+        database.setDatabaseName(filePath);
+        success = database.open();
+
+        QStringList allStatements(statements);
+        if (!hexKey.isEmpty()) {
+            allStatements.prepend(QStringLiteral("PRAGMA key = \"x'%1'\";").arg(QLatin1String(hexKey)));
+        }
+        for (const QString &statement : allStatements) {
+            QSqlQuery query(database);
+            if (success && !query.exec(statement)) {
+                qWarning() << "Unable to create test database:" << query.lastError() << statement;
+                success = false;
+            }
+        }
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return success;
+}
+
+void tst_schemaupgrade::sqlitePluginVersion1()
+{
+    // the version 1 schema had no filter data match keys nor index.
+    QVERIFY(createDatabase(QStringLiteral("QSQLITE"),
+                           databaseDirPath(TestDatabaseSubdir) + QStringLiteral("secrets.db"),
+                           QByteArray(),
+                           QStringList()
+            << QStringLiteral("CREATE TABLE Collections ("
+                              " CollectionName TEXT NOT NULL,"
+                              " PRIMARY KEY (CollectionName));")
+            << QStringLiteral("CREATE TABLE Secrets ("
+                              " CollectionName TEXT NOT NULL,"
+                              " SecretName TEXT NOT NULL,"
+                              " Secret BLOB,"
+                              " Timestamp DATE,"
+                              " FOREIGN KEY (CollectionName) REFERENCES Collections(CollectionName) ON DELETE CASCADE,"
+                              " PRIMARY KEY (CollectionName, SecretName));")
+            << QStringLiteral("CREATE TABLE SecretsFilterData ("
+                              " CollectionName TEXT NOT NULL,"
+                              " SecretName TEXT NOT NULL,"
+                              " Field TEXT NOT NULL,"
+                              " Value TEXT,"
+                              " FOREIGN KEY (CollectionName, SecretName) REFERENCES Secrets (CollectionName, SecretName) ON DELETE CASCADE,"
+                              " PRIMARY KEY (CollectionName, SecretName, Field));")
+            << QStringLiteral("INSERT INTO Collections (CollectionName) VALUES ('standalone');")
+            << QStringLiteral("INSERT INTO Secrets (CollectionName, SecretName) VALUES ('standalone', 'secret');")
+            << QStringLiteral("INSERT INTO SecretsFilterData (CollectionName, SecretName, Field, Value)"
+                              " VALUES ('standalone', 'secret', 'Domain', 'Example.COM');")
+            << QStringLiteral("INSERT INTO SecretsFilterData (CollectionName, SecretName, Field, Value)"
+                              " VALUES ('standalone', 'secret', 'Note', NULL);")
+            << QStringLiteral("PRAGMA user_version=1;")));
+
+    Sqlite::Database db;
+    QVERIFY(openSqlitePluginDatabase(&db, TestDatabaseSubdir, QStringLiteral("tst_schemaupgrade-sqlite")));
+    QSqlDatabase &database(db);
+    QCOMPARE(schemaVersion(database), 2);
+    QVERIFY(indexExists(database, QStringLiteral("SecretsFilterDataMatchIndex")));
+    QCOMPARE(filterDataMatchKeys(database),
+             QStringList() << QStringLiteral("domain") << QStringLiteral("example.com")
+                           << QStringLiteral("note") << QString());
+    db.close();
+}
+
+void tst_schemaupgrade::sqlCipherPluginVersion1()
+{
+    // the version 1 schema had no filter data match keys nor index.
+    QVERIFY(createDatabase(QStringLiteral("QSQLCIPHER"),
+                           databaseDirPath(TestDatabaseSubdir) + QStringLiteral("collection.db"),
+                           TestHexKey,
+                           QStringList()
+            << QStringLiteral("CREATE TABLE Secrets ("
+                              " SecretName TEXT NOT NULL,"
+                              " Secret BLOB,"
+                              " Timestamp DATE,"
+                              " PRIMARY KEY (SecretName));")
+            << QStringLiteral("CREATE TABLE SecretsFilterData ("
+                              " SecretName TEXT NOT NULL,"
+                              " Field TEXT NOT NULL,"
+                              " Value TEXT,"
+                              " FOREIGN KEY (SecretName) REFERENCES Secrets (SecretName) ON DELETE CASCADE,"
+                              " PRIMARY KEY (SecretName, Field));")
+            << QStringLiteral("INSERT INTO Secrets (SecretName) VALUES ('secret');")
+            << QStringLiteral("INSERT INTO SecretsFilterData (SecretName, Field, Value)"
+                              " VALUES ('secret', 'Domain', 'Example.COM');")
+            << QStringLiteral("INSERT INTO SecretsFilterData (SecretName, Field, Value)"
+                              " VALUES ('secret', 'Note', NULL);")
+            << QStringLiteral("PRAGMA user_version=1;")));
+
+    Sqlite::Database db;
+    QVERIFY(openSqlCipherPluginDatabase(&db, TestDatabaseSubdir, QStringLiteral("collection.db"),
+                                        TestHexKey, QStringLiteral("tst_schemaupgrade-sqlcipher")));
+    QSqlDatabase &database(db);
+    QCOMPARE(schemaVersion(database), 2);
+    QVERIFY(indexExists(database, QStringLiteral("SecretsFilterDataMatchIndex")));
+    QCOMPARE(filterDataMatchKeys(database),
+             QStringList() << QStringLiteral("domain") << QStringLiteral("example.com")
+                           << QStringLiteral("note") << QString());
+    db.close();
+}
+
+void tst_schemaupgrade::metadataVersion1()
+{
+    // the version 1 schema had no collection key derivation parameters.
+    QVERIFY(createDatabase(QStringLiteral("QSQLCIPHER"),
+                           databaseDirPath(TestDatabaseSubdir) + QStringLiteral("metadata.db"),
+                           TestHexKey,
+                           QStringList()
+            << QStringLiteral("CREATE TABLE Collections ("
+                              " CollectionId INTEGER PRIMARY KEY AUTOINCREMENT,"
+                              " CollectionName TEXT NOT NULL,"
+                              " ApplicationId TEXT NOT NULL,"
+                              " UsesDeviceLockKey INTEGER NOT NULL,"
+                              " EncryptionPluginName TEXT NOT NULL,"
+                              " AuthenticationPluginName TEXT NOT NULL,"
+                              " UnlockSemantic INTEGER NOT NULL,"
+                              " AccessControlMode INTEGER NOT NULL,"
+                              " CONSTRAINT collectionNameUnique UNIQUE (CollectionName));")
+            << QStringLiteral("CREATE TABLE Secrets ("
+                              " SecretId INTEGER PRIMARY KEY AUTOINCREMENT,"
+                              " CollectionName TEXT NOT NULL,"
+                              " SecretName TEXT NOT NULL,"
+                              " ApplicationId TEXT NOT NULL,"
+                              " UsesDeviceLockKey INTEGER NOT NULL,"
+                              " EncryptionPluginName TEXT NOT NULL,"
+                              " AuthenticationPluginName TEXT NOT NULL,"
+                              " UnlockSemantic INTEGER NOT NULL,"
+                              " AccessControlMode INTEGER NOT NULL,"
+                              " Type Text,"
+                              " CryptoPluginName TEXT,"
+                              " FOREIGN KEY (CollectionName) REFERENCES Collections(CollectionName) ON DELETE CASCADE,"
+                              " CONSTRAINT collectionSecretNameUnique UNIQUE (CollectionName, SecretName));")
+            << QStringLiteral("INSERT INTO Collections (CollectionName, ApplicationId, UsesDeviceLockKey,"
+                              " EncryptionPluginName, AuthenticationPluginName, UnlockSemantic, AccessControlMode)"
+                              " VALUES ('standalone', 'standalone', 0, 'standalone', 'standalone', 0, 0);")
+            << QStringLiteral("PRAGMA user_version=1;")));
+
+    Sqlite::Database db;
+    QVERIFY(openMetadataDatabase(&db, TestDatabaseSubdir, TestHexKey, QStringLiteral("tst_schemaupgrade-metadata")));
+    QSqlDatabase &database(db);
+    QCOMPARE(schemaVersion(database), 2);
+    QVERIFY(columnNames(database, QStringLiteral("Collections")).contains(QStringLiteral("KeyDerivationParameters")));
+
+    QSqlQuery query(database);
+    QVERIFY(query.exec(QStringLiteral("SELECT CollectionName, KeyDerivationParameters FROM Collections")));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toString(), QStringLiteral("standalone"));
+    QVERIFY(query.value(1).isNull());
+    query.finish();
+    db.close();
+}
+
+QTEST_MAIN(tst_schemaupgrade)
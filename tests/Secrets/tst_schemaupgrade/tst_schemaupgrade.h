@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Chris Adams <chris.adams@jollamobile.com>
+ * All rights reserved.
+ * BSD 3-Clause License, see LICENSE.
+ */
+
+#include <QtTest>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QByteArray>
+
+#include "database_p.h"
+
+// Open a database with the schema defined by a storage plugin or by the
+// daemon's metadata database, upgrading it to the current schema version.
+bool openSqlitePluginDatabase(Sailfish::Secrets::Daemon::Sqlite::Database *db,
+                              const QString &databaseSubdir,
+                              const QString &connectionName);
+bool openSqlCipherPluginDatabase(Sailfish::Secrets::Daemon::Sqlite::Database *db,
+                                 const QString &databaseSubdir,
+                                 const QString &databaseFilename,
+                                 const QByteArray &hexKey,
+                                 const QString &connectionName);
+bool openMetadataDatabase(Sailfish::Secrets::Daemon::Sqlite::Database *db,
+                          const QString &databaseSubdir,
+                          const QByteArray &hexKey,
+                          const QString &connectionName);
+
+class tst_schemaupgrade : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void init();
+    void cleanup();
+
+private slots:
+    void sqlitePluginVersion1();
+    void sqlCipherPluginVersion1();
+    void metadataVersion1();
+
+private:
+    QString databaseDirPath(const QString &databaseSubdir) const;
+    bool createDatabase(const QString &driver,
+                        const QString &filePath,
+                        const QByteArray &hexKey,
+                        const QStringList &statements);
+};
@@ -0,0 +1,30 @@
+TEMPLATE = app
+TARGET = tst_schemaupgrade
+target.path = /opt/tests/Sailfish/Secrets/
+QT += testlib sql
+QT -= gui
+
+include($$PWD/../../../lib/libsailfishsecrets.pri)
+include($$PWD/../../../lib/libsailfishcrypto.pri)
+include($$PWD/../../../database/database.pri)
+
+INCLUDEPATH += \
+    $$PWD/../../../plugins/sqliteplugin \
+    $$PWD/../../../plugins/sqlcipherplugin \
+    $$PWD/../../../daemon/SecretsImpl
+DEPENDPATH += $$INCLUDEPATH
+
+HEADERS += \
+    $$PWD/../../../plugins/sqliteplugin/sqlitedatabase_p.h \
+    $$PWD/../../../plugins/sqlcipherplugin/sqlcipherdatabase_p.h \
+    $$PWD/../../../daemon/SecretsImpl/metadatadbschema_p.h \
+    tst_schemaupgrade.h
+
+# each schema is defined by file-static statements, so is opened from its own source file.
+SOURCES += \
+    sqliteschema.cpp \
+    sqlcipherschema.cpp \
+    metadataschema.cpp \
+    tst_schemaupgrade.cpp
+
+INSTALLS += target
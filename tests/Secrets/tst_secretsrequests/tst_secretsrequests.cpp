@@ -15,8 +15,11 @@
 #include "Secrets/secretmanager.h"
 #include "Secrets/secret.h"
 #include "Secrets/interactionparameters.h"
+#include "Secrets/batchrequest.h"
+#include "Secrets/collectionarchiverequest.h"
 #include "Secrets/collectionnamesrequest.h"
 #include "Secrets/createcollectionrequest.h"
+#include "Secrets/daemonstatisticsrequest.h"
 #include "Secrets/deletecollectionrequest.h"
 #include "Secrets/deletesecretrequest.h"
 #include "Secrets/findsecretsrequest.h"
@@ -53,16 +56,20 @@ public slots:
 
 private slots:
     void getPluginInfo();
+    void getDaemonStatistics();
 
     void devicelockCollection();
     void devicelockCollectionSecret();
     void devicelockStandaloneSecret();
+    void devicelockCollectionSecretBatch();
+    void devicelockCollectionSecretConcurrent();
 
     void customlockCollection();
     void customlockCollectionSecret();
     void customlockStandaloneSecret();
 
     void encryptedStorageCollection();
+    void collectionArchive();
 
     void storeUserSecret();
 
@@ -140,6 +147,43 @@ void tst_secretsrequests::getPluginInfo()
     QVERIFY(authenticationPluginNames.contains(QStringLiteral("org.sailfishos.secrets.plugin.authentication.inapp.test")));
 }
 
+void tst_secretsrequests::getDaemonStatistics()
+{
+    // ensure that at least one request has completed.
+    PluginInfoRequest pir;
+    pir.setManager(&sm);
+    pir.startRequest();
+    pir.waitForFinished();
+    QCOMPARE(pir.result().code(), Result::Succeeded);
+
+    DaemonStatisticsRequest r;
+    r.setManager(&sm);
+    QSignalSpy ss(&r, &DaemonStatisticsRequest::statusChanged);
+    QSignalSpy sts(&r, &DaemonStatisticsRequest::statisticsChanged);
+    QCOMPARE(r.status(), Request::Inactive);
+    r.startRequest();
+    QCOMPARE(ss.count(), 1);
+    QCOMPARE(r.status(), Request::Active);
+    QCOMPARE(r.result().code(), Result::Pending);
+    r.waitForFinished();
+    QCOMPARE(ss.count(), 2);
+    QCOMPARE(r.status(), Request::Finished);
+    QCOMPARE(r.result().code(), Result::Succeeded);
+    QCOMPARE(sts.count(), 1);
+
+    const QVariantMap statistics = r.statistics();
+    QVERIFY(statistics.contains(QStringLiteral("plugins")));
+    QVERIFY(statistics.contains(QStringLiteral("threadPools")));
+    QVERIFY(statistics.value(QStringLiteral("crypto")).toMap().contains(QStringLiteral("queue")));
+
+    const QVariantMap requestTypes = statistics.value(QStringLiteral("secrets")).toMap()
+                                               .value(QStringLiteral("requestTypes")).toMap();
+    const QVariantMap pluginInfoStatistics = requestTypes.value(QStringLiteral("GetPluginInfoRequest")).toMap();
+    QVERIFY(pluginInfoStatistics.value(QStringLiteral("completed")).toULongLong() >= 1);
+    QVERIFY(pluginInfoStatistics.contains(QStringLiteral("averageQueueWaitUs")));
+    QVERIFY(pluginInfoStatistics.contains(QStringLiteral("averageExecutionTimeUs")));
+}
+
 void tst_secretsrequests::devicelockCollection()
 {
     // create a new collection
@@ -392,6 +436,173 @@ void tst_secretsrequests::devicelockCollectionSecret()
 }
 
 
+void tst_secretsrequests::devicelockCollectionSecretBatch()
+{
+    // create a collection
+    CreateCollectionRequest ccr;
+    ccr.setManager(&sm);
+    ccr.setCollectionLockType(CreateCollectionRequest::DeviceLock);
+    ccr.setCollectionName(QLatin1String("testcollection"));
+    ccr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    ccr.setEncryptionPluginName(DEFAULT_TEST_ENCRYPTION_PLUGIN);
+    ccr.setDeviceLockUnlockSemantic(SecretManager::DeviceLockKeepUnlocked);
+    ccr.setAccessControlMode(SecretManager::OwnerOnlyMode);
+    ccr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(ccr);
+    QCOMPARE(ccr.result().code(), Result::Succeeded);
+
+    // store several secrets into the collection in a single batch
+    QVector<Secret> testSecrets;
+    for (int i = 0; i < 3; ++i) {
+        Secret testSecret(Secret::Identifier(
+                            QStringLiteral("testsecretname%1").arg(i),
+                            QLatin1String("testcollection"),
+                            DEFAULT_TEST_STORAGE_PLUGIN));
+        testSecret.setData(QStringLiteral("testsecretvalue%1").arg(i).toUtf8());
+        testSecret.setType(Secret::TypeBlob);
+        testSecrets.append(testSecret);
+    }
+
+    BatchRequest sbr;
+    sbr.setManager(&sm);
+    QSignalSpy sbrss(&sbr, &BatchRequest::statusChanged);
+    sbr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    QCOMPARE(sbr.userInteractionMode(), SecretManager::ApplicationInteraction);
+    for (const Secret &testSecret : testSecrets) {
+        sbr.addStoreSecretOperation(testSecret);
+    }
+    QCOMPARE(sbr.operationCount(), testSecrets.size());
+    QCOMPARE(sbr.operationType(0), BatchRequest::StoreSecretOperation);
+    QCOMPARE(sbr.status(), Request::Inactive);
+    sbr.startRequest();
+    QCOMPARE(sbrss.count(), 1);
+    QCOMPARE(sbr.status(), Request::Active);
+    QCOMPARE(sbr.result().code(), Result::Pending);
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(sbr);
+    QCOMPARE(sbrss.count(), 2);
+    QCOMPARE(sbr.status(), Request::Finished);
+    QCOMPARE(sbr.result().code(), Result::Succeeded);
+    QCOMPARE(sbr.results().size(), testSecrets.size());
+    for (const Result &result : sbr.results()) {
+        QCOMPARE(result.code(), Result::Succeeded);
+    }
+
+    // retrieve and then delete the secrets, plus one which doesn't exist
+    Secret::Identifier missingIdentifier(QLatin1String("missingsecretname"),
+                                         QLatin1String("testcollection"),
+                                         DEFAULT_TEST_STORAGE_PLUGIN);
+    BatchRequest gbr;
+    gbr.setManager(&sm);
+    gbr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    for (const Secret &testSecret : testSecrets) {
+        gbr.addStoredSecretOperation(testSecret.identifier());
+    }
+    gbr.addStoredSecretOperation(missingIdentifier);
+    for (const Secret &testSecret : testSecrets) {
+        gbr.addDeleteSecretOperation(testSecret.identifier());
+    }
+    gbr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(gbr);
+    QCOMPARE(gbr.result().code(), Result::Succeeded);
+    QCOMPARE(gbr.results().size(), 2 * testSecrets.size() + 1);
+    QCOMPARE(gbr.secrets().size(), 2 * testSecrets.size() + 1);
+    for (int i = 0; i < testSecrets.size(); ++i) {
+        QCOMPARE(gbr.results().at(i).code(), Result::Succeeded);
+        QCOMPARE(gbr.secrets().at(i).data(), testSecrets.at(i).data());
+        QCOMPARE(gbr.results().at(testSecrets.size() + 1 + i).code(), Result::Succeeded);
+    }
+    QCOMPARE(gbr.results().at(testSecrets.size()).code(), Result::Failed);
+
+    // finally, clean up the collection
+    DeleteCollectionRequest dcr;
+    dcr.setManager(&sm);
+    dcr.setCollectionName(QLatin1String("testcollection"));
+    dcr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    dcr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    dcr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(dcr);
+    QCOMPARE(dcr.result().code(), Result::Succeeded);
+}
+
+void tst_secretsrequests::devicelockCollectionSecretConcurrent()
+{
+    // create a collection
+    CreateCollectionRequest ccr;
+    ccr.setManager(&sm);
+    ccr.setCollectionLockType(CreateCollectionRequest::DeviceLock);
+    ccr.setCollectionName(QLatin1String("testcollection"));
+    ccr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    ccr.setEncryptionPluginName(DEFAULT_TEST_ENCRYPTION_PLUGIN);
+    ccr.setDeviceLockUnlockSemantic(SecretManager::DeviceLockKeepUnlocked);
+    ccr.setAccessControlMode(SecretManager::OwnerOnlyMode);
+    ccr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(ccr);
+    QCOMPARE(ccr.result().code(), Result::Succeeded);
+
+    // start several store requests without waiting in between, so that
+    // the daemon can commit the queued writes together.  The last one
+    // duplicates the first secret and must fail on its own.
+    QVector<Secret> testSecrets;
+    for (int i = 0; i < 4; ++i) {
+        Secret testSecret(Secret::Identifier(
+                            QStringLiteral("testsecretname%1").arg(i),
+                            QLatin1String("testcollection"),
+                            DEFAULT_TEST_STORAGE_PLUGIN));
+        testSecret.setData(QStringLiteral("testsecretvalue%1").arg(i).toUtf8());
+        testSecret.setType(Secret::TypeBlob);
+        testSecrets.append(testSecret);
+    }
+    testSecrets.append(testSecrets.first());
+
+    QVector<QSharedPointer<StoreSecretRequest> > requests;
+    for (const Secret &testSecret : testSecrets) {
+        QSharedPointer<StoreSecretRequest> ssr(new StoreSecretRequest);
+        ssr->setManager(&sm);
+        ssr->setSecretStorageType(StoreSecretRequest::CollectionSecret);
+        ssr->setUserInteractionMode(SecretManager::ApplicationInteraction);
+        ssr->setSecret(testSecret);
+        ssr->startRequest();
+        requests.append(ssr);
+    }
+
+    int succeeded = 0;
+    int alreadyExists = 0;
+    for (const QSharedPointer<StoreSecretRequest> &ssr : requests) {
+        WAIT_FOR_FINISHED_WITHOUT_BLOCKING((*ssr));
+        QCOMPARE(ssr->status(), Request::Finished);
+        if (ssr->result().code() == Result::Succeeded) {
+            ++succeeded;
+        } else {
+            QCOMPARE(ssr->result().errorCode(), Result::SecretAlreadyExistsError);
+            ++alreadyExists;
+        }
+    }
+    QCOMPARE(succeeded, testSecrets.size() - 1);
+    QCOMPARE(alreadyExists, 1);
+
+    // retrieve the secrets, ensure they match
+    for (int i = 0; i < testSecrets.size() - 1; ++i) {
+        StoredSecretRequest gsr;
+        gsr.setManager(&sm);
+        gsr.setIdentifier(testSecrets.at(i).identifier());
+        gsr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+        gsr.startRequest();
+        WAIT_FOR_FINISHED_WITHOUT_BLOCKING(gsr);
+        QCOMPARE(gsr.result().code(), Result::Succeeded);
+        QCOMPARE(gsr.secret().data(), testSecrets.at(i).data());
+    }
+
+    // finally, clean up the collection
+    DeleteCollectionRequest dcr;
+    dcr.setManager(&sm);
+    dcr.setCollectionName(QLatin1String("testcollection"));
+    dcr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    dcr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    dcr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(dcr);
+    QCOMPARE(dcr.result().code(), Result::Succeeded);
+}
+
 void tst_secretsrequests::devicelockStandaloneSecret()
 {
     // write the secret
@@ -894,6 +1105,155 @@ void tst_secretsrequests::encryptedStorageCollection()
     QCOMPARE(dcr.result().code(), Result::Succeeded);
 }
 
+void tst_secretsrequests::collectionArchive()
+{
+    // create a collection
+    CreateCollectionRequest ccr;
+    ccr.setManager(&sm);
+    ccr.setCollectionLockType(CreateCollectionRequest::DeviceLock);
+    ccr.setCollectionName(QLatin1String("testarchivecollection"));
+    ccr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    ccr.setEncryptionPluginName(DEFAULT_TEST_ENCRYPTION_PLUGIN);
+    ccr.setDeviceLockUnlockSemantic(SecretManager::DeviceLockKeepUnlocked);
+    ccr.setAccessControlMode(SecretManager::OwnerOnlyMode);
+    ccr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(ccr);
+    QCOMPARE(ccr.status(), Request::Finished);
+    QCOMPARE(ccr.result().code(), Result::Succeeded);
+
+    // store some secrets into the collection
+    QVector<Secret> testSecrets;
+    for (int i = 0; i < 3; ++i) {
+        Secret testSecret(Secret::Identifier(
+                            QStringLiteral("testarchivesecret%1").arg(i),
+                            QLatin1String("testarchivecollection"),
+                            DEFAULT_TEST_STORAGE_PLUGIN));
+        testSecret.setData(QByteArray("testarchivesecretvalue") + QByteArray::number(i));
+        testSecret.setType(Secret::TypeBlob);
+        testSecret.setFilterData(QLatin1String("domain"), QLatin1String("sailfishos.org"));
+        testSecret.setFilterData(QLatin1String("index"), QString::number(i));
+        testSecrets.append(testSecret);
+
+        StoreSecretRequest ssr;
+        ssr.setManager(&sm);
+        ssr.setSecretStorageType(StoreSecretRequest::CollectionSecret);
+        ssr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+        ssr.setSecret(testSecret);
+        ssr.startRequest();
+        WAIT_FOR_FINISHED_WITHOUT_BLOCKING(ssr);
+        QCOMPARE(ssr.status(), Request::Finished);
+        QCOMPARE(ssr.result().code(), Result::Succeeded);
+    }
+
+    // export the collection to an archive file
+    QTemporaryFile archiveFile;
+    QVERIFY(archiveFile.open());
+
+    CollectionArchiveRequest car;
+    car.setManager(&sm);
+    QSignalSpy carss(&car, &CollectionArchiveRequest::statusChanged);
+    car.setOperation(CollectionArchiveRequest::ExportCollection);
+    QCOMPARE(car.operation(), CollectionArchiveRequest::ExportCollection);
+    car.setCollectionName(QLatin1String("testarchivecollection"));
+    QCOMPARE(car.collectionName(), QLatin1String("testarchivecollection"));
+    car.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    QCOMPARE(car.storagePluginName(), DEFAULT_TEST_STORAGE_PLUGIN);
+    car.setFileDescriptor(archiveFile.handle());
+    QCOMPARE(car.fileDescriptor(), archiveFile.handle());
+    car.setPassphrase(QByteArray("testarchivepassphrase"));
+    QCOMPARE(car.passphrase(), QByteArray("testarchivepassphrase"));
+    car.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    QCOMPARE(car.userInteractionMode(), SecretManager::ApplicationInteraction);
+    QCOMPARE(car.status(), Request::Inactive);
+    car.startRequest();
+    QCOMPARE(carss.count(), 1);
+    QCOMPARE(car.status(), Request::Active);
+    QCOMPARE(car.result().code(), Result::Pending);
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(car);
+    QCOMPARE(carss.count(), 2);
+    QCOMPARE(car.status(), Request::Finished);
+    QCOMPARE(car.result().code(), Result::Succeeded);
+    QVERIFY(archiveFile.size() > 0);
+
+    // the secret values must not appear in the archive in the clear
+    archiveFile.seek(0);
+    QVERIFY(!archiveFile.readAll().contains(QByteArray("testarchivesecretvalue")));
+
+    // delete the secrets from the collection
+    for (const Secret &testSecret : testSecrets) {
+        DeleteSecretRequest dsr;
+        dsr.setManager(&sm);
+        dsr.setIdentifier(testSecret.identifier());
+        dsr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+        dsr.startRequest();
+        WAIT_FOR_FINISHED_WITHOUT_BLOCKING(dsr);
+        QCOMPARE(dsr.status(), Request::Finished);
+        QCOMPARE(dsr.result().code(), Result::Succeeded);
+    }
+
+    // importing with the wrong passphrase should fail without storing any secret
+    car.setOperation(CollectionArchiveRequest::ImportCollection);
+    car.setPassphrase(QByteArray("wrongarchivepassphrase"));
+    car.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(car);
+    QCOMPARE(car.status(), Request::Finished);
+    QCOMPARE(car.result().code(), Result::Failed);
+    QCOMPARE(car.result().errorCode(), Result::IncorrectAuthenticationCodeError);
+
+    StoredSecretRequest gsr;
+    gsr.setManager(&sm);
+    gsr.setIdentifier(testSecrets.first().identifier());
+    gsr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    gsr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(gsr);
+    QCOMPARE(gsr.status(), Request::Finished);
+    QCOMPARE(gsr.result().code(), Result::Failed);
+
+    // importing with the correct passphrase should restore the secrets
+    car.setPassphrase(QByteArray("testarchivepassphrase"));
+    car.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(car);
+    QCOMPARE(car.status(), Request::Finished);
+    QCOMPARE(car.result().code(), Result::Succeeded);
+
+    for (const Secret &testSecret : testSecrets) {
+        gsr.setIdentifier(testSecret.identifier());
+        gsr.startRequest();
+        WAIT_FOR_FINISHED_WITHOUT_BLOCKING(gsr);
+        QCOMPARE(gsr.status(), Request::Finished);
+        QCOMPARE(gsr.result().code(), Result::Succeeded);
+        QCOMPARE(gsr.secret().data(), testSecret.data());
+        QCOMPARE(gsr.secret().type(), testSecret.type());
+        QCOMPARE(gsr.secret().filterData(), testSecret.filterData());
+    }
+
+    // importing the archive again should fail, as the secrets already exist
+    car.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(car);
+    QCOMPARE(car.status(), Request::Finished);
+    QCOMPARE(car.result().code(), Result::Failed);
+    QCOMPARE(car.result().errorCode(), Result::SecretAlreadyExistsError);
+
+    // a truncated archive should be rejected
+    QVERIFY(archiveFile.resize(archiveFile.size() - 1));
+    car.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(car);
+    QCOMPARE(car.status(), Request::Finished);
+    QCOMPARE(car.result().code(), Result::Failed);
+    QCOMPARE(car.result().errorCode(), Result::SerializationError);
+
+    // clean up the collection
+    DeleteCollectionRequest dcr;
+    dcr.setManager(&sm);
+    dcr.setCollectionName(QLatin1String("testarchivecollection"));
+    dcr.setStoragePluginName(DEFAULT_TEST_STORAGE_PLUGIN);
+    dcr.setUserInteractionMode(SecretManager::ApplicationInteraction);
+    dcr.startRequest();
+    WAIT_FOR_FINISHED_WITHOUT_BLOCKING(dcr);
+    QCOMPARE(dcr.status(), Request::Finished);
+    QCOMPARE(dcr.result().code(), Result::Succeeded);
+}
+
 void tst_secretsrequests::storeUserSecret()
 {
     // construct the in-process authentication key UI.
@@ -22,12 +22,16 @@ DEPENDPATH += \
 
 HEADERS += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator_p.h \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_helpers_p.h \
     $$PWD/../../../plugins/opensslcryptoplugin/opensslcryptoplugin.h \
     $$PWD/../../../plugins/exampleusbtokenplugin/exampleusbtokenplugin.h
 
 SOURCES += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator.cpp \
     $$PWD/../../../plugins/opensslcryptoplugin/opensslcryptoplugin.cpp \
     $$PWD/../../../plugins/exampleusbtokenplugin/exampleusbtokenplugin.cpp \
     $$PWD/../../../plugins/exampleusbtokenplugin/encryptedstorageplugin.cpp \
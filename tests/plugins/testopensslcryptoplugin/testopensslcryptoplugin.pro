@@ -15,10 +15,14 @@ DEPENDPATH += $$PWD/../../../plugins/opensslcryptoplugin/evp/
 
 HEADERS += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator_p.h \
     $$PWD/../../../plugins/opensslcryptoplugin/opensslcryptoplugin.h
 
 SOURCES += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator.cpp \
     $$PWD/../../../plugins/opensslcryptoplugin/opensslcryptoplugin.cpp
 
 target.path=/usr/lib/Sailfish/Crypto/
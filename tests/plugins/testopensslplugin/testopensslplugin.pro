@@ -4,6 +4,12 @@ TARGET = sailfishsecrets-testopenssl
 TARGET = $$qtLibraryTarget($$TARGET)
 PKGCONFIG += libcrypto
 
+# Argon2id key derivation is available if libargon2 is installed.
+packagesExist(libargon2) {
+    PKGCONFIG += libargon2
+    DEFINES += SAILFISH_SECRETS_HAVE_ARGON2
+}
+
 include($$PWD/../../../common.pri)
 include($$PWD/../../../lib/libsailfishsecrets.pri)
 
@@ -14,10 +20,12 @@ DEPENDPATH += $$PWD/../../../plugins/opensslcryptoplugin/evp/
 
 HEADERS += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keyderivation_p.h \
     $$PWD/../../../plugins/opensslplugin/plugin.h
 
 SOURCES += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keyderivation.cpp \
     $$PWD/../../../plugins/opensslplugin/plugin.cpp
 
 target.path=/usr/lib/Sailfish/Secrets/
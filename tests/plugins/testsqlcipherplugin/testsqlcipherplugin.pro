@@ -4,6 +4,12 @@ TARGET = sailfishsecrets-testsqlcipher
 TARGET = $$qtLibraryTarget($$TARGET)
 PKGCONFIG += libcrypto
 
+# Argon2id key derivation is available if libargon2 is installed.
+packagesExist(libargon2) {
+    PKGCONFIG += libargon2
+    DEFINES += SAILFISH_SECRETS_HAVE_ARGON2
+}
+
 include($$PWD/../../../common.pri)
 include($$PWD/../../../lib/libsailfishsecrets.pri)
 include($$PWD/../../../lib/libsailfishcrypto.pri)
@@ -22,12 +28,19 @@ DEPENDPATH += \
 
 HEADERS += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator_p.h \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keyderivation_p.h \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp_helpers_p.h \
     $$PWD/../../../plugins/opensslcryptoplugin/opensslcryptoplugin.h \
+    $$PWD/../../../plugins/sqlcipherplugin/sqlcipherdatabase_p.h \
     $$PWD/../../../plugins/sqlcipherplugin/sqlcipherplugin.h
 
 SOURCES += \
     $$PWD/../../../plugins/opensslcryptoplugin/evp/evp.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keycache.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/randomgenerator.cpp \
+    $$PWD/../../../plugins/opensslcryptoplugin/evp/keyderivation.cpp \
     $$PWD/../../../plugins/opensslcryptoplugin/opensslcryptoplugin.cpp \
     $$PWD/../../../plugins/sqlcipherplugin/sqlcipherplugin.cpp \
     $$PWD/../../../plugins/sqlcipherplugin/encryptedstorageplugin.cpp \
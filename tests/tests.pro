@@ -5,5 +5,6 @@ SUBDIRS = \
     $$PWD/Crypto \
     $$PWD/Secrets \
     $$PWD/SecretsCrypto \
+    $$PWD/Benchmarks \
     $$PWD/qml \
     $$PWD/scripts
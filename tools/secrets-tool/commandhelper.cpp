@@ -12,11 +12,13 @@
 #include <Secrets/collectionnamesrequest.h>
 #include <Secrets/createcollectionrequest.h>
 #include <Secrets/deletecollectionrequest.h>
+#include <Secrets/collectionarchiverequest.h>
 #include <Secrets/storesecretrequest.h>
 #include <Secrets/storedsecretrequest.h>
 #include <Secrets/deletesecretrequest.h>
 #include <Secrets/interactionrequest.h>
 #include <Secrets/healthcheckrequest.h>
+#include <Secrets/daemonstatisticsrequest.h>
 
 #include <Crypto/interactionparameters.h>
 #include <Crypto/keypairgenerationparameters.h>
@@ -39,6 +41,25 @@
 #define EXITCODE_SUCCESS 0
 #define EXITCODE_FAILED 1
 
+static void printStatistics(const QVariantMap &statistics, int indent)
+{
+    const QString prefix(indent * 4, QLatin1Char(' '));
+    for (QVariantMap::const_iterator it = statistics.constBegin(); it != statistics.constEnd(); ++it) {
+        if (it.value().type() == QVariant::Map) {
+            qInfo().noquote() << prefix + it.key() + QStringLiteral(":");
+            printStatistics(it.value().toMap(), indent + 1);
+        } else if (it.value().type() == QVariant::List) {
+            QStringList values;
+            for (const QVariant &value : it.value().toList()) {
+                values.append(value.toString());
+            }
+            qInfo().noquote() << prefix + it.key() + QStringLiteral(":") << values.join(QStringLiteral(" "));
+        } else {
+            qInfo().noquote() << prefix + it.key() + QStringLiteral(":") << it.value().toString();
+        }
+    }
+}
+
 static Sailfish::Crypto::CryptoManager::Algorithm algorithmEnum(const QString &algo)
 {
     if (algo == QStringLiteral("RSA")) {
@@ -317,6 +338,30 @@ void CommandHelper::start(const QString &command, const QStringList &args, const
         connect(m_secretsRequest.data(), &Sailfish::Secrets::Request::statusChanged,
                 this, &CommandHelper::secretsRequestStatusChanged);
         m_secretsRequest->startRequest();
+    } else if (command == QStringLiteral("--export-collection")
+            || command == QStringLiteral("--import-collection")) {
+        const bool exporting = command == QStringLiteral("--export-collection");
+        m_archiveFile.reset(new QFile(args.value(2)));
+        if (!m_archiveFile->open(exporting ? (QIODevice::WriteOnly | QIODevice::Truncate)
+                                           : QIODevice::ReadOnly)) {
+            qInfo() << "Unable to open archive file:" << args.value(2);
+            emitFinished(EXITCODE_FAILED);
+            return;
+        }
+        // the file remains open until the request has finished.
+        Sailfish::Secrets::CollectionArchiveRequest *r = new Sailfish::Secrets::CollectionArchiveRequest;
+        r->setOperation(exporting ? Sailfish::Secrets::CollectionArchiveRequest::ExportCollection
+                                  : Sailfish::Secrets::CollectionArchiveRequest::ImportCollection);
+        r->setStoragePluginName(args.value(0));
+        r->setCollectionName(args.value(1));
+        r->setFileDescriptor(m_archiveFile->handle());
+        r->setPassphrase(args.value(3).toUtf8());
+        r->setUserInteractionMode(Sailfish::Secrets::SecretManager::SystemInteraction);
+        m_secretsRequest.reset(r);
+        m_secretsRequest->setManager(&m_secretManager);
+        connect(m_secretsRequest.data(), &Sailfish::Secrets::Request::statusChanged,
+                this, &CommandHelper::secretsRequestStatusChanged);
+        m_secretsRequest->startRequest();
     } else if (command == QStringLiteral("--list-secrets")) {
         qInfo() << "This command is not yet implemented";
         emitFinished(EXITCODE_FAILED);
@@ -861,6 +906,13 @@ void CommandHelper::start(const QString &command, const QStringList &args, const
         connect(m_secretsRequest.data(), &Sailfish::Secrets::Request::statusChanged,
                 this, &CommandHelper::secretsRequestStatusChanged);
         m_secretsRequest->startRequest();
+    } else if (command == QStringLiteral("--stats")) {
+        Sailfish::Secrets::DaemonStatisticsRequest *r = new Sailfish::Secrets::DaemonStatisticsRequest;
+        m_secretsRequest.reset(r);
+        m_secretsRequest->setManager(&m_secretManager);
+        connect(m_secretsRequest.data(), &Sailfish::Secrets::Request::statusChanged,
+                this, &CommandHelper::secretsRequestStatusChanged);
+        m_secretsRequest->startRequest();
     } else {
         qInfo() << "Unknown command:" << command;
         emitFinished(EXITCODE_FAILED);
@@ -899,6 +951,10 @@ void CommandHelper::secretsRequestStatusChanged()
         Sailfish::Secrets::HealthCheckRequest *r = qobject_cast<Sailfish::Secrets::HealthCheckRequest*>(m_secretsRequest.data());
         qInfo() << "Salt data health:" << r->saltDataHealth();
         qInfo() << "Masterlock health:" << r->masterlockHealth();
+    } else if (m_command == QStringLiteral("--stats")) {
+        Sailfish::Secrets::DaemonStatisticsRequest *r = qobject_cast<Sailfish::Secrets::DaemonStatisticsRequest*>(m_secretsRequest.data());
+        qInfo() << "Daemon statistics (durations ending in Us are microseconds, histogram buckets are <100us <1ms <10ms <100ms <1s >=1s):";
+        printStatistics(r->statistics(), 1);
     }
 
     emitFinished(EXITCODE_SUCCESS);
@@ -12,6 +12,7 @@
 #include <QtCore/QStringList>
 #include <QtCore/QString>
 #include <QtCore/QScopedPointer>
+#include <QtCore/QFile>
 
 #include <Secrets/secretmanager.h>
 #include <Secrets/request.h>
@@ -39,6 +40,7 @@ private:
     void emitFinished(int exitCode);
     QScopedPointer<Sailfish::Secrets::Request> m_secretsRequest;
     QScopedPointer<Sailfish::Crypto::Request> m_cryptoRequest;
+    QScopedPointer<QFile> m_archiveFile;
     Sailfish::Secrets::SecretManager m_secretManager;
     Sailfish::Crypto::CryptoManager m_cryptoManager;
     QStringList m_authenticationPlugins;
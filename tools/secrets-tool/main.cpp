@@ -56,6 +56,8 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--list-collections", "List available collections (of secrets or keys) stored by a given storage plugin" },
         {"--create-collection", "Create a collection in a particular storage plugin, encrypted by a particular encryption plugin"},
         {"--delete-collection", "Delete a collection from a storage plugin" },
+        {"--export-collection", "Export the secrets of a collection to a passphrase-protected archive file" },
+        {"--import-collection", "Import the secrets of a passphrase-protected archive file into an existing collection" },
         {"--list-secrets", "List the secrets stored by a storage plugin, optionally limited to a single collection" },
         {"--store-standalone-secret", "Store a standalone secret in a particular storage plugin, encrypted by a particular encryption plugin" },
         {"--store-collection-secret", "Store a secret in a particular collection" },
@@ -74,12 +76,15 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--decrypt", "Decrypt a particular file with the specified key, output to stdout" },
         {"--get-user-input", "Request user input via system dialog" },
         {"--health-check", "Check the health of secrets daemon data" },
+        {"--stats", "Show request latency, plugin latency and queue statistics of the secrets daemon" },
     };
 
     const QMap<QString, QString> paramOptions {
         {"--list-collections", "<storagePlugin>" },
         {"--create-collection", "[--devicelock] [--keep-unlocked] <storagePlugin> <collectionName> [<encryptionPlugin>]"},
         {"--delete-collection", "<storagePlugin> <collectionName>" },
+        {"--export-collection", "<storagePlugin> <collectionName> <archiveFile> <passphrase>" },
+        {"--import-collection", "<storagePlugin> <collectionName> <archiveFile> <passphrase>" },
         {"--list-secrets", "<storagePlugin> [<collectionName>]" },
         {"--store-standalone-secret", "[--devicelock] [--keep-unlocked] <storagePlugin> <encryptionPlugin> <secretName> [<secretData>]" },
         {"--store-collection-secret", "<storagePlugin> <collectionName> <secretName> [<secretData>]" },
@@ -98,6 +103,7 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--decrypt", "<cryptoPlugin> <storagePlugin> <collectionName> <keyName> <fileName>" },
         {"--get-user-input", "" },
         {"--health-check", "" },
+        {"--stats", "" },
     };
 
     const QMap<QString, int> paramOptionsMin {
@@ -107,6 +113,8 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--list-collections", 1 },
         {"--create-collection", 2 },
         {"--delete-collection", 2 },
+        {"--export-collection", 4 },
+        {"--import-collection", 4 },
         {"--list-secrets", 1 },
         {"--store-standalone-secret", 3 },
         {"--store-collection-secret", 3 },
@@ -125,6 +133,7 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--decrypt", 5 },
         {"--get-user-input", 0 },
         {"--health-check", 0 },
+        {"--stats", 0 },
     };
 
     const QMap<QString, int> paramOptionsMax {
@@ -134,6 +143,8 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--list-collections", 1 },
         {"--create-collection", 5 },
         {"--delete-collection", 2 },
+        {"--export-collection", 4 },
+        {"--import-collection", 4 },
         {"--list-secrets", 2 },
         {"--store-standalone-secret", 6 },
         {"--store-collection-secret", 4 },
@@ -152,6 +163,7 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--decrypt", 5 },
         {"--get-user-input", 0 },
         {"--health-check", 0 },
+        {"--stats", 0 },
     };
 
     const QMap<QString, QString> paramExamples {
@@ -161,6 +173,8 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--list-collections", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher" },
         {"--create-collection", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection" },
         {"--delete-collection", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection" },
+        {"--export-collection", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection MyCollection.archive MyArchivePassphrase" },
+        {"--import-collection", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection MyCollection.archive MyArchivePassphrase" },
         {"--list-secrets", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection" },
         {"--store-standalone-secret", "org.sailfishos.secrets.plugin.storage.sqlite org.sailfishos.secrets.plugin.encryption.openssl MyStandaloneSecret" },
         {"--store-collection-secret", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection MyCollectionSecret" },
@@ -179,6 +193,7 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         {"--decrypt", "org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher org.sailfishos.secrets.plugin.encryptedstorage.sqlcipher MyCollection MyAesKey document.txt.enc > document.txt.dec" },
         {"--get-user-input", "" },
         {"--health-check", "" },
+        {"--stats", "" },
     };
 
     bool autotestMode = false;